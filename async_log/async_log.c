@@ -0,0 +1,429 @@
+/**
+ * @file async_log.c
+ * @brief Implementation of the asynchronous, async-signal-safe logger.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "async_log.h"
+#include "../futex/futex.h"
+#include "../ring_registry/ring_registry.h"
+
+/**
+ * @brief Size of the buffer the drain thread fills before each `write`.
+ */
+#define LOG_BATCH_BYTES 4096
+
+/**
+ * @brief One buffered message.
+ */
+typedef struct {
+    uint64_t sequence;              /**< Position of the message in its ring plus one, once it is complete. */
+    uint32_t length;                /**< Length of `text`. */
+    char text[LOG_LINE_MAX];        /**< The message, ending with a newline. */
+} log_record_t;
+
+/**
+ * @brief Ring of one thread, drained by the drain thread; see `ring_registry.h` for the protocol.
+ */
+typedef struct {
+    ring_header_t header;                       /**< Positions, link and drop counter. */
+    _Alignas(64) log_record_t records[LOG_RING_SIZE];  /**< The messages. */
+} log_ring_t;
+
+/**
+ * @brief Messages the drain thread is batching into one `write`.
+ */
+typedef struct {
+    int fd;                                     /**< Descriptor written to. */
+    size_t length;                              /**< Bytes of `batch` in use. */
+    char batch[LOG_BATCH_BYTES];                /**< The messages. */
+} log_batch_t;
+
+/**
+ * @brief Descriptor of the running logger, or -1 while messages are written directly.
+ */
+static _Atomic int log_fd = -1;
+
+/**
+ * @brief Rings of every thread that logged or registered.
+ */
+static ring_registry_t rings = RING_REGISTRY_INITIALIZER(log_ring_t);
+
+/**
+ * @brief Ring of the calling thread.
+ */
+static __thread log_ring_t *own_ring = NULL;
+
+/**
+ * @brief Drain thread, the futex word it sleeps on and the flag that keeps it running.
+ */
+static pthread_t drain_thread;
+static _Atomic uint32_t drain_wakeups = 0;
+static _Atomic uint32_t drain_running = 0;
+static _Atomic uint32_t exit_hook = 0;
+
+/**
+ * @brief Appends a string to a message.
+ * @return Returns the new length.
+ */
+static size_t append_text(char *out, size_t length, size_t size, const char *text)
+{
+    while (*text != '\0' && length < size)
+    {
+        out[length++] = *text++;
+    }
+    return length;
+}
+
+/**
+ * @brief Appends an unsigned number to a message.
+ * @return Returns the new length.
+ */
+static size_t append_number(char *out, size_t length, size_t size, unsigned long long value, unsigned int base)
+{
+    char digits[24];
+    int count = 0;
+
+    do
+    {
+        digits[count++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value != 0);
+
+    while (count > 0 && length < size)
+    {
+        out[length++] = digits[--count];
+    }
+    return length;
+}
+
+/**
+ * @brief Formats a message without `stdio`, so it can run in a signal handler.
+ * @param out The buffer.
+ * @param size The size of the buffer.
+ * @param format The format, see `async_log_write`.
+ * @param args The arguments.
+ * @return Returns the length of the message, truncated to `size`.
+ */
+static size_t format_message(char *out, size_t size, const char *format, va_list args)
+{
+    size_t length = 0;
+
+    for (; *format != '\0' && length < size; format++)
+    {
+        int longs = 0, size_t_arg = 0;
+        unsigned long long value;
+
+        if (*format != '%')
+        {
+            out[length++] = *format;
+            continue;
+        }
+
+        /* Size modifiers */
+        for (format++; *format == 'l' || *format == 'z'; format++)
+        {
+            longs += (*format == 'l');
+            size_t_arg |= (*format == 'z');
+        }
+
+        switch (*format)
+        {
+        case 'd':
+        case 'i':
+        {
+            long long signed_value = size_t_arg ? (long long)va_arg(args, ptrdiff_t) :
+                                     longs >= 2 ? va_arg(args, long long) :
+                                     longs == 1 ? va_arg(args, long) : va_arg(args, int);
+            if (signed_value < 0)
+            {
+                length = append_text(out, length, size, "-");
+                value = 0ULL - (unsigned long long)signed_value;
+            }
+            else
+            {
+                value = (unsigned long long)signed_value;
+            }
+            length = append_number(out, length, size, value, 10);
+            break;
+        }
+
+        case 'u':
+        case 'x':
+            value = size_t_arg ? va_arg(args, size_t) :
+                    longs >= 2 ? va_arg(args, unsigned long long) :
+                    longs == 1 ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+            length = append_number(out, length, size, value, *format == 'u' ? 10 : 16);
+            break;
+
+        case 'p':
+            length = append_text(out, length, size, "0x");
+            length = append_number(out, length, size, (uintptr_t)va_arg(args, void *), 16);
+            break;
+
+        case 's':
+        {
+            const char *text = va_arg(args, const char *);
+            length = append_text(out, length, size, text != NULL ? text : "(null)");
+            break;
+        }
+
+        case 'c':
+            out[length++] = (char)va_arg(args, int);
+            break;
+
+        case '%':
+            out[length++] = '%';
+            break;
+
+        default:
+            /* Unsupported conversion: print it as is */
+            length = append_text(out, length, size, "%?");
+            if (*format == '\0')
+            {
+                return length;
+            }
+            break;
+        }
+    }
+
+    return length;
+}
+
+/**
+ * @brief Writes a whole buffer, retrying after partial writes and interruptions.
+ */
+static void write_all(int fd, const char *buffer, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, buffer, length);
+        if (written <= 0)
+        {
+            return;
+        }
+        buffer += written;
+        length -= (size_t)written;
+    }
+}
+
+/**
+ * @brief Allocates the ring of the calling thread and adds it to the registry.
+ * @return Returns the ring, or `NULL` if it cannot be allocated.
+ */
+static log_ring_t *create_ring(void)
+{
+    log_ring_t *ring = (log_ring_t *)ring_registry_attach(&rings);
+
+    if (ring != NULL)
+    {
+        own_ring = ring;
+    }
+    return ring;
+}
+
+/**
+ * @brief Appends a message to a batch, writing the batch out first if the message does not fit.
+ * @param batch The batch.
+ * @param text The message.
+ * @param length The length of the message.
+ */
+static void batch_append(log_batch_t *batch, const char *text, size_t length)
+{
+    if (batch->length + length > sizeof(batch->batch))
+    {
+        write_all(batch->fd, batch->batch, batch->length);
+        batch->length = 0;
+    }
+    memcpy(batch->batch + batch->length, text, length);
+    batch->length += length;
+}
+
+/**
+ * @brief Moves the published messages of a ring to the batch, followed by a note of the messages dropped.
+ * @param base The ring.
+ * @param context The `log_batch_t`.
+ */
+static void drain_ring(ring_header_t *base, void *context)
+{
+    log_ring_t *ring = (log_ring_t *)base;
+    log_batch_t *batch = (log_batch_t *)context;
+    uint64_t tail = atomic_load_explicit(&ring->header.tail, memory_order_relaxed);
+    uint64_t dropped;
+
+    for (;;)
+    {
+        log_record_t *record = &ring->records[tail & (LOG_RING_SIZE - 1)];
+        if (__atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE) != tail + 1)
+        {
+            break;
+        }
+        batch_append(batch, record->text, record->length);
+        atomic_store_explicit(&ring->header.tail, ++tail, memory_order_release);
+    }
+
+    dropped = atomic_exchange_explicit(&ring->header.dropped, 0, memory_order_relaxed);
+    if (dropped != 0)
+    {
+        char note[64];
+        size_t note_length = append_text(note, 0, sizeof(note), "[log] ");
+        note_length = append_number(note, note_length, sizeof(note), dropped, 10);
+        note_length = append_text(note, note_length, sizeof(note), " messages dropped\n");
+        batch_append(batch, note, note_length);
+    }
+}
+
+/**
+ * @brief Writes the published messages of every ring to `fd`, batching them into few `write` calls.
+ * @param fd The file descriptor.
+ * @details Messages of one thread keep their order; messages of different threads are grouped by thread.
+ */
+static void drain_rings(int fd)
+{
+    log_batch_t batch;
+
+    batch.fd = fd;
+    batch.length = 0;
+    ring_registry_drain(&rings, drain_ring, &batch);
+    write_all(fd, batch.batch, batch.length);
+}
+
+/**
+ * @brief Body of the drain thread: drains the rings whenever woken or every `LOG_FLUSH_MS`.
+ */
+static void *drain_body(void *arg)
+{
+    struct timespec interval = { .tv_sec = 0, .tv_nsec = LOG_FLUSH_MS * 1000000L };
+
+    (void) arg;
+    while (atomic_load(&drain_running))
+    {
+        futex_wait(&drain_wakeups, atomic_load(&drain_wakeups), &interval);
+        drain_rings(atomic_load(&log_fd));
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the drain thread; later messages are buffered and written to `fd`.
+ * @param fd The file descriptor to write to.
+ * @return Returns 1 on success or if the logger is already running, 0 if the drain thread cannot be created.
+ * @details The remaining messages are flushed at exit.
+ */
+int async_log_start(int fd)
+{
+    uint32_t idle = 0;
+
+    if (!atomic_compare_exchange_strong(&drain_running, &idle, 1))
+    {
+        return 1;
+    }
+
+    atomic_store(&log_fd, fd);
+    if (pthread_create(&drain_thread, NULL, drain_body, NULL) != 0)
+    {
+        atomic_store(&log_fd, -1);
+        atomic_store(&drain_running, 0);
+        return 0;
+    }
+    if (atomic_exchange(&exit_hook, 1) == 0)
+    {
+        atexit(async_log_stop);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Drains the rings, stops the drain thread and returns to direct writes.
+ * @details Messages logged concurrently with the stop may be written directly before older buffered ones.
+ */
+void async_log_stop(void)
+{
+    uint32_t running = 1;
+    int fd;
+
+    if (!atomic_compare_exchange_strong(&drain_running, &running, 0))
+    {
+        return;
+    }
+
+    atomic_fetch_add(&drain_wakeups, 1);
+    futex_wake(&drain_wakeups, 1);
+    pthread_join(drain_thread, NULL);
+
+    fd = atomic_exchange(&log_fd, -1);
+    drain_rings(fd);
+}
+
+/**
+ * @brief Formats a message and queues it on the calling thread's ring.
+ * @param level The level of the message; use the `LOG_*` macros so low levels are compiled out.
+ * @param format A `printf` format using only `%d %i %u %x %p %s %c %%`, with `l`, `ll` or `z` sizes.
+ * @details A full ring drops the message and counts it. The drain thread is woken once a ring is half full.
+ * @note This function is async-signal-safe once the calling thread has a ring; see `async_log_register_thread`.
+ */
+void async_log_write(int level, const char *format, ...)
+{
+    log_ring_t *ring = own_ring;
+    log_record_t *record;
+    uint64_t position, fill;
+    char text[LOG_LINE_MAX];
+    size_t length;
+    va_list args;
+
+    (void) level;
+    va_start(args, format);
+    length = format_message(text, sizeof(text), format, args);
+    va_end(args);
+    if (length == sizeof(text))
+    {
+        text[length - 1] = '\n';  /* Keep one message per line when truncating */
+    }
+
+    /* Without a drain thread, write the message at once */
+    if (atomic_load_explicit(&log_fd, memory_order_acquire) < 0 ||
+        (ring == NULL && (ring = create_ring()) == NULL))
+    {
+        write_all(STDOUT_FILENO, text, length);
+        return;
+    }
+
+    /* Reserve a position; a handler interrupting this thread reserves the next one */
+    if (!ring_registry_reserve(&ring->header, LOG_RING_SIZE, &position, &fill))
+    {
+        return;
+    }
+
+    record = &ring->records[position & (LOG_RING_SIZE - 1)];
+    memcpy(record->text, text, length);
+    record->length = (uint32_t)length;
+    __atomic_store_n(&record->sequence, position + 1, __ATOMIC_RELEASE);
+
+    if (fill == LOG_RING_SIZE / 2)
+    {
+        atomic_fetch_add_explicit(&drain_wakeups, 1, memory_order_release);
+        futex_wake(&drain_wakeups, 1);
+    }
+}
+
+/**
+ * @brief Gives the calling thread its ring ahead of its first message.
+ * @details Threads that log from signal handlers call this first, so the ring is never allocated inside a handler.
+ */
+void async_log_register_thread(void)
+{
+    if (own_ring == NULL)
+    {
+        create_ring();
+    }
+}
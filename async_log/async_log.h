@@ -0,0 +1,93 @@
+/**
+ * @file async_log.h
+ * @brief Header file for the asynchronous, async-signal-safe logger of the switching core.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details A log call formats its message with a small built-in formatter into a ring owned by the calling thread,
+ *          taking no lock, so it never blocks behind a thread stopped while logging. A thread that registered its
+ *          ring with `async_log_register_thread` may also log from signal handlers. A drain thread writes the rings
+ *          out with batched `write(2)` calls. Messages below `LOG_LEVEL` are compiled out. Before `async_log_start`,
+ *          and after `async_log_stop`, messages are written directly with `write(2)`.
+ */
+
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <stdint.h>
+
+#define LOG_LEVEL_DEBUG 0   /**< Detailed tracing of the core. */
+#define LOG_LEVEL_INFO 1    /**< Progress of the workers. */
+#define LOG_LEVEL_WARN 2    /**< Refused requests: the caller gets `ERROR` as well. */
+#define LOG_LEVEL_ERROR 3   /**< Failures of the runtime itself. */
+#define LOG_LEVEL_OFF 4     /**< Nothing is logged. */
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO  /**< Messages below this level are compiled out. */
+#endif
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 256  /**< Messages buffered per thread; a power of two. */
+#endif
+
+/**
+ * @brief Longest message kept, including its newline; longer ones are truncated.
+ */
+#define LOG_LINE_MAX 120
+
+/**
+ * @brief Interval between two drains of the rings when no ring fills up.
+ */
+#define LOG_FLUSH_MS 20
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) async_log_write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) async_log_write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) async_log_write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) async_log_write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+/**
+ * @brief Starts the drain thread; later messages are buffered and written to `fd`.
+ * @param fd The file descriptor to write to.
+ * @return Returns 1 on success or if the logger is already running, 0 if the drain thread cannot be created.
+ * @details The remaining messages are flushed at exit.
+ */
+int async_log_start(int fd);
+
+/**
+ * @brief Drains the rings, stops the drain thread and returns to direct writes.
+ */
+void async_log_stop(void);
+
+/**
+ * @brief Formats a message and queues it on the calling thread's ring.
+ * @param level The level of the message; use the `LOG_*` macros so low levels are compiled out.
+ * @param format A `printf` format using only `%d %i %u %x %p %s %c %%`, with `l`, `ll` or `z` sizes.
+ * @note This function is async-signal-safe once the calling thread has a ring; see `async_log_register_thread`.
+ */
+void async_log_write(int level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Gives the calling thread its ring ahead of its first message.
+ * @details Threads that log from signal handlers call this first, so the ring is never allocated inside a handler.
+ */
+void async_log_register_thread(void);
+
+#endif /* ASYNC_LOG_H */
@@ -0,0 +1,2013 @@
+/**
+ * @file benchmark.c
+ * @brief Benchmark driver for the pthread switching core.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details Usage: `benchmark.out [--text] [--trace file] [stop | roundtrip [rounds] | pingpong [rounds] | stopall [rounds] |
+ *                          async [rounds] |
+ *                          scaling [max threads] | tick [threads] [seconds] | periodic [policy] [seconds] | timers [count] |
+ *                          executor [workers] [tasks] [batch] | spawn [threads] [stack kb] [flags] | switch [rounds] |
+ *                          tasks [carriers] [seconds] |
+ *                          transitions [controllers] [seconds] [serialized] | placement [policy] [rounds]]`
+ *          Every mode prints one JSON object, with latencies as p50/p99/p999 and a log2 histogram, so runs can be
+ *          compared across backends and commits; `--text` prints the same fields as aligned text instead.
+ *          Build with `-DBENCHMARK_COMMIT=\"$(git rev-parse --short HEAD)\"` to record the commit in the output.
+ *          `--trace file` records every stop and resume of the run into a binary trace for `trace_convert`.
+ *          - `stop` (default) measures the latency of `stop_thread` and the CPU time the controller burns
+ *            while waiting for stop acknowledgements.
+ *          - `roundtrip` stops and resumes every worker in turn and reports the `stop_thread`, `resume_thread`
+ *            and round-trip latency distributions.
+ *          - `pingpong` hands control back and forth between the main thread and a worker with a condition variable,
+ *            with `stop_main`/`resume_main` and with `handoff_to`, and reports handoffs per second for each.
+ *          - `scaling` grows the pool from 1 to `max threads` (10000 by default) in powers of ten and times
+ *            `stop_all`, `resume_all` and the lookup of a thread ID at each size.
+ *          - `tick` (built with `-DPOSIX_TIMER`) hands busy workers of three priorities to the tick scheduler and
+ *            reports the tick and dispatch latencies, the preemptions and the running time of each priority.
+ *          - `periodic` runs three control loops under `rm`, `edf` or `deadline`, the last of which always needs more
+ *            than its budget, and reports the jobs, overruns, deadline misses and worst response time of each.
+ *          - `timers` arms and cancels `count` timers (100000 by default) on the timer wheel, reports the cost per
+ *            operation, how late timers fire, the wake-ups of an idle process and whether `sleep_thread` wakes every worker.
+ *          - `executor` submits `tasks` small functions (100000 by default) to the executor, one by one or in batches,
+ *            joins their futures and reports the throughput and the submit-to-completion latency.
+ *          - `spawn` spawns `threads` workers (1000 by default) one at a time, lets them all retire and spawns them
+ *            again, and reports the spawn-to-start latency and the resident memory of both rounds. With a `stack kb`
+ *            the workers run on pooled stacks, `prefault` and `huge` set the flags of the pool; 0 keeps the stacks
+ *            of the C library for comparison.
+ *          - `stopall` compares quiescing the whole pool with `stop_all` and with `quiesce` against one `stop_thread` per
+ *            worker, and reports the distribution of `quiesce` and the workers slowest to reach their safepoint.
+ *          - `async` stops the whole pool from one event loop with `stop_thread_async`, waiting in `epoll` on an
+ *            eventfd the acknowledgements write, and reports the time to stop the pool and the wake-ups per round.
+ *          - `switch` measures the resume+stop round trip of a busy worker suspended by signals and of one
+ *            suspended cooperatively at safepoints.
+ *          - `tasks` runs `NUMBER_OF_THREADS` user-context tasks that keep yielding on a few carriers and reports
+ *            the cost of a yield and the stop_task+resume_task round trip. Build with `-DUSE_UCONTEXT` to measure
+ *            swapcontext instead of the hand-written switch.
+ *          - `transitions` runs several controller threads that stop and resume disjoint sets of workers,
+ *            checks that no transition failed and reports transitions per second. With `serialized`, every
+ *            call is wrapped in one global mutex, which reproduces the old `kernel_mutex` behaviour.
+ *          - `placement` pins the pool with `none`, `compact`, `scatter`, `numa` or `list:<cpu>,<cpu>,...` and
+ *            measures the time from `resume_thread` until the worker makes progress on its working set again,
+ *            plus the cache misses and CPU migrations of the run. Run it with `none` and with a policy to compare.
+ *          Build with `-DNUMBER_OF_THREADS=<n>` to change the pool size.
+ */
+
+#define _GNU_SOURCE
+#include <limits.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/perf_event.h>
+#include "../pthreads_switching/pthreads_switching.h"
+#include "../task_switching/task_switching.h"
+#include "../executor/executor.h"
+
+#define MAX_CONTROLLERS 64  /**< Maximum number of controller threads. */
+#define MAX_SAMPLES (NUMBER_OF_THREADS > 10000 ? NUMBER_OF_THREADS : 10000)  /**< Maximum number of latency samples. */
+#define WORKING_SET_BYTES (256 * 1024)  /**< Memory each worker of the placement benchmark keeps walking. */
+#define MAX_PLACEMENT_CPUS 256  /**< Maximum length of an explicit CPU list. */
+#define MAX_REPORT_DEPTH 8  /**< Maximum nesting of objects and arrays in a report. */
+#define HISTOGRAM_BUCKETS 64  /**< Number of log2 latency buckets. */
+
+#ifndef BENCHMARK_COMMIT
+#define BENCHMARK_COMMIT "unknown"  /**< Commit the benchmark was built from. */
+#endif
+
+/* Array to store the created threads initially */
+extern pthread_t threads[NUMBER_OF_THREADS];
+
+/* Variable to store the main thread ID */
+extern pthread_t main_thread;
+
+/* Latency samples in nanoseconds */
+static long long latency_ns[MAX_SAMPLES];
+static long long resume_ns[MAX_SAMPLES];
+static long long roundtrip_ns[MAX_SAMPLES];
+static long long pipelined_ns[MAX_SAMPLES];
+
+/* Report state: output format, nesting and whether the current level already has a field */
+static int json_output = 1;
+static int report_depth = 0;
+static int report_has_field[MAX_REPORT_DEPTH];
+
+/* Parameters and results of the transitions benchmark */
+static int controllers = 4;
+static int serialized = 0;
+static atomic_int running = 1;
+static pthread_mutex_t serial_mutex = PTHREAD_MUTEX_INITIALIZER;
+static long long transitions[MAX_CONTROLLERS];
+static long long failures[MAX_CONTROLLERS];
+
+/* State of the ping-pong benchmark: pings of `stop_main`, and the turn of the condition variable baseline */
+static _Atomic uint32_t ping = 0;
+static pthread_mutex_t pong_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pong_cond = PTHREAD_COND_INITIALIZER;
+static int pong_turn = 0;
+
+/* State of the tasks benchmark */
+static atomic_int tasks_running = 1;
+static long long task_yields[NUMBER_OF_THREADS];
+
+/* State of the timers benchmark: the timers, their expiry times and how many have fired */
+static timer_entry_t *bench_timers;
+static uint64_t *bench_expiry_ns;
+static atomic_int timers_fired = 0;
+
+/* Completion times of the executor benchmark */
+static long long completed_ns[MAX_SAMPLES];
+
+/* Start times of the spawn benchmark, the number of workers started and the futex word that holds them */
+static long long started_ns[MAX_SAMPLES];
+static atomic_int spawns_started = 0;
+static _Atomic uint32_t spawns_held = 0;
+
+/* Control loops of the periodic benchmark: period, budget and CPU time of a job in milliseconds */
+static const uint64_t loop_timing_ms[][3] = { { 10, 2, 1 }, { 20, 4, 2 }, { 40, 8, 12 } };
+
+/* State of the placement benchmark: one progress counter per worker, each on its own cache line */
+static struct {
+    _Alignas(64) _Atomic unsigned long steps;
+} progress[NUMBER_OF_THREADS];
+static pthread_t placed_threads[NUMBER_OF_THREADS];
+
+/**
+ * @brief Reads a clock in nanoseconds.
+ * @param clock_id The clock to read.
+ * @return Returns the clock value in nanoseconds.
+ */
+static long long clock_ns(clockid_t clock_id)
+{
+    struct timespec now;
+    clock_gettime(clock_id, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * @brief Comparison function for sorting latencies.
+ */
+static int compare_latency(const void *a, const void *b)
+{
+    long long lhs = *(const long long *)a;
+    long long rhs = *(const long long *)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+/**
+ * @brief Starts a field of the current report level: separator, indentation and key.
+ * @param key The name of the field, or `NULL` for an array element.
+ */
+static void report_key(const char *key)
+{
+    if (json_output)
+    {
+        if (report_depth > 0)
+        {
+            printf("%s\n%*s", report_has_field[report_depth] ? "," : "", report_depth * 2, "");
+        }
+        if (key != NULL)
+        {
+            printf("\"%s\": ", key);
+        }
+    }
+    else if (key != NULL)
+    {
+        printf("%*s%-*s: ", (report_depth - 1) * 2, "", 21 - (report_depth - 1) * 2, key);
+    }
+    report_has_field[report_depth] = 1;
+}
+
+/**
+ * @brief Opens a nested object or array in the report.
+ * @param key The name of the field, or `NULL` for an array element.
+ * @param bracket `{` or `[`.
+ */
+static void report_open(const char *key, char bracket)
+{
+    if (json_output)
+    {
+        report_key(key);
+        putchar(bracket);
+    }
+    else if (key != NULL)
+    {
+        printf("%*s%s:\n", (report_depth - 1) * 2, "", key);
+    }
+    else if (report_has_field[report_depth])
+    {
+        putchar('\n');  /* Blank line between the elements of an array */
+    }
+    report_has_field[report_depth] = 1;
+    if (report_depth + 1 < MAX_REPORT_DEPTH)
+    {
+        report_depth++;
+    }
+    report_has_field[report_depth] = 0;
+}
+
+/**
+ * @brief Closes the object or array opened last.
+ * @param bracket `}` or `]`.
+ */
+static void report_close(char bracket)
+{
+    int had_fields = report_has_field[report_depth];
+
+    report_depth--;
+    if (json_output)
+    {
+        printf(had_fields ? "\n%*s%c" : "%*s%c", had_fields ? report_depth * 2 : 0, "", bracket);
+    }
+}
+
+/**
+ * @brief Starts the report of a benchmark mode.
+ * @param mode The name of the mode.
+ */
+static void report_begin(const char *mode)
+{
+    report_depth = 0;
+    report_has_field[0] = 0;
+    report_open(NULL, '{');
+    report_key("benchmark");
+    printf(json_output ? "\"%s\"" : "%s\n", mode);
+    report_key("commit");
+    printf(json_output ? "\"%s\"" : "%s\n", BENCHMARK_COMMIT);
+}
+
+/**
+ * @brief Ends the report of a benchmark mode.
+ */
+static void report_end(void)
+{
+    report_close('}');
+    if (json_output)
+    {
+        putchar('\n');
+    }
+    fflush(stdout);
+}
+
+/**
+ * @brief Adds an integer field to the report.
+ * @param key The name of the field.
+ * @param value The value.
+ */
+static void report_int(const char *key, long long value)
+{
+    report_key(key);
+    printf(json_output ? "%lld" : "%lld\n", value);
+}
+
+/**
+ * @brief Adds a floating-point field to the report.
+ * @param key The name of the field.
+ * @param value The value.
+ */
+static void report_double(const char *key, double value)
+{
+    report_key(key);
+    printf(json_output ? "%.3f" : "%.3f\n", value);
+}
+
+/**
+ * @brief Adds a string field to the report.
+ * @param key The name of the field.
+ * @param value The value; must not need escaping.
+ */
+static void report_string(const char *key, const char *value)
+{
+    report_key(key);
+    printf(json_output ? "\"%s\"" : "%s\n", value);
+}
+
+/**
+ * @brief Adds a latency distribution to the report and sorts the samples.
+ * @param key The name of the field.
+ * @param samples The samples in nanoseconds.
+ * @param count The number of samples.
+ * @details Reports the count, mean, p50, p99, p999 and maximum, plus in JSON a log2 histogram where bucket
+ *          `le_ns` counts the samples in `(le_ns / 2, le_ns]`.
+ */
+static void report_latency(const char *key, long long *samples, int count)
+{
+    long long buckets[HISTOGRAM_BUCKETS] = {0};
+    long long total = 0;
+
+    report_open(key, '{');
+    report_int("count", count);
+    if (count > 0)
+    {
+        qsort(samples, count, sizeof(samples[0]), compare_latency);
+        for (int i = 0; i < count; i++)
+        {
+            total += samples[i];
+            buckets[samples[i] > 1 ? 64 - __builtin_clzll((unsigned long long)samples[i] - 1) : 0]++;
+        }
+        report_int("mean_ns", total / count);
+        report_int("p50_ns", samples[count / 2]);
+        report_int("p99_ns", samples[(int)((long long)count * 99 / 100)]);
+        report_int("p999_ns", samples[(int)((long long)count * 999 / 1000)]);
+        report_int("max_ns", samples[count - 1]);
+        if (json_output)
+        {
+            report_open("histogram", '[');
+            for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+            {
+                if (buckets[b] != 0)
+                {
+                    report_key(NULL);
+                    printf("{\"le_ns\": %llu, \"count\": %lld}", 1ULL << b, buckets[b]);
+                }
+            }
+            report_close(']');
+        }
+    }
+    report_close('}');
+}
+
+/**
+ * @brief Adds the signal delivery latency recorded by the per-thread statistics to the report.
+ * @details Delivery is the part of a stop or resume between sending the request and the target acting on it.
+ *          Nothing is added when the statistics are compiled out.
+ */
+static void report_delivery(void)
+{
+    static thread_stats_snapshot_t snapshots[NUMBER_OF_THREADS];
+    unsigned long long stop_total = 0, stop_count = 0, resume_total = 0, resume_count = 0, stop_max = 0, resume_max = 0;
+    unsigned int count = get_all_thread_stats(snapshots, NUMBER_OF_THREADS);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        stop_total += snapshots[i].stop_latency_mean_ns * snapshots[i].stop_signals;
+        stop_count += snapshots[i].stop_signals;
+        stop_max = snapshots[i].stop_latency_max_ns > stop_max ? snapshots[i].stop_latency_max_ns : stop_max;
+        resume_total += snapshots[i].resume_latency_mean_ns * snapshots[i].resume_signals;
+        resume_count += snapshots[i].resume_signals;
+        resume_max = snapshots[i].resume_latency_max_ns > resume_max ? snapshots[i].resume_latency_max_ns : resume_max;
+    }
+
+    report_open("delivery", '{');
+    report_int("stop_mean_ns", stop_count != 0 ? (long long)(stop_total / stop_count) : 0);
+    report_int("stop_max_ns", (long long)stop_max);
+    report_int("resume_mean_ns", resume_count != 0 ? (long long)(resume_total / resume_count) : 0);
+    report_int("resume_max_ns", (long long)resume_max);
+    report_close('}');
+}
+
+/**
+ * @brief Worker body that stays alive and idle so it can be stopped and resumed any number of times.
+ */
+static void idle_body(void *arg)
+{
+    (void) arg;
+    for (;;)
+    {
+        pause();
+    }
+}
+
+/**
+ * @brief Worker body that answers every ping of the main thread by handing control back with `resume_main`.
+ * @details A `resume_main` sent before the main thread parks is kept, so one per ping is enough.
+ */
+static void pong_body(void *arg)
+{
+    uint32_t seen = 0;
+
+    (void) arg;
+    for (;;)
+    {
+        seen = futex_await_change(&ping, seen);
+        resume_main();
+    }
+}
+
+/**
+ * @brief Worker body that answers every turn of the main thread on a condition variable, the baseline of `pingpong`.
+ */
+static void condvar_pong_body(void *arg)
+{
+    (void) arg;
+    pthread_mutex_lock(&pong_mutex);
+    for (;;)
+    {
+        while (pong_turn != 1)
+        {
+            pthread_cond_wait(&pong_cond, &pong_mutex);
+        }
+        pong_turn = 0;
+        pthread_cond_signal(&pong_cond);
+    }
+}
+
+/**
+ * @brief Worker body that hands control straight back to the main thread with `handoff_to`.
+ */
+static void handoff_pong_body(void *arg)
+{
+    (void) arg;
+    handoff_wait();
+    for (;;)
+    {
+        handoff_to(main_thread);
+    }
+}
+
+/**
+ * @brief Worker body that keeps computing; odd workers suspend cooperatively at a safepoint per iteration.
+ * @param arg The index of the thread.
+ */
+static void busy_body(void *arg)
+{
+    volatile unsigned long dummy = 0;
+
+    if ((intptr_t)arg % 2 == 1)
+    {
+        enable_safepoints();
+    }
+    for (;;)
+    {
+        safepoint();
+        for (int i = 0; i < 100; i++)
+        {
+            dummy++;
+        }
+    }
+}
+
+/**
+ * @brief Worker body of a periodic control loop: each job burns a fixed amount of CPU time.
+ * @param arg The index of the loop in `loop_timing_ms`.
+ * @details CPU time is measured on the thread's own clock, so the time the scheduler keeps it stopped does not count.
+ */
+static void control_loop_body(void *arg)
+{
+    long long work_ns = (long long)loop_timing_ms[(intptr_t)arg][2] * 1000000;
+
+    for (;;)
+    {
+        long long start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+        while (clock_ns(CLOCK_THREAD_CPUTIME_ID) - start < work_ns)
+        {
+        }
+        wait_next_period();
+    }
+}
+
+/**
+ * @brief Function submitted by the executor benchmark: a little work, then its completion time.
+ * @param arg The index of the call.
+ * @return Returns `arg`, so the joiner can check it got the right result.
+ */
+static void *executor_task(void *arg)
+{
+    volatile unsigned long dummy = 0;
+
+    for (int i = 0; i < 100; i++)
+    {
+        dummy++;
+    }
+    if ((intptr_t)arg < MAX_SAMPLES)
+    {
+        completed_ns[(intptr_t)arg] = clock_ns(CLOCK_MONOTONIC);
+    }
+
+    return arg;
+}
+
+/**
+ * @brief Worker body of the spawn benchmark: records when it started, then holds its thread until the round ends.
+ * @param arg The index of the spawn.
+ */
+static void start_body(void *arg)
+{
+    started_ns[(intptr_t)arg] = clock_ns(CLOCK_MONOTONIC);
+    atomic_fetch_add(&spawns_started, 1);
+    while (atomic_load(&spawns_held))
+    {
+        futex_wait(&spawns_held, 1, NULL);
+    }
+}
+
+/**
+ * @brief Reads the resident memory of the process.
+ * @return Returns the resident set size in kilobytes, or 0 if it cannot be read.
+ */
+static long long resident_kb(void)
+{
+    FILE *statm = fopen("/proc/self/statm", "r");
+    long long size = 0, resident = 0;
+
+    if (statm == NULL)
+    {
+        return 0;
+    }
+    if (fscanf(statm, "%lld %lld", &size, &resident) != 2)
+    {
+        resident = 0;
+    }
+    fclose(statm);
+
+    return resident * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+/**
+ * @brief Worker body that keeps walking a private working set, one cache line per step.
+ * @param arg The index of the thread.
+ * @details The buffer is allocated and first touched by the worker, so a pinned worker gets it on its own node.
+ */
+static void walk_body(void *arg)
+{
+    intptr_t id = (intptr_t)arg;
+    volatile unsigned char *buffer = (volatile unsigned char *)malloc(WORKING_SET_BYTES);
+    unsigned long steps = 0;
+
+    if (buffer == NULL)
+    {
+        return;
+    }
+    for (;;)
+    {
+        for (size_t offset = 0; offset < WORKING_SET_BYTES; offset += 64)
+        {
+            buffer[offset]++;
+            atomic_store_explicit(&progress[id].steps, ++steps, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Opens a counter of a hardware or software event for this process and the threads it creates later.
+ * @param type The perf event type.
+ * @param config The event.
+ * @return Returns the file descriptor of the counter, or -1 if the event is not available.
+ */
+static int open_counter(unsigned int type, unsigned long long config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * @brief Reads a counter opened by `open_counter`.
+ * @param fd The file descriptor of the counter, or -1.
+ * @return Returns the count, or -1 if the counter is not available.
+ */
+static long long read_counter(int fd)
+{
+    long long value;
+
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value))
+    {
+        return -1;
+    }
+    return value;
+}
+
+/**
+ * @brief Task body that yields until the benchmark ends.
+ * @param arg The ID of the task.
+ */
+static void yield_body(void *arg)
+{
+    intptr_t id = (intptr_t)arg;
+
+    while (atomic_load_explicit(&tasks_running, memory_order_relaxed))
+    {
+        task_yields[id]++;
+        task_yield();
+    }
+}
+
+/**
+ * @brief Stops or resumes a thread, optionally under the global benchmark mutex.
+ */
+static int transition(pthread_t thread, int stop)
+{
+    int status;
+
+    if (serialized)
+    {
+        pthread_mutex_lock(&serial_mutex);
+    }
+    status = stop ? stop_thread(thread) : resume_thread(thread);
+    if (serialized)
+    {
+        pthread_mutex_unlock(&serial_mutex);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Controller thread: alternately stops and resumes every worker it owns.
+ * @param arg The index of the controller; it owns the workers `i` with `i % controllers == index`.
+ */
+static void *controller_body(void *arg)
+{
+    int index = (int)(intptr_t)arg;
+
+    while (atomic_load_explicit(&running, memory_order_relaxed))
+    {
+        for (int stop = 1; stop >= 0; stop--)
+        {
+            for (int i = index; i < NUMBER_OF_THREADS; i += controllers)
+            {
+                if (transition(threads[i], stop) == ERROR)
+                {
+                    failures[index]++;
+                }
+                else
+                {
+                    transitions[index]++;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Stops every worker once and reports stop latency and controller CPU burn.
+ * @return Returns 0 on success.
+ */
+static int benchmark_stop(void)
+{
+    long long wall_start, wall_end, cpu_start, cpu_end;
+    int stopped = 0;
+
+    wall_start = clock_ns(CLOCK_MONOTONIC);
+    cpu_start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    for (int i = 0; i < NUMBER_OF_THREADS; i++)
+    {
+        long long start = clock_ns(CLOCK_MONOTONIC);
+        if (stop_thread(threads[i]) == ERROR)
+        {
+            continue;
+        }
+        latency_ns[stopped++] = clock_ns(CLOCK_MONOTONIC) - start;
+    }
+    cpu_end = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    wall_end = clock_ns(CLOCK_MONOTONIC);
+
+    if (stopped == 0)
+    {
+        printf("No thread could be stopped\n");
+        return 1;
+    }
+
+    report_begin("stop");
+    report_string("backend", "signal");
+    report_int("threads", stopped);
+    report_latency("stop_latency", latency_ns, stopped);
+    report_int("controller_wall_us", (wall_end - wall_start) / 1000);
+    report_int("controller_cpu_us", (cpu_end - cpu_start) / 1000);
+    report_double("cpu_per_wall", (double)(cpu_end - cpu_start) / (double)(wall_end - wall_start));
+    report_end();
+
+    return 0;
+}
+
+/**
+ * @brief Timer callback of the timers benchmark: records how late the timer fired.
+ * @param arg The index of the timer.
+ */
+static void timer_fired(void *arg)
+{
+    intptr_t index = (intptr_t)arg;
+    int fired = atomic_fetch_add(&timers_fired, 1);
+
+    if (fired < MAX_SAMPLES)
+    {
+        latency_ns[fired] = (long long)(timer_now_ns() - bench_expiry_ns[index]);
+    }
+}
+
+/**
+ * @brief Measures the timer wheel: arming and cancelling many timers, firing lateness, idle wake-ups and `sleep_thread`.
+ * @param count Number of timers armed at once.
+ * @return Returns 0 if every timer fired, the idle process was never woken and every sleeping worker woke up.
+ * @details Arming and cancelling should cost the same with 10 or 1000000 pending timers. Once no timer is pending,
+ *          the timer thread must not wake up at all.
+ */
+static int benchmark_timers(int count)
+{
+    long long arm_ns, cancel_ns, start;
+    int fire_count = count < MAX_SAMPLES ? count : MAX_SAMPLES;
+    int slept = 0, running_count = 0, waited;
+    uint64_t now, idle_wakeups;
+    LinkedList running_list;
+
+    bench_timers = (timer_entry_t *)malloc((size_t)count * sizeof(timer_entry_t));
+    bench_expiry_ns = (uint64_t *)malloc((size_t)count * sizeof(uint64_t));
+    if (bench_timers == NULL || bench_expiry_ns == NULL)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        timer_entry_init(&bench_timers[i]);
+    }
+
+    /* Arm timers spread over 1 to 11 seconds, then cancel them all */
+    now = timer_now_ns();
+    start = clock_ns(CLOCK_MONOTONIC);
+    for (int i = 0; i < count; i++)
+    {
+        bench_expiry_ns[i] = now + 1000000000ULL + (uint64_t)(i * 7919LL % 10000) * 1000000ULL;
+        timer_arm(&bench_timers[i], bench_expiry_ns[i], timer_fired, (void *)(intptr_t)i);
+    }
+    arm_ns = clock_ns(CLOCK_MONOTONIC) - start;
+    start = clock_ns(CLOCK_MONOTONIC);
+    for (int i = 0; i < count; i++)
+    {
+        timer_disarm(&bench_timers[i]);
+    }
+    cancel_ns = clock_ns(CLOCK_MONOTONIC) - start;
+
+    /* Fire timers spread over the next 50 ms */
+    now = timer_now_ns();
+    for (int i = 0; i < fire_count; i++)
+    {
+        bench_expiry_ns[i] = now + 1000000ULL + (uint64_t)(i * 7919LL % 49000) * 1000ULL;
+        timer_arm(&bench_timers[i], bench_expiry_ns[i], timer_fired, (void *)(intptr_t)i);
+    }
+    for (waited = 0; atomic_load(&timers_fired) < fire_count && waited < 2000; waited += 10)
+    {
+        usleep(10000);
+    }
+
+    /* Nothing is pending: the timer thread must stay asleep */
+    idle_wakeups = timer_service_wakeups();
+    usleep(200000);
+    idle_wakeups = timer_service_wakeups() - idle_wakeups;
+
+    /* Put every worker to sleep for 10 ms; all of them must be running again afterwards */
+    for (int i = 0; i < NUMBER_OF_THREADS; i++)
+    {
+        slept += (sleep_thread(threads[i], 10000000ULL) != ERROR);
+    }
+    usleep(100000);
+    init_list(&running_list);
+    get_threads_in_state(THREAD_STATE_RUNNING, &running_list);
+    for (Node *node = running_list.head; node != NULL; node = node->next)
+    {
+        running_count++;
+    }
+
+    report_begin("timers");
+    report_string("backend", "signal");
+    report_int("timers", count);
+    report_int("resolution_ns", TIMER_WHEEL_RESOLUTION_NS);
+    report_double("arm_ns", (double)arm_ns / count);
+    report_double("cancel_ns", (double)cancel_ns / count);
+    report_int("fired", atomic_load(&timers_fired));
+    report_latency("lateness", latency_ns, atomic_load(&timers_fired) < fire_count ? atomic_load(&timers_fired) :
+                                                                                     fire_count);
+    report_int("idle_wakeups", (long long)idle_wakeups);
+    report_int("slept", slept);
+    report_int("running_after_sleep", running_count);
+    report_end();
+
+    free(bench_timers);
+    free(bench_expiry_ns);
+    return (atomic_load(&timers_fired) == fire_count && idle_wakeups == 0 && running_count == slept) ? 0 : 1;
+}
+
+/**
+ * @brief Compares a batched full-pool stop and a quiesce against one stop per worker.
+ * @param rounds Number of stop/resume rounds of each kind.
+ * @return Returns 0 if every round stopped the whole pool, otherwise 1.
+ * @details The time-to-safepoint of every worker is kept across the quiesce rounds, and the slowest workers of the
+ *          last round are reported as stragglers.
+ */
+static int benchmark_stop_all(int rounds)
+{
+    long long batched = 0, sequential = 0, start;
+    quiesce_sample_t stragglers[3];
+    quiesce_report_t report = { .samples = stragglers, .capacity = 3 };
+    int complete = 1, measured = 0;
+
+    for (int round = 0; round < rounds; round++)
+    {
+        start = clock_ns(CLOCK_MONOTONIC);
+        complete &= (stop_all() == NUMBER_OF_THREADS);
+        batched += clock_ns(CLOCK_MONOTONIC) - start;
+        resume_all();
+
+        start = clock_ns(CLOCK_MONOTONIC);
+        for (int i = 0; i < NUMBER_OF_THREADS; i++)
+        {
+            complete &= (stop_thread(threads[i]) != ERROR);
+        }
+        sequential += clock_ns(CLOCK_MONOTONIC) - start;
+        resume_all();
+
+        complete &= (quiesce(&report) != ERROR && report.stopped == NUMBER_OF_THREADS);
+        if (measured < MAX_SAMPLES)
+        {
+            latency_ns[measured++] = (long long)report.quiesce_ns;
+        }
+        unquiesce();
+    }
+
+    report_begin("stopall");
+    report_string("backend", "signal");
+    report_int("threads", NUMBER_OF_THREADS);
+    report_int("rounds", rounds);
+    report_int("stop_all_us", batched / rounds / 1000);
+    report_int("stop_thread_loop_us", sequential / rounds / 1000);
+    report_latency("quiesce", latency_ns, measured);
+    report_open("stragglers", '[');
+    for (size_t i = 0; i < report.count; i++)
+    {
+        report_open(NULL, '{');
+        report_int("thread", stragglers[i].index);
+        report_int("time_to_safepoint_ns", (long long)stragglers[i].time_to_safepoint_ns);
+        report_close('}');
+    }
+    report_close(']');
+    report_end();
+
+    return complete ? 0 : 1;
+}
+
+/**
+ * @brief Drives the stop of every worker from one event loop with asynchronous transitions.
+ * @param rounds Number of stop/resume rounds.
+ * @return Returns 0 if every transition completed, otherwise 1.
+ * @details Every stop of a round is started before any completes; the loop then sleeps in `epoll_wait` on one eventfd
+ *          that the acknowledgements write, and polls the pending handles each time it wakes. Each sample runs from
+ *          the first stop of a round until the last handle completed.
+ */
+static int benchmark_async(int rounds)
+{
+    static transition_t ops[NUMBER_OF_THREADS];
+    struct epoll_event event = { .events = EPOLLIN };
+    int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    long long start, wakeups = 0, failed = 0;
+    int measured = 0;
+
+    if (event_fd < 0 || epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &event) != 0)
+    {
+        printf("Cannot create the event loop\n");
+        return 1;
+    }
+
+    for (int round = 0; round < rounds; round++)
+    {
+        int pending = 0;
+
+        start = clock_ns(CLOCK_MONOTONIC);
+        for (int i = 0; i < NUMBER_OF_THREADS; i++)
+        {
+            pending += stop_thread_async(threads[i], &ops[i], event_fd) != ERROR;
+        }
+        failed += NUMBER_OF_THREADS - pending;
+
+        /* The event loop: sleep until an acknowledgement arrives, then collect every completed handle */
+        while (pending > 0)
+        {
+            uint64_t completions;
+
+            if (epoll_wait(epoll_fd, &event, 1, -1) <= 0 || read(event_fd, &completions, sizeof(completions)) < 0)
+            {
+                continue;
+            }
+            wakeups++;
+            pending = 0;
+            for (int i = 0; i < NUMBER_OF_THREADS; i++)
+            {
+                transition_status_t status = ops[i].status;
+                if (status == TRANSITION_PENDING)
+                {
+                    status = transition_poll(&ops[i]);
+                    pending += status == TRANSITION_PENDING;
+                    failed += status == TRANSITION_FAILED;
+                }
+            }
+        }
+        if (measured < MAX_SAMPLES)
+        {
+            latency_ns[measured++] = clock_ns(CLOCK_MONOTONIC) - start;
+        }
+
+        for (int i = 0; i < NUMBER_OF_THREADS; i++)
+        {
+            failed += resume_thread_async(threads[i], &ops[i]) == ERROR;
+        }
+    }
+    close(epoll_fd);
+    close(event_fd);
+
+    report_begin("async");
+    report_string("backend", "signal");
+    report_int("threads", NUMBER_OF_THREADS);
+    report_int("rounds", rounds);
+    report_int("failed", failed);
+    report_double("epoll_wakeups_per_round", (double)wakeups / rounds);
+    report_latency("stop_pool", latency_ns, measured);
+    report_end();
+
+    return failed == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Stops and resumes every worker in turn and reports the latency of each half and of the round trip.
+ * @param rounds Number of passes over the pool; samples beyond `MAX_SAMPLES` are dropped.
+ * @return Returns 0 if every stop and resume succeeded, otherwise 1.
+ * @details A second pass sends each stop and its resume together with `send_thread_commands`, which waits for the
+ *          acknowledgement of the resume only.
+ */
+static int benchmark_roundtrip(int rounds)
+{
+    static const thread_command_t stop_resume[] = { THREAD_COMMAND_STOP, THREAD_COMMAND_RESUME };
+    long long start, stopped, resumed;
+    int measured = 0, pipelined = 0, failed = 0;
+
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int i = 0; i < NUMBER_OF_THREADS && measured < MAX_SAMPLES; i++)
+        {
+            start = clock_ns(CLOCK_MONOTONIC);
+            if (stop_thread(threads[i]) == ERROR)
+            {
+                failed++;
+                continue;
+            }
+            stopped = clock_ns(CLOCK_MONOTONIC);
+            if (resume_thread(threads[i]) == ERROR)
+            {
+                failed++;
+                continue;
+            }
+            resumed = clock_ns(CLOCK_MONOTONIC);
+
+            latency_ns[measured] = stopped - start;
+            resume_ns[measured] = resumed - stopped;
+            roundtrip_ns[measured++] = resumed - start;
+        }
+    }
+
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int i = 0; i < NUMBER_OF_THREADS && pipelined < MAX_SAMPLES; i++)
+        {
+            start = clock_ns(CLOCK_MONOTONIC);
+            if (send_thread_commands(threads[i], stop_resume, 2) == ERROR)
+            {
+                failed++;
+                continue;
+            }
+            pipelined_ns[pipelined++] = clock_ns(CLOCK_MONOTONIC) - start;
+        }
+    }
+
+    report_begin("roundtrip");
+    report_string("backend", "signal");
+    report_int("threads", NUMBER_OF_THREADS);
+    report_int("rounds", rounds);
+    report_int("failed", failed);
+    report_latency("stop_thread", latency_ns, measured);
+    report_latency("resume_thread", resume_ns, measured);
+    report_latency("round_trip", roundtrip_ns, measured);
+    report_latency("pipelined_round_trip", pipelined_ns, pipelined);
+    report_delivery();
+    report_end();
+
+    return failed == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Hands control back and forth between the main thread and one worker, on each handoff path in turn.
+ * @param rounds Number of ping-pongs of each path, capped at `MAX_SAMPLES`.
+ * @return Returns 0 on success.
+ * @details `condvar` is a mutex and a condition variable with a turn predicate, `stop_main` a futex ping answered by
+ *          `resume_main`, and `handoff_to` a direct handoff each way. Each sample runs from the ping until the main
+ *          thread has control again, so it holds two handoffs.
+ */
+static int benchmark_pingpong(int rounds)
+{
+    thread_pool_config_t config = {
+        .min_threads = 0,
+        .max_threads = 3,
+    };
+    static const char *const backends[] = { "condvar", "stop_main", "handoff_to" };
+    thread_body_t bodies[] = { condvar_pong_body, pong_body, handoff_pong_body };
+    pthread_t workers[3];
+    long long start, begin;
+
+    if (init_thread_pool(&config) == ERROR)
+    {
+        printf("Cannot start the pool\n");
+        return 1;
+    }
+    for (int backend = 0; backend < 3; backend++)
+    {
+        if (spawn_thread(bodies[backend], NULL, &workers[backend]) == ERROR)
+        {
+            printf("Cannot start the pool\n");
+            return 1;
+        }
+    }
+
+    report_begin("pingpong");
+    report_open("backends", '[');
+    for (int backend = 0; backend < 3; backend++)
+    {
+        int measured = 0;
+
+        begin = clock_ns(CLOCK_MONOTONIC);
+        for (int round = 0; round < rounds && round < MAX_SAMPLES; round++)
+        {
+            start = clock_ns(CLOCK_MONOTONIC);
+            if (backend == 0)
+            {
+                pthread_mutex_lock(&pong_mutex);
+                pong_turn = 1;
+                pthread_cond_signal(&pong_cond);
+                while (pong_turn != 0)
+                {
+                    pthread_cond_wait(&pong_cond, &pong_mutex);
+                }
+                pthread_mutex_unlock(&pong_mutex);
+            }
+            else if (backend == 1)
+            {
+                atomic_fetch_add(&ping, 1);
+                futex_wake(&ping, 1);
+                stop_main();
+            }
+            else
+            {
+                handoff_to(workers[backend]);
+            }
+            latency_ns[measured++] = clock_ns(CLOCK_MONOTONIC) - start;
+        }
+
+        report_open(NULL, '{');
+        report_string("backend", backends[backend]);
+        report_int("rounds", measured);
+        report_double("handoffs_per_s", 2.0 * measured * 1e9 / (double)(clock_ns(CLOCK_MONOTONIC) - begin));
+        report_latency("ping_pong", latency_ns, measured);
+        report_close('}');
+    }
+    report_close(']');
+    report_end();
+
+    return 0;
+}
+
+/**
+ * @brief Times `stop_all`, `resume_all` and the lookup of a thread ID as the pool grows from 1 worker to
+ *        `max_threads` in powers of ten.
+ * @param max_threads The largest pool size measured.
+ * @return Returns 0 if every size was reached and fully stopped, otherwise 1.
+ * @details If the system refuses more threads, the sizes reached so far are still reported. The lookup is of the
+ *          newest worker, the last one a scan of the pool would reach.
+ */
+static int benchmark_scaling(unsigned int max_threads)
+{
+    thread_pool_config_t config = {
+        .min_threads = 0,
+        .max_threads = max_threads,
+    };
+    const int rounds = 5, lookups = 100000;
+    unsigned int spawned = 0, handle;
+    int complete = 1;
+    pthread_t thread;
+
+    if (init_thread_pool(&config) == ERROR)
+    {
+        printf("Cannot start the pool\n");
+        return 1;
+    }
+
+    report_begin("scaling");
+    report_string("backend", "signal");
+    report_int("rounds", rounds);
+    report_open("sizes", '[');
+    for (unsigned int size = 1; complete; size *= 10)
+    {
+        long long stop_total = 0, resume_total = 0, lookup_total, start;
+        int stopped = 0;
+
+        size = size < max_threads ? size : max_threads;
+        for (; spawned < size; spawned++)
+        {
+            if (spawn_thread(idle_body, NULL, &thread) == ERROR)
+            {
+                break;
+            }
+        }
+        if (spawned < size)
+        {
+            complete = 0;
+            size = spawned;
+            if (size == 0)
+            {
+                break;
+            }
+        }
+
+        start = clock_ns(CLOCK_MONOTONIC);
+        for (int i = 0; i < lookups; i++)
+        {
+            complete &= (get_thread_handle(thread, &handle) != ERROR);
+        }
+        lookup_total = clock_ns(CLOCK_MONOTONIC) - start;
+
+        for (int round = 0; round < rounds; round++)
+        {
+            start = clock_ns(CLOCK_MONOTONIC);
+            stopped = stop_all();
+            stop_total += clock_ns(CLOCK_MONOTONIC) - start;
+            start = clock_ns(CLOCK_MONOTONIC);
+            resume_all();
+            resume_total += clock_ns(CLOCK_MONOTONIC) - start;
+            complete &= (stopped == (int)size);
+        }
+
+        report_open(NULL, '{');
+        report_int("threads", size);
+        report_int("stopped", stopped);
+        report_int("stop_all_us", stop_total / rounds / 1000);
+        report_int("resume_all_us", resume_total / rounds / 1000);
+        report_double("lookup_ns", (double)lookup_total / lookups);
+        report_close('}');
+
+        if (size == max_threads)
+        {
+            break;
+        }
+    }
+    report_close(']');
+    report_end();
+
+    return complete ? 0 : 1;
+}
+
+/**
+ * @brief Times the start of fresh workers and of workers spawned after the first ones retired.
+ * @param threads The number of workers of each round.
+ * @param stack_kb The size of the pooled stacks in kilobytes, or 0 for the stacks of the C library.
+ * @param flags The `STACK_POOL_*` flags of the pool.
+ * @return Returns 0 if every worker of both rounds started, otherwise 1.
+ * @details Each worker is spawned once the previous one has started, and every worker stays alive until the
+ *          round ends, so each spawn creates a thread. The second round reuses the slots of the first, so on pooled
+ *          stacks every worker starts on the stack its predecessor left.
+ */
+static int benchmark_spawn(unsigned int threads, unsigned int stack_kb, unsigned int flags)
+{
+    thread_pool_config_t config = {
+        .min_threads = 0,
+        .max_threads = threads,
+        .idle_timeout_ms = 1,
+        .stack_size = (size_t)stack_kb * 1024,
+        .guard_size = (size_t)sysconf(_SC_PAGESIZE),
+        .stack_flags = flags,
+    };
+    static const char *const rounds[] = { "fresh", "recycled" };
+    long long *samples[] = { latency_ns, resume_ns };
+    long long rss_kb[2];
+    stack_pool_stats_t stacks;
+    int complete = 1;
+
+    if (init_thread_pool(&config) == ERROR)
+    {
+        printf("Cannot start the pool\n");
+        return 1;
+    }
+
+    for (int round = 0; round < 2; round++)
+    {
+        atomic_store(&spawns_started, 0);
+        atomic_store(&spawns_held, 1);
+        for (unsigned int i = 0; i < threads; i++)
+        {
+            long long begin = clock_ns(CLOCK_MONOTONIC);
+            if (spawn_thread(start_body, (void *)(intptr_t)i, NULL) == ERROR)
+            {
+                complete = 0;
+                break;
+            }
+            while (atomic_load(&spawns_started) <= (int)i)
+            {
+                sched_yield();
+            }
+            samples[round][i] = started_ns[i] - begin;
+        }
+        rss_kb[round] = resident_kb();
+
+        /* Let every worker return and retire, so the next round creates threads again */
+        atomic_store(&spawns_held, 0);
+        futex_wake(&spawns_held, INT_MAX);
+        while (get_pool_size() != 0)
+        {
+            usleep(1000);
+        }
+    }
+
+    report_begin("spawn");
+    report_int("threads", threads);
+    report_int("stack_kb", stack_kb);
+    report_string("flags", flags == 0 ? "none" : flags == STACK_POOL_PREFAULT ? "prefault" : "huge");
+    report_open("rounds", '[');
+    for (int round = 0; round < 2; round++)
+    {
+        report_open(NULL, '{');
+        report_string("round", rounds[round]);
+        report_int("rss_kb", rss_kb[round]);
+        report_latency("spawn_to_start", samples[round], (int)threads);
+        report_close('}');
+    }
+    report_close(']');
+    if (get_stack_pool_stats(&stacks) != ERROR)
+    {
+        report_open("stack_pool", '{');
+        report_int("mapped", (long long)stacks.mapped);
+        report_int("reused", (long long)stacks.reused);
+        report_int("mapped_kb", (long long)(stacks.mapped_bytes / 1024));
+        report_close('}');
+    }
+    report_end();
+
+    return complete ? 0 : 1;
+}
+
+/**
+ * @brief Measures the resume+stop round trip of one worker, with every other worker stopped.
+ * @param thread The worker to switch.
+ * @param rounds Number of round trips.
+ * @param label Name of the suspension mode.
+ * @return Returns 0 if every round trip succeeded, otherwise 1.
+ */
+static int measure_switch(pthread_t thread, int rounds, const char *label)
+{
+    long long start;
+    int measured = 0;
+
+    for (int round = 0; round < rounds && round < MAX_SAMPLES; round++)
+    {
+        start = clock_ns(CLOCK_MONOTONIC);
+        if (resume_thread(thread) == ERROR || stop_thread(thread) == ERROR)
+        {
+            return 1;
+        }
+        latency_ns[measured++] = clock_ns(CLOCK_MONOTONIC) - start;
+    }
+
+    report_latency(label, latency_ns, measured);
+
+    return 0;
+}
+
+/**
+ * @brief Compares the switch latency of signal-based and cooperative suspension.
+ * @param rounds Number of round trips per mode, capped at `MAX_SAMPLES`.
+ * @return Returns 0 on success.
+ */
+static int benchmark_switch(int rounds)
+{
+    int status = 0;
+
+    if (NUMBER_OF_THREADS < 2)
+    {
+        printf("At least two threads are needed\n");
+        return 1;
+    }
+
+    /* Keep only the measured worker runnable */
+    stop_all();
+    report_begin("switch");
+    report_int("threads", NUMBER_OF_THREADS);
+    status |= measure_switch(threads[0], rounds, "signal");
+    status |= measure_switch(threads[1], rounds, "cooperative");
+    report_end();
+
+    return status;
+}
+
+/**
+ * @brief Measures the user-context backend: yield cost and stop/resume round trip.
+ * @param carriers Number of carrier pthreads.
+ * @param seconds Duration of the yield measurement.
+ * @return Returns 0 on success.
+ */
+static int benchmark_tasks(unsigned int carriers, int seconds)
+{
+    long long start, elapsed, yields = 0;
+    carrier_stats_t stats[MAX_CONTROLLERS];
+    int measured = 0;
+
+    if (carriers > MAX_CONTROLLERS)
+    {
+        carriers = MAX_CONTROLLERS;
+    }
+    if (init_tasks(TASK_BACKEND_USER_CONTEXT, carriers, yield_body, NULL) == ERROR)
+    {
+        printf("Cannot start the tasks\n");
+        return 1;
+    }
+
+    /* Yield throughput of the whole pool */
+    start = clock_ns(CLOCK_MONOTONIC);
+    sleep(seconds);
+    elapsed = clock_ns(CLOCK_MONOTONIC) - start;
+    for (int i = 0; i < NUMBER_OF_THREADS; i++)
+    {
+        yields += task_yields[i];
+    }
+
+    /* Round trip of one task while the others keep yielding */
+    for (int round = 0; round < 1000; round++)
+    {
+        start = clock_ns(CLOCK_MONOTONIC);
+        if (stop_task(0) == ERROR || resume_task(0) == ERROR)
+        {
+            break;
+        }
+        latency_ns[measured++] = clock_ns(CLOCK_MONOTONIC) - start;
+    }
+
+    /* Read the carriers before they are torn down */
+    for (unsigned int i = 0; i < carriers; i++)
+    {
+        get_carrier_stats(i, &stats[i]);
+    }
+
+    atomic_store(&tasks_running, 0);
+    wait_tasks();
+
+    report_begin("tasks");
+    report_string("backend", "user-context");
+#ifdef USE_UCONTEXT
+    report_string("switch", "swapcontext");
+#else
+    report_string("switch", "hand-written");
+#endif
+    report_int("tasks", NUMBER_OF_THREADS);
+    report_int("carriers", carriers);
+    report_double("yields_per_s", (double)yields * 1e9 / (double)elapsed);
+    report_double("ns_per_yield", (double)elapsed * carriers / (double)(yields ? yields : 1));
+    report_latency("stop_resume", latency_ns, measured);
+    report_open("carrier_stats", '[');
+    for (unsigned int i = 0; i < carriers; i++)
+    {
+        report_open(NULL, '{');
+        report_int("carrier", i);
+        report_double("utilization", stats[i].utilization);
+        report_int("tasks_run", (long long)stats[i].tasks_run);
+        report_int("steals", (long long)stats[i].steals);
+        report_close('}');
+    }
+    report_close(']');
+    report_end();
+
+    return measured == 1000 ? 0 : 1;
+}
+
+/**
+ * @brief Runs concurrent controllers for a while and reports transitions per second.
+ * @param seconds Duration of the run.
+ * @return Returns 0 if every transition succeeded and the final state is consistent, otherwise 1.
+ */
+static int benchmark_transitions(int seconds)
+{
+    pthread_t controller_threads[MAX_CONTROLLERS];
+    long long total = 0, failed = 0, start, elapsed;
+    LinkedList running_list;
+    int running_count = 0;
+
+    start = clock_ns(CLOCK_MONOTONIC);
+    for (int i = 0; i < controllers; i++)
+    {
+        pthread_create(&controller_threads[i], NULL, controller_body, (void *)(intptr_t)i);
+    }
+    sleep(seconds);
+    atomic_store(&running, 0);
+    for (int i = 0; i < controllers; i++)
+    {
+        pthread_join(controller_threads[i], NULL);
+        total += transitions[i];
+        failed += failures[i];
+    }
+    elapsed = clock_ns(CLOCK_MONOTONIC) - start;
+
+    /* Every controller finishes a full stop+resume sweep, so every worker must be running again */
+    init_list(&running_list);
+    get_threads_in_state(THREAD_STATE_RUNNING, &running_list);
+    for (Node *node = running_list.head; node != NULL; node = node->next)
+    {
+        running_count++;
+    }
+
+    report_begin("transitions");
+    report_string("backend", "signal");
+    report_int("threads", NUMBER_OF_THREADS);
+    report_int("controllers", controllers);
+    report_int("serialized", serialized);
+    report_int("transitions", total);
+    report_int("failed_transitions", failed);
+    report_int("running_at_end", running_count);
+    report_double("transitions_per_s", (double)total * 1e9 / (double)elapsed);
+    report_end();
+
+    return (failed == 0 && running_count == NUMBER_OF_THREADS) ? 0 : 1;
+}
+
+#ifdef POSIX_TIMER
+/**
+ * @brief Adds the running time of every worker to the total of its priority.
+ * @param run_ns Totals indexed by priority, `i % 3` for worker `i`.
+ * @param threads Number of workers.
+ * @param sign 1 to add the current times, -1 to subtract them.
+ */
+static void add_run_by_priority(long long *run_ns, unsigned int threads, int sign)
+{
+    thread_stats_snapshot_t *snapshots = (thread_stats_snapshot_t *)malloc(threads * sizeof(*snapshots));
+    unsigned int count = snapshots != NULL ? get_all_thread_stats(snapshots, threads) : 0;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        run_ns[snapshots[i].index % 3] += sign * (long long)snapshots[i].run_ns;
+    }
+    free(snapshots);
+}
+
+/**
+ * @brief Runs busy workers under the tick scheduler and reports its tick and dispatch latencies.
+ * @param threads Number of workers; worker `i` gets priority `i % 3`.
+ * @param seconds Duration of the run.
+ * @return Returns 0 if the scheduler dispatched and the lower priorities never ran, otherwise 1.
+ * @details The workers of the highest priority share the CPU one time slice each, so every slice ends in a
+ *          preemption. Running times need the statistics; built with `-DTHREAD_STATS=0` they read 0.
+ */
+static int benchmark_tick(unsigned int threads, int seconds)
+{
+    thread_pool_config_t config = {
+        .min_threads = 0,
+        .max_threads = threads,
+    };
+    long long run_ns[3] = { 0 };
+    unsigned int top = threads < 3 ? threads - 1 : 2;
+    tick_scheduler_stats_t stats;
+    pthread_t thread;
+    int lower_ran = 0;
+
+    if (init_thread_pool(&config) == ERROR)
+    {
+        printf("Cannot start the pool\n");
+        return 1;
+    }
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        if (spawn_thread(busy_body, (void *)(intptr_t)i, &thread) == ERROR ||
+            set_thread_priority(thread, i % 3) == ERROR)
+        {
+            return 1;
+        }
+    }
+
+    add_run_by_priority(run_ns, threads, -1);
+    set_callback(increment_tick);
+    if (!osEE_linux_system_timer_init())
+    {
+        printf("Cannot start the system tick\n");
+        return 1;
+    }
+    sleep(seconds);
+    osEE_linux_system_timer_stop();
+    get_tick_scheduler_stats(&stats);
+    add_run_by_priority(run_ns, threads, 1);
+
+    report_begin("tick");
+    report_string("backend", "signal");
+    report_int("threads", threads);
+    report_int("tick_us", SYSTEM_TICK_US);
+    report_int("time_slice_ticks", SCHED_TIME_SLICE);
+    report_int("ticks", (long long)stats.ticks);
+    report_int("missed_ticks", (long long)stats.missed_ticks);
+    report_int("dispatches", (long long)stats.dispatches);
+    report_int("preemptions", (long long)stats.preemptions);
+    report_int("tick_latency_mean_ns", (long long)stats.tick_latency_mean_ns);
+    report_int("tick_latency_max_ns", (long long)stats.tick_latency_max_ns);
+    report_int("dispatch_latency_mean_ns", (long long)stats.dispatch_latency_mean_ns);
+    report_int("dispatch_latency_max_ns", (long long)stats.dispatch_latency_max_ns);
+    report_open("run_ms_by_priority", '[');
+    for (unsigned int priority = 0; priority <= top; priority++)
+    {
+        report_open(NULL, '{');
+        report_int("priority", priority);
+        report_int("run_ms", run_ns[priority] / 1000000);
+        report_close('}');
+        lower_ran |= (priority < top && run_ns[priority] != 0);
+    }
+    report_close(']');
+    report_end();
+
+    return (stats.dispatches != 0 && !lower_ran) ? 0 : 1;
+}
+#endif
+
+/**
+ * @brief Submits small functions to the executor and reports its throughput and latency.
+ * @param workers Number of executor workers.
+ * @param tasks Number of functions submitted.
+ * @param batch Functions per `submit_batch` call; 1 uses `submit`.
+ * @return Returns 0 if every future returned its own argument, otherwise 1.
+ * @details Functions are submitted in windows of one queue per worker and the window is joined before the next
+ *          one, so the futures never run out. Latency runs from the submission of a window to the completion of each
+ *          function, so it includes the wake-up of parked workers.
+ */
+static int benchmark_executor(unsigned int workers, int tasks, int batch)
+{
+    thread_pool_config_t config = {
+        .min_threads = 0,
+        .max_threads = workers,
+    };
+    const int queue_capacity = 256;
+    int window = (int)workers * queue_capacity;
+    future_t **pending = (future_t **)malloc((size_t)window * sizeof(future_t *));
+    void **args = (void **)malloc((size_t)window * sizeof(void *));
+    long long begin, submitted_ns, elapsed;
+    int measured = 0, wrong = 0;
+
+    if (pending == NULL || args == NULL || init_thread_pool(&config) == ERROR ||
+        !executor_start(workers, (size_t)queue_capacity))
+    {
+        printf("Cannot start the executor\n");
+        return 1;
+    }
+
+    begin = clock_ns(CLOCK_MONOTONIC);
+    for (int first = 0; first < tasks; first += window)
+    {
+        int count = tasks - first < window ? tasks - first : window;
+        int filled = 0;
+
+        submitted_ns = clock_ns(CLOCK_MONOTONIC);
+        while (filled < count)
+        {
+            if (batch > 1)
+            {
+                int chunk = count - filled < batch ? count - filled : batch;
+                for (int i = 0; i < chunk; i++)
+                {
+                    args[filled + i] = (void *)(intptr_t)(first + filled + i);
+                }
+                filled += (int)submit_batch(executor_task, &args[filled], (size_t)chunk, &pending[filled]);
+            }
+            else
+            {
+                pending[filled] = submit(executor_task, (void *)(intptr_t)(first + filled));
+                filled++;
+            }
+        }
+        for (int i = 0; i < count; i++)
+        {
+            wrong += future_join(pending[i]) != (void *)(intptr_t)(first + i);
+            if (first + i < MAX_SAMPLES)
+            {
+                latency_ns[measured++] = completed_ns[first + i] - submitted_ns;
+            }
+        }
+    }
+    elapsed = clock_ns(CLOCK_MONOTONIC) - begin;
+    executor_stop();
+
+    report_begin("executor");
+    report_int("workers", workers);
+    report_int("tasks", tasks);
+    report_int("batch", batch);
+    report_int("wrong_results", wrong);
+    report_double("tasks_per_s", (double)tasks * 1e9 / (double)elapsed);
+    report_latency("submit_to_completion", latency_ns, measured);
+    report_end();
+
+    free(pending);
+    free(args);
+
+    return wrong == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Runs three periodic control loops under a policy and reports their timing counters.
+ * @param name The policy: `rm`, `edf` or `deadline`.
+ * @param seconds Duration of the run.
+ * @return Returns 0 if every loop completed jobs and the overrunning loop was caught, otherwise 1.
+ * @details The first two loops fit their budgets; the third needs 12 ms of CPU in a budget of 8 ms, so each of its
+ *          jobs is stopped when the budget runs out and misses its deadline.
+ */
+static int benchmark_periodic(const char *name, int seconds)
+{
+    thread_pool_config_t config = {
+        .min_threads = 0,
+        .max_threads = 3,
+    };
+    pthread_t loops[3];
+    periodic_stats_t stats;
+    sched_policy_t policy;
+    int failed = 0;
+
+    if (strcmp(name, "rm") == 0)
+    {
+        policy = SCHED_POLICY_RATE_MONOTONIC;
+    }
+    else if (strcmp(name, "edf") == 0)
+    {
+        policy = SCHED_POLICY_EDF;
+    }
+    else if (strcmp(name, "deadline") == 0)
+    {
+        policy = SCHED_POLICY_DEADLINE;
+    }
+    else
+    {
+        printf("Unknown policy %s\n", name);
+        return 1;
+    }
+
+    if (init_thread_pool(&config) == ERROR || set_sched_policy(policy) == ERROR)
+    {
+        printf("Cannot start the pool\n");
+        return 1;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        periodic_params_t params = {
+            .period_ns = loop_timing_ms[i][0] * 1000000,
+            .budget_ns = loop_timing_ms[i][1] * 1000000,
+            .deadline_ns = 0,
+        };
+        if (spawn_thread(control_loop_body, (void *)(intptr_t)i, &loops[i]) == ERROR ||
+            set_thread_period(loops[i], &params) == ERROR)
+        {
+            printf("Cannot make loop %d periodic\n", i);
+            return 1;
+        }
+    }
+    sleep(seconds);
+
+    report_begin("periodic");
+    report_string("policy", name);
+    report_open("loops", '[');
+    for (int i = 0; i < 3; i++)
+    {
+        get_periodic_stats(loops[i], &stats);
+        clear_thread_period(loops[i]);
+        report_open(NULL, '{');
+        report_int("period_ms", (long long)loop_timing_ms[i][0]);
+        report_int("budget_ms", (long long)loop_timing_ms[i][1]);
+        report_int("work_ms", (long long)loop_timing_ms[i][2]);
+        report_int("jobs", (long long)stats.jobs);
+        report_int("overruns", (long long)stats.overruns);
+        report_int("deadline_misses", (long long)stats.deadline_misses);
+        report_int("preemptions", (long long)stats.preemptions);
+        report_int("max_response_us", (long long)stats.max_response_ns / 1000);
+        report_close('}');
+        failed |= stats.jobs == 0 || (i == 2 && stats.overruns == 0);
+    }
+    report_close(']');
+    report_end();
+
+    return failed;
+}
+
+/**
+ * @brief Measures how fast resumed workers make progress again under a placement policy.
+ * @param config The pool configuration holding the placement.
+ * @param name The name of the policy, for the report.
+ * @param rounds Number of stop/resume rounds over the whole pool.
+ * @return Returns 0 if every stop and resume succeeded, otherwise 1.
+ * @details Each worker is stopped while the others keep walking their working sets, then resumed; the sample is the
+ *          time from `resume_thread` until the worker's step counter moves. Unpinned workers may come back on another
+ *          CPU with cold caches, pinned ones return to the CPU they left.
+ */
+static int benchmark_placement(thread_pool_config_t *config, const char *name, int rounds)
+{
+    int misses_fd, migrations_fd;
+    long long steps = 0, misses, migrations;
+    int measured = 0, failed = 0;
+
+    /* Counters inherited by every worker created from now on */
+    misses_fd = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    migrations_fd = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS);
+
+    if (init_thread_pool(config) == ERROR)
+    {
+        printf("Cannot start the pool\n");
+        return 1;
+    }
+    for (int i = 0; i < NUMBER_OF_THREADS; i++)
+    {
+        if (spawn_thread(walk_body, NULL, &placed_threads[i]) == ERROR)
+        {
+            return 1;
+        }
+    }
+    usleep(100000);  /* Let every worker warm its working set */
+
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int i = 0; i < NUMBER_OF_THREADS; i++)
+        {
+            unsigned long before;
+            long long start;
+
+            if (stop_thread(placed_threads[i]) == ERROR)
+            {
+                failed++;
+                continue;
+            }
+            usleep(1000);  /* The others run meanwhile and may take the worker's CPU */
+
+            before = atomic_load_explicit(&progress[i].steps, memory_order_relaxed);
+            start = clock_ns(CLOCK_MONOTONIC);
+            if (resume_thread(placed_threads[i]) == ERROR)
+            {
+                failed++;
+                continue;
+            }
+            while (atomic_load_explicit(&progress[i].steps, memory_order_relaxed) == before)
+            {
+                sched_yield();
+            }
+            if (measured < MAX_SAMPLES)
+            {
+                latency_ns[measured++] = clock_ns(CLOCK_MONOTONIC) - start;
+            }
+        }
+    }
+
+    misses = read_counter(misses_fd);
+    migrations = read_counter(migrations_fd);
+    for (int i = 0; i < NUMBER_OF_THREADS; i++)
+    {
+        steps += (long long)atomic_load(&progress[i].steps);
+    }
+
+    /* Counters that perf cannot provide here are reported as -1 */
+    report_begin("placement");
+    report_string("backend", "signal");
+    report_string("placement", name);
+    report_int("threads", NUMBER_OF_THREADS);
+    report_latency("resume_to_progress", latency_ns, measured);
+    report_double("cache_misses_per_1k_steps", misses >= 0 ? (double)misses * 1000.0 / (double)(steps ? steps : 1) : -1.0);
+    report_int("cpu_migrations", migrations);
+    report_end();
+
+    return failed == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Parses a placement policy given on the command line.
+ * @param text `none`, `compact`, `scatter`, `numa` or `list:<cpu>,<cpu>,...`.
+ * @param config Receives the policy and the CPU list.
+ * @param cpus Storage for the CPU list.
+ * @return Returns 1 if the policy is valid, otherwise 0.
+ */
+static int parse_placement(const char *text, thread_pool_config_t *config, int *cpus)
+{
+    if (strcmp(text, "none") == 0)
+    {
+        config->placement = PLACEMENT_NONE;
+    }
+    else if (strcmp(text, "compact") == 0)
+    {
+        config->placement = PLACEMENT_COMPACT;
+    }
+    else if (strcmp(text, "scatter") == 0)
+    {
+        config->placement = PLACEMENT_SCATTER;
+    }
+    else if (strcmp(text, "numa") == 0)
+    {
+        config->placement = PLACEMENT_NUMA_NODE;
+    }
+    else if (strncmp(text, "list:", 5) == 0)
+    {
+        const char *cursor = text + 5;
+        char *end;
+
+        config->placement = PLACEMENT_CPU_LIST;
+        config->cpus = cpus;
+        config->cpu_count = 0;
+        while (*cursor != '\0' && config->cpu_count < MAX_PLACEMENT_CPUS)
+        {
+            cpus[config->cpu_count++] = (int)strtol(cursor, &end, 10);
+            if (end == cursor)
+            {
+                return 0;
+            }
+            cursor = *end == ',' ? end + 1 : end;
+        }
+        return config->cpu_count != 0;
+    }
+    else
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Entry point of the benchmark.
+ * @return Returns 0 on success.
+ */
+int main(int argc, char *argv[])
+{
+    const char *mode;
+
+    /* Leading options: --text switches every report from JSON to aligned text, --trace records a timeline */
+    while (argc > 1 && strncmp(argv[1], "--", 2) == 0)
+    {
+        int used = 1;
+
+        if (strcmp(argv[1], "--text") == 0)
+        {
+            json_output = 0;
+        }
+        else if (strcmp(argv[1], "--trace") == 0 && argc > 2)
+        {
+            if (!trace_start(argv[2], 0))
+            {
+                return 1;
+            }
+            atexit(trace_stop);
+            used = 2;
+        }
+        else
+        {
+            break;
+        }
+        argv[used] = argv[0];
+        argv += used;
+        argc -= used;
+    }
+    mode = argc > 1 ? argv[1] : "stop";
+
+    if (strcmp(mode, "tasks") == 0)
+    {
+        int carriers = argc > 2 ? atoi(argv[2]) : 1;
+        int seconds = argc > 3 ? atoi(argv[3]) : 1;
+        return benchmark_tasks(carriers > 0 ? carriers : 1, seconds > 0 ? seconds : 1);
+    }
+
+    if (strcmp(mode, "placement") == 0)
+    {
+        static int cpus[MAX_PLACEMENT_CPUS];
+        thread_pool_config_t config = {
+            .min_threads = 0,
+            .max_threads = NUMBER_OF_THREADS,
+        };
+        const char *policy = argc > 2 ? argv[2] : "none";
+        int rounds = argc > 3 ? atoi(argv[3]) : 100;
+        if (!parse_placement(policy, &config, cpus))
+        {
+            printf("Unknown placement %s\n", policy);
+            return 1;
+        }
+        main_thread = pthread_self();
+        init_signals();
+        return benchmark_placement(&config, policy, rounds > 0 ? rounds : 1);
+    }
+
+    if (strcmp(mode, "pingpong") == 0)
+    {
+        int rounds = argc > 2 ? atoi(argv[2]) : 10000;
+        main_thread = pthread_self();
+        init_signals();
+        return benchmark_pingpong(rounds > 0 ? rounds : 1);
+    }
+
+    if (strcmp(mode, "tick") == 0)
+    {
+#ifdef POSIX_TIMER
+        int threads = argc > 2 ? atoi(argv[2]) : 6;
+        int seconds = argc > 3 ? atoi(argv[3]) : 1;
+        main_thread = pthread_self();
+        init_signals();
+        return benchmark_tick(threads > 0 ? (unsigned int)threads : 1, seconds > 0 ? seconds : 1);
+#else
+        printf("Build with -DPOSIX_TIMER to run the tick scheduler\n");
+        return 1;
+#endif
+    }
+
+    if (strcmp(mode, "executor") == 0)
+    {
+        int workers = argc > 2 ? atoi(argv[2]) : 4;
+        int tasks = argc > 3 ? atoi(argv[3]) : 100000;
+        int batch = argc > 4 ? atoi(argv[4]) : 1;
+        main_thread = pthread_self();
+        init_signals();
+        return benchmark_executor(workers > 0 && workers <= EXECUTOR_MAX_WORKERS ? (unsigned int)workers : 4,
+                                  tasks > 0 ? tasks : 1, batch > 0 ? batch : 1);
+    }
+
+    if (strcmp(mode, "spawn") == 0)
+    {
+        int threads = argc > 2 ? atoi(argv[2]) : 1000;
+        int stack_kb = argc > 3 ? atoi(argv[3]) : 64;
+        const char *flags = argc > 4 ? argv[4] : "none";
+        main_thread = pthread_self();
+        init_signals();
+        return benchmark_spawn(threads > 0 && threads <= MAX_SAMPLES ? (unsigned int)threads : 1000,
+                               stack_kb > 0 ? (unsigned int)stack_kb : 0,
+                               strcmp(flags, "prefault") == 0 ? STACK_POOL_PREFAULT :
+                               strcmp(flags, "huge") == 0 ? STACK_POOL_HUGEPAGES : 0);
+    }
+
+    if (strcmp(mode, "periodic") == 0)
+    {
+        int seconds = argc > 3 ? atoi(argv[3]) : 1;
+        main_thread = pthread_self();
+        init_signals();
+        return benchmark_periodic(argc > 2 ? argv[2] : "rm", seconds > 0 ? seconds : 1);
+    }
+
+    if (strcmp(mode, "scaling") == 0)
+    {
+        int max_threads = argc > 2 ? atoi(argv[2]) : 10000;
+        main_thread = pthread_self();
+        init_signals();
+        return benchmark_scaling(max_threads > 0 ? (unsigned int)max_threads : 1);
+    }
+
+    main_thread = pthread_self();
+    init_signals();
+    init_threads_with_body(strcmp(mode, "switch") == 0 ? busy_body : idle_body, NULL);
+
+    if (strcmp(mode, "switch") == 0)
+    {
+        int rounds = argc > 2 ? atoi(argv[2]) : 1000;
+        return benchmark_switch(rounds > 0 ? rounds : 1000);
+    }
+
+    if (strcmp(mode, "stop") == 0)
+    {
+        return benchmark_stop();
+    }
+
+    if (strcmp(mode, "roundtrip") == 0)
+    {
+        int rounds = argc > 2 ? atoi(argv[2]) : 100;
+        return benchmark_roundtrip(rounds > 0 ? rounds : 1);
+    }
+
+    if (strcmp(mode, "timers") == 0)
+    {
+        int count = argc > 2 ? atoi(argv[2]) : 100000;
+        return benchmark_timers(count > 0 ? count : 1);
+    }
+
+    if (strcmp(mode, "stopall") == 0)
+    {
+        int rounds = argc > 2 ? atoi(argv[2]) : 100;
+        return benchmark_stop_all(rounds > 0 ? rounds : 1);
+    }
+
+    if (strcmp(mode, "async") == 0)
+    {
+        int rounds = argc > 2 ? atoi(argv[2]) : 100;
+        return benchmark_async(rounds > 0 ? rounds : 1);
+    }
+
+    if (strcmp(mode, "transitions") == 0)
+    {
+        int seconds = argc > 3 ? atoi(argv[3]) : 2;
+        controllers = argc > 2 ? atoi(argv[2]) : 4;
+        serialized = argc > 4 && strcmp(argv[4], "serialized") == 0;
+        if (controllers < 1 || controllers > MAX_CONTROLLERS)
+        {
+            printf("controllers must be between 1 and %d\n", MAX_CONTROLLERS);
+            return 1;
+        }
+        return benchmark_transitions(seconds);
+    }
+
+    printf("Usage: %s [--text] [--trace file] [stop | roundtrip [rounds] | pingpong [rounds] | stopall [rounds] | async [rounds] |"
+           " scaling [max threads] | tick [threads] [seconds] | periodic [policy] [seconds] | timers [count] |"
+           " executor [workers] [tasks] [batch] | spawn [threads] [stack kb] [flags] | switch [rounds] |"
+           " tasks [carriers] [seconds] | transitions [controllers] [seconds] [serialized] | placement [policy] [rounds]]\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,312 @@
+/**
+ * @file cpu_topology.c
+ * @brief Implementation of CPU and NUMA topology discovery from sysfs and of the thread placement policies.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "cpu_topology.h"
+
+/**
+ * @brief Position of a CPU in the machine, used to order the CPUs.
+ */
+typedef struct {
+    int cpu;            /**< CPU number. */
+    int node;           /**< NUMA node. */
+    int package;        /**< Physical package (socket). */
+    int core;           /**< Core ID within the package. */
+    int core_rank;      /**< Rank of the core among the cores of the node. */
+    int smt_rank;       /**< Rank of the CPU among the SMT siblings of its core. */
+} cpu_position_t;
+
+/**
+ * @brief Reads a small integer from a sysfs file.
+ * @param path The path of the file.
+ * @param fallback Value returned if the file cannot be read.
+ * @return Returns the value read, or `fallback`.
+ */
+static int read_sysfs_int(const char *path, int fallback)
+{
+    FILE *file = fopen(path, "r");
+    int value;
+
+    if (file == NULL)
+    {
+        return fallback;
+    }
+    if (fscanf(file, "%d", &value) != 1)
+    {
+        value = fallback;
+    }
+    fclose(file);
+
+    return value;
+}
+
+/**
+ * @brief Assigns every CPU of a sysfs CPU list such as `0-3,8-11` to a node.
+ * @param path The path of the `cpulist` file.
+ * @param node The node the listed CPUs belong to.
+ * @param node_of The per-CPU node table to fill.
+ * @return Returns 1 if the list was read, otherwise 0.
+ */
+static int read_node_cpulist(const char *path, int node, int *node_of)
+{
+    FILE *file = fopen(path, "r");
+    int first, last;
+    char separator;
+
+    if (file == NULL)
+    {
+        return 0;
+    }
+
+    while (fscanf(file, "%d", &first) == 1)
+    {
+        last = first;
+        separator = (char)fgetc(file);
+        if (separator == '-')
+        {
+            if (fscanf(file, "%d", &last) != 1)
+            {
+                break;
+            }
+            separator = (char)fgetc(file);
+        }
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+        {
+            node_of[cpu] = node;
+        }
+        if (separator != ',')
+        {
+            break;
+        }
+    }
+    fclose(file);
+
+    return 1;
+}
+
+/**
+ * @brief Orders CPUs so that siblings are adjacent: node, package, core, then CPU number.
+ */
+static int compare_compact(const void *a, const void *b)
+{
+    const cpu_position_t *x = (const cpu_position_t *)a;
+    const cpu_position_t *y = (const cpu_position_t *)b;
+
+    if (x->node != y->node)
+    {
+        return x->node - y->node;
+    }
+    if (x->package != y->package)
+    {
+        return x->package - y->package;
+    }
+    if (x->core != y->core)
+    {
+        return x->core - y->core;
+    }
+    return x->cpu - y->cpu;
+}
+
+/**
+ * @brief Orders CPUs so that neighbours are far apart: SMT rank, core rank, then node.
+ */
+static int compare_scatter(const void *a, const void *b)
+{
+    const cpu_position_t *x = (const cpu_position_t *)a;
+    const cpu_position_t *y = (const cpu_position_t *)b;
+
+    if (x->smt_rank != y->smt_rank)
+    {
+        return x->smt_rank - y->smt_rank;
+    }
+    if (x->core_rank != y->core_rank)
+    {
+        return x->core_rank - y->core_rank;
+    }
+    if (x->node != y->node)
+    {
+        return x->node - y->node;
+    }
+    return x->cpu - y->cpu;
+}
+
+/**
+ * @brief Reads the topology of the CPUs the calling thread may run on.
+ * @param topology Receives the topology.
+ * @return Returns 1 on success, 0 if the affinity of the calling thread cannot be read or memory is short.
+ * @details Machines without NUMA information in sysfs are reported as a single node 0. The CPUs are sorted in a
+ *          buffer of the call, so schedulers may detect their topologies concurrently.
+ */
+int topology_detect(cpu_topology_t *topology)
+{
+    cpu_position_t *positions;
+    char path[128];
+    cpu_set_t allowed;
+    unsigned int count = 0;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        return 0;
+    }
+    positions = (cpu_position_t *)malloc((size_t)CPU_COUNT(&allowed) * sizeof(*positions));
+    if (positions == NULL)
+    {
+        return 0;
+    }
+
+    /* Map every CPU to its node; CPUs of absent nodes stay on node 0 */
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        topology->node_of[cpu] = 0;
+    }
+    for (int node = 0; node < TOPOLOGY_MAX_NODES; node++)
+    {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        read_node_cpulist(path, node, topology->node_of);
+    }
+
+    /* Collect the usable CPUs with their package and core */
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+        {
+            continue;
+        }
+        positions[count].cpu = cpu;
+        positions[count].node = topology->node_of[cpu];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        positions[count].package = read_sysfs_int(path, 0);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+        positions[count].core = read_sysfs_int(path, cpu);
+        count++;
+    }
+    topology->cpu_count = count;
+
+    /* Rank cores within their node and CPUs within their core, walking the compact order */
+    qsort(positions, count, sizeof(positions[0]), compare_compact);
+    topology->node_count = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        cpu_position_t *previous = i > 0 ? &positions[i - 1] : NULL;
+
+        if (previous == NULL || previous->node != positions[i].node)
+        {
+            if (topology->node_count < TOPOLOGY_MAX_NODES)
+            {
+                topology->nodes[topology->node_count++] = positions[i].node;
+            }
+            positions[i].core_rank = 0;
+            positions[i].smt_rank = 0;
+        }
+        else if (previous->package != positions[i].package || previous->core != positions[i].core)
+        {
+            positions[i].core_rank = previous->core_rank + 1;
+            positions[i].smt_rank = 0;
+        }
+        else
+        {
+            positions[i].core_rank = previous->core_rank;
+            positions[i].smt_rank = previous->smt_rank + 1;
+        }
+        topology->compact[i] = positions[i].cpu;
+    }
+
+    qsort(positions, count, sizeof(positions[0]), compare_scatter);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        topology->scatter[i] = positions[i].cpu;
+    }
+    free(positions);
+
+    return count != 0;
+}
+
+/**
+ * @brief Computes the CPUs a worker may run on under a placement policy.
+ * @param topology The topology from `topology_detect`.
+ * @param policy The placement policy.
+ * @param cpus The explicit CPU list of `PLACEMENT_CPU_LIST`.
+ * @param cpu_count The length of `cpus`.
+ * @param index The index of the worker.
+ * @param set Receives the CPUs.
+ * @param node Receives the NUMA node the worker's memory should come from, or -1 for no preference.
+ * @return Returns 1 if `set` holds the placement, 0 if the worker is not pinned.
+ */
+int topology_place(const cpu_topology_t *topology, placement_policy_t policy, const int *cpus, unsigned int cpu_count,
+                   unsigned int index, cpu_set_t *set, int *node)
+{
+    int cpu;
+
+    CPU_ZERO(set);
+    *node = -1;
+
+    switch (policy)
+    {
+    case PLACEMENT_COMPACT:
+    case PLACEMENT_SCATTER:
+        if (topology->cpu_count == 0)
+        {
+            return 0;
+        }
+        cpu = (policy == PLACEMENT_COMPACT ? topology->compact : topology->scatter)[index % topology->cpu_count];
+        break;
+
+    case PLACEMENT_CPU_LIST:
+        if (cpus == NULL || cpu_count == 0 || cpus[index % cpu_count] < 0 || cpus[index % cpu_count] >= CPU_SETSIZE)
+        {
+            return 0;
+        }
+        cpu = cpus[index % cpu_count];
+        break;
+
+    case PLACEMENT_NUMA_NODE:
+        if (topology->node_count == 0)
+        {
+            return 0;
+        }
+        *node = topology->nodes[index % topology->node_count];
+        for (unsigned int i = 0; i < topology->cpu_count; i++)
+        {
+            if (topology->node_of[topology->compact[i]] == *node)
+            {
+                CPU_SET(topology->compact[i], set);
+            }
+        }
+        return 1;
+
+    default:
+        return 0;
+    }
+
+    CPU_SET(cpu, set);
+    *node = topology->node_of[cpu];
+    return 1;
+}
+
+/**
+ * @brief Makes the calling thread allocate its memory from a NUMA node.
+ * @param node The node.
+ * @return Returns 1 on success, 0 on failure.
+ * @details New pages the thread touches, including its stack, come from `node` while it has free memory.
+ */
+int topology_prefer_node(int node)
+{
+    unsigned long mask[TOPOLOGY_MAX_NODES / (8 * sizeof(unsigned long)) + 1] = {0};
+
+    if (node < 0 || node >= TOPOLOGY_MAX_NODES)
+    {
+        return 0;
+    }
+
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    return syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, TOPOLOGY_MAX_NODES + 1) == 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file cpu_topology.h
+ * @brief Header file for CPU and NUMA topology discovery and thread placement policies.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+
+/**
+ * @brief Maximum number of NUMA nodes tracked.
+ */
+#define TOPOLOGY_MAX_NODES 64
+
+/**
+ * @brief Policy used to pick the CPUs a worker may run on.
+ */
+typedef enum {
+    PLACEMENT_NONE = 0,     /**< Workers are not pinned; the kernel places them. */
+    PLACEMENT_COMPACT,      /**< Worker `i` on the `i`-th CPU, filling a core, then a node, before the next. */
+    PLACEMENT_SCATTER,      /**< Worker `i` on the `i`-th CPU, spreading over nodes, then cores, before SMT siblings. */
+    PLACEMENT_CPU_LIST,     /**< Worker `i` on CPU `cpus[i % cpu_count]` of an explicit list. */
+    PLACEMENT_NUMA_NODE     /**< Worker `i` on any CPU of the `i`-th node, round-robin, with node-local memory. */
+} placement_policy_t;
+
+/**
+ * @brief CPUs the process may run on, ordered for the placement policies.
+ */
+typedef struct {
+    unsigned int cpu_count;                 /**< Number of usable CPUs. */
+    unsigned int node_count;                /**< Number of NUMA nodes with usable CPUs. */
+    int compact[CPU_SETSIZE];               /**< Usable CPUs in compact order. */
+    int scatter[CPU_SETSIZE];               /**< Usable CPUs in scatter order. */
+    int node_of[CPU_SETSIZE];               /**< NUMA node of each CPU number. */
+    int nodes[TOPOLOGY_MAX_NODES];          /**< Node numbers with usable CPUs, ascending. */
+} cpu_topology_t;
+
+/**
+ * @brief Reads the topology of the CPUs the calling thread may run on.
+ * @param topology Receives the topology.
+ * @return Returns 1 on success, 0 if the affinity of the calling thread cannot be read or memory is short.
+ * @details Machines without NUMA information in sysfs are reported as a single node 0. Reentrant.
+ */
+int topology_detect(cpu_topology_t *topology);
+
+/**
+ * @brief Computes the CPUs a worker may run on under a placement policy.
+ * @param topology The topology from `topology_detect`.
+ * @param policy The placement policy.
+ * @param cpus The explicit CPU list of `PLACEMENT_CPU_LIST`.
+ * @param cpu_count The length of `cpus`.
+ * @param index The index of the worker.
+ * @param set Receives the CPUs.
+ * @param node Receives the NUMA node the worker's memory should come from, or -1 for no preference.
+ * @return Returns 1 if `set` holds the placement, 0 if the worker is not pinned.
+ */
+int topology_place(const cpu_topology_t *topology, placement_policy_t policy, const int *cpus, unsigned int cpu_count,
+                   unsigned int index, cpu_set_t *set, int *node);
+
+/**
+ * @brief Makes the calling thread allocate its memory from a NUMA node.
+ * @param node The node.
+ * @return Returns 1 on success, 0 on failure.
+ * @details New pages the thread touches, including its stack, come from `node` while it has free memory.
+ */
+int topology_prefer_node(int node);
+
+#endif /* CPU_TOPOLOGY_H */
@@ -0,0 +1,413 @@
+/**
+ * @file executor.c
+ * @brief Implementation of the task executor on workers of the managed pool.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details The queue of a worker is the bounded lock-free queue of the switching core. Submitters only enqueue and
+ *          its worker dequeues, except that an idle worker also takes from the queues of the others, so a worker
+ *          stopped with `stop_thread` does not hold its queued functions back.
+ *          A worker parks with a Dekker-style handshake: it publishes `sleeping` and then checks the queues, while a
+ *          submitter enqueues and then checks `sleeping`, with a full fence on both sides, so a submission is never
+ *          left in a queue whose worker sleeps.
+ */
+
+#define _GNU_SOURCE
+#include <limits.h>
+#include <stdlib.h>
+#include "executor.h"
+#include "../pthreads_switching/pthreads_switching.h"
+#include "../index_free_list/index_free_list.h"
+
+/**
+ * @brief A worker of the executor and its queue.
+ */
+typedef struct {
+    lockfree_queue_t queue;                 /**< Futures submitted to the worker. */
+    _Alignas(64) _Atomic uint32_t sleeping; /**< Futex word; non-zero while the worker is parked or about to park. */
+    unsigned int index;                     /**< Index of the worker. */
+} executor_worker_t;
+
+/**
+ * @brief The workers, their number, and the flag that keeps them running.
+ */
+static executor_worker_t executor_workers[EXECUTOR_MAX_WORKERS];
+static unsigned int worker_count = 0;
+static _Atomic uint32_t executor_running = 0;
+
+/**
+ * @brief Latch counted down by every worker that returns to the pool.
+ */
+static countdown_latch_t exit_latch;
+
+/**
+ * @brief Storage of the futures and the lock-free free list of their indices.
+ */
+static future_t *futures = NULL;
+static size_t future_capacity = 0;
+static index_free_list_t future_free;
+
+/**
+ * @brief Worker a submitting thread tries first; every thread walks the workers from its own cursor.
+ */
+static __thread unsigned int submit_cursor = 0;
+
+/**
+ * @brief Takes a future from the free list.
+ * @return Returns a future, or `NULL` if every future is in use.
+ */
+static future_t *future_pop(void)
+{
+    uint32_t index = index_free_list_pop(&future_free);
+
+    return index != INDEX_FREE_LIST_EMPTY ? &futures[index] : NULL;
+}
+
+/**
+ * @brief Gives a future back to the free list.
+ * @param future A future of the pool.
+ */
+static void future_push(future_t *future)
+{
+    index_free_list_push(&future_free, (uint32_t)(future - futures));
+}
+
+/**
+ * @brief Runs the function of a future and completes it.
+ * @param future The future.
+ * @details The joiner is only woken when it announced itself with `FUTURE_WAITING`, so completing a future that
+ *          nobody waits for yet costs no system call.
+ */
+static void run_future(future_t *future)
+{
+    future->result = future->fn(future->arg);
+    if (atomic_exchange_explicit(&future->state, FUTURE_DONE, memory_order_acq_rel) == FUTURE_WAITING)
+    {
+        futex_wake(&future->state, INT_MAX);
+    }
+}
+
+/**
+ * @brief Wakes a worker if it is parked.
+ * @param worker The worker.
+ * @details The fence orders the enqueue before the read of `sleeping`, against the opposite order in the worker.
+ */
+static void wake_worker(executor_worker_t *worker)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&worker->sleeping, memory_order_relaxed) &&
+        atomic_exchange_explicit(&worker->sleeping, 0, memory_order_relaxed))
+    {
+        futex_wake(&worker->sleeping, 1);
+    }
+}
+
+/**
+ * @brief Queues a future on the first worker from the caller's cursor that has room.
+ * @param future The future.
+ * @return Returns the worker, or `NULL` if every queue is full.
+ */
+static executor_worker_t *enqueue_future(future_t *future)
+{
+    for (unsigned int i = 0; i < worker_count; i++)
+    {
+        executor_worker_t *worker = &executor_workers[submit_cursor++ % worker_count];
+
+        if (lockfree_queue_enqueue(&worker->queue, future))
+        {
+            return worker;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Takes the next future of a worker, from its own queue first and then from the others.
+ * @param worker The worker.
+ * @param future Receives the future.
+ * @return Returns 1 if a future was taken, 0 if every queue is empty.
+ */
+static int take_future(executor_worker_t *worker, future_t **future)
+{
+    for (unsigned int i = 0; i < worker_count; i++)
+    {
+        executor_worker_t *victim = &executor_workers[(worker->index + i) % worker_count];
+
+        if (lockfree_queue_dequeue(&victim->queue, (void **)future))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Body of an executor worker: runs futures until the executor stops, parking while there is no work.
+ * @param arg The worker.
+ * @details The queues are checked once more after `sleeping` is published, so a submission that raced with the
+ *          decision to park is either seen here or wakes the worker. On stop the queues are drained first.
+ */
+static void worker_body(void *arg)
+{
+    executor_worker_t *worker = (executor_worker_t *)arg;
+    future_t *future;
+
+    for (;;)
+    {
+        if (take_future(worker, &future))
+        {
+            run_future(future);
+            continue;
+        }
+
+        atomic_store_explicit(&worker->sleeping, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (take_future(worker, &future))
+        {
+            atomic_store_explicit(&worker->sleeping, 0, memory_order_relaxed);
+            run_future(future);
+            continue;
+        }
+        if (!atomic_load(&executor_running))
+        {
+            break;
+        }
+        futex_wait(&worker->sleeping, 1, NULL);
+    }
+
+    latch_count_down(&exit_latch);
+}
+
+/**
+ * @brief Starts the executor on workers of the managed pool.
+ * @param workers The number of workers, at most `EXECUTOR_MAX_WORKERS`.
+ * @param queue_capacity The capacity of the queue of each worker.
+ * @return Returns 1 on success, 0 if the executor is running, the pool cannot spawn the workers or memory is short.
+ * @details The pool of futures holds twice what the queues can, so completed futures waiting to be joined do not
+ *          starve submissions.
+ */
+int executor_start(unsigned int workers, size_t queue_capacity)
+{
+    uint32_t stopped = 0;
+
+    if (workers == 0 || workers > EXECUTOR_MAX_WORKERS || queue_capacity == 0 ||
+        !atomic_compare_exchange_strong(&executor_running, &stopped, 1))
+    {
+        return 0;
+    }
+
+    future_capacity = 2 * (size_t)workers * queue_capacity;
+    futures = future_capacity < UINT32_MAX ? (future_t *)calloc(future_capacity, sizeof(future_t)) : NULL;
+    if (futures == NULL || !index_free_list_init(&future_free, future_capacity))
+    {
+        free(futures);
+        futures = NULL;
+        atomic_store(&executor_running, 0);
+        return 0;
+    }
+
+    /* Start the workers; on failure the started ones drain and return, and the missing ones are counted down */
+    latch_init(&exit_latch, workers);
+    worker_count = 0;
+    for (unsigned int i = 0; i < workers; i++)
+    {
+        executor_worker_t *worker = &executor_workers[i];
+
+        worker->index = i;
+        atomic_init(&worker->sleeping, 0);
+        if (!lockfree_queue_init(&worker->queue, queue_capacity))
+        {
+            break;
+        }
+        worker_count = i + 1;
+        if (spawn_thread(worker_body, worker, NULL) == ERROR)
+        {
+            lockfree_queue_destroy(&worker->queue);
+            worker_count = i;
+            break;
+        }
+    }
+    if (worker_count < workers)
+    {
+        for (unsigned int i = worker_count; i < workers; i++)
+        {
+            latch_count_down(&exit_latch);
+        }
+        executor_stop();
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Stops the executor once the queued functions have run, and waits for the workers to return to the pool.
+ * @details Futures that were not joined are released with the executor. No submission may race with the stop.
+ */
+void executor_stop(void)
+{
+    if (futures == NULL)
+    {
+        return;
+    }
+
+    atomic_store(&executor_running, 0);
+    for (unsigned int i = 0; i < worker_count; i++)
+    {
+        atomic_store(&executor_workers[i].sleeping, 0);
+        futex_wake(&executor_workers[i].sleeping, 1);
+    }
+    latch_wait(&exit_latch);
+
+    for (unsigned int i = 0; i < worker_count; i++)
+    {
+        lockfree_queue_destroy(&executor_workers[i].queue);
+    }
+    worker_count = 0;
+    index_free_list_destroy(&future_free);
+    free(futures);
+    futures = NULL;
+    future_capacity = 0;
+}
+
+/**
+ * @brief Submits a function to the executor.
+ * @param fn The function.
+ * @param arg The argument of `fn`.
+ * @return Returns the future of the call, or `NULL` if the executor is stopped or every future is in use.
+ * @details The function runs on the caller when every queue is full, which slows down producers that outpace the workers.
+ */
+future_t *submit(task_fn_t fn, void *arg)
+{
+    executor_worker_t *worker;
+    future_t *future;
+
+    if (!atomic_load_explicit(&executor_running, memory_order_acquire) || (future = future_pop()) == NULL)
+    {
+        return NULL;
+    }
+
+    future->fn = fn;
+    future->arg = arg;
+    atomic_store_explicit(&future->state, FUTURE_PENDING, memory_order_relaxed);
+    worker = enqueue_future(future);
+    if (worker != NULL)
+    {
+        wake_worker(worker);
+    }
+    else
+    {
+        run_future(future);
+    }
+
+    return future;
+}
+
+/**
+ * @brief Submits the same function for several arguments, waking each worker at most once.
+ * @param fn The function.
+ * @param args The arguments, one call each.
+ * @param count The number of arguments.
+ * @param batch Receives the future of each call.
+ * @return Returns the number of calls submitted; they are the first of `args`.
+ * @details The calls are spread over the workers and the workers that received one are woken after the last
+ *          enqueue. When every queue is full the workers are woken before the caller runs the call itself.
+ */
+size_t submit_batch(task_fn_t fn, void *const *args, size_t count, future_t **batch)
+{
+    unsigned char touched[EXECUTOR_MAX_WORKERS] = { 0 };
+    size_t submitted;
+
+    if (!atomic_load_explicit(&executor_running, memory_order_acquire))
+    {
+        return 0;
+    }
+
+    for (submitted = 0; submitted < count; submitted++)
+    {
+        executor_worker_t *worker;
+        future_t *future = future_pop();
+
+        if (future == NULL)
+        {
+            break;
+        }
+        future->fn = fn;
+        future->arg = args[submitted];
+        atomic_store_explicit(&future->state, FUTURE_PENDING, memory_order_relaxed);
+        batch[submitted] = future;
+
+        worker = enqueue_future(future);
+        if (worker != NULL)
+        {
+            touched[worker->index] = 1;
+            continue;
+        }
+
+        /* Every queue is full: let the workers drain them while the caller runs this call */
+        for (unsigned int i = 0; i < worker_count; i++)
+        {
+            if (touched[i])
+            {
+                wake_worker(&executor_workers[i]);
+                touched[i] = 0;
+            }
+        }
+        run_future(future);
+    }
+
+    for (unsigned int i = 0; i < worker_count; i++)
+    {
+        if (touched[i])
+        {
+            wake_worker(&executor_workers[i]);
+        }
+    }
+
+    return submitted;
+}
+
+/**
+ * @brief Checks whether the function of a future has completed.
+ * @param future The future.
+ * @return Returns 1 if it has, otherwise 0.
+ */
+int future_done(future_t *future)
+{
+    return atomic_load_explicit(&future->state, memory_order_acquire) == FUTURE_DONE;
+}
+
+/**
+ * @brief Waits until the function of a future has completed and gives the future back.
+ * @param future The future; it must not be used afterwards.
+ * @return Returns the value returned by the function.
+ * @details Polls the future `FUTEX_SPIN_LIMIT` times, then announces itself with `FUTURE_WAITING` and parks until
+ *          the worker completes it.
+ */
+void *future_join(future_t *future)
+{
+    uint32_t state = atomic_load_explicit(&future->state, memory_order_acquire);
+    void *result;
+
+    for (int i = 0; i < FUTEX_SPIN_LIMIT && state != FUTURE_DONE; i++)
+    {
+        state = atomic_load_explicit(&future->state, memory_order_acquire);
+    }
+    while (state != FUTURE_DONE)
+    {
+        if (state == FUTURE_PENDING &&
+            !atomic_compare_exchange_weak_explicit(&future->state, &state, FUTURE_WAITING,
+                                                   memory_order_acquire, memory_order_acquire))
+        {
+            continue;
+        }
+        futex_wait(&future->state, FUTURE_WAITING, NULL);
+        state = atomic_load_explicit(&future->state, memory_order_acquire);
+    }
+
+    result = future->result;
+    future_push(future);
+
+    return result;
+}
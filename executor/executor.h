@@ -0,0 +1,102 @@
+/**
+ * @file executor.h
+ * @brief Header file for the task executor running submitted functions on pooled workers and returning futures.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details Every worker owns a bounded queue that any thread submits to and the worker drains; an idle worker
+ *          first takes work from the queues of the others, then parks on a futex until a submission wakes it.
+ *          The workers are threads of the managed pool, so they can be stopped and resumed like any other.
+ */
+
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifndef EXECUTOR_MAX_WORKERS
+#define EXECUTOR_MAX_WORKERS 64  /**< Maximum number of executor workers. */
+#endif
+
+/**
+ * @brief Function run by the executor.
+ * @param arg The argument given to `submit`.
+ * @return Returns the result handed to the joiner of the future.
+ */
+typedef void *(*task_fn_t)(void *arg);
+
+/**
+ * @brief Future of a submitted function; taken from a fixed pool and given back by `future_join`.
+ */
+typedef struct future {
+    task_fn_t fn;                   /**< Function to run. */
+    void *arg;                      /**< Argument of `fn`. */
+    void *result;                   /**< Value returned by `fn`, valid once the future is done. */
+    _Atomic uint32_t state;         /**< `FUTURE_*` state; futex word the joiner parks on. */
+} future_t;
+
+/**
+ * @brief The function has not completed and nobody waits for it.
+ */
+#define FUTURE_PENDING 0
+
+/**
+ * @brief The function has not completed and a joiner is parked on the future.
+ */
+#define FUTURE_WAITING 1
+
+/**
+ * @brief The function has completed.
+ */
+#define FUTURE_DONE 2
+
+/**
+ * @brief Starts the executor on workers of the managed pool.
+ * @param workers The number of workers, at most `EXECUTOR_MAX_WORKERS`.
+ * @param queue_capacity The capacity of the queue of each worker.
+ * @return Returns 1 on success, 0 if the executor is running, the pool cannot spawn the workers or memory is short.
+ * @note The pool must be initialized with `init_thread_pool` and have room for the workers.
+ */
+int executor_start(unsigned int workers, size_t queue_capacity);
+
+/**
+ * @brief Stops the executor once the queued functions have run, and waits for the workers to return to the pool.
+ * @details Futures that were not joined are released with the executor.
+ */
+void executor_stop(void);
+
+/**
+ * @brief Submits a function to the executor.
+ * @param fn The function.
+ * @param arg The argument of `fn`.
+ * @return Returns the future of the call, or `NULL` if the executor is stopped or every future is in use.
+ * @details The function runs on the caller when every queue is full, which slows down producers that outpace the workers.
+ */
+future_t *submit(task_fn_t fn, void *arg);
+
+/**
+ * @brief Submits the same function for several arguments, waking each worker at most once.
+ * @param fn The function.
+ * @param args The arguments, one call each.
+ * @param count The number of arguments.
+ * @param batch Receives the future of each call.
+ * @return Returns the number of calls submitted; they are the first of `args`.
+ */
+size_t submit_batch(task_fn_t fn, void *const *args, size_t count, future_t **batch);
+
+/**
+ * @brief Checks whether the function of a future has completed.
+ * @param future The future.
+ * @return Returns 1 if it has, otherwise 0.
+ */
+int future_done(future_t *future);
+
+/**
+ * @brief Waits until the function of a future has completed and gives the future back.
+ * @param future The future; it must not be used afterwards.
+ * @return Returns the value returned by the function.
+ */
+void *future_join(future_t *future);
+
+#endif /* EXECUTOR_H */
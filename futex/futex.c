@@ -0,0 +1,246 @@
+/**
+ * @file futex.c
+ * @brief Implementation of thin wrappers around the Linux futex syscall.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+/*******************************************************************
+ * Includes
+ *******************************************************************/
+#include <stdlib.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "futex.h"
+
+/*******************************************************************
+ * Functions
+ *******************************************************************/
+
+/**
+ * @brief Blocks the calling thread while `*word` still holds `expected`.
+ * @param word The 32-bit futex word to wait on.
+ * @param expected The value the word must hold for the thread to sleep.
+ * @param timeout Relative timeout, or `NULL` to wait forever.
+ * @return Returns 0 when woken, -1 with `errno` set otherwise.
+ * @details The kernel re-checks the word atomically before sleeping, so a wake issued between the caller's
+ *          last check and this call is never lost.
+ */
+int futex_wait(_Atomic uint32_t *word, uint32_t expected, const struct timespec *timeout)
+{
+    return (int)syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT_PRIVATE, expected, timeout, NULL, 0);
+}
+
+/**
+ * @brief Wakes up to `count` threads waiting on `word`.
+ * @param word The 32-bit futex word.
+ * @param count Maximum number of waiters to wake.
+ * @return Returns the number of woken waiters, or -1 on failure.
+ */
+int futex_wake(_Atomic uint32_t *word, int count)
+{
+    return (int)syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+/**
+ * @brief Waits until `*word` differs from `unwanted`.
+ * @param word The 32-bit futex word.
+ * @param unwanted The value to wait away from.
+ * @return Returns the first observed value that differs from `unwanted`.
+ * @details The acquire load pairs with the release store of the thread that changes the word.
+ */
+uint32_t futex_await_change(_Atomic uint32_t *word, uint32_t unwanted)
+{
+    uint32_t value;
+
+    /* Short bounded spin: the other side is usually already running */
+    for (int i = 0; i < FUTEX_SPIN_LIMIT; i++)
+    {
+        value = atomic_load_explicit(word, memory_order_acquire);
+        if (value != unwanted)
+        {
+            return value;
+        }
+    }
+
+    /* Park until the word changes */
+    while ((value = atomic_load_explicit(word, memory_order_acquire)) == unwanted)
+    {
+        futex_wait(word, unwanted, NULL);
+    }
+
+    return value;
+}
+
+/**
+ * @brief Initializes a latch.
+ * @param latch The latch to initialize.
+ * @param count The initial count.
+ */
+void latch_init(countdown_latch_t *latch, uint32_t count)
+{
+    atomic_init(&latch->count, count);
+    latch->parent = NULL;
+    latch->notify_fd = -1;
+}
+
+/**
+ * @brief Adds outstanding count-downs to a latch that has not reached zero yet.
+ * @param latch The latch.
+ * @param count The number of count-downs to add.
+ */
+void latch_add(countdown_latch_t *latch, uint32_t count)
+{
+    atomic_fetch_add_explicit(&latch->count, count, memory_order_relaxed);
+}
+
+/**
+ * @brief Counts a latch down by one and wakes the waiters when it reaches zero.
+ * @param latch The latch.
+ * @details The release ordering publishes everything the caller wrote before counting down to the waiters. Nobody
+ *          waits on a latch with a parent, so reaching zero there costs no system call. The links are read before the
+ *          count-down, since the owner may release the latch as soon as it reaches zero. Writing to an eventfd is
+ *          async-signal-safe, so a stop handler can complete a latch that an event loop waits for.
+ */
+void latch_count_down(countdown_latch_t *latch)
+{
+    for (;;)
+    {
+        countdown_latch_t *parent = latch->parent;
+        int notify_fd = latch->notify_fd;
+        uint64_t one = 1;
+
+        if (atomic_fetch_sub_explicit(&latch->count, 1, memory_order_acq_rel) != 1)
+        {
+            return;
+        }
+        if (parent != NULL)
+        {
+            latch = parent;
+            continue;
+        }
+
+        futex_wake(&latch->count, INT32_MAX);
+        if (notify_fd >= 0)
+        {
+            ssize_t written = write(notify_fd, &one, sizeof(one));
+            (void) written;  /* A saturated eventfd is readable anyway */
+        }
+        return;
+    }
+}
+
+/**
+ * @brief Waits until a latch reaches zero.
+ * @param latch The latch.
+ * @details Polls the count `FUTEX_SPIN_LIMIT` times, then parks until the last count-down wakes it.
+ */
+void latch_wait(countdown_latch_t *latch)
+{
+    uint32_t count;
+
+    for (int i = 0; i < FUTEX_SPIN_LIMIT; i++)
+    {
+        if (atomic_load_explicit(&latch->count, memory_order_acquire) == 0)
+        {
+            return;
+        }
+    }
+
+    while ((count = atomic_load_explicit(&latch->count, memory_order_acquire)) != 0)
+    {
+        futex_wait(&latch->count, count, NULL);
+    }
+}
+
+/**
+ * @brief Allocates a latch tree with every leaf held.
+ * @param tree The tree to initialize.
+ * @param arrivals The number of arrival indices the tree must cover.
+ * @return Returns 1 on success, 0 if memory is short.
+ * @details Levels are built bottom-up in one array. A leaf starts at 1, the hold of the owner; an inner node starts
+ *          at its number of children, each of which counts it down once when it completes.
+ */
+int latch_tree_init(latch_tree_t *tree, uint32_t arrivals)
+{
+    uint32_t leaves = arrivals == 0 ? 1 : (arrivals + LATCH_TREE_FANIN - 1) / LATCH_TREE_FANIN;
+    uint32_t count = 0, first = 0;
+
+    /* Count the nodes of every level */
+    for (uint32_t width = leaves; ; width = (width + LATCH_TREE_FANIN - 1) / LATCH_TREE_FANIN)
+    {
+        count += width;
+        if (width == 1)
+        {
+            break;
+        }
+    }
+
+    tree->nodes = (latch_node_t *)aligned_alloc(_Alignof(latch_node_t), count * sizeof(latch_node_t));
+    if (tree->nodes == NULL)
+    {
+        return 0;
+    }
+    tree->leaves = leaves;
+    tree->count = count;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        latch_init(&tree->nodes[i].latch, i < leaves ? 1 : 0);
+    }
+
+    /* Link each level to the next */
+    for (uint32_t width = leaves; width > 1; width = (width + LATCH_TREE_FANIN - 1) / LATCH_TREE_FANIN)
+    {
+        for (uint32_t i = 0; i < width; i++)
+        {
+            tree->nodes[first + i].latch.parent = &tree->nodes[first + width + i / LATCH_TREE_FANIN].latch;
+            latch_add(tree->nodes[first + i].latch.parent, 1);
+        }
+        first += width;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Returns the leaf an arrival counts down.
+ * @param tree The tree.
+ * @param index The index of the arrival.
+ * @return Returns the latch of the leaf; add to it with `latch_add` before the arrival counts it down.
+ */
+countdown_latch_t *latch_tree_leaf(latch_tree_t *tree, uint32_t index)
+{
+    return &tree->nodes[(index / LATCH_TREE_FANIN) % tree->leaves].latch;
+}
+
+/**
+ * @brief Drops the hold of the owner on every leaf; no arrival may be added afterwards.
+ * @param tree The tree.
+ */
+void latch_tree_release(latch_tree_t *tree)
+{
+    for (uint32_t i = 0; i < tree->leaves; i++)
+    {
+        latch_count_down(&tree->nodes[i].latch);
+    }
+}
+
+/**
+ * @brief Waits until every arrival has counted down and the tree is released.
+ * @param tree The tree.
+ */
+void latch_tree_wait(latch_tree_t *tree)
+{
+    latch_wait(&tree->nodes[tree->count - 1].latch);
+}
+
+/**
+ * @brief Frees a latch tree that has completed.
+ * @param tree The tree.
+ */
+void latch_tree_destroy(latch_tree_t *tree)
+{
+    free(tree->nodes);
+    tree->nodes = NULL;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file futex.h
+ * @brief Header file for thin wrappers around the Linux futex syscall.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#ifndef __FUTEX__
+#define __FUTEX__
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Number of polls a waiter performs before parking on the futex.
+ */
+#define FUTEX_SPIN_LIMIT 100
+
+/**
+ * @brief Number of children of each node of a latch tree.
+ */
+#define LATCH_TREE_FANIN 8
+
+/**
+ * @brief Blocks the calling thread while `*word` still holds `expected`.
+ * @param word The 32-bit futex word to wait on.
+ * @param expected The value the word must hold for the thread to sleep.
+ * @param timeout Relative timeout, or `NULL` to wait forever.
+ * @return Returns 0 when woken, -1 with `errno` set (`EAGAIN`, `EINTR`, `ETIMEDOUT`) otherwise.
+ * @note This function is async-signal-safe.
+ */
+int futex_wait(_Atomic uint32_t *word, uint32_t expected, const struct timespec *timeout);
+
+/**
+ * @brief Wakes up to `count` threads waiting on `word`.
+ * @param word The 32-bit futex word.
+ * @param count Maximum number of waiters to wake.
+ * @return Returns the number of woken waiters, or -1 on failure.
+ * @note This function is async-signal-safe.
+ */
+int futex_wake(_Atomic uint32_t *word, int count);
+
+/**
+ * @brief Waits until `*word` differs from `unwanted`.
+ * @param word The 32-bit futex word.
+ * @param unwanted The value to wait away from.
+ * @return Returns the first observed value that differs from `unwanted`.
+ * @details Polls the word `FUTEX_SPIN_LIMIT` times before parking, so short waits stay in user space
+ *          and long waits cost a single wait/wake syscall pair instead of a hot spin.
+ */
+uint32_t futex_await_change(_Atomic uint32_t *word, uint32_t unwanted);
+
+/**
+ * @brief Countdown latch built on a futex word.
+ * @details Waiters block until the count drops to zero; counting down is async-signal-safe, so signal handlers
+ *          can release a controller that waits for many acknowledgements at once. A latch with a parent counts the
+ *          parent down instead of waking waiters when it reaches zero, which is how a latch tree combines arrivals.
+ *          A latch with a `notify_fd` also writes to that eventfd when it reaches zero, so an event loop can wait for
+ *          it with `epoll` instead of blocking a thread in `latch_wait`.
+ */
+typedef struct countdown_latch {
+    _Atomic uint32_t count;             /**< Number of outstanding count-downs. */
+    struct countdown_latch *parent;     /**< Latch counted down when this one reaches zero, or `NULL`. */
+    int notify_fd;                      /**< Eventfd written when the latch reaches zero, or -1. */
+} countdown_latch_t;
+
+/**
+ * @brief Node of a latch tree, on its own cache line.
+ */
+typedef struct {
+    _Alignas(64) countdown_latch_t latch;   /**< Latch of the node. */
+} latch_node_t;
+
+/**
+ * @brief Combining tree of latches, so that many arrivals contend on `LATCH_TREE_FANIN` arrivals per cache line
+ *        instead of a single counter.
+ * @details Arrival `i` counts down leaf `i / LATCH_TREE_FANIN`; the last arrival at a node carries on to its parent,
+ *          and only the root wakes the waiter. Each leaf is held by the owner until `latch_tree_release`, so arrivals
+ *          can be added to a leaf while others already count down.
+ */
+typedef struct {
+    latch_node_t *nodes;        /**< Leaves first, then each level up to the root. */
+    uint32_t leaves;            /**< Number of leaves. */
+    uint32_t count;             /**< Number of nodes; the root is the last. */
+} latch_tree_t;
+
+/**
+ * @brief Initializes a latch.
+ * @param latch The latch to initialize.
+ * @param count The initial count.
+ */
+void latch_init(countdown_latch_t *latch, uint32_t count);
+
+/**
+ * @brief Adds outstanding count-downs to a latch that has not reached zero yet.
+ * @param latch The latch.
+ * @param count The number of count-downs to add.
+ */
+void latch_add(countdown_latch_t *latch, uint32_t count);
+
+/**
+ * @brief Counts a latch down by one and wakes the waiters when it reaches zero.
+ * @param latch The latch.
+ * @note This function is async-signal-safe.
+ */
+void latch_count_down(countdown_latch_t *latch);
+
+/**
+ * @brief Waits until a latch reaches zero.
+ * @param latch The latch.
+ */
+void latch_wait(countdown_latch_t *latch);
+
+/**
+ * @brief Allocates a latch tree with every leaf held.
+ * @param tree The tree to initialize.
+ * @param arrivals The number of arrival indices the tree must cover.
+ * @return Returns 1 on success, 0 if memory is short.
+ */
+int latch_tree_init(latch_tree_t *tree, uint32_t arrivals);
+
+/**
+ * @brief Returns the leaf an arrival counts down.
+ * @param tree The tree.
+ * @param index The index of the arrival.
+ * @return Returns the latch of the leaf; add to it with `latch_add` before the arrival counts it down.
+ */
+countdown_latch_t *latch_tree_leaf(latch_tree_t *tree, uint32_t index);
+
+/**
+ * @brief Drops the hold of the owner on every leaf; no arrival may be added afterwards.
+ * @param tree The tree.
+ */
+void latch_tree_release(latch_tree_t *tree);
+
+/**
+ * @brief Waits until every arrival has counted down and the tree is released.
+ * @param tree The tree.
+ */
+void latch_tree_wait(latch_tree_t *tree);
+
+/**
+ * @brief Frees a latch tree that has completed.
+ * @param tree The tree.
+ */
+void latch_tree_destroy(latch_tree_t *tree);
+
+#endif /* __FUTEX__ */
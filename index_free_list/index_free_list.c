@@ -0,0 +1,102 @@
+/**
+ * @file index_free_list.c
+ * @brief Implementation of lock-free free lists of array indices.
+ * @author Mohamed Ezzat
+ * @date 2026-10-17
+ */
+
+#include <stdlib.h>
+#include "index_free_list.h"
+
+#define LINK_END 0  /**< Link marking the end of the list. */
+
+/**
+ * @brief Creates a free list holding every index, lowest first.
+ * @param list The list to initialize.
+ * @param capacity The number of indices; below `INDEX_FREE_LIST_EMPTY`.
+ * @return Returns 1 on success, 0 if the capacity is invalid or the links cannot be allocated.
+ */
+int index_free_list_init(index_free_list_t *list, size_t capacity)
+{
+    atomic_init(&list->head, LINK_END);
+    list->links = NULL;
+    list->capacity = 0;
+    if (capacity == 0 || capacity >= INDEX_FREE_LIST_EMPTY)
+    {
+        return 0;
+    }
+
+    list->links = (_Atomic uint32_t *)calloc(capacity, sizeof(*list->links));
+    if (list->links == NULL)
+    {
+        return 0;
+    }
+    list->capacity = (uint32_t)capacity;
+
+    /* Chain every index, lowest first */
+    for (size_t i = 0; i < capacity; i++)
+    {
+        atomic_init(&list->links[i], (i + 1 < capacity) ? (uint32_t)(i + 2) : LINK_END);
+    }
+    atomic_store_explicit(&list->head, 1, memory_order_release);
+
+    return 1;
+}
+
+/**
+ * @brief Releases the links of a free list; it is empty afterwards.
+ * @param list The list.
+ */
+void index_free_list_destroy(index_free_list_t *list)
+{
+    atomic_store_explicit(&list->head, LINK_END, memory_order_relaxed);
+    free((void *)list->links);
+    list->links = NULL;
+    list->capacity = 0;
+}
+
+/**
+ * @brief Takes an index from a free list.
+ * @param list The list.
+ * @return Returns a free index, or `INDEX_FREE_LIST_EMPTY` if there is none.
+ * @details The link of the first index may be stale if another thread popped it meanwhile; the tag then makes the
+ *          CAS fail, so the stale link is never installed.
+ */
+uint32_t index_free_list_pop(index_free_list_t *list)
+{
+    uint64_t head = atomic_load_explicit(&list->head, memory_order_acquire);
+    uint64_t new_head;
+    uint32_t link;
+
+    do
+    {
+        link = (uint32_t)head;
+        if (link == LINK_END)
+        {
+            return INDEX_FREE_LIST_EMPTY;
+        }
+        new_head = ((head >> 32) + 1) << 32 | atomic_load_explicit(&list->links[link - 1], memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&list->head, &head, new_head,
+                                                    memory_order_acquire, memory_order_acquire));
+
+    return link - 1;
+}
+
+/**
+ * @brief Gives an index back to a free list.
+ * @param list The list.
+ * @param index An index taken from the list.
+ * @details The release CAS publishes what the caller wrote to the element to the thread that pops it next.
+ */
+void index_free_list_push(index_free_list_t *list, uint32_t index)
+{
+    uint64_t head = atomic_load_explicit(&list->head, memory_order_relaxed);
+    uint64_t new_head;
+
+    do
+    {
+        atomic_store_explicit(&list->links[index], (uint32_t)head, memory_order_relaxed);
+        new_head = ((head >> 32) + 1) << 32 | (index + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&list->head, &head, new_head,
+                                                    memory_order_release, memory_order_relaxed));
+}
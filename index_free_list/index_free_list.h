@@ -0,0 +1,58 @@
+/**
+ * @file index_free_list.h
+ * @brief Header file for lock-free free lists of array indices, shared by the list node pool and the futures.
+ * @author Mohamed Ezzat
+ * @date 2026-10-17
+ * @details The list hands out the indices of a fixed array of elements the caller owns. Links are kept apart from the
+ *          elements, as `index + 1` so that 0 can end the list. The head packs the first link into its low 32 bits
+ *          and a tag into its high 32 bits that every update bumps, so an index popped and pushed back between the
+ *          load and the CAS of another thread is not mistaken for an unchanged head.
+ */
+
+#ifndef INDEX_FREE_LIST_H
+#define INDEX_FREE_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define INDEX_FREE_LIST_EMPTY UINT32_MAX  /**< Returned by `index_free_list_pop` when every index is in use. */
+
+/**
+ * @brief Free list of the indices `0` to `capacity - 1`.
+ */
+typedef struct {
+    _Atomic uint64_t head;          /**< Tag in the high 32 bits, link of the first free index in the low 32 bits. */
+    _Atomic uint32_t *links;        /**< Link of every index: the next free index plus one, or 0 at the end. */
+    uint32_t capacity;              /**< Number of indices. */
+} index_free_list_t;
+
+/**
+ * @brief Creates a free list holding every index, lowest first.
+ * @param list The list to initialize.
+ * @param capacity The number of indices; below `INDEX_FREE_LIST_EMPTY`.
+ * @return Returns 1 on success, 0 if the capacity is invalid or the links cannot be allocated.
+ */
+int index_free_list_init(index_free_list_t *list, size_t capacity);
+
+/**
+ * @brief Releases the links of a free list; it is empty afterwards.
+ * @param list The list.
+ */
+void index_free_list_destroy(index_free_list_t *list);
+
+/**
+ * @brief Takes an index from a free list.
+ * @param list The list.
+ * @return Returns a free index, or `INDEX_FREE_LIST_EMPTY` if there is none.
+ */
+uint32_t index_free_list_pop(index_free_list_t *list);
+
+/**
+ * @brief Gives an index back to a free list.
+ * @param list The list.
+ * @param index An index taken from the list.
+ */
+void index_free_list_push(index_free_list_t *list, uint32_t index);
+
+#endif /* INDEX_FREE_LIST_H */
@@ -0,0 +1,144 @@
+/**
+ * @file lockfree_queue.c
+ * @brief Implementation of a bounded lock-free multi-producer/multi-consumer queue.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details Array-based queue where each cell carries a sequence number (D. Vyukov's bounded MPMC queue).
+ *          A producer claims a position with one CAS on `enqueue_pos`, a consumer with one CAS on `dequeue_pos`;
+ *          the cell's sequence then publishes the element to the other side.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "lockfree_queue.h"
+
+/**
+ * @brief Initializes a queue.
+ * @param queue The queue to initialize.
+ * @param capacity Minimum number of elements; rounded up to a power of two.
+ * @return Returns 1 on success, 0 on failure.
+ */
+int lockfree_queue_init(lockfree_queue_t *queue, size_t capacity)
+{
+    size_t size = 2;
+
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    queue->cells = (lockfree_cell_t *)calloc(size, sizeof(lockfree_cell_t));
+    if (queue->cells == NULL)
+    {
+        return 0;
+    }
+
+    /* Cell i is ready for the producer of position i */
+    for (size_t i = 0; i < size; i++)
+    {
+        atomic_init(&queue->cells[i].sequence, i);
+    }
+    queue->mask = size - 1;
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+
+    return 1;
+}
+
+/**
+ * @brief Releases the storage of a queue.
+ * @param queue The queue to destroy.
+ */
+void lockfree_queue_destroy(lockfree_queue_t *queue)
+{
+    free(queue->cells);
+    queue->cells = NULL;
+}
+
+/**
+ * @brief Appends an element to the queue.
+ * @param queue The queue to append to.
+ * @param data The element to append.
+ * @return Returns 1 on success, 0 if the queue is full.
+ */
+int lockfree_queue_enqueue(lockfree_queue_t *queue, void *data)
+{
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    lockfree_cell_t *cell;
+
+    for (;;)
+    {
+        cell = &queue->cells[pos & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            /* The cell is free for this position, try to claim it */
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* The consumer of the previous lap has not freed the cell yet */
+            return 0;
+        }
+        else
+        {
+            /* Another producer claimed the position, reload */
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->data = data;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+
+    return 1;
+}
+
+/**
+ * @brief Removes the oldest element from the queue.
+ * @param queue The queue to remove from.
+ * @param data Receives the removed element.
+ * @return Returns 1 on success, 0 if the queue is empty.
+ */
+int lockfree_queue_dequeue(lockfree_queue_t *queue, void **data)
+{
+    size_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    lockfree_cell_t *cell;
+
+    for (;;)
+    {
+        cell = &queue->cells[pos & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+
+        if (diff == 0)
+        {
+            /* The cell holds the element of this position, try to claim it */
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* The producer of this position has not published yet */
+            return 0;
+        }
+        else
+        {
+            /* Another consumer claimed the position, reload */
+            pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    *data = cell->data;
+    atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+
+    return 1;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file lockfree_queue.h
+ * @brief Header file for a bounded lock-free multi-producer/multi-consumer queue.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#ifndef LOCKFREE_QUEUE_H
+#define LOCKFREE_QUEUE_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+/**
+ * @brief One cell of the queue.
+ * @details `sequence` tells producers and consumers whose turn it is to use the cell.
+ */
+typedef struct {
+    _Atomic size_t sequence;        /**< Turn counter of the cell. */
+    void *data;                     /**< Stored element. */
+} lockfree_cell_t;
+
+/**
+ * @brief Bounded MPMC queue of pointers.
+ * @details The enqueue and dequeue positions live on separate cache lines so producers and consumers
+ *          do not invalidate each other's line on every operation.
+ */
+typedef struct {
+    lockfree_cell_t *cells;                         /**< Ring of `mask + 1` cells. */
+    size_t mask;                                    /**< Capacity minus one; capacity is a power of two. */
+    _Alignas(64) _Atomic size_t enqueue_pos;        /**< Next position to enqueue at. */
+    _Alignas(64) _Atomic size_t dequeue_pos;        /**< Next position to dequeue from. */
+} lockfree_queue_t;
+
+/**
+ * @brief Initializes a queue.
+ * @param queue The queue to initialize.
+ * @param capacity Minimum number of elements; rounded up to a power of two.
+ * @return Returns 1 on success, 0 on failure.
+ */
+int lockfree_queue_init(lockfree_queue_t *queue, size_t capacity);
+
+/**
+ * @brief Releases the storage of a queue.
+ * @param queue The queue to destroy.
+ */
+void lockfree_queue_destroy(lockfree_queue_t *queue);
+
+/**
+ * @brief Appends an element to the queue.
+ * @param queue The queue to append to.
+ * @param data The element to append.
+ * @return Returns 1 on success, 0 if the queue is full.
+ */
+int lockfree_queue_enqueue(lockfree_queue_t *queue, void *data);
+
+/**
+ * @brief Removes the oldest element from the queue.
+ * @param queue The queue to remove from.
+ * @param data Receives the removed element.
+ * @return Returns 1 on success, 0 if the queue is empty.
+ */
+int lockfree_queue_dequeue(lockfree_queue_t *queue, void **data);
+
+#endif /* LOCKFREE_QUEUE_H */
@@ -44,12 +44,8 @@
      osEE_linux_system_timer_init();
  #endif
  
-     /* Stop all threads */
-     for (int i = 0; i < NUMBER_OF_THREADS && threads[i] != -1; i++)
-     {
-         printf("Thread[%d] stopped\n", i);
-         stop_thread(threads[i]);
-     }
+     /* Stop all threads with a single round-trip */
+     printf("%d threads stopped\n", stop_all());
  
      printf("\n**************************");
      printf("\nALL THREADS STOPPED\n");
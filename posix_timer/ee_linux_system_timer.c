@@ -0,0 +1,160 @@
+/**
+ * @file ee_linux_system_timer.c
+ * @brief Implementation of the periodic system tick on a `timerfd`.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/timerfd.h>
+#include "ee_linux_system_timer.h"
+#include "../timer_wheel/timer_wheel.h"
+
+/**
+ * @brief Function called on every tick.
+ */
+static _Atomic(tick_callback_t) tick_callback = NULL;
+
+/**
+ * @brief The timer, the thread reading it and the flag that keeps the thread running.
+ */
+static int timer_fd = -1;
+static pthread_t tick_thread;
+static _Atomic uint32_t tick_running = 0;
+
+/**
+ * @brief Monotonic time of the first expiry, ticks elapsed since and time of the latest expiry.
+ */
+static uint64_t first_expiry_ns;
+static _Atomic uint64_t tick_count = 0;
+static _Atomic uint64_t last_expiry_ns = 0;
+
+/**
+ * @brief Body of the tick thread: waits for the timer and calls the callback with the number of elapsed periods.
+ * @details The expiry time is derived from the first expiry and the tick count rather than read after the wake-up,
+ *          so the latency a callback measures includes the time the tick thread took to be scheduled.
+ */
+static void *tick_body(void *arg)
+{
+    struct sched_param param = { .sched_priority = sched_get_priority_max(SCHED_FIFO) };
+    uint64_t expirations;
+
+    (void) arg;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);  /* Best effort: needs CAP_SYS_NICE */
+
+    while (atomic_load(&tick_running))
+    {
+        tick_callback_t callback;
+        uint64_t ticks;
+
+        if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        {
+            continue;  /* Interrupted, or the timer was disarmed by `osEE_linux_system_timer_stop` */
+        }
+
+        ticks = atomic_fetch_add(&tick_count, expirations) + expirations;
+        atomic_store(&last_expiry_ns, first_expiry_ns + (ticks - 1) * SYSTEM_TICK_US * 1000ULL);
+
+        callback = atomic_load(&tick_callback);
+        if (callback != NULL && atomic_load(&tick_running))
+        {
+            callback((int)expirations);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Sets the function called on every tick.
+ * @param callback The function, or `NULL` to ignore the ticks.
+ */
+void set_callback(tick_callback_t callback)
+{
+    atomic_store(&tick_callback, callback);
+}
+
+/**
+ * @brief Starts the periodic tick.
+ * @return Returns 1 on success or if the tick is already running, 0 if the timer or its thread cannot be created.
+ * @details The first tick expires one period from now, on an absolute schedule, so ticks do not drift.
+ */
+int osEE_linux_system_timer_init(void)
+{
+    struct itimerspec period;
+    uint32_t idle = 0;
+
+    if (!atomic_compare_exchange_strong(&tick_running, &idle, 1))
+    {
+        return 1;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd < 0)
+    {
+        perror("timerfd_create");
+        atomic_store(&tick_running, 0);
+        return 0;
+    }
+
+    first_expiry_ns = timer_now_ns() + SYSTEM_TICK_US * 1000ULL;
+    period.it_interval.tv_sec = SYSTEM_TICK_US / 1000000;
+    period.it_interval.tv_nsec = (long)(SYSTEM_TICK_US % 1000000) * 1000L;
+    period.it_value.tv_sec = (time_t)(first_expiry_ns / 1000000000ULL);
+    period.it_value.tv_nsec = (long)(first_expiry_ns % 1000000000ULL);
+    atomic_store(&tick_count, 0);
+
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &period, NULL) != 0 ||
+        pthread_create(&tick_thread, NULL, tick_body, NULL) != 0)
+    {
+        close(timer_fd);
+        timer_fd = -1;
+        atomic_store(&tick_running, 0);
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Stops the tick and waits for the tick thread to exit.
+ * @details The timer is re-armed to expire at once without a period, so the tick thread returns from `read`
+ *          and sees the flag cleared.
+ */
+void osEE_linux_system_timer_stop(void)
+{
+    struct itimerspec once = { .it_interval = { 0, 0 }, .it_value = { 0, 1 } };
+    uint32_t running = 1;
+
+    if (!atomic_compare_exchange_strong(&tick_running, &running, 0))
+    {
+        return;
+    }
+
+    timerfd_settime(timer_fd, 0, &once, NULL);
+    pthread_join(tick_thread, NULL);
+    close(timer_fd);
+    timer_fd = -1;
+}
+
+/**
+ * @brief Returns the number of ticks elapsed since the timer started.
+ */
+uint64_t osEE_linux_system_timer_ticks(void)
+{
+    return atomic_load(&tick_count);
+}
+
+/**
+ * @brief Returns the monotonic time at which the latest tick expired.
+ * @return Returns the time in nanoseconds; callbacks subtract it from the current time to measure their latency.
+ */
+uint64_t osEE_linux_system_timer_expiry_ns(void)
+{
+    return atomic_load(&last_expiry_ns);
+}
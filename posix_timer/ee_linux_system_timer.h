@@ -0,0 +1,54 @@
+/**
+ * @file ee_linux_system_timer.h
+ * @brief Header file for the periodic system tick of the POSIX_TIMER build.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details The tick is a `timerfd` read by a dedicated thread, so the callback runs in thread context and may stop and
+ *          resume threads, which a SIGALRM handler could not do safely. The tick thread asks for `SCHED_FIFO` at the
+ *          highest priority and keeps its normal policy when it is not allowed to.
+ */
+
+#ifndef EE_LINUX_SYSTEM_TIMER_H
+#define EE_LINUX_SYSTEM_TIMER_H
+
+#include <stdint.h>
+
+#ifndef SYSTEM_TICK_US
+#define SYSTEM_TICK_US 1000  /**< Period of the system tick in microseconds. */
+#endif
+
+/**
+ * @brief Function called on every tick.
+ * @param ticks The number of periods elapsed since the previous call; more than 1 when ticks were missed.
+ */
+typedef void (*tick_callback_t)(int ticks);
+
+/**
+ * @brief Sets the function called on every tick.
+ * @param callback The function, or `NULL` to ignore the ticks.
+ */
+void set_callback(tick_callback_t callback);
+
+/**
+ * @brief Starts the periodic tick.
+ * @return Returns 1 on success or if the tick is already running, 0 if the timer or its thread cannot be created.
+ */
+int osEE_linux_system_timer_init(void);
+
+/**
+ * @brief Stops the tick and waits for the tick thread to exit.
+ */
+void osEE_linux_system_timer_stop(void);
+
+/**
+ * @brief Returns the number of ticks elapsed since the timer started.
+ */
+uint64_t osEE_linux_system_timer_ticks(void);
+
+/**
+ * @brief Returns the monotonic time at which the latest tick expired.
+ * @return Returns the time in nanoseconds; callbacks subtract it from the current time to measure their latency.
+ */
+uint64_t osEE_linux_system_timer_expiry_ns(void);
+
+#endif /* EE_LINUX_SYSTEM_TIMER_H */
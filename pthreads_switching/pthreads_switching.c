@@ -10,358 +10,4023 @@
  * Includes
  *******************************************************************/
  #include "pthreads_switching.h"
+ #include <sys/syscall.h>
+
+/*******************************************************************
+ * Types
+ *******************************************************************/
+/**
+ * @brief Slot of the worker pool: the control block of a worker and the work handed to it.
+ * @details The control block comes first, so a block found by `find_tcb` converts back to its slot.
+ */
+typedef struct {
+    thread_control_block_t tcb;     /**< Control block of the worker. */
+    thread_body_t body;             /**< Body the worker runs next. */
+    void *arg;                      /**< Argument of `body`, or `NULL` to pass the index of the worker. */
+    _Atomic uint32_t work;          /**< Futex word an idle worker parks on; bumped when work is handed to it. */
+    _Atomic uint32_t reusable;      /**< Non-zero while no thread uses the slot. */
+    int node;                       /**< NUMA node the worker allocates from, or -1 if it is not pinned. */
+    pooled_stack_t *stack;          /**< Pooled stack of the thread, or `NULL`; recycled once the thread is joined. */
+    uint32_t joinable;              /**< Non-zero while the last thread of the slot has not been joined. */
+    scheduler_t *owner;             /**< Scheduler the slot belongs to. */
+} worker_slot_t;
+
+/**
+ * @brief Periodic scheduler of a pool.
+ * @details Each scheduler runs its own periodic set with its own policy and one periodic job at a time, so the
+ *          periodic threads of different schedulers, e.g. one per core, are scheduled independently.
+ */
+typedef struct {
+    pthread_mutex_t mutex;                  /**< Serializes the periodic scheduler. */
+    sched_policy_t policy;                  /**< Policy of the periodic threads. */
+    thread_control_block_t *head;           /**< Set of periodic threads. */
+    thread_control_block_t *running;        /**< Periodic job that runs, or `NULL`. */
+    timer_entry_t budget_timer;             /**< Timer of the budget of the running job. */
+} periodic_scheduler_t;
+
+/**
+ * @brief A worker pool and everything it owns.
+ * @details Control blocks live in chunks of `POOL_CHUNK_SIZE`; block `i` lives in chunk `i / POOL_CHUNK_SIZE`.
+ *          Chunks are only freed by `sched_destroy`, so a block stays valid for controllers and queues that still
+ *          point to it. The state queues are lock-free FIFOs of control blocks; a block is queued at most once per
+ *          state, and entries whose thread has changed state since are skipped when dequeued.
+ *          A scheduler starts on its own cache line, so two schedulers never share one.
+ */
+struct scheduler {
+    _Alignas(64) worker_slot_t **slot_chunks;   /**< Table of the chunks of control blocks. */
+    _Atomic unsigned int slot_count;            /**< Slots handed out; those below it are readable without `pool_mutex`. */
+    _Atomic unsigned int live_workers;          /**< Number of live workers. */
+    _Atomic uint32_t destroying;                /**< Non-zero once `sched_destroy` retires the workers. */
+    thread_pool_config_t pool_config;           /**< Configuration of the pool; owns its copy of the CPU list. */
+    pthread_mutex_t pool_mutex;                 /**< Serializes the growth of the pool; stop and resume never take it. */
+    thread_index_t thread_index;                /**< Thread IDs of the workers to slots; written with `pool_mutex` held. */
+    stack_pool_t worker_stacks;                 /**< Stacks of the workers when the pool has a stack size. */
+    cpu_topology_t topology;                    /**< Topology of the CPUs the pool places its workers on. */
+    lockfree_queue_t stopped_threads;           /**< Threads that are currently stopped. */
+    lockfree_queue_t running_threads;           /**< Threads that are currently running. */
+    pthread_mutex_t quiesce_mutex;              /**< Serializes `sched_quiesce` and `sched_unquiesce`. */
+    _Atomic uint32_t quiescing;                 /**< Non-zero from `sched_quiesce` to `sched_unquiesce`; no worker is spawned or resumed meanwhile. */
+    periodic_scheduler_t periodic;              /**< Periodic scheduler of the workers. */
+    quiesce_sample_t *quiesced;                 /**< Workers the last `sched_quiesce` stopped, slowest first. */
+    size_t quiesced_count;                      /**< Number of entries of `quiesced`. */
+};
+
+/**
+ * @brief Sequence numbers of the control commands are 31 bits wide, so a number and a command fit in the `int` payload.
+ */
+#define COMMAND_SEQ_MASK 0x7fffffffu
+#define COMMAND_PAYLOAD(seq, command) ((int)(((seq) << 1) | (uint32_t)(command)))
+#define COMMAND_SEQ(payload) ((uint32_t)(payload) >> 1)
+#define COMMAND_OF(payload) ((thread_command_t)((uint32_t)(payload) & 1))
+
+/**
+ * @brief Value of `kernel_tid` while a controller sleeps on it before the thread has published its kernel ID.
+ */
+#define KERNEL_TID_WAITING UINT32_MAX
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6            /**< Policy number of `SCHED_DEADLINE`, missing from older C libraries. */
+#endif
+#ifndef SCHED_FLAG_DL_OVERRUN
+#define SCHED_FLAG_DL_OVERRUN 0x04  /**< Asks the kernel for SIGXCPU when a reservation overruns its runtime. */
+#endif
+
+/**
+ * @brief Argument of the `sched_setattr` system call, which the C library does not wrap.
+ */
+typedef struct {
+    uint32_t size;                  /**< Size of the structure. */
+    uint32_t sched_policy;          /**< Policy. */
+    uint64_t sched_flags;           /**< `SCHED_FLAG_*` flags. */
+    int32_t sched_nice;             /**< Nice value of `SCHED_OTHER`. */
+    uint32_t sched_priority;        /**< Priority of `SCHED_FIFO` and `SCHED_RR`. */
+    uint64_t sched_runtime;         /**< Runtime of a `SCHED_DEADLINE` reservation in nanoseconds. */
+    uint64_t sched_deadline;        /**< Relative deadline of a `SCHED_DEADLINE` reservation in nanoseconds. */
+    uint64_t sched_period;          /**< Period of a `SCHED_DEADLINE` reservation in nanoseconds. */
+} deadline_attr_t;
+
+/**
+ * @brief Table of the process-wide index of the workers.
+ * @details A table is replaced by one twice as large when it fills up. The tables it replaced stay on its `retired`
+ *          chain, since a lookup may still probe them; doubling bounds them by the size of the live table.
+ */
+typedef struct owner_table {
+    thread_index_t index;           /**< Thread IDs of the workers of every scheduler to their control blocks. */
+    uint32_t capacity;              /**< Number of thread IDs the index holds at most. */
+    struct owner_table *retired;    /**< Table this one replaced, or `NULL`. */
+} owner_table_t;
 
 /*******************************************************************
  * Static Global Variables
  *******************************************************************/
 /**
- * @brief List of threads that are currently stopped.
- * @details This list stores the thread IDs of threads that have been paused using the `stop_thread` function.
+ * @brief Scheduler set up by `init_thread_pool`, used by the functions without a scheduler argument.
+ */
+static scheduler_t default_scheduler = {
+    .pool_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .quiesce_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .periodic = { .mutex = PTHREAD_MUTEX_INITIALIZER, .policy = SCHED_POLICY_FIFO },
+};
+
+/**
+ * @brief Control block of the main thread.
+ */
+static thread_control_block_t main_tcb;
+
+/**
+ * @brief Process-wide index of the workers of every scheduler, so a thread ID reaches its worker whichever scheduler
+ *        runs it, and the mutex serializing its writers.
+ * @details Written when a scheduler creates a thread or is destroyed; read without a lock by `find_tcb`.
+ */
+static _Atomic(owner_table_t *) owner_table = NULL;
+static pthread_mutex_t owner_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Control block of the calling thread.
+ * @details Set once when a thread registers itself, read by `control_signal_handler`.
+ */
+static __thread thread_control_block_t *current_tcb = NULL;
+
+/**
+ * @brief Latch published by detached stops.
+ * @details Nobody waits on it: its count starts at one, so the count-downs that match the additions of `begin_stop`
+ *          never bring it to zero. A thread that finds it when acknowledging a stop completes the stop itself.
+ */
+static countdown_latch_t detached_latch = { .count = 1, .parent = NULL, .notify_fd = -1 };
+
+/**
+ * @brief Thread printing the statistics periodically, and the futex word that keeps it running while non-zero.
+ */
+static pthread_t dump_thread;
+static _Atomic uint32_t dump_running = 0;
+
+#ifdef POSIX_TIMER
+/**
+ * @brief Serializes the tick scheduler; the tick thread and the functions handing threads to it take it.
+ */
+static pthread_mutex_t tick_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Ready queues of the tick scheduler, one FIFO per priority, and the bitmap of the non-empty ones.
+ * @details Bit `p` is set while queue `p` holds a thread, so the highest ready priority is found in O(1)
+ *          with `__builtin_clz` however many threads are queued.
+ */
+static uint32_t ready_bitmap = 0;
+static thread_control_block_t *ready_head[SCHED_PRIORITIES];
+static thread_control_block_t *ready_tail[SCHED_PRIORITIES];
+
+/**
+ * @brief Thread the tick scheduler runs, and the ticks left of its time slice.
+ */
+static thread_control_block_t *dispatched_tcb = NULL;
+static unsigned int slice_left = 0;
+
+/**
+ * @brief Counters of the tick scheduler; the latencies are kept as totals until they are read.
+ */
+static tick_scheduler_stats_t tick_stats;
+static uint64_t tick_latency_total_ns = 0;
+static uint64_t dispatch_latency_total_ns = 0;
+#endif
+
+/*******************************************************************
+ * Global Variables
+ *******************************************************************/
+
+/**
+ * @brief Array to store the created threads initially.
+ * @details This array holds the thread IDs of the threads created by `init_threads`. Threads spawned later are only
+ *          known to the pool.
+ */
+pthread_t threads[NUMBER_OF_THREADS];
+
+/**
+ * @brief Stores the thread ID of the main thread.
+ * @details This variable is used to identify the main thread for special handling.
+ */
+pthread_t main_thread;
+
+/*******************************************************************
+ * Static Functions
+ *******************************************************************/
+/**
+ * @brief Signal handler for the control signal, which stops or resumes the thread execution.
+ * @param sig The signal number.
+ * @param info The payload of the signal.
+ * @param context The interrupted context (unused).
+ */
+static void control_signal_handler(int sig, siginfo_t *info, void *context);
+
+/**
+ * @brief Default body of the worker threads.
+ * @param arg The index of the thread in `threads`.
+ */
+static void pthread_body(void *arg);
+
+/**
+ * @brief Entry point for created threads.
+ * @param arg The pool slot of the thread.
+ * @return Never returns; the thread exits with `pthread_exit`.
+ */
+static void *thread_entry(void *arg);
+
+/**
+ * @brief Marks the calling thread as exited and releases any controller waiting for it.
+ * @param arg The pool slot of the thread.
+ */
+static void thread_exit_cleanup(void *arg);
+
+/**
+ * @brief Returns a slot of a scheduler.
+ * @param scheduler The scheduler.
+ * @param index The index of the slot, below `slot_count`.
+ * @return Returns a pointer to the slot.
+ */
+static worker_slot_t *get_slot(scheduler_t *scheduler, unsigned int index);
+
+/**
+ * @brief Reserves a slot for a new worker thread.
+ * @param scheduler The scheduler.
+ * @return Returns a pointer to the slot, or `NULL` if the pool is full.
+ */
+static worker_slot_t *claim_slot(scheduler_t *scheduler);
+
+/**
+ * @brief Initializes the attributes of a new worker thread, including its CPU placement.
+ * @param attr The attributes to initialize.
+ * @param slot The pool slot of the worker.
+ */
+static void init_worker_attr(pthread_attr_t *attr, worker_slot_t *slot);
+
+/**
+ * @brief Parks the calling worker until it is handed new work.
+ * @param slot The pool slot of the calling worker.
+ * @return Returns 1 once the worker has new work, 0 if it retired instead.
+ */
+static int wait_for_work(worker_slot_t *slot);
+
+/**
+ * @brief Allocates the list of control blocks a batch of stops waits for.
+ * @param local A list of `STOP_BATCH` entries on the caller's stack.
+ * @param count The number of stops in the batch.
+ * @param capacity Receives the capacity of the returned list.
+ * @return Returns `local` for small batches, otherwise a list to free with `release_pending`.
+ */
+static thread_control_block_t **alloc_pending(thread_control_block_t **local, size_t count, size_t *capacity);
+
+/**
+ * @brief Frees a list returned by `alloc_pending`.
+ * @param pending The list.
+ * @param local The list on the caller's stack.
+ */
+static void release_pending(thread_control_block_t **pending, thread_control_block_t **local);
+
+/**
+ * @brief Finds the control block of a managed thread.
+ * @param thread The thread ID to look up.
+ * @return Returns a pointer to the control block, or `NULL` if the thread is not managed.
+ */
+static thread_control_block_t *find_tcb(pthread_t thread);
+
+/**
+ * @brief Finds the control block of a worker of a scheduler.
+ * @param scheduler The scheduler.
+ * @param thread The thread ID to look up.
+ * @return Returns a pointer to the control block, or `NULL` if the thread is not a live worker of the scheduler.
+ */
+static thread_control_block_t *lookup_tcb(scheduler_t *scheduler, pthread_t thread);
+
+/**
+ * @brief Checks that a control block found by thread ID is bound to a live thread with that ID.
+ * @param tcb The control block.
+ * @param thread The thread ID it was found by.
+ * @return Returns the control block, or `NULL` if its thread has exited or was replaced.
+ */
+static thread_control_block_t *live_tcb(thread_control_block_t *tcb, pthread_t thread);
+
+/**
+ * @brief Maps the thread of a worker in the process-wide index, in place of the previous thread of its slot.
+ * @param tcb The control block of the worker.
+ * @param previous The thread ID the slot was bound to before.
+ * @param thread The thread ID of the worker.
+ * @return Returns `!ERROR` on success, `ERROR` if memory is short.
+ */
+static int index_worker(thread_control_block_t *tcb, pthread_t previous, pthread_t thread);
+
+/**
+ * @brief Initializes a scheduler and starts its minimum number of workers.
+ * @param scheduler The scheduler, zeroed or with only its mutexes initialized.
+ * @param config The configuration of its pool.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ */
+static int sched_init(scheduler_t *scheduler, const thread_pool_config_t *config);
+
+/**
+ * @brief Acknowledges a stop request of the calling thread.
+ * @param tcb The control block of the calling thread.
+ */
+static void acknowledge_stop(thread_control_block_t *tcb);
+
+/**
+ * @brief Publishes the sequence number of the last command handled by the calling thread.
+ * @param tcb The control block of the calling thread.
+ * @param seq The sequence number.
+ */
+static void acknowledge_command(thread_control_block_t *tcb, uint32_t seq);
+
+/**
+ * @brief Queues a command to a thread with the next sequence number.
+ * @param tcb The control block of the thread.
+ * @param command The command.
+ * @param seq Receives the sequence number of the command.
+ * @return Returns `!ERROR` if the signal was queued, `ERROR` otherwise.
+ */
+static int send_command(thread_control_block_t *tcb, thread_command_t command, uint32_t *seq);
+
+/**
+ * @brief Waits until a thread has handled a command.
+ * @param tcb The control block of the thread.
+ * @param seq The sequence number of the command.
+ * @return Returns `!ERROR` once the command is acknowledged, `ERROR` if the thread exited.
+ */
+static int await_command(thread_control_block_t *tcb, uint32_t seq);
+
+/**
+ * @brief Publishes the state reached by a transition and queues the thread for that state.
+ * @param tcb The control block owned by the caller.
+ * @param state The new state (`THREAD_STATE_RUNNING` or `THREAD_STATE_STOPPED`).
+ */
+static void publish_state(thread_control_block_t *tcb, thread_state_t state);
+
+/**
+ * @brief Takes ownership of a thread's stop and sends it the stop signal.
+ * @param tcb The control block of the thread to stop.
+ * @param latch The latch the thread counts down once it acknowledges.
+ * @return Returns `!ERROR` if the signal was sent, `ERROR` otherwise.
+ */
+static int begin_stop(thread_control_block_t *tcb, countdown_latch_t *latch);
+
+/**
+ * @brief Completes a stop started by `begin_stop` once its latch has reached zero.
+ * @param tcb The control block of the thread.
+ * @return Returns `!ERROR` if the thread is stopped, `ERROR` if it exited instead.
+ */
+static int finish_stop(thread_control_block_t *tcb);
+
+/**
+ * @brief Starts a stop that completes without a controller waiting for it.
+ * @param tcb The control block of the thread to stop.
+ * @return Returns `!ERROR` if the stop is under way, `ERROR` otherwise.
+ */
+static int stop_detached(thread_control_block_t *tcb);
+
+/**
+ * @brief Completes a detached stop of the calling thread and applies the resume deferred to it, if any.
+ * @param tcb The control block of the calling thread.
+ */
+static void complete_detached_stop(thread_control_block_t *tcb);
+
+/**
+ * @brief Takes ownership of a thread's resume and sends it the resume signal.
+ * @param tcb The control block of the thread to resume.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ */
+static int do_resume(thread_control_block_t *tcb);
+
+/**
+ * @brief Sends the resume of a thread the caller has moved to RESUMING.
+ * @param tcb The control block of the thread.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ */
+static int deliver_resume(thread_control_block_t *tcb);
+
+/**
+ * @brief Tells whether a thread belongs to a quiesced scheduler.
+ * @param tcb The control block of the thread.
+ * @return Returns non-zero if the thread may not be resumed or handed work until the scheduler is unquiesced.
+ */
+static int quiesce_gated(thread_control_block_t *tcb);
+
+/**
+ * @brief Copies the statistics of a control block.
+ * @param tcb The control block.
+ * @param snapshot Receives the statistics.
+ */
+static void snapshot_tcb(thread_control_block_t *tcb, thread_stats_snapshot_t *snapshot);
+
+/**
+ * @brief Parks the calling thread until it is handed off to.
+ * @param tcb The control block of the calling thread.
+ */
+static void handoff_park(thread_control_block_t *tcb);
+
+/**
+ * @brief Hands off to a thread, waking it if it is parked.
+ * @param tcb The control block of the thread.
+ */
+static void handoff_unpark(thread_control_block_t *tcb);
+
+/**
+ * @brief Orders quiesce samples slowest first, for `qsort`.
+ * @param a The first sample.
+ * @param b The second sample.
+ */
+static int compare_safepoint(const void *a, const void *b);
+
+/**
+ * @brief Body of the thread started by `start_stats_dump`.
+ * @param arg The interval between two dumps in milliseconds.
+ * @return Returns `NULL` once `stop_stats_dump` is called.
+ */
+static void *stats_dump_body(void *arg);
+
+/**
+ * @brief Stops one thread and waits for its acknowledgement.
+ * @param tcb The control block of the thread.
+ * @return Returns `!ERROR` if the thread is stopped, `ERROR` otherwise.
+ */
+static int stop_tcb(thread_control_block_t *tcb);
+
+/**
+ * @brief Callback of a thread's stop timer.
+ * @param arg The control block of the thread.
+ */
+static void stop_timer_expired(void *arg);
+
+/**
+ * @brief Callback of a thread's resume timer.
+ * @param arg The control block of the thread.
+ */
+static void resume_timer_expired(void *arg);
+
+/**
+ * @brief Signal handler for SIGXCPU, which the kernel sends when a `SCHED_DEADLINE` job overruns its runtime.
+ * @param sig The signal number (unused).
+ */
+static void deadline_overrun_handler(int sig);
+
+/**
+ * @brief Waits until a thread has published its kernel ID.
+ * @param tcb The control block of the thread.
+ */
+static void await_kernel_tid(thread_control_block_t *tcb);
+
+/**
+ * @brief Sets the kernel scheduling attributes of a thread.
+ * @param tcb The control block of the thread.
+ * @param params The timing of a `SCHED_DEADLINE` reservation, or `NULL` to go back to `SCHED_OTHER`.
+ * @return Returns `!ERROR` on success, `ERROR` on failure or if the kernel ID of the thread is not known yet.
+ */
+static int set_deadline_attr(thread_control_block_t *tcb, const periodic_params_t *params);
+
+/**
+ * @brief Returns the scheduler a thread belongs to.
+ * @param tcb The control block of the thread.
+ * @return Returns the owner of a worker, or the default scheduler for the main thread.
+ */
+static scheduler_t *scheduler_of(thread_control_block_t *tcb);
+
+/**
+ * @brief Returns the urgency of a periodic job under the policy of its scheduler; lower is more urgent.
+ * @param scheduler The scheduler of the thread.
+ * @param tcb The control block of the thread.
+ */
+static uint64_t periodic_key(scheduler_t *scheduler, thread_control_block_t *tcb);
+
+/**
+ * @brief Blocks the control signal of the calling thread and takes the periodic mutex of a scheduler.
+ * @param scheduler The scheduler.
+ * @param old_mask Receives the signal mask to restore.
+ */
+static void periodic_lock(scheduler_t *scheduler, sigset_t *old_mask);
+
+/**
+ * @brief Releases the periodic mutex of a scheduler and restores the signal mask of the calling thread.
+ * @param scheduler The scheduler.
+ * @param old_mask The signal mask returned by `periodic_lock`.
+ */
+static void periodic_unlock(scheduler_t *scheduler, const sigset_t *old_mask);
+
+/**
+ * @brief Gives the CPU to the most urgent released periodic job of a scheduler.
+ * @param scheduler The scheduler.
+ */
+static void periodic_dispatch(scheduler_t *scheduler);
+
+/**
+ * @brief Removes a thread from the periodic set of its scheduler and lets it run.
+ * @param scheduler The scheduler of the thread.
+ * @param tcb The control block of the thread.
+ */
+static void periodic_leave(scheduler_t *scheduler, thread_control_block_t *tcb);
+
+/**
+ * @brief Callback of a thread's release timer.
+ * @param arg The control block of the thread.
+ */
+static void release_timer_expired(void *arg);
+
+/**
+ * @brief Callback of the budget timer of a scheduler.
+ * @param arg The scheduler.
+ */
+static void budget_timer_expired(void *arg);
+
+#ifdef POSIX_TIMER
+/**
+ * @brief Appends a thread to the ready queue of its priority.
+ * @param tcb The control block of the thread.
+ */
+static void ready_push(thread_control_block_t *tcb);
+
+/**
+ * @brief Removes a thread from the ready queue of its priority.
+ * @param tcb The control block of the thread.
+ */
+static void ready_remove(thread_control_block_t *tcb);
+
+/**
+ * @brief Removes the oldest ready thread of the highest priority that can still be resumed.
+ * @return Returns its control block, or `NULL` if no thread is ready.
+ */
+static thread_control_block_t *ready_pop(void);
+
+/**
+ * @brief Adds a latency to a pair of total and maximum.
+ * @param total The total.
+ * @param max The maximum.
+ * @param expiry_ns The time the tick expired.
+ */
+static void record_tick_latency(uint64_t *total, uint64_t *max, uint64_t expiry_ns);
+#endif
+
+/*******************************************************************
+ * Signal Handlers
+ *******************************************************************/
+
+/**
+ * @brief Signal handler for the control signal, which stops or resumes the thread execution.
+ * @param sig The signal number.
+ * @param info The payload of the signal: the sequence number and the command.
+ * @param context The interrupted context (unused).
+ * @details A stop acknowledges its sequence number and counts down the controller's latch, then suspends the thread
+ *          with every signal blocked except the control signal and SIGALRM. The control signal is blocked while the
+ *          handler runs, so a resume that races with the acknowledgement stays queued until `sigsuspend`; it then runs
+ *          as a nested handler that clears `command_stopped` and lets the frame below return. Since realtime signals
+ *          are neither merged nor reordered, a stop queued behind that resume is handled only once this frame returns.
+ *          A signal sent with `kill` or `pthread_kill` carries no command and is ignored.
  */
-static LinkedList stopped_threads;
+void control_signal_handler(int sig, siginfo_t *info, void *context)
+{
+    (void) context; /* To remove warning */
+    thread_control_block_t *tcb = current_tcb;
+    uint32_t seq = COMMAND_SEQ(info->si_value.sival_int);
+    sigset_t signal_mask;
+
+    if (tcb == NULL || info->si_code != SI_QUEUE)
+    {
+        return;
+    }
+
+    /* A resume releases the stopped frame below this one */
+    if (COMMAND_OF(info->si_value.sival_int) == THREAD_COMMAND_RESUME)
+    {
+        tcb->command_stopped = 0;
+        acknowledge_command(tcb, seq);
+        return;
+    }
+    if (tcb->command_stopped)
+    {
+        acknowledge_command(tcb, seq);
+        return;
+    }
+
+    sigfillset(&signal_mask);  /* Block all signals */
+    sigdelset(&signal_mask, sig);  /* Unblock the control signal */
+    sigdelset(&signal_mask, SIGALRM);  /* Unblock SIGALRM */
+
+    /* Acknowledge the stop and release the controller waiting on the latch; no trace ring is allocated from here */
+    TRACE_HANDLER_ENTER();
+    tcb->command_stopped = 1;
+    acknowledge_stop(tcb);
+    acknowledge_command(tcb, seq);
+
+    /* Suspend the thread until a resume command is received */
+    while (tcb->command_stopped)
+    {
+        sigsuspend(&signal_mask);
+    }
+    STATS_DELIVERED(tcb, resume_delivery);
+    TRACE_EVENT(TRACE_RESUMED, tcb->index, 0);
+    TRACE_HANDLER_LEAVE();
+}
+
+/**
+ * @brief Signal handler for SIGXCPU, which the kernel sends when a `SCHED_DEADLINE` job overruns its runtime.
+ * @param sig The signal number (unused).
+ * @details The kernel throttles the thread until its next period; the handler only counts the overrun.
+ */
+void deadline_overrun_handler(int sig)
+{
+    (void) sig;
+    if (current_tcb != NULL)
+    {
+        atomic_fetch_add_explicit(&current_tcb->periodic.overruns, 1, memory_order_relaxed);
+    }
+}
+
+/*******************************************************************
+ * Static Functions
+ *******************************************************************/
+
+/**
+ * @brief Finds the control block of a worker of a scheduler.
+ * @param scheduler The scheduler.
+ * @param thread The thread ID to look up.
+ * @return Returns a pointer to the control block, or `NULL` if the thread is not a live worker of the scheduler.
+ * @details Looks the thread up in the hash index without a lock, in O(1) whatever the size of the pool; the state of
+ *          the thread is then read from the block.
+ */
+thread_control_block_t *lookup_tcb(scheduler_t *scheduler, pthread_t thread)
+{
+    uint64_t index;
+
+    if (scheduler->thread_index.entries == NULL || !thread_index_lookup(&scheduler->thread_index, thread, &index))
+    {
+        return NULL;
+    }
+
+    return live_tcb(&get_slot(scheduler, (unsigned int)index)->tcb, thread);
+}
+
+/**
+ * @brief Checks that a control block found by thread ID is bound to a live thread with that ID.
+ * @param tcb The control block.
+ * @param thread The thread ID it was found by.
+ * @return Returns the control block, or `NULL` if its thread has exited or was replaced.
+ * @details Skips blocks of exited threads: their thread ID may have been reused.
+ */
+thread_control_block_t *live_tcb(thread_control_block_t *tcb, pthread_t thread)
+{
+    thread_state_t state = tcb_get_state(tcb);
+
+    if (state == THREAD_STATE_UNUSED || state == THREAD_STATE_EXITED || !pthread_equal(thread, tcb->thread_id))
+    {
+        return NULL;
+    }
+
+    return tcb;
+}
+
+/**
+ * @brief Finds the control block of a managed thread.
+ * @param thread The thread ID to look up.
+ * @return Returns a pointer to the control block, or `NULL` if the thread is not managed.
+ * @details The main thread is checked first, then the process-wide index, which maps the workers of every scheduler
+ *          to their blocks. Like the `sched_*` calls, a lookup must not race with the destruction of the scheduler
+ *          of the thread.
+ */
+thread_control_block_t *find_tcb(pthread_t thread)
+{
+    owner_table_t *table = atomic_load_explicit(&owner_table, memory_order_acquire);
+    uint64_t tcb;
+
+    if (pthread_equal(thread, main_thread))
+    {
+        return &main_tcb;
+    }
+    if (table == NULL || !thread_index_lookup(&table->index, thread, &tcb))
+    {
+        return NULL;
+    }
+
+    return live_tcb((thread_control_block_t *)(uintptr_t)tcb, thread);
+}
+
+/**
+ * @brief Maps the thread of a worker in the process-wide index, in place of the previous thread of its slot.
+ * @param tcb The control block of the worker.
+ * @param previous The thread ID the slot was bound to before.
+ * @param thread The thread ID of the worker.
+ * @return Returns `!ERROR` on success, `ERROR` if memory is short.
+ * @details Called with the control signal blocked, like every writer of a thread index. A full table is replaced by
+ *          one twice as large before the new table is published.
+ */
+int index_worker(thread_control_block_t *tcb, pthread_t previous, pthread_t thread)
+{
+    owner_table_t *table, *grown;
+    int result = !ERROR;
+
+    pthread_mutex_lock(&owner_mutex);
+    table = atomic_load_explicit(&owner_table, memory_order_relaxed);
+    if (table != NULL)
+    {
+        thread_index_remove(&table->index, previous, (uintptr_t)tcb);
+    }
+    while (table == NULL || !thread_index_insert(&table->index, thread, (uintptr_t)tcb))
+    {
+        grown = (owner_table_t *)aligned_alloc(_Alignof(owner_table_t), sizeof(owner_table_t));
+        if (grown == NULL)
+        {
+            result = ERROR;
+            break;
+        }
+        grown->capacity = table != NULL ? 2 * table->capacity : NUMBER_OF_THREADS;
+        grown->retired = table;
+        if (!thread_index_init(&grown->index, grown->capacity))
+        {
+            free(grown);
+            result = ERROR;
+            break;
+        }
+        if (table != NULL && !thread_index_copy(&grown->index, &table->index))
+        {
+            thread_index_destroy(&grown->index);
+            free(grown);
+            result = ERROR;
+            break;
+        }
+        atomic_store_explicit(&owner_table, grown, memory_order_release);
+        table = grown;
+    }
+    pthread_mutex_unlock(&owner_mutex);
+
+    return result;
+}
+
+/**
+ * @brief Acknowledges a stop request of the calling thread.
+ * @param tcb The control block of the calling thread.
+ * @details Stores the time and the acknowledgement, then counts down the controller's latch. Async-signal-safe.
+ */
+void acknowledge_stop(thread_control_block_t *tcb)
+{
+    countdown_latch_t *latch = atomic_exchange(&tcb->stop_latch, NULL);
+
+    tcb->stop_ack_ns = timer_now_ns();
+    STATS_DELIVERED(tcb, stop_delivery);
+    TRACE_EVENT(TRACE_STOP_ACK, tcb->index, 0);
+    atomic_store_explicit(&tcb->stop_ack, SIGNAL_HANDLED, memory_order_release);
+    if (latch == &detached_latch)
+    {
+        complete_detached_stop(tcb);
+    }
+    if (latch != NULL)
+    {
+        latch_count_down(latch);
+    }
+}
+
+/**
+ * @brief Publishes the sequence number of the last command handled by the calling thread.
+ * @param tcb The control block of the calling thread.
+ * @param seq The sequence number.
+ * @details The word is stored before the waiter flag is read and `await_command` does the opposite, both sequentially
+ *          consistent, so the futex is only woken when a controller sleeps on it. Async-signal-safe.
+ */
+void acknowledge_command(thread_control_block_t *tcb, uint32_t seq)
+{
+    atomic_store(&tcb->commands_acked, seq);
+    if (atomic_load(&tcb->commands_waiting))
+    {
+        futex_wake(&tcb->commands_acked, 1);
+    }
+}
+
+/**
+ * @brief Queues a command to a thread with the next sequence number.
+ * @param tcb The control block of the thread.
+ * @param command The command.
+ * @param seq Receives the sequence number of the command.
+ * @return Returns `!ERROR` if the signal was queued, `ERROR` otherwise.
+ * @details Only the controller owning the thread's transition sends, so the numbers reach the thread in order.
+ *          Sending fails with `EAGAIN` once the caller's quota of queued signals is used up.
+ */
+int send_command(thread_control_block_t *tcb, thread_command_t command, uint32_t *seq)
+{
+    uint32_t previous = atomic_load_explicit(&tcb->commands_sent, memory_order_relaxed);
+    uint32_t next = (previous + 1) & COMMAND_SEQ_MASK;
+    union sigval value;
+
+    value.sival_int = COMMAND_PAYLOAD(next, command);
+    atomic_store(&tcb->commands_sent, next);
+    if (pthread_sigqueue(tcb->thread_id, CONTROL_SIGNAL, value) != 0)
+    {
+        atomic_store(&tcb->commands_sent, previous);
+        return ERROR;
+    }
+
+    *seq = next;
+    return !ERROR;
+}
+
+/**
+ * @brief Waits until a thread has handled a command.
+ * @param tcb The control block of the thread.
+ * @param seq The sequence number of the command.
+ * @return Returns `!ERROR` once the command is acknowledged, `ERROR` if the thread exited.
+ * @details A command is acknowledged once the last acknowledged number is at most half the sequence space ahead of
+ *          it. The exit path marks the thread EXITED before it publishes the last number sent, so a controller that
+ *          sends after that reads EXITED here instead of sleeping.
+ */
+int await_command(thread_control_block_t *tcb, uint32_t seq)
+{
+    uint32_t acked = atomic_load_explicit(&tcb->commands_acked, memory_order_acquire);
+
+    /* Short bounded spin: the handler usually runs within microseconds */
+    for (int i = 0; i < FUTEX_SPIN_LIMIT && ((acked - seq) & COMMAND_SEQ_MASK) > (COMMAND_SEQ_MASK >> 1); i++)
+    {
+        acked = atomic_load_explicit(&tcb->commands_acked, memory_order_acquire);
+    }
+
+    while (((acked - seq) & COMMAND_SEQ_MASK) > (COMMAND_SEQ_MASK >> 1))
+    {
+        if (tcb_get_state(tcb) == THREAD_STATE_EXITED)
+        {
+            return ERROR;
+        }
+        atomic_store(&tcb->commands_waiting, 1);
+        acked = atomic_load(&tcb->commands_acked);
+        if (((acked - seq) & COMMAND_SEQ_MASK) > (COMMAND_SEQ_MASK >> 1) && tcb_get_state(tcb) != THREAD_STATE_EXITED)
+        {
+            futex_wait(&tcb->commands_acked, acked, NULL);
+        }
+        atomic_store(&tcb->commands_waiting, 0);
+        acked = atomic_load_explicit(&tcb->commands_acked, memory_order_acquire);
+    }
+
+    return tcb_get_state(tcb) == THREAD_STATE_EXITED ? ERROR : !ERROR;
+}
+
+/**
+ * @brief Publishes the state reached by a transition and queues the thread for that state.
+ * @param tcb The control block owned by the caller.
+ * @param state The new state (`THREAD_STATE_RUNNING` or `THREAD_STATE_STOPPED`).
+ * @details The main thread is never queued; a worker is queued on its scheduler. A block that is still queued for
+ *          `state` from an earlier transition is not queued again, so each queue holds at most one entry per thread
+ *          and can never fill up.
+ */
+void publish_state(thread_control_block_t *tcb, thread_state_t state)
+{
+    uint32_t bit = 1u << state;
+    scheduler_t *scheduler;
+
+    STATS_ENTER(tcb, state == THREAD_STATE_STOPPED);
+    tcb_set_state(tcb, state);
+
+    if (tcb == &main_tcb)
+    {
+        return;
+    }
+
+    /* The control block of a worker is the first member of its slot */
+    scheduler = ((worker_slot_t *)tcb)->owner;
+    if ((atomic_fetch_or_explicit(&tcb->queued, bit, memory_order_acq_rel) & bit) == 0)
+    {
+        lockfree_queue_enqueue(state == THREAD_STATE_RUNNING ? &scheduler->running_threads : &scheduler->stopped_threads,
+                               tcb);
+    }
+}
+
+/**
+ * @brief Takes ownership of a thread's stop and sends it the stop signal.
+ * @param tcb The control block of the thread to stop.
+ * @param latch The latch the thread counts down once it acknowledges.
+ * @return Returns `!ERROR` if the signal was sent, `ERROR` otherwise.
+ * @details A thread that polls safepoints is asked to stop through its request counter, any other thread through a
+ *          stop command on the control signal.
+ *          On success the latch holds one more count-down, released by the stop handler, the safepoint or the thread's exit.
+ *          The thread's state is checked after the latch is published and the exit path clears the latch after
+ *          publishing EXITED, so whichever side reclaims the latch is the one that counts it down.
+ */
+int begin_stop(thread_control_block_t *tcb, countdown_latch_t *latch)
+{
+    thread_state_t state;
+    uint32_t seq;
+
+    /* Take ownership of the transition */
+    if (!tcb_try_transition(tcb, THREAD_STATE_RUNNING, THREAD_STATE_STOPPING, &state))
+    {
+        TRACE_EVENT(TRACE_TRANSITION_FAILED, tcb->index, 1);
+        LOG_WARN(state == THREAD_STATE_STOPPED ? "Thread is already stopped\n" :
+               state == THREAD_STATE_IDLE ? "Thread is idle\n" : "Thread is busy\n");
+        return ERROR;
+    }
+
+    /* Publish the latch, then make sure the thread did not exit in the meantime */
+    atomic_store(&tcb->stop_ack, SIGNAL_UNHANDLED);
+    latch_add(latch, 1);
+    atomic_store(&tcb->stop_latch, latch);
+    if (tcb_get_state(tcb) == THREAD_STATE_EXITED)
+    {
+        LOG_WARN("Thread has exited\n");
+        if (atomic_exchange(&tcb->stop_latch, NULL) == latch)
+        {
+            latch_count_down(latch);
+        }
+        return ERROR;
+    }
+
+    /* Cooperative threads see the request at their next safepoint */
+    STATS_SENT(tcb, stop_delivery);
+    TRACE_EVENT(TRACE_STOP_REQUEST, tcb->index, atomic_load(&tcb->cooperative) != 0);
+    if (atomic_load(&tcb->cooperative))
+    {
+        atomic_fetch_add_explicit(&tcb->stop_requests, 1, memory_order_release);
+        return !ERROR;
+    }
+
+    /* Try to queue the stop command to the thread */
+    if (send_command(tcb, THREAD_COMMAND_STOP, &seq) == ERROR)
+    {
+        LOG_WARN("Cannot send stop signal\n");
+        if (atomic_exchange(&tcb->stop_latch, NULL) == latch)
+        {
+            latch_count_down(latch);
+        }
+        tcb_try_transition(tcb, THREAD_STATE_STOPPING, THREAD_STATE_RUNNING, NULL);
+        return ERROR;
+    }
+
+    return !ERROR;
+}
+
+/**
+ * @brief Completes a stop started by `begin_stop` once its latch has reached zero.
+ * @param tcb The control block of the thread.
+ * @return Returns `!ERROR` if the thread is stopped, `ERROR` if it exited instead.
+ */
+int finish_stop(thread_control_block_t *tcb)
+{
+    if (atomic_load_explicit(&tcb->stop_ack, memory_order_acquire) == SIGNAL_THREAD_EXITED)
+    {
+        TRACE_EVENT(TRACE_STOPPED, tcb->index, 0);
+        LOG_WARN("Thread has exited\n");
+        return ERROR;
+    }
+
+    TRACE_EVENT(TRACE_STOPPED, tcb->index, 1);
+    STATS_COUNT(tcb, stops);
+    publish_state(tcb, THREAD_STATE_STOPPED);
+
+    return !ERROR;
+}
+
+/**
+ * @brief Starts a stop that completes without a controller waiting for it.
+ * @param tcb The control block of the thread to stop.
+ * @return Returns `!ERROR` if the stop is under way, `ERROR` otherwise.
+ * @details For controllers that must not block, such as the timer thread. The stop publishes `detached_latch`, so the
+ *          thread publishes STOPPED itself when it acknowledges; a resume that arrives before then is deferred to it.
+ */
+int stop_detached(thread_control_block_t *tcb)
+{
+    uint32_t expected = 0;
+
+    if (!atomic_compare_exchange_strong(&tcb->stop_detached, &expected, 1))
+    {
+        TRACE_EVENT(TRACE_TRANSITION_FAILED, tcb->index, 1);
+        LOG_WARN("Thread is busy\n");
+        return ERROR;
+    }
+    if (begin_stop(tcb, &detached_latch) == ERROR)
+    {
+        atomic_store(&tcb->stop_detached, 0);
+        return ERROR;
+    }
+
+    return !ERROR;
+}
+
+/**
+ * @brief Completes a detached stop of the calling thread and applies the resume deferred to it, if any.
+ * @param tcb The control block of the calling thread.
+ * @details Called from the stop handler or the safepoint once the stop is acknowledged. STOPPED is published before
+ *          the flag is cleared and `do_resume` defers only while the flag is set, so a resume is either taken over
+ *          here or finds the thread STOPPED. The deferred resume is queued to the thread itself. Async-signal-safe.
+ */
+void complete_detached_stop(thread_control_block_t *tcb)
+{
+    finish_stop(tcb);
+    if (atomic_exchange(&tcb->stop_detached, 0) == 2)
+    {
+        do_resume(tcb);
+    }
+}
+
+/**
+ * @brief Takes ownership of a thread's resume and sends it the resume signal.
+ * @param tcb The control block of the thread to resume.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ * @details A worker of a quiesced scheduler is left stopped; only `sched_unquiesce` resumes it.
+ */
+int do_resume(thread_control_block_t *tcb)
+{
+    thread_state_t state;
+
+    /* Take ownership of the transition, or hand the resume to a detached stop still in flight */
+    while (!tcb_try_transition(tcb, THREAD_STATE_STOPPED, THREAD_STATE_RESUMING, &state))
+    {
+        uint32_t detached = 1;
+
+        if (state == THREAD_STATE_STOPPING && atomic_compare_exchange_strong(&tcb->stop_detached, &detached, 2))
+        {
+            return !ERROR;
+        }
+        /* Retry if the detached stop completed in the meantime */
+        if (state != THREAD_STATE_STOPPING || detached != 0 || tcb_get_state(tcb) != THREAD_STATE_STOPPED)
+        {
+            TRACE_EVENT(TRACE_TRANSITION_FAILED, tcb->index, 0);
+            LOG_WARN(state == THREAD_STATE_RUNNING ? "Thread is already running\n" : "Thread is busy\n");
+            return ERROR;
+        }
+    }
+    if (quiesce_gated(tcb))
+    {
+        tcb_set_state(tcb, THREAD_STATE_STOPPED);
+        TRACE_EVENT(TRACE_TRANSITION_FAILED, tcb->index, 0);
+        LOG_WARN("Pool is quiesced\n");
+        return ERROR;
+    }
+
+    return deliver_resume(tcb);
+}
+
+/**
+ * @brief Sends the resume of a thread the caller has moved to RESUMING.
+ * @param tcb The control block of the thread.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ */
+int deliver_resume(thread_control_block_t *tcb)
+{
+    uint32_t seq;
+
+    /* Cooperative threads are parked on their resume counter */
+    STATS_SENT(tcb, resume_delivery);
+    TRACE_EVENT(TRACE_RESUME_REQUEST, tcb->index, atomic_load(&tcb->cooperative) != 0);
+    if (atomic_load(&tcb->cooperative))
+    {
+        atomic_fetch_add_explicit(&tcb->resumes, 1, memory_order_release);
+        futex_wake(&tcb->resumes, 1);
+    }
+    /* Try to queue the resume command to the thread */
+    else if (send_command(tcb, THREAD_COMMAND_RESUME, &seq) == ERROR)
+    {
+        LOG_WARN("Cannot send resume signal\n");
+        tcb_set_state(tcb, THREAD_STATE_STOPPED);
+        return ERROR;
+    }
+
+    STATS_COUNT(tcb, resumes);
+    publish_state(tcb, THREAD_STATE_RUNNING);
+
+    return !ERROR;
+}
+
+/**
+ * @brief Tells whether a thread belongs to a quiesced scheduler.
+ * @param tcb The control block of the thread, which the caller has just moved out of a stable state.
+ * @return Returns non-zero if the thread may not be resumed or handed work until the scheduler is unquiesced.
+ * @details The fence orders the caller's CAS before the load of the flag, and `sched_quiesce` fences between setting
+ *          the flag and scanning the states, so a transition the flag misses is seen by the scan.
+ */
+int quiesce_gated(thread_control_block_t *tcb)
+{
+    if (tcb == &main_tcb)
+    {
+        return 0;
+    }
+
+    atomic_thread_fence(memory_order_seq_cst);
+    return atomic_load_explicit(&((worker_slot_t *)tcb)->owner->quiescing, memory_order_relaxed) != 0;
+}
+
+/**
+ * @brief Stops one thread and waits for its acknowledgement.
+ * @param tcb The control block of the thread.
+ * @return Returns `!ERROR` if the thread is stopped, `ERROR` otherwise.
+ * @details `stop_thread` without the lookup of the control block.
+ */
+int stop_tcb(thread_control_block_t *tcb)
+{
+    countdown_latch_t latch;
+
+    latch_init(&latch, 1);
+    if (begin_stop(tcb, &latch) == ERROR)
+    {
+        return ERROR;
+    }
+    latch_count_down(&latch);
+    latch_wait(&latch);
+
+    return finish_stop(tcb);
+}
+
+/**
+ * @brief Callback of a thread's stop timer.
+ * @param arg The control block of the thread.
+ * @details Runs on the timer thread, which only starts the stop: the thread completes it when it acknowledges, so a
+ *          slow or cooperative target does not hold back the other timers.
+ */
+void stop_timer_expired(void *arg)
+{
+    stop_detached((thread_control_block_t *)arg);
+}
+
+/**
+ * @brief Callback of a thread's resume timer.
+ * @param arg The control block of the thread.
+ */
+void resume_timer_expired(void *arg)
+{
+    do_resume((thread_control_block_t *)arg);
+}
+
+/**
+ * @brief Waits until a thread has published its kernel ID.
+ * @param tcb The control block of the thread.
+ * @details A worker just spawned may not know its kernel ID yet: the caller marks the word and sleeps on it until the
+ *          worker publishes its ID, which wakes it. Must not be called with the periodic mutex held.
+ */
+void await_kernel_tid(thread_control_block_t *tcb)
+{
+    uint32_t tid = atomic_load_explicit(&tcb->kernel_tid, memory_order_acquire);
+
+    while (tid == 0 || tid == KERNEL_TID_WAITING)
+    {
+        if (tid == 0 && !atomic_compare_exchange_weak(&tcb->kernel_tid, &tid, KERNEL_TID_WAITING))
+        {
+            continue;
+        }
+        futex_wait(&tcb->kernel_tid, KERNEL_TID_WAITING, NULL);
+        tid = atomic_load_explicit(&tcb->kernel_tid, memory_order_acquire);
+    }
+}
+
+/**
+ * @brief Sets the kernel scheduling attributes of a thread.
+ * @param tcb The control block of the thread.
+ * @param params The timing of a `SCHED_DEADLINE` reservation, or `NULL` to go back to `SCHED_OTHER`.
+ * @return Returns `!ERROR` on success, `ERROR` on failure or if the kernel ID of the thread is not known yet.
+ * @details The reservation asks for SIGXCPU on overruns, so they are counted like those of the user-space policies.
+ *          Never waits: ID 0 would name the caller, so a thread without a published ID is refused, and callers that
+ *          need the ID wait for it with `await_kernel_tid` before taking the periodic mutex.
+ */
+int set_deadline_attr(thread_control_block_t *tcb, const periodic_params_t *params)
+{
+    deadline_attr_t attr;
+    uint32_t tid = atomic_load_explicit(&tcb->kernel_tid, memory_order_acquire);
+
+    if (tid == 0 || tid == KERNEL_TID_WAITING)
+    {
+        return ERROR;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.sched_policy = SCHED_OTHER;
+    if (params != NULL)
+    {
+        attr.sched_policy = SCHED_DEADLINE;
+        attr.sched_flags = SCHED_FLAG_DL_OVERRUN;
+        attr.sched_runtime = params->budget_ns;
+        attr.sched_deadline = params->deadline_ns;
+        attr.sched_period = params->period_ns;
+    }
+
+    return syscall(SYS_sched_setattr, (pid_t)tid, &attr, 0) == 0 ? !ERROR : ERROR;
+}
+
+/**
+ * @brief Returns the scheduler a thread belongs to.
+ * @param tcb The control block of the thread.
+ * @return Returns the owner of a worker, or the default scheduler for the main thread.
+ */
+scheduler_t *scheduler_of(thread_control_block_t *tcb)
+{
+    /* The control block of a worker is the first member of its slot */
+    return tcb == &main_tcb ? &default_scheduler : ((worker_slot_t *)tcb)->owner;
+}
+
+/**
+ * @brief Blocks the control signal of the calling thread and takes the periodic mutex of a scheduler.
+ * @param scheduler The scheduler.
+ * @param old_mask Receives the signal mask to restore.
+ * @details The timer thread takes the mutex to dispatch, and only its dispatcher resumes a periodic job: a worker
+ *          stopped while holding the mutex, or the service mutex of the timer wheel behind it, would stall every
+ *          timer. Blocking the signal holds a stop back until the worker has left the critical section.
+ */
+void periodic_lock(scheduler_t *scheduler, sigset_t *old_mask)
+{
+    sigset_t control_signals;
+
+    sigemptyset(&control_signals);
+    sigaddset(&control_signals, CONTROL_SIGNAL);
+    pthread_sigmask(SIG_BLOCK, &control_signals, old_mask);
+    pthread_mutex_lock(&scheduler->periodic.mutex);
+}
+
+/**
+ * @brief Releases the periodic mutex of a scheduler and restores the signal mask of the calling thread.
+ * @param scheduler The scheduler.
+ * @param old_mask The signal mask returned by `periodic_lock`.
+ */
+void periodic_unlock(scheduler_t *scheduler, const sigset_t *old_mask)
+{
+    pthread_mutex_unlock(&scheduler->periodic.mutex);
+    pthread_sigmask(SIG_SETMASK, old_mask, NULL);
+}
+
+/**
+ * @brief Returns the urgency of a periodic job under the policy of its scheduler; lower is more urgent.
+ * @param scheduler The scheduler of the thread.
+ * @param tcb The control block of the thread.
+ * @details Rate-monotonic priorities are static, so the key is the period; EDF compares absolute deadlines.
+ */
+uint64_t periodic_key(scheduler_t *scheduler, thread_control_block_t *tcb)
+{
+    return scheduler->periodic.policy == SCHED_POLICY_EDF ? tcb->periodic.deadline_at_ns : tcb->periodic.period_ns;
+}
+
+/**
+ * @brief Gives the CPU to the most urgent released periodic job of a scheduler.
+ * @param scheduler The scheduler.
+ * @details Must be called with the periodic mutex of the scheduler held. The running job keeps the CPU unless a
+ *          released job is strictly more urgent; it is then stopped with a detached stop, so the mutex is never held
+ *          across an acknowledgement. A job waiting in `wait_next_period` is woken on its dispatch counter, a job the
+ *          scheduler stopped is resumed (after its stop completes, if it is still in flight), and the budget timer is
+ *          armed for what is left of its budget. The periodic set is scanned linearly; it holds a handful of control loops.
+ *          Threads that cannot be stopped or resumed any more leave the periodic set.
+ */
+void periodic_dispatch(scheduler_t *scheduler)
+{
+    for (;;)
+    {
+        thread_control_block_t *best = scheduler->periodic.running;
+        thread_control_block_t *running = scheduler->periodic.running;
+        uint64_t now;
+
+        for (thread_control_block_t *tcb = scheduler->periodic.head; tcb != NULL; tcb = tcb->periodic.next)
+        {
+            if (tcb->periodic.state == PERIODIC_READY &&
+                (best == NULL || periodic_key(scheduler, tcb) < periodic_key(scheduler, best)))
+            {
+                best = tcb;
+            }
+        }
+        if (best == running)
+        {
+            return;
+        }
+
+        /* Preempt the running job, which keeps the budget it has left */
+        now = timer_now_ns();
+        if (running != NULL)
+        {
+            timer_disarm(&scheduler->periodic.budget_timer);
+            running->periodic.budget_used_ns += now - running->periodic.dispatched_ns;
+            scheduler->periodic.running = NULL;
+            if (stop_detached(running) == ERROR)
+            {
+                periodic_leave(scheduler, running);
+                continue;
+            }
+            running->periodic.state = PERIODIC_READY;
+            running->periodic.held = 1;
+            atomic_fetch_add_explicit(&running->periodic.preemptions, 1, memory_order_relaxed);
+        }
+
+        /* Dispatch the most urgent job */
+        if (best->periodic.held)
+        {
+            best->periodic.held = 0;
+            if (do_resume(best) == ERROR)
+            {
+                periodic_leave(scheduler, best);
+                continue;
+            }
+        }
+        else
+        {
+            atomic_fetch_add_explicit(&best->periodic.dispatches, 1, memory_order_release);
+            futex_wake(&best->periodic.dispatches, 1);
+        }
+        best->periodic.state = PERIODIC_RUNNING;
+        best->periodic.dispatched_ns = now;
+        scheduler->periodic.running = best;
+        timer_arm(&scheduler->periodic.budget_timer,
+                  now + (best->periodic.budget_ns > best->periodic.budget_used_ns ?
+                         best->periodic.budget_ns - best->periodic.budget_used_ns : 0),
+                  budget_timer_expired, scheduler);
+        return;
+    }
+}
+
+/**
+ * @brief Removes a thread from the periodic set of its scheduler and lets it run.
+ * @param scheduler The scheduler of the thread.
+ * @param tcb The control block of the thread.
+ * @details Must be called with the periodic mutex of the scheduler held. A thread the scheduler stopped is resumed and
+ *          one waiting in `wait_next_period` is released, so it returns to its body as a normal thread.
+ */
+void periodic_leave(scheduler_t *scheduler, thread_control_block_t *tcb)
+{
+    thread_control_block_t **link = &scheduler->periodic.head;
+
+    while (*link != NULL && *link != tcb)
+    {
+        link = &(*link)->periodic.next;
+    }
+    if (*link != NULL)
+    {
+        *link = tcb->periodic.next;
+    }
+    tcb->periodic.next = NULL;
+
+    timer_disarm(&tcb->periodic.release_timer);
+    if (scheduler->periodic.running == tcb)
+    {
+        timer_disarm(&scheduler->periodic.budget_timer);
+        scheduler->periodic.running = NULL;
+    }
+    if (scheduler->periodic.policy == SCHED_POLICY_DEADLINE)
+    {
+        set_deadline_attr(tcb, NULL);
+    }
+
+    tcb->periodic.state = PERIODIC_NONE;
+    atomic_fetch_add_explicit(&tcb->periodic.dispatches, 1, memory_order_release);
+    futex_wake(&tcb->periodic.dispatches, 1);
+    if (tcb->periodic.held)
+    {
+        tcb->periodic.held = 0;
+        do_resume(tcb);
+    }
+}
+
+/**
+ * @brief Callback of a thread's release timer.
+ * @param arg The control block of the thread.
+ * @details Releases the next job on the absolute schedule of the thread. A job still incomplete at the next release
+ *          has missed its deadline, since deadlines do not exceed periods; the thread goes on with a fresh budget.
+ */
+void release_timer_expired(void *arg)
+{
+    thread_control_block_t *tcb = (thread_control_block_t *)arg;
+    scheduler_t *scheduler = scheduler_of(tcb);
+    uint64_t now;
+
+    pthread_mutex_lock(&scheduler->periodic.mutex);
+    if (tcb->periodic.state == PERIODIC_NONE || scheduler->periodic.policy == SCHED_POLICY_DEADLINE)
+    {
+        pthread_mutex_unlock(&scheduler->periodic.mutex);
+        return;
+    }
+
+    now = timer_now_ns();
+    if (tcb->periodic.state != PERIODIC_WAITING)
+    {
+        atomic_fetch_add_explicit(&tcb->periodic.deadline_misses, 1, memory_order_relaxed);
+    }
+    tcb->periodic.release_ns += tcb->periodic.period_ns;
+    tcb->periodic.deadline_at_ns = tcb->periodic.release_ns + tcb->periodic.deadline_ns;
+    tcb->periodic.budget_used_ns = 0;
+    timer_arm(&tcb->periodic.release_timer, tcb->periodic.release_ns + tcb->periodic.period_ns,
+              release_timer_expired, tcb);
+
+    if (tcb == scheduler->periodic.running)
+    {
+        tcb->periodic.dispatched_ns = now;
+        timer_arm(&scheduler->periodic.budget_timer, now + tcb->periodic.budget_ns, budget_timer_expired, scheduler);
+    }
+    else
+    {
+        tcb->periodic.state = PERIODIC_READY;
+    }
+    periodic_dispatch(scheduler);
+    pthread_mutex_unlock(&scheduler->periodic.mutex);
+}
+
+/**
+ * @brief Callback of the budget timer of a scheduler.
+ * @param arg The scheduler.
+ * @details The running job has used up its budget: the overrun is counted and the thread is stopped until its next
+ *          release, then the next job is dispatched. The stop is detached, so the timer thread does not wait for it.
+ */
+void budget_timer_expired(void *arg)
+{
+    scheduler_t *scheduler = (scheduler_t *)arg;
+    thread_control_block_t *tcb;
+    uint64_t now;
+
+    pthread_mutex_lock(&scheduler->periodic.mutex);
+    tcb = scheduler->periodic.running;
+    if (tcb == NULL)
+    {
+        pthread_mutex_unlock(&scheduler->periodic.mutex);
+        return;
+    }
+
+    /* The timer may have been re-armed while this expiry was on its way */
+    now = timer_now_ns();
+    tcb->periodic.budget_used_ns += now - tcb->periodic.dispatched_ns;
+    tcb->periodic.dispatched_ns = now;
+    if (tcb->periodic.budget_used_ns < tcb->periodic.budget_ns)
+    {
+        timer_arm(&scheduler->periodic.budget_timer, now + tcb->periodic.budget_ns - tcb->periodic.budget_used_ns,
+                  budget_timer_expired, scheduler);
+        pthread_mutex_unlock(&scheduler->periodic.mutex);
+        return;
+    }
+
+    atomic_fetch_add_explicit(&tcb->periodic.overruns, 1, memory_order_relaxed);
+    scheduler->periodic.running = NULL;
+    if (stop_detached(tcb) != ERROR)
+    {
+        tcb->periodic.state = PERIODIC_THROTTLED;
+        tcb->periodic.held = 1;
+    }
+    else
+    {
+        periodic_leave(scheduler, tcb);
+    }
+    periodic_dispatch(scheduler);
+    pthread_mutex_unlock(&scheduler->periodic.mutex);
+}
+
+/**
+ * @brief Returns a slot of a scheduler.
+ * @param scheduler The scheduler.
+ * @param index The index of the slot, below `slot_count`.
+ * @return Returns a pointer to the slot.
+ */
+worker_slot_t *get_slot(scheduler_t *scheduler, unsigned int index)
+{
+    return &scheduler->slot_chunks[index / POOL_CHUNK_SIZE][index % POOL_CHUNK_SIZE];
+}
+
+/**
+ * @brief Reserves a slot for a new worker thread.
+ * @param scheduler The scheduler.
+ * @return Returns a pointer to the slot, or `NULL` if the pool is full.
+ * @details Must be called with `pool_mutex` held. Slots of exited threads are reused before the table grows; a
+ *          reused block keeps its queue bits and counters, since stale queue entries and controllers may still see it.
+ *          A thread on a pooled stack may still be unwinding on it after releasing its slot, so it is joined here
+ *          before its stack goes back to the pool for the next thread.
+ */
+worker_slot_t *claim_slot(scheduler_t *scheduler)
+{
+    unsigned int count = atomic_load_explicit(&scheduler->slot_count, memory_order_relaxed);
+    worker_slot_t *slot;
+
+    /* Reuse the slot of an exited thread */
+    for (unsigned int i = 0; i < count; i++)
+    {
+        slot = get_slot(scheduler, i);
+        if (atomic_load_explicit(&slot->reusable, memory_order_acquire))
+        {
+            atomic_store(&slot->reusable, 0);
+            if (slot->joinable)
+            {
+                pthread_join(slot->tcb.thread_id, NULL);
+                slot->joinable = 0;
+            }
+            if (slot->stack != NULL)
+            {
+                stack_pool_put(&scheduler->worker_stacks, slot->stack);
+                slot->stack = NULL;
+            }
+            atomic_store(&slot->tcb.stop_ack, SIGNAL_UNHANDLED);
+            atomic_store(&slot->tcb.stop_latch, NULL);
+            atomic_store(&slot->tcb.stop_detached, 0);
+            atomic_store(&slot->tcb.cooperative, 0);
+            atomic_store(&slot->tcb.kernel_tid, 0);
+            slot->tcb.stops_served = atomic_load(&slot->tcb.stop_requests);
+            slot->tcb.handoffs_taken = atomic_load(&slot->tcb.handoffs);
+            slot->tcb.command_stopped = 0;
+#if THREAD_STATS
+            stats_reset(&slot->tcb.stats);
+#endif
+            tcb_set_state(&slot->tcb, THREAD_STATE_UNUSED);
+            return slot;
+        }
+    }
+
+    if (count == scheduler->pool_config.max_threads)
+    {
+        return NULL;
+    }
+
+    /* Grow the table by one chunk when the last one is full; slots keep the cache-line alignment of their statistics */
+    if (scheduler->slot_chunks[count / POOL_CHUNK_SIZE] == NULL)
+    {
+        scheduler->slot_chunks[count / POOL_CHUNK_SIZE] =
+            (worker_slot_t *)aligned_alloc(_Alignof(worker_slot_t), POOL_CHUNK_SIZE * sizeof(worker_slot_t));
+        if (scheduler->slot_chunks[count / POOL_CHUNK_SIZE] == NULL)
+        {
+            return NULL;
+        }
+        memset(scheduler->slot_chunks[count / POOL_CHUNK_SIZE], 0, POOL_CHUNK_SIZE * sizeof(worker_slot_t));
+    }
+
+    slot = get_slot(scheduler, count);
+    slot->owner = scheduler;
+    tcb_init(&slot->tcb, count);
+    atomic_init(&slot->work, 0);
+    atomic_init(&slot->reusable, 0);
+    atomic_store_explicit(&scheduler->slot_count, count + 1, memory_order_release);
+
+    return slot;
+}
+
+/**
+ * @brief Initializes the attributes of a new worker thread, including its CPU placement.
+ * @param attr The attributes to initialize.
+ * @param slot The pool slot of the worker.
+ * @details The placement depends on the slot index only, so a worker spawned into a reused slot lands where its
+ *          predecessor ran. Workers are joinable: a worker is joined when its slot is reused or its scheduler
+ *          destroyed, so nothing frees the slot or the stack while the thread still runs. If no pooled stack can be
+ *          mapped, the C library provides one. Workers inherit the scheduling policy of their creator: a real-time
+ *          policy needs `CAP_SYS_NICE`, and `set_thread_period` sets one per thread where it is wanted.
+ */
+void init_worker_attr(pthread_attr_t *attr, worker_slot_t *slot)
+{
+    scheduler_t *scheduler = slot->owner;
+    cpu_set_t cpus;
+
+    pthread_attr_init(attr);
+
+    /* Run on a recycled stack; its guard is the pool's, `pthread_attr_setstack` ignores the guard size */
+    if (scheduler->pool_config.stack_size != 0 && (slot->stack = stack_pool_get(&scheduler->worker_stacks)) != NULL)
+    {
+        pthread_attr_setstack(attr, slot->stack->base, stack_pool_stack_size(&scheduler->worker_stacks));
+    }
+
+    /* Pin the thread before it runs, so its stack is first touched on its own node */
+    slot->node = -1;
+    if (topology_place(&scheduler->topology, scheduler->pool_config.placement, scheduler->pool_config.cpus,
+                       scheduler->pool_config.cpu_count, slot->tcb.index, &cpus, &slot->node))
+    {
+        pthread_attr_setaffinity_np(attr, sizeof(cpus), &cpus);
+    }
+}
+
+/**
+ * @brief Parks the calling worker until it is handed new work.
+ * @param slot The pool slot of the calling worker.
+ * @return Returns 1 once the worker has new work, 0 if it retired instead.
+ * @details The worker first moves RUNNING -> IDLE, serving any stop that is still in flight. `spawn_thread` claims an
+ *          idle worker with a CAS out of IDLE and a retiring worker with a CAS into EXITED, so exactly one of them wins.
+ *          Every worker retires once its scheduler is being destroyed, whatever the minimum.
+ */
+int wait_for_work(worker_slot_t *slot)
+{
+    scheduler_t *scheduler = slot->owner;
+    uint32_t work = atomic_load_explicit(&slot->work, memory_order_acquire);
+    struct timespec timeout;
+    unsigned int live;
+
+    /* A pending stop signal is delivered by the next system call, a cooperative one at the safepoint */
+    while (!tcb_try_transition(&slot->tcb, THREAD_STATE_RUNNING, THREAD_STATE_IDLE, NULL))
+    {
+        safepoint();
+        sched_yield();
+    }
+
+    timeout.tv_sec = scheduler->pool_config.idle_timeout_ms / 1000;
+    timeout.tv_nsec = (long)(scheduler->pool_config.idle_timeout_ms % 1000) * 1000000L;
+
+    while (atomic_load_explicit(&slot->work, memory_order_acquire) == work && !atomic_load(&scheduler->destroying))
+    {
+        if (futex_wait(&slot->work, work, scheduler->pool_config.idle_timeout_ms != 0 ? &timeout : NULL) == 0 ||
+            errno != ETIMEDOUT)
+        {
+            continue;
+        }
+
+        /* Timed out: retire unless the pool is at its minimum */
+        live = atomic_load(&scheduler->live_workers);
+        while (live > scheduler->pool_config.min_threads &&
+               !atomic_compare_exchange_weak(&scheduler->live_workers, &live, live - 1))
+        {
+        }
+        if (live <= scheduler->pool_config.min_threads)
+        {
+            continue;
+        }
+        if (tcb_try_transition(&slot->tcb, THREAD_STATE_IDLE, THREAD_STATE_EXITED, NULL))
+        {
+            return 0;
+        }
+
+        /* A spawner claimed the worker meanwhile; its work is on the way */
+        atomic_fetch_add(&scheduler->live_workers, 1);
+    }
+
+    /* The scheduler is being destroyed: retire unless a spawner got in first */
+    if (atomic_load(&scheduler->destroying))
+    {
+        atomic_fetch_sub(&scheduler->live_workers, 1);
+        if (tcb_try_transition(&slot->tcb, THREAD_STATE_IDLE, THREAD_STATE_EXITED, NULL))
+        {
+            return 0;
+        }
+        atomic_fetch_add(&scheduler->live_workers, 1);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Allocates the list of control blocks a batch of stops waits for.
+ * @param local A list of `STOP_BATCH` entries on the caller's stack.
+ * @param count The number of stops in the batch.
+ * @param capacity Receives the capacity of the returned list.
+ * @return Returns `local` for small batches, otherwise a list to free with `release_pending`.
+ * @details If the allocation fails, the batch falls back to `local` and is flushed every `STOP_BATCH` stops.
+ */
+thread_control_block_t **alloc_pending(thread_control_block_t **local, size_t count, size_t *capacity)
+{
+    thread_control_block_t **pending = NULL;
+
+    if (count > STOP_BATCH)
+    {
+        pending = (thread_control_block_t **)malloc(count * sizeof(*pending));
+    }
+    if (pending == NULL)
+    {
+        *capacity = STOP_BATCH;
+        return local;
+    }
+
+    *capacity = count;
+    return pending;
+}
+
+/**
+ * @brief Frees a list returned by `alloc_pending`.
+ * @param pending The list.
+ * @param local The list on the caller's stack.
+ */
+void release_pending(thread_control_block_t **pending, thread_control_block_t **local)
+{
+    if (pending != local)
+    {
+        free(pending);
+    }
+}
+
+/**
+ * @brief Copies the statistics of a control block.
+ * @param tcb The control block.
+ * @param snapshot Receives the statistics.
+ */
+void snapshot_tcb(thread_control_block_t *tcb, thread_stats_snapshot_t *snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->thread_id = tcb->thread_id;
+    snapshot->index = tcb->index;
+    snapshot->state = tcb_get_state(tcb);
+#if THREAD_STATS
+    stats_snapshot(&tcb->stats, snapshot);
+#endif
+}
+
+/**
+ * @brief Body of the thread started by `start_stats_dump`.
+ * @param arg The interval between two dumps in milliseconds.
+ * @return Returns `NULL` once `stop_stats_dump` is called.
+ * @details Sleeps on `dump_running`, so `stop_stats_dump` ends the wait at once instead of after a full interval.
+ */
+void *stats_dump_body(void *arg)
+{
+    scheduler_t *scheduler = &default_scheduler;
+    unsigned int interval_ms = (unsigned int)(uintptr_t)arg;
+    thread_stats_snapshot_t *snapshots = NULL;
+    struct timespec interval;
+    unsigned int capacity = 0, count;
+
+    interval.tv_sec = interval_ms / 1000;
+    interval.tv_nsec = (long)(interval_ms % 1000) * 1000000L;
+
+    while (atomic_load(&dump_running))
+    {
+        futex_wait(&dump_running, 1, &interval);
+        if (!atomic_load(&dump_running))
+        {
+            break;
+        }
+
+        /* Grow the buffer with the pool */
+        count = atomic_load_explicit(&scheduler->slot_count, memory_order_acquire);
+        if (count > capacity)
+        {
+            thread_stats_snapshot_t *grown =
+                (thread_stats_snapshot_t *)realloc(snapshots, count * sizeof(thread_stats_snapshot_t));
+            if (grown == NULL)
+            {
+                continue;
+            }
+            snapshots = grown;
+            capacity = count;
+        }
+        stats_print(stdout, snapshots, get_all_thread_stats(snapshots, capacity));
+    }
+
+    free(snapshots);
+    return NULL;
+}
+
+/*******************************************************************
+ * Functions
+ *******************************************************************/
+
+/**
+ * @brief Sends a control signal to stop the execution of a thread.
+ * @param thread_to_stop The thread ID of the thread to be stopped.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ * @details This function moves the thread RUNNING -> STOPPING with a CAS, queues a stop command to it, which triggers
+ *          the `control_signal_handler` to pause the thread, and publishes STOPPED once the handler acknowledges.
+ *          Controllers stopping or resuming different threads never wait for each other. It is `stop_threads` with one thread.
+ */
+int stop_thread(pthread_t thread_to_stop)
+{
+    return stop_threads(&thread_to_stop, 1) == 1 ? !ERROR : ERROR;
+}
+
+/**
+ * @brief Sends a control signal to resume the execution of a thread.
+ * @param thread_to_resume The thread ID of the thread to be resumed.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ * @details This function moves the thread STOPPED -> RESUMING with a CAS, queues a resume command to it, which
+ *          releases the thread from the `control_signal_handler`, and publishes RUNNING.
+ */
+int resume_thread(pthread_t thread_to_resume)
+{
+    /* Find the control block of the thread */
+    thread_control_block_t *tcb = find_tcb(thread_to_resume);
+    if (tcb == NULL)
+    {
+        LOG_WARN("Thread is not managed\n");
+        return ERROR;
+    }
+
+    return do_resume(tcb);
+}
+
+/**
+ * @brief Stops a worker of a scheduler.
+ * @param scheduler The scheduler.
+ * @param thread The thread ID of the worker.
+ * @return Returns `!ERROR` on success, `ERROR` if the thread is not a worker of the scheduler or cannot be stopped.
+ * @details The lookup touches the index of `scheduler` only, whichever scheduler the caller runs on.
+ */
+int sched_stop_thread(scheduler_t *scheduler, pthread_t thread)
+{
+    thread_control_block_t *tcb = lookup_tcb(scheduler, thread);
+    if (tcb == NULL)
+    {
+        LOG_WARN("Thread is not managed by the scheduler\n");
+        return ERROR;
+    }
+
+    return stop_tcb(tcb);
+}
+
+/**
+ * @brief Resumes a worker of a scheduler.
+ * @param scheduler The scheduler.
+ * @param thread The thread ID of the worker.
+ * @return Returns `!ERROR` on success, `ERROR` if the thread is not a worker of the scheduler or is not stopped.
+ */
+int sched_resume_thread(scheduler_t *scheduler, pthread_t thread)
+{
+    thread_control_block_t *tcb = lookup_tcb(scheduler, thread);
+    if (tcb == NULL)
+    {
+        LOG_WARN("Thread is not managed by the scheduler\n");
+        return ERROR;
+    }
+
+    return do_resume(tcb);
+}
+
+/**
+ * @brief Starts stopping a thread without waiting for its acknowledgement.
+ * @param thread The thread ID of the thread to stop.
+ * @param op The handle of the transition.
+ * @param event_fd Eventfd written once the thread acknowledges, or -1.
+ * @return Returns `!ERROR` if the stop is pending, `ERROR` if it could not start; `op` is then `TRANSITION_FAILED`.
+ * @details The stop is sent like `stop_thread`, but the acknowledgement counts down the latch of `op` instead of
+ *          releasing a blocked controller. The caller holds the latch until the signal is sent, so the eventfd is
+ *          written exactly once, by whichever of the two finishes last. One event loop can keep thousands of stops
+ *          in flight and learn of their completion through `epoll` on a shared eventfd.
+ */
+int stop_thread_async(pthread_t thread, transition_t *op, int event_fd)
+{
+    op->tcb = find_tcb(thread);
+    op->status = TRANSITION_PENDING;
+    latch_init(&op->latch, 1);
+    op->latch.notify_fd = event_fd;
+    if (op->tcb == NULL)
+    {
+        LOG_WARN("Thread is not managed\n");
+        op->status = TRANSITION_FAILED;
+        return ERROR;
+    }
+
+    if (begin_stop(op->tcb, &op->latch) == ERROR)
+    {
+        op->status = TRANSITION_FAILED;
+        return ERROR;
+    }
+    latch_count_down(&op->latch);
+
+    return !ERROR;
+}
+
+/**
+ * @brief Resumes a thread through a transition handle.
+ * @param thread The thread ID of the thread to resume.
+ * @param op The handle of the transition.
+ * @return Returns `!ERROR` on success, `ERROR` on failure; `op` is complete either way.
+ * @details A resume waits for no acknowledgement, so it completes before returning and writes no eventfd.
+ */
+int resume_thread_async(pthread_t thread, transition_t *op)
+{
+    int status = resume_thread(thread);
+
+    op->tcb = find_tcb(thread);
+    latch_init(&op->latch, 0);
+    op->status = status != ERROR ? TRANSITION_DONE : TRANSITION_FAILED;
+
+    return status;
+}
+
+/**
+ * @brief Checks whether an asynchronous transition has completed, without blocking.
+ * @param op The handle of the transition.
+ * @return Returns the status of the transition.
+ * @details The first poll that sees the latch at zero publishes the new state of the thread, so a handle must be
+ *          polled by one thread at a time.
+ */
+transition_status_t transition_poll(transition_t *op)
+{
+    if (op->status == TRANSITION_PENDING && atomic_load_explicit(&op->latch.count, memory_order_acquire) == 0)
+    {
+        op->status = finish_stop(op->tcb) != ERROR ? TRANSITION_DONE : TRANSITION_FAILED;
+    }
+
+    return op->status;
+}
+
+/**
+ * @brief Waits until an asynchronous transition has completed.
+ * @param op The handle of the transition.
+ * @return Returns `TRANSITION_DONE` or `TRANSITION_FAILED`.
+ */
+transition_status_t transition_wait(transition_t *op)
+{
+    if (op->status == TRANSITION_PENDING)
+    {
+        latch_wait(&op->latch);
+    }
+
+    return transition_poll(op);
+}
+
+/**
+ * @brief Stops several threads with a single round-trip.
+ * @param threads_to_stop The thread IDs of the threads to be stopped.
+ * @param count The number of thread IDs.
+ * @return Returns the number of threads that were stopped.
+ * @details All stop signals are sent first and the caller then waits once on a countdown latch that every
+ *          stop handler counts down, so the handlers run in parallel instead of one after the other.
+ */
+int stop_threads(const pthread_t *threads_to_stop, size_t count)
+{
+    thread_control_block_t *local[STOP_BATCH];
+    thread_control_block_t **pending;
+    countdown_latch_t latch;
+    size_t pending_count = 0, capacity;
+    int stopped = 0;
+
+    pending = alloc_pending(local, count, &capacity);
+
+    /* The caller holds one count so the latch cannot reach zero while signals are still being sent */
+    latch_init(&latch, 1);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        thread_control_block_t *tcb = find_tcb(threads_to_stop[i]);
+        if (tcb == NULL)
+        {
+            LOG_WARN("Thread is not managed\n");
+        }
+        else if (begin_stop(tcb, &latch) != ERROR)
+        {
+            pending[pending_count++] = tcb;
+        }
+
+        /* The list is full only if it could not be allocated: flush what is pending */
+        if (pending_count == capacity && i + 1 < count)
+        {
+            latch_count_down(&latch);
+            latch_wait(&latch);
+            for (size_t j = 0; j < pending_count; j++)
+            {
+                stopped += (finish_stop(pending[j]) != ERROR);
+            }
+            pending_count = 0;
+            latch_init(&latch, 1);
+        }
+    }
+
+    /* Wait for every acknowledgement at once */
+    latch_count_down(&latch);
+    latch_wait(&latch);
+    for (size_t j = 0; j < pending_count; j++)
+    {
+        stopped += (finish_stop(pending[j]) != ERROR);
+    }
+    release_pending(pending, local);
+
+    return stopped;
+}
+
+/**
+ * @brief Resumes several threads.
+ * @param threads_to_resume The thread IDs of the threads to be resumed.
+ * @param count The number of thread IDs.
+ * @return Returns the number of threads that were resumed.
+ */
+int resume_threads(const pthread_t *threads_to_resume, size_t count)
+{
+    int resumed = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        resumed += (resume_thread(threads_to_resume[i]) != ERROR);
+    }
+
+    return resumed;
+}
+
+/**
+ * @brief Sends a sequence of stop and resume commands to a thread and waits only for the last acknowledgement.
+ * @param thread The thread ID of a worker that takes stop signals.
+ * @param commands The commands, applied in order; a command that would not change the state is dropped.
+ * @param count The number of commands.
+ * @return Returns `!ERROR` once the thread acknowledged every command, `ERROR` if the thread is not managed, is busy,
+ *         polls safepoints, exited, or a command could not be sent.
+ * @details The caller owns the thread for the whole sequence, through the transitional state of its first command.
+ *          Every command is queued at once: the thread handles them in order and acknowledges each by its sequence
+ *          number, so the caller waits once, for the last one, and publishes the state the sequence ends in. When a
+ *          command cannot be sent, the commands before it still take effect.
+ */
+int send_thread_commands(pthread_t thread, const thread_command_t *commands, size_t count)
+{
+    thread_control_block_t *tcb = find_tcb(thread);
+    thread_state_t state;
+    size_t sent = 0, changes = 0;
+    uint32_t seq = 0;
+
+    if (tcb == NULL || tcb == &main_tcb)
+    {
+        LOG_WARN("Thread is not managed\n");
+        return ERROR;
+    }
+    if (atomic_load(&tcb->cooperative))
+    {
+        LOG_WARN("Thread polls safepoints\n");
+        return ERROR;
+    }
+
+    /* Take ownership of the thread from whichever stable state it is in */
+    if (tcb_try_transition(tcb, THREAD_STATE_RUNNING, THREAD_STATE_STOPPING, &state))
+    {
+        state = THREAD_STATE_RUNNING;
+        atomic_store(&tcb->stop_ack, SIGNAL_UNHANDLED);
+    }
+    else if (!tcb_try_transition(tcb, THREAD_STATE_STOPPED, THREAD_STATE_RESUMING, &state))
+    {
+        TRACE_EVENT(TRACE_TRANSITION_FAILED, tcb->index, 1);
+        LOG_WARN(state == THREAD_STATE_IDLE ? "Thread is idle\n" : "Thread is busy\n");
+        return ERROR;
+    }
+    if (quiesce_gated(tcb))
+    {
+        tcb_set_state(tcb, state);
+        LOG_WARN("Pool is quiesced\n");
+        return ERROR;
+    }
+
+    /* Queue every command without waiting in between */
+    for (size_t i = 0; i < count; i++)
+    {
+        int stop = commands[i] == THREAD_COMMAND_STOP;
+
+        if (stop == (state == THREAD_STATE_STOPPED))
+        {
+            continue;
+        }
+        changes++;
+        if (stop)
+        {
+            STATS_SENT(tcb, stop_delivery);
+            TRACE_EVENT(TRACE_STOP_REQUEST, tcb->index, 0);
+        }
+        else
+        {
+            STATS_SENT(tcb, resume_delivery);
+            TRACE_EVENT(TRACE_RESUME_REQUEST, tcb->index, 0);
+        }
+        if (send_command(tcb, commands[i], &seq) == ERROR)
+        {
+            LOG_WARN("Cannot send command\n");
+            break;
+        }
+        if (stop)
+        {
+            STATS_COUNT(tcb, stops);
+        }
+        else
+        {
+            STATS_COUNT(tcb, resumes);
+        }
+        state = stop ? THREAD_STATE_STOPPED : THREAD_STATE_RUNNING;
+        sent++;
+    }
+
+    /* One round-trip for the whole sequence */
+    if (sent != 0 && await_command(tcb, seq) == ERROR)
+    {
+        TRACE_EVENT(TRACE_STOPPED, tcb->index, 0);
+        LOG_WARN("Thread has exited\n");
+        return ERROR;
+    }
+    if (sent != 0 && state == THREAD_STATE_STOPPED)
+    {
+        TRACE_EVENT(TRACE_STOPPED, tcb->index, 1);
+    }
+    publish_state(tcb, state);
+
+    return sent == changes ? !ERROR : ERROR;
+}
+
+/**
+ * @brief Stops every running worker of a scheduler with a single round-trip.
+ * @param scheduler The scheduler.
+ * @return Returns the number of threads that were stopped.
+ * @details The main thread is not stopped. Workers that change state concurrently are skipped.
+ */
+int sched_stop_all(scheduler_t *scheduler)
+{
+    unsigned int count = atomic_load_explicit(&scheduler->slot_count, memory_order_acquire);
+    thread_control_block_t *local[STOP_BATCH];
+    thread_control_block_t **pending;
+    countdown_latch_t latch;
+    size_t pending_count = 0, capacity;
+    int stopped = 0;
+
+    pending = alloc_pending(local, count, &capacity);
+    latch_init(&latch, 1);
+
+    /* Send every stop signal first */
+    for (unsigned int i = 0; i < count; i++)
+    {
+        thread_control_block_t *tcb = &get_slot(scheduler, i)->tcb;
+        if (tcb_get_state(tcb) == THREAD_STATE_RUNNING && begin_stop(tcb, &latch) != ERROR)
+        {
+            pending[pending_count++] = tcb;
+        }
+
+        /* The list is full only if it could not be allocated: flush what is pending */
+        if (pending_count == capacity && i + 1 < count)
+        {
+            latch_count_down(&latch);
+            latch_wait(&latch);
+            for (size_t j = 0; j < pending_count; j++)
+            {
+                stopped += (finish_stop(pending[j]) != ERROR);
+            }
+            pending_count = 0;
+            latch_init(&latch, 1);
+        }
+    }
+
+    /* Then wait for every acknowledgement at once */
+    latch_count_down(&latch);
+    latch_wait(&latch);
+    for (size_t j = 0; j < pending_count; j++)
+    {
+        stopped += (finish_stop(pending[j]) != ERROR);
+    }
+    release_pending(pending, local);
+
+    return stopped;
+}
+
+/**
+ * @brief Stops every running worker thread with a single round-trip.
+ * @return Returns the number of threads that were stopped.
+ * @details `sched_stop_all` on the default scheduler.
+ */
+int stop_all()
+{
+    return sched_stop_all(&default_scheduler);
+}
+
+/**
+ * @brief Resumes every stopped worker of a scheduler.
+ * @param scheduler The scheduler.
+ * @return Returns the number of threads that were resumed.
+ * @details The main thread is not resumed. Workers that change state concurrently are skipped.
+ */
+int sched_resume_all(scheduler_t *scheduler)
+{
+    unsigned int count = atomic_load_explicit(&scheduler->slot_count, memory_order_acquire);
+    int resumed = 0;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        thread_control_block_t *tcb = &get_slot(scheduler, i)->tcb;
+        if (tcb_get_state(tcb) == THREAD_STATE_STOPPED)
+        {
+            resumed += (do_resume(tcb) != ERROR);
+        }
+    }
+
+    return resumed;
+}
+
+/**
+ * @brief Resumes every stopped worker thread.
+ * @return Returns the number of threads that were resumed.
+ * @details `sched_resume_all` on the default scheduler.
+ */
+int resume_all()
+{
+    return sched_resume_all(&default_scheduler);
+}
+
+/**
+ * @brief Parks the calling thread until it is handed off to.
+ * @param tcb The control block of the calling thread.
+ * @details Every handoff bumps `handoffs` and the thread consumes one per park, so a handoff that arrives before the
+ *          thread parks makes the next park return at once. The thread announces itself in `handoff_parked` before
+ *          its final check and `handoff_unpark` bumps the word before reading the flag; both are sequentially
+ *          consistent, so either the check sees the handoff or the waker sees the flag and wakes the thread.
+ */
+void handoff_park(thread_control_block_t *tcb)
+{
+    uint32_t taken = tcb->handoffs_taken;
+
+    /* Short bounded spin: the other side is usually about to hand control back */
+    for (int i = 0; i < FUTEX_SPIN_LIMIT; i++)
+    {
+        if (atomic_load_explicit(&tcb->handoffs, memory_order_acquire) != taken)
+        {
+            tcb->handoffs_taken = taken + 1;
+            return;
+        }
+    }
+
+    while (atomic_load_explicit(&tcb->handoffs, memory_order_acquire) == taken)
+    {
+        atomic_store(&tcb->handoff_parked, 1);
+        if (atomic_load(&tcb->handoffs) == taken)
+        {
+            futex_wait(&tcb->handoffs, taken, NULL);
+        }
+        atomic_store(&tcb->handoff_parked, 0);
+    }
+    tcb->handoffs_taken = taken + 1;
+}
+
+/**
+ * @brief Hands off to a thread, waking it if it is parked.
+ * @param tcb The control block of the thread.
+ */
+void handoff_unpark(thread_control_block_t *tcb)
+{
+    atomic_fetch_add(&tcb->handoffs, 1);
+    if (atomic_load(&tcb->handoff_parked))
+    {
+        futex_wake(&tcb->handoffs, 1);
+    }
+}
+
+/**
+ * @brief Wakes a thread parked in `handoff_wait` or `handoff_to`, and parks the caller until a handoff wakes it.
+ * @param thread The thread ID of the thread to hand off to.
+ * @return Returns `!ERROR` once the caller has been handed control back, `ERROR` if either thread is not managed.
+ * @details The target is woken with at most one system call and the caller parks on its own word, so two threads
+ *          handing off to each other never share a lock. A handoff to a thread that is not parked is kept for its
+ *          next park; a thread stopped by `stop_thread` consumes it only once resumed.
+ */
+int handoff_to(pthread_t thread)
+{
+    thread_control_block_t *target = find_tcb(thread);
+
+    if (target == NULL || current_tcb == NULL)
+    {
+        LOG_WARN("Thread is not managed\n");
+        return ERROR;
+    }
+
+    handoff_unpark(target);
+    handoff_park(current_tcb);
+
+    return !ERROR;
+}
+
+/**
+ * @brief Wakes a thread parked in `handoff_wait` or `handoff_to` without parking the caller.
+ * @param thread The thread ID of the thread to wake.
+ * @return Returns `!ERROR` on success, `ERROR` if the thread is not managed.
+ */
+int handoff_wake(pthread_t thread)
+{
+    thread_control_block_t *target = find_tcb(thread);
+
+    if (target == NULL)
+    {
+        LOG_WARN("Thread is not managed\n");
+        return ERROR;
+    }
+
+    handoff_unpark(target);
+
+    return !ERROR;
+}
+
+/**
+ * @brief Parks the calling thread until a handoff wakes it.
+ * @return Returns `!ERROR` once woken, `ERROR` if the caller is not managed.
+ */
+int handoff_wait()
+{
+    if (current_tcb == NULL)
+    {
+        LOG_WARN("Thread is not managed\n");
+        return ERROR;
+    }
+
+    handoff_park(current_tcb);
+
+    return !ERROR;
+}
+
+/**
+ * @brief Orders quiesce samples slowest first, for `qsort`.
+ * @param a The first sample.
+ * @param b The second sample.
+ */
+int compare_safepoint(const void *a, const void *b)
+{
+    uint64_t first = ((const quiesce_sample_t *)a)->time_to_safepoint_ns;
+    uint64_t second = ((const quiesce_sample_t *)b)->time_to_safepoint_ns;
+
+    return (first < second) - (first > second);
+}
+
+/**
+ * @brief Stops every running worker of a scheduler but the caller, for a consistent snapshot of the state they share.
+ * @param scheduler The scheduler.
+ * @param report Receives the outcome and the time-to-safepoint of the slowest workers, or `NULL`.
+ * @return Returns `!ERROR` once every stopped worker has reached its safepoint, `ERROR` if the pool is already
+ *         quiesced or memory is short.
+ * @details Like `stop_all`, every stop is sent before any acknowledgement is awaited, but the acknowledgements
+ *          arrive on a latch tree: worker `i` counts down leaf `i / LATCH_TREE_FANIN`, so a thousand workers
+ *          acknowledging at once contend on a few workers per cache line and the controller is woken once, by the
+ *          root. Workers that are stopped, idle or exiting are left alone.
+ *          Until `sched_unquiesce`, the scheduler refuses to spawn workers, hand work to idle ones or resume any of its
+ *          workers, whether through a resume call, a timer or the periodic scheduler.
+ */
+int sched_quiesce(scheduler_t *scheduler, quiesce_report_t *report)
+{
+    unsigned int count;
+    latch_tree_t tree;
+    uint64_t start_ns;
+    size_t pending_count = 0, stopped = 0;
+
+    pthread_mutex_lock(&scheduler->quiesce_mutex);
+    if (scheduler->quiesced != NULL)
+    {
+        pthread_mutex_unlock(&scheduler->quiesce_mutex);
+        LOG_WARN("Pool is already quiesced\n");
+        return ERROR;
+    }
+
+    /* Close the gate, then wait for a spawn that is growing the pool, after which `slot_count` is final */
+    atomic_store(&scheduler->quiescing, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    STATS_LOCK(&scheduler->pool_mutex, current_tcb);
+    count = atomic_load_explicit(&scheduler->slot_count, memory_order_acquire);
+    pthread_mutex_unlock(&scheduler->pool_mutex);
+
+    scheduler->quiesced = (quiesce_sample_t *)malloc((count != 0 ? count : 1) * sizeof(quiesce_sample_t));
+    if (scheduler->quiesced == NULL || !latch_tree_init(&tree, count))
+    {
+        free(scheduler->quiesced);
+        scheduler->quiesced = NULL;
+        atomic_store(&scheduler->quiescing, 0);
+        pthread_mutex_unlock(&scheduler->quiesce_mutex);
+        LOG_ERROR("Cannot allocate the quiesce state\n");
+        return ERROR;
+    }
+
+    /* Send every stop request, recording the workers in the list that will hold their samples */
+    start_ns = timer_now_ns();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        thread_control_block_t *tcb = &get_slot(scheduler, i)->tcb;
+        thread_state_t state;
+
+        /* A resume or a hand-off that got past the gate ends in RUNNING within a few instructions */
+        while ((state = tcb_get_state(tcb)) == THREAD_STATE_RESUMING)
+        {
+            sched_yield();
+        }
+        if (tcb != current_tcb && state == THREAD_STATE_RUNNING && begin_stop(tcb, latch_tree_leaf(&tree, i)) != ERROR)
+        {
+            scheduler->quiesced[pending_count++].index = i;
+        }
+    }
+
+    /* Then wait for the root of the tree */
+    latch_tree_release(&tree);
+    latch_tree_wait(&tree);
+    latch_tree_destroy(&tree);
+    for (size_t j = 0; j < pending_count; j++)
+    {
+        thread_control_block_t *tcb = &get_slot(scheduler, scheduler->quiesced[j].index)->tcb;
+        if (finish_stop(tcb) != ERROR)
+        {
+            scheduler->quiesced[stopped].thread = tcb->thread_id;
+            scheduler->quiesced[stopped].index = tcb->index;
+            scheduler->quiesced[stopped].time_to_safepoint_ns = tcb->stop_ack_ns - start_ns;
+            stopped++;
+        }
+    }
+    scheduler->quiesced_count = stopped;
+    qsort(scheduler->quiesced, stopped, sizeof(quiesce_sample_t), compare_safepoint);
+
+    if (report != NULL)
+    {
+        report->stopped = stopped;
+        report->quiesce_ns = stopped != 0 ? scheduler->quiesced[0].time_to_safepoint_ns : 0;
+        report->count = report->samples != NULL ? (stopped < report->capacity ? stopped : report->capacity) : 0;
+        if (report->count != 0)
+        {
+            memcpy(report->samples, scheduler->quiesced, report->count * sizeof(quiesce_sample_t));
+        }
+    }
+    pthread_mutex_unlock(&scheduler->quiesce_mutex);
+
+    return !ERROR;
+}
+
+/**
+ * @brief Stops every running worker but the caller, for a consistent snapshot of the state they share.
+ * @param report Receives the outcome and the time-to-safepoint of the slowest workers, or `NULL`.
+ * @return Returns `!ERROR` once every stopped worker has reached its safepoint, `ERROR` if the pool is already
+ *         quiesced or memory is short.
+ * @details `sched_quiesce` on the default scheduler.
+ */
+int quiesce(quiesce_report_t *report)
+{
+    return sched_quiesce(&default_scheduler, report);
+}
+
+/**
+ * @brief Resumes the workers of a scheduler stopped by `sched_quiesce`.
+ * @param scheduler The scheduler.
+ * @return Returns the number of workers resumed.
+ * @details Only the workers `quiesce` stopped are resumed, so threads that were stopped before keep their state.
+ *          The gate is opened once they run again.
+ */
+int sched_unquiesce(scheduler_t *scheduler)
+{
+    int resumed = 0;
+
+    pthread_mutex_lock(&scheduler->quiesce_mutex);
+    if (scheduler->quiesced == NULL)
+    {
+        pthread_mutex_unlock(&scheduler->quiesce_mutex);
+        LOG_WARN("Pool is not quiesced\n");
+        return 0;
+    }
+    for (size_t i = 0; i < scheduler->quiesced_count; i++)
+    {
+        thread_control_block_t *tcb = &get_slot(scheduler, scheduler->quiesced[i].index)->tcb;
+        if (tcb_try_transition(tcb, THREAD_STATE_STOPPED, THREAD_STATE_RESUMING, NULL))
+        {
+            resumed += (deliver_resume(tcb) != ERROR);
+        }
+    }
+    free(scheduler->quiesced);
+    scheduler->quiesced = NULL;
+    scheduler->quiesced_count = 0;
+    atomic_store(&scheduler->quiescing, 0);
+    pthread_mutex_unlock(&scheduler->quiesce_mutex);
+
+    return resumed;
+}
+
+/**
+ * @brief Resumes the workers stopped by `quiesce`.
+ * @return Returns the number of workers resumed.
+ * @details `sched_unquiesce` on the default scheduler.
+ */
+int unquiesce()
+{
+    return sched_unquiesce(&default_scheduler);
+}
+
+/**
+ * @brief Stops a thread once a delay has elapsed.
+ * @param thread The thread ID of the thread to stop.
+ * @param delay_ns The delay in nanoseconds.
+ * @return Returns `!ERROR` if the stop is scheduled, `ERROR` if the thread is not managed or no timer is available.
+ * @details Re-arming replaces a pending stop of the same thread. The timer thread starts the stop with the same
+ *          protocol and the same failures as `stop_thread` but does not wait for it; a resume that comes before the
+ *          thread acknowledges is applied once it has stopped.
+ */
+int stop_after(pthread_t thread, uint64_t delay_ns)
+{
+    thread_control_block_t *tcb = find_tcb(thread);
+
+    if (tcb == NULL)
+    {
+        LOG_WARN("Thread is not managed\n");
+        return ERROR;
+    }
+
+    return timer_arm(&tcb->stop_timer, timer_now_ns() + delay_ns, stop_timer_expired, tcb) ? !ERROR : ERROR;
+}
+
+/**
+ * @brief Resumes a thread once a delay has elapsed.
+ * @param thread The thread ID of the thread to resume.
+ * @param delay_ns The delay in nanoseconds.
+ * @return Returns `!ERROR` if the resume is scheduled, `ERROR` if the thread is not managed or no timer is available.
+ * @details Re-arming replaces a pending resume of the same thread. The resume is made by the timer thread.
+ */
+int resume_after(pthread_t thread, uint64_t delay_ns)
+{
+    thread_control_block_t *tcb = find_tcb(thread);
+
+    if (tcb == NULL)
+    {
+        LOG_WARN("Thread is not managed\n");
+        return ERROR;
+    }
+
+    return timer_arm(&tcb->resume_timer, timer_now_ns() + delay_ns, resume_timer_expired, tcb) ? !ERROR : ERROR;
+}
+
+/**
+ * @brief Stops a thread now and resumes it after a duration.
+ * @param thread The thread ID of the thread to put to sleep.
+ * @param duration_ns The duration in nanoseconds, counted from the acknowledgement of the stop.
+ * @return Returns `!ERROR` on success, `ERROR` if the thread could not be stopped or the resume not scheduled.
+ */
+int sleep_thread(pthread_t thread, uint64_t duration_ns)
+{
+    thread_control_block_t *tcb = find_tcb(thread);
+
+    if (tcb == NULL)
+    {
+        LOG_WARN("Thread is not managed\n");
+        return ERROR;
+    }
+    if (stop_tcb(tcb) == ERROR)
+    {
+        return ERROR;
+    }
+
+    return timer_arm(&tcb->resume_timer, timer_now_ns() + duration_ns, resume_timer_expired, tcb) ? !ERROR : ERROR;
+}
+
+/**
+ * @brief Cancels the pending `stop_after`, `resume_after` and `sleep_thread` timers of a thread.
+ * @param thread The thread ID.
+ * @return Returns the number of timers cancelled; a timer that is already firing is not counted.
+ */
+int cancel_thread_timers(pthread_t thread)
+{
+    thread_control_block_t *tcb = find_tcb(thread);
+
+    if (tcb == NULL)
+    {
+        return 0;
+    }
+
+    return timer_disarm(&tcb->stop_timer) + timer_disarm(&tcb->resume_timer);
+}
+
+/**
+ * @brief Selects the policy of the periodic threads of a scheduler.
+ * @param scheduler The scheduler.
+ * @param policy The policy.
+ * @return Returns `!ERROR` on success, `ERROR` while periodic threads of the scheduler exist.
+ * @details `SCHED_POLICY_DEADLINE` installs the SIGXCPU handler that counts the overruns the kernel reports.
+ */
+int sched_set_sched_policy(scheduler_t *scheduler, sched_policy_t policy)
+{
+    sigset_t old_mask;
+    int result = !ERROR;
+
+    periodic_lock(scheduler, &old_mask);
+    if (scheduler->periodic.head != NULL)
+    {
+        LOG_WARN("Policy cannot change while periodic threads exist\n");
+        result = ERROR;
+    }
+    else
+    {
+        if (policy == SCHED_POLICY_DEADLINE)
+        {
+            struct sigaction sigxcpu;
+
+            sigxcpu.sa_flags = SA_RESTART;
+            sigxcpu.sa_handler = deadline_overrun_handler;
+            sigemptyset(&sigxcpu.sa_mask);
+            if (sigaction(SIGXCPU, &sigxcpu, NULL) == -1)
+            {
+                LOG_ERROR("Error in initializing the overrun handler\n");
+            }
+        }
+        scheduler->periodic.policy = policy;
+    }
+    periodic_unlock(scheduler, &old_mask);
+
+    return result;
+}
+
+/**
+ * @brief Selects the policy of the periodic threads of the default scheduler.
+ * @param policy The policy.
+ * @return Returns `!ERROR` on success, `ERROR` while periodic threads exist.
+ * @details `sched_set_sched_policy` on the default scheduler.
+ */
+int set_sched_policy(sched_policy_t policy)
+{
+    return sched_set_sched_policy(&default_scheduler, policy);
+}
+
+/**
+ * @brief Returns the policy of the periodic threads of a scheduler.
+ * @param scheduler The scheduler.
+ */
+sched_policy_t sched_get_sched_policy(scheduler_t *scheduler)
+{
+    sched_policy_t policy;
+    sigset_t old_mask;
+
+    periodic_lock(scheduler, &old_mask);
+    policy = scheduler->periodic.policy;
+    periodic_unlock(scheduler, &old_mask);
+
+    return policy;
+}
+
+/**
+ * @brief Returns the policy of the periodic threads of the default scheduler.
+ */
+sched_policy_t get_sched_policy()
+{
+    return sched_get_sched_policy(&default_scheduler);
+}
+
+/**
+ * @brief Hands a worker to the periodic scheduler of its pool, or changes its timing; its first job is released at
+ *        once.
+ * @param thread The thread ID of a worker.
+ * @param params The timing; `budget_ns <= deadline_ns <= period_ns` is required.
+ * @return Returns `!ERROR` on success, `ERROR` if no periodic policy is selected, the thread is not a worker that
+ *         takes stop signals, or the timing is invalid.
+ * @details Under the user-space policies a joining thread is stopped and waits for its first dispatch, which happens
+ *          at once if its job is the most urgent. Under `SCHED_POLICY_DEADLINE` the thread gets a kernel reservation
+ *          and keeps running. The counters of a thread restart when it joins.
+ *          A thread that polls safepoints cannot be stopped while it waits for the scheduler, so it is refused.
+ *          The joining thread is stopped, or its kernel ID awaited, before the periodic mutex is taken, so the timer
+ *          thread never waits behind a blocking call; the state is checked again under the mutex.
+ */
+int set_thread_period(pthread_t thread, const periodic_params_t *params)
+{
+    thread_control_block_t *tcb = find_tcb(thread);
+    scheduler_t *scheduler;
+    periodic_params_t timing;
+    sched_policy_t policy;
+    sigset_t old_mask;
+    uint64_t now;
+    int stopped = 0, release = 0;
+    int result = !ERROR;
+
+    if (params == NULL || tcb == NULL || tcb == &main_tcb || atomic_load(&tcb->cooperative))
+    {
+        LOG_WARN("Thread cannot be made periodic\n");
+        return ERROR;
+    }
+    scheduler = scheduler_of(tcb);
+    timing = *params;
+    if (timing.deadline_ns == 0)
+    {
+        timing.deadline_ns = timing.period_ns;
+    }
+    if (timing.budget_ns == 0 || timing.budget_ns > timing.deadline_ns || timing.deadline_ns > timing.period_ns)
+    {
+        LOG_WARN("Invalid periodic timing\n");
+        return ERROR;
+    }
+
+    /* Block outside the mutex: wait for the kernel ID, or stop a thread that is not periodic yet */
+    policy = sched_get_sched_policy(scheduler);
+    if (policy == SCHED_POLICY_DEADLINE)
+    {
+        await_kernel_tid(tcb);
+    }
+    else if (policy != SCHED_POLICY_FIFO && tcb->periodic.state == PERIODIC_NONE &&
+             tcb_get_state(tcb) == THREAD_STATE_RUNNING)
+    {
+        if (stop_tcb(tcb) == ERROR)
+        {
+            return ERROR;
+        }
+        stopped = 1;
+    }
+
+    periodic_lock(scheduler, &old_mask);
+    if (scheduler->periodic.policy == SCHED_POLICY_FIFO)
+    {
+        LOG_WARN("No periodic policy is selected\n");
+        result = ERROR;
+    }
+    else if (scheduler->periodic.policy != policy)
+    {
+        LOG_WARN("Policy changed while the thread was joining\n");
+        result = ERROR;
+    }
+    else if (tcb->periodic.state == PERIODIC_NONE && atomic_load(&scheduler->destroying))
+    {
+        LOG_WARN("Scheduler is being destroyed\n");
+        result = ERROR;
+    }
+    else if (policy == SCHED_POLICY_DEADLINE && set_deadline_attr(tcb, &timing) == ERROR)
+    {
+        LOG_WARN("Cannot reserve SCHED_DEADLINE bandwidth\n");
+        result = ERROR;
+    }
+    else if (tcb->periodic.state == PERIODIC_NONE && policy != SCHED_POLICY_DEADLINE &&
+             tcb_get_state(tcb) != THREAD_STATE_STOPPED)
+    {
+        LOG_WARN("Thread cannot be made periodic\n");
+        result = ERROR;
+    }
+    else
+    {
+        /* Join the periodic set */
+        now = timer_now_ns();
+        if (tcb->periodic.state == PERIODIC_NONE)
+        {
+            atomic_store(&tcb->periodic.jobs, 0);
+            atomic_store(&tcb->periodic.overruns, 0);
+            atomic_store(&tcb->periodic.deadline_misses, 0);
+            atomic_store(&tcb->periodic.preemptions, 0);
+            atomic_store(&tcb->periodic.max_response_ns, 0);
+            tcb->periodic.next = scheduler->periodic.head;
+            scheduler->periodic.head = tcb;
+            tcb->periodic.held = scheduler->periodic.policy != SCHED_POLICY_DEADLINE;
+            tcb->periodic.state = tcb->periodic.held ? PERIODIC_READY : PERIODIC_RUNNING;
+        }
+        tcb->periodic.period_ns = timing.period_ns;
+        tcb->periodic.budget_ns = timing.budget_ns;
+        tcb->periodic.deadline_ns = timing.deadline_ns;
+        tcb->periodic.release_ns = now;
+        tcb->periodic.deadline_at_ns = now + timing.deadline_ns;
+        tcb->periodic.budget_used_ns = 0;
+
+        /* Release the first job now; the kernel does it under SCHED_DEADLINE */
+        if (scheduler->periodic.policy != SCHED_POLICY_DEADLINE)
+        {
+            if (tcb->periodic.state != PERIODIC_RUNNING)
+            {
+                tcb->periodic.state = PERIODIC_READY;
+            }
+            else
+            {
+                tcb->periodic.dispatched_ns = now;
+                timer_arm(&scheduler->periodic.budget_timer, now + timing.budget_ns, budget_timer_expired, scheduler);
+            }
+            timer_arm(&tcb->periodic.release_timer, now + timing.period_ns, release_timer_expired, tcb);
+            periodic_dispatch(scheduler);
+        }
+    }
+    /* A thread stopped here that did not join is let go again */
+    release = result == ERROR && stopped && tcb->periodic.state == PERIODIC_NONE;
+    periodic_unlock(scheduler, &old_mask);
+    if (release)
+    {
+        do_resume(tcb);
+    }
+
+    return result;
+}
+
+/**
+ * @brief Takes a thread back from the periodic scheduler and lets it run.
+ * @param thread The thread ID.
+ * @return Returns `!ERROR` on success, `ERROR` if the thread is not periodic.
+ */
+int clear_thread_period(pthread_t thread)
+{
+    thread_control_block_t *tcb = find_tcb(thread);
+    scheduler_t *scheduler;
+    sigset_t old_mask;
+    int result = ERROR;
+
+    if (tcb == NULL)
+    {
+        return ERROR;
+    }
+    scheduler = scheduler_of(tcb);
+    periodic_lock(scheduler, &old_mask);
+    if (tcb->periodic.state != PERIODIC_NONE)
+    {
+        periodic_leave(scheduler, tcb);
+        periodic_dispatch(scheduler);
+        result = !ERROR;
+    }
+    periodic_unlock(scheduler, &old_mask);
+
+    return result;
+}
+
+/**
+ * @brief Completes the current job of the calling periodic thread and waits until its next job is dispatched.
+ * @details The job is counted, with its response time and a deadline miss if it completes late. Under the user-space
+ *          policies the thread waits on its dispatch counter while the scheduler runs the next job; under
+ *          `SCHED_POLICY_DEADLINE` it yields, which ends the job of its reservation until the next period.
+ *          Returns at once when the calling thread is not periodic.
+ */
+void wait_next_period()
+{
+    thread_control_block_t *tcb = current_tcb;
+    scheduler_t *scheduler;
+    uint64_t now, response, longest;
+    uint32_t dispatches;
+    sigset_t old_mask;
+
+    if (tcb == NULL)
+    {
+        return;
+    }
+
+    scheduler = scheduler_of(tcb);
+    periodic_lock(scheduler, &old_mask);
+    if (tcb->periodic.state == PERIODIC_NONE)
+    {
+        periodic_unlock(scheduler, &old_mask);
+        return;
+    }
+
+    /* Complete the job */
+    now = timer_now_ns();
+    response = now - tcb->periodic.release_ns;
+    longest = atomic_load_explicit(&tcb->periodic.max_response_ns, memory_order_relaxed);
+    if (response > longest)
+    {
+        atomic_store_explicit(&tcb->periodic.max_response_ns, response, memory_order_relaxed);
+    }
+    if (now > tcb->periodic.deadline_at_ns)
+    {
+        atomic_fetch_add_explicit(&tcb->periodic.deadline_misses, 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&tcb->periodic.jobs, 1, memory_order_relaxed);
+
+    if (scheduler->periodic.policy == SCHED_POLICY_DEADLINE)
+    {
+        periodic_unlock(scheduler, &old_mask);
+        sched_yield();
+        periodic_lock(scheduler, &old_mask);
+        tcb->periodic.release_ns = timer_now_ns();
+        tcb->periodic.deadline_at_ns = tcb->periodic.release_ns + tcb->periodic.deadline_ns;
+        periodic_unlock(scheduler, &old_mask);
+        return;
+    }
+
+    /* Give the CPU to the next job and wait for the next dispatch */
+    if (scheduler->periodic.running == tcb)
+    {
+        timer_disarm(&scheduler->periodic.budget_timer);
+        scheduler->periodic.running = NULL;
+    }
+    tcb->periodic.state = PERIODIC_WAITING;
+    dispatches = atomic_load_explicit(&tcb->periodic.dispatches, memory_order_acquire);
+    periodic_dispatch(scheduler);
+    periodic_unlock(scheduler, &old_mask);
+
+    futex_await_change(&tcb->periodic.dispatches, dispatches);
+}
+
+/**
+ * @brief Copies the counters of a periodic thread.
+ * @param thread The thread ID.
+ * @param stats Receives the counters.
+ * @return Returns `!ERROR` on success, `ERROR` if the thread is not managed.
+ */
+int get_periodic_stats(pthread_t thread, periodic_stats_t *stats)
+{
+    thread_control_block_t *tcb = find_tcb(thread);
+
+    if (tcb == NULL)
+    {
+        return ERROR;
+    }
+
+    stats->jobs = atomic_load_explicit(&tcb->periodic.jobs, memory_order_relaxed);
+    stats->overruns = atomic_load_explicit(&tcb->periodic.overruns, memory_order_relaxed);
+    stats->deadline_misses = atomic_load_explicit(&tcb->periodic.deadline_misses, memory_order_relaxed);
+    stats->preemptions = atomic_load_explicit(&tcb->periodic.preemptions, memory_order_relaxed);
+    stats->max_response_ns = atomic_load_explicit(&tcb->periodic.max_response_ns, memory_order_relaxed);
+
+    return !ERROR;
+}
+
+/**
+ * @brief Switches the calling worker thread to cooperative suspension.
+ * @details From now on `stop_thread` no longer interrupts the thread with the control signal; it raises the thread's stop
+ *          request instead, and the thread suspends the next time it calls `safepoint`. The switch is one-way.
+ *          Does nothing when called from a thread that is not managed.
+ */
+void enable_safepoints()
+{
+    if (current_tcb != NULL)
+    {
+        atomic_store(&current_tcb->cooperative, 1);
+    }
+}
+
+/**
+ * @brief Suspends the calling thread here if a stop has been requested.
+ * @details The fast path is one relaxed load and a compare. When a stop is pending, the thread acknowledges it and
+ *          parks on its resume counter until `resume_thread` bumps it, then checks for the next request. Call it from
+ *          points where the thread holds no locks, so a stopped thread can never block the others.
+ */
+void safepoint()
+{
+    thread_control_block_t *tcb = current_tcb;
+    uint32_t resumes;
+
+    if (tcb == NULL)
+    {
+        return;
+    }
+
+    while (atomic_load_explicit(&tcb->stop_requests, memory_order_relaxed) != tcb->stops_served)
+    {
+        atomic_thread_fence(memory_order_acquire);
+        tcb->stops_served++;
+
+        /* Read the resume counter before acknowledging: no resume can happen until the stop is acknowledged */
+        resumes = atomic_load_explicit(&tcb->resumes, memory_order_acquire);
+        acknowledge_stop(tcb);
+        futex_await_change(&tcb->resumes, resumes);
+        STATS_DELIVERED(tcb, resume_delivery);
+        TRACE_EVENT(TRACE_RESUMED, tcb->index, 0);
+    }
+}
+
+/**
+ * @brief Removes the oldest thread from the queue of a given state of a scheduler.
+ * @param scheduler The scheduler.
+ * @param state The state to pick from (`THREAD_STATE_RUNNING` or `THREAD_STATE_STOPPED`).
+ * @param thread Receives the thread ID.
+ * @return Returns `!ERROR` on success, `ERROR` if no thread is queued for the state.
+ * @details Lock-free and safe to call from several threads. The state is re-checked after dequeuing, but the
+ *          thread may change state right afterwards; the CAS in `stop_thread`/`resume_thread` stays authoritative.
+ */
+int sched_next_thread_in_state(scheduler_t *scheduler, thread_state_t state, pthread_t *thread)
+{
+    lockfree_queue_t *queue;
+    uint32_t bit = 1u << state;
+    void *entry;
+
+    if (state == THREAD_STATE_RUNNING)
+    {
+        queue = &scheduler->running_threads;
+    }
+    else if (state == THREAD_STATE_STOPPED)
+    {
+        queue = &scheduler->stopped_threads;
+    }
+    else
+    {
+        return ERROR;
+    }
+
+    while (lockfree_queue_dequeue(queue, &entry))
+    {
+        thread_control_block_t *tcb = (thread_control_block_t *)entry;
+
+        /* Allow the block to be queued again, then drop it if it is stale */
+        atomic_fetch_and_explicit(&tcb->queued, ~bit, memory_order_acq_rel);
+        if (tcb_get_state(tcb) == state)
+        {
+            *thread = tcb->thread_id;
+            return !ERROR;
+        }
+    }
+
+    return ERROR;
+}
+
+/**
+ * @brief Removes the oldest thread from the queue of a given state.
+ * @param state The state to pick from (`THREAD_STATE_RUNNING` or `THREAD_STATE_STOPPED`).
+ * @param thread Receives the thread ID.
+ * @return Returns `!ERROR` on success, `ERROR` if no thread is queued for the state.
+ * @details `sched_next_thread_in_state` on the default scheduler.
+ */
+int next_thread_in_state(thread_state_t state, pthread_t *thread)
+{
+    return sched_next_thread_in_state(&default_scheduler, state, thread);
+}
+
+/**
+ * @brief Copies the IDs of the threads of a scheduler in a given state into a linked list.
+ * @param scheduler The scheduler.
+ * @param state The state to collect (`THREAD_STATE_RUNNING` or `THREAD_STATE_STOPPED`).
+ * @param list An initialized linked list that receives the thread IDs in slot order.
+ * @return Returns `!ERROR` on success, `ERROR` if the state is invalid or a list node cannot be allocated; the list
+ *         then holds the threads collected so far.
+ * @details Threads in the middle of a transition are not reported. The main thread is never reported.
+ */
+int sched_get_threads_in_state(scheduler_t *scheduler, thread_state_t state, LinkedList *list)
+{
+    unsigned int count = atomic_load_explicit(&scheduler->slot_count, memory_order_acquire);
+
+    if (state != THREAD_STATE_RUNNING && state != THREAD_STATE_STOPPED)
+    {
+        return ERROR;
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        thread_control_block_t *tcb = &get_slot(scheduler, i)->tcb;
+        if (tcb_get_state(tcb) == state && !add_node_end(list, tcb->thread_id))
+        {
+            LOG_WARN("Cannot allocate a list node\n");
+            return ERROR;
+        }
+    }
+
+    return !ERROR;  /* Return success */
+}
+
+/**
+ * @brief Copies the IDs of the threads in a given state into a linked list.
+ * @param state The state to collect (`THREAD_STATE_RUNNING` or `THREAD_STATE_STOPPED`).
+ * @param list An initialized linked list that receives the thread IDs in slot order.
+ * @return Returns `!ERROR` on success, `ERROR` if the state is invalid or a list node cannot be allocated.
+ * @details `sched_get_threads_in_state` on the default scheduler.
+ */
+int get_threads_in_state(thread_state_t state, LinkedList *list)
+{
+    return sched_get_threads_in_state(&default_scheduler, state, list);
+}
+
+/**
+ * @brief Entry point function for worker threads.
+ * @param arg The pool slot of the thread.
+ * @return Never returns; the thread exits with `pthread_exit`.
+ * @details This function registers the thread's control block, unblocks the control signals and runs the bodies
+ *          handed to the worker until it retires.
+ */
+void *thread_entry(void *arg)
+{
+    worker_slot_t *slot = (worker_slot_t *)arg;
+    sigset_t control_signals;
+
+    /* Register the control block, the trace ring and the log ring before accepting stop requests */
+    current_tcb = &slot->tcb;
+    if (atomic_exchange(&slot->tcb.kernel_tid, (uint32_t)syscall(SYS_gettid)) == KERNEL_TID_WAITING)
+    {
+        futex_wake(&slot->tcb.kernel_tid, INT32_MAX);
+    }
+    trace_register_thread();
+    async_log_register_thread();
+    TRACE_EVENT(TRACE_THREAD_START, slot->tcb.index, 0);
+    sigemptyset(&control_signals);
+    sigaddset(&control_signals, CONTROL_SIGNAL);
+    pthread_sigmask(SIG_UNBLOCK, &control_signals, NULL);
+
+    /* Keep the memory of a pinned worker on its node, whatever policy the process inherited */
+    if (slot->node >= 0)
+    {
+        topology_prefer_node(slot->node);
+    }
+
+    /* The cleanup handler also runs when the body calls pthread_exit */
+    pthread_cleanup_push(thread_exit_cleanup, slot);
+    do
+    {
+        TRACE_EVENT(TRACE_BODY_BEGIN, slot->tcb.index, 0);
+        slot->body(slot->arg != NULL ? slot->arg : (void *)(intptr_t)slot->tcb.index);
+        TRACE_EVENT(TRACE_BODY_END, slot->tcb.index, 0);
+    } while (wait_for_work(slot));
+    pthread_cleanup_pop(1);
+
+    pthread_exit(NULL);  /* Exit the thread once it retires */
+}
+
+/**
+ * @brief Marks the calling thread as exited and releases any controller waiting for it.
+ * @param arg The pool slot of the thread.
+ * @details The state is changed before the stop latch is reclaimed, which `begin_stop` does in the opposite order,
+ *          so a controller racing with the exit either fails its CAS, sees EXITED, or is released with `SIGNAL_THREAD_EXITED`.
+ *          A controller waiting for a command is released by acknowledging every command sent so far.
+ *          A retiring worker is already EXITED and has left the live count. The slot is released last, once the
+ *          control signal is blocked and `current_tcb` cleared, so no handler touches the slot afterwards.
+ */
+void thread_exit_cleanup(void *arg)
+{
+    worker_slot_t *slot = (worker_slot_t *)arg;
+    thread_control_block_t *tcb = &slot->tcb;
+    scheduler_t *scheduler = slot->owner;
+    sigset_t control_signals, old_mask;
+    countdown_latch_t *latch;
+
+    TRACE_EVENT(TRACE_THREAD_EXIT, tcb->index, 0);
+    timer_disarm(&tcb->stop_timer);
+    timer_disarm(&tcb->resume_timer);
+    if (tcb->periodic.state != PERIODIC_NONE)
+    {
+        periodic_lock(scheduler, &old_mask);
+        if (tcb->periodic.state != PERIODIC_NONE)
+        {
+            periodic_leave(scheduler, tcb);
+            periodic_dispatch(scheduler);
+        }
+        periodic_unlock(scheduler, &old_mask);
+    }
+    if (atomic_exchange(&tcb->state, THREAD_STATE_EXITED) != THREAD_STATE_EXITED)
+    {
+        atomic_fetch_sub(&slot->owner->live_workers, 1);
+    }
+    latch = atomic_exchange(&tcb->stop_latch, NULL);
+    atomic_store(&tcb->stop_ack, SIGNAL_THREAD_EXITED);
+    if (latch != NULL)
+    {
+        latch_count_down(latch);
+    }
+    acknowledge_command(tcb, atomic_load(&tcb->commands_sent));
+
+    sigemptyset(&control_signals);
+    sigaddset(&control_signals, CONTROL_SIGNAL);
+    pthread_sigmask(SIG_BLOCK, &control_signals, NULL);
+    current_tcb = NULL;
+    atomic_store_explicit(&slot->reusable, 1, memory_order_release);
+}
+
+/**
+ * @brief Default body of the worker threads.
+ * @param arg The index of the thread in `threads` (unused).
+ * @details This function simulates a task by incrementing a dummy variable and then resumes the main thread before
+ *          returning, so the worker parks in the pool for new work instead of exiting.
+ */
+void pthread_body(void *arg)
+{
+    (void) arg; /* To remove warning */
+    sleep(1);  /* Simulate some initial delay */
+    volatile int dummy = 0;  /* Dummy variable to simulate work */
+
+    /* Simulate work by incrementing the dummy variable */
+    for (int i = 1; i < 100; i++)
+    {
+        dummy++;
+    }
+
+    LOG_INFO("Thread finished\n");  /* Indicate that the thread has completed its work */
+    resume_main();  /* Resume the main thread */
+    LOG_INFO("Main resumed and task returns to the pool\n");  /* Indicate that the main thread has been resumed */
+}
+
+/**
+ * @brief Initializes the handler of the control signal.
+ * @details This function installs `control_signal_handler` for `CONTROL_SIGNAL` with `SA_SIGINFO`, so the handler
+ *          receives the command and the sequence number queued with each signal.
+ */
+void init_signals()
+{
+    struct sigaction control;
+
+    /* Configure the control signal handler to stop and resume threads */
+    control.sa_flags = SA_SIGINFO;
+    control.sa_sigaction = control_signal_handler;
+    sigemptyset(&control.sa_mask);
+
+    /* Register the control signal handler */
+    if (sigaction(CONTROL_SIGNAL, &control, NULL) == -1)
+    {
+        LOG_ERROR("Error in initializing the control handler\n");
+    }
+}
+
+/**
+ * @brief Initializes the default scheduler and starts its minimum number of workers.
+ * @param config The configuration of the pool.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ * @details This function registers the calling thread as the main thread and initializes the default scheduler
+ *          with `sched_init`.
+ */
+int init_thread_pool(const thread_pool_config_t *config)
+{
+    unsigned int max_threads = config->max_threads != 0 ? config->max_threads : NUMBER_OF_THREADS;
+
+    if (default_scheduler.slot_chunks != NULL)
+    {
+        LOG_ERROR("Pool is already initialized\n");
+        return ERROR;
+    }
+
+    /* Pre-allocate the nodes used when exporting thread lists, enough for a list of the whole pool */
+    init_node_pool(max_threads);
+
+    /* Register the control block of the main thread */
+    tcb_init(&main_tcb, max_threads);
+    main_tcb.thread_id = main_thread;
+    atomic_store(&main_tcb.kernel_tid, (uint32_t)syscall(SYS_gettid));
+    tcb_set_state(&main_tcb, THREAD_STATE_RUNNING);
+    current_tcb = &main_tcb;
+    trace_register_thread();
+    async_log_register_thread();
+    TRACE_EVENT(TRACE_THREAD_START, main_tcb.index, 1);
+
+    return sched_init(&default_scheduler, config);
+}
+
+/**
+ * @brief Initializes a scheduler and starts its minimum number of workers.
+ * @param scheduler The scheduler, zeroed with its mutexes initialized.
+ * @param config The configuration of its pool.
+ * @return Returns `!ERROR` on success, `ERROR` on failure; what was set up is released by `sched_destroy`.
+ * @details This function initializes the `running_threads` and `stopped_threads` queues, reads the CPU topology if
+ *          the workers are pinned, and spawns `min_threads` workers running `config->body`.
+ *          Only the table of chunk pointers and the queues are sized from `max_threads`; control blocks are allocated
+ *          as workers are spawned.
+ */
+int sched_init(scheduler_t *scheduler, const thread_pool_config_t *config)
+{
+    thread_pool_config_t *pool_config = &scheduler->pool_config;
+
+    *pool_config = *config;
+    pool_config->cpus = NULL;
+    if (pool_config->max_threads == 0)
+    {
+        pool_config->max_threads = NUMBER_OF_THREADS;
+    }
+    if (pool_config->min_threads > pool_config->max_threads ||
+        (pool_config->min_threads != 0 && pool_config->body == NULL) ||
+        (pool_config->placement == PLACEMENT_CPU_LIST && config->cpus == NULL))
+    {
+        LOG_ERROR("Invalid pool configuration\n");
+        return ERROR;
+    }
+
+    /* The CPU list is copied so the caller's array may go away */
+    if (pool_config->placement == PLACEMENT_CPU_LIST)
+    {
+        int *cpus = (int *)malloc(pool_config->cpu_count * sizeof(int));
+        if (cpus == NULL)
+        {
+            return ERROR;
+        }
+        memcpy(cpus, config->cpus, pool_config->cpu_count * sizeof(int));
+        pool_config->cpus = cpus;
+    }
+
+    /* Workers run on recycled stacks when a stack size is configured */
+    if (pool_config->stack_size != 0)
+    {
+        stack_pool_config_t stacks = {
+            .stack_size = pool_config->stack_size,
+            .guard_size = pool_config->guard_size,
+            .flags = pool_config->stack_flags,
+        };
+        if (!stack_pool_init(&scheduler->worker_stacks, &stacks))
+        {
+            LOG_ERROR("Invalid worker stack size\n");
+            return ERROR;
+        }
+    }
+
+    /* Workers log through the drain thread, so a worker stopped while logging holds no stdio lock */
+    if (!async_log_start(STDOUT_FILENO))
+    {
+        LOG_WARN("Cannot start the log thread, messages are written directly\n");
+    }
+
+    /* Initialize the table of slots and the queues for running and stopped threads */
+    scheduler->slot_chunks = (worker_slot_t **)calloc((pool_config->max_threads + POOL_CHUNK_SIZE - 1) /
+                                                      POOL_CHUNK_SIZE, sizeof(worker_slot_t *));
+    if (scheduler->slot_chunks == NULL ||
+        !thread_index_init(&scheduler->thread_index, pool_config->max_threads) ||
+        !lockfree_queue_init(&scheduler->running_threads, pool_config->max_threads) ||
+        !lockfree_queue_init(&scheduler->stopped_threads, pool_config->max_threads))
+    {
+        return ERROR;
+    }
+
+    /* Read the topology once */
+    if (pool_config->placement != PLACEMENT_NONE && !topology_detect(&scheduler->topology))
+    {
+        LOG_WARN("Cannot read the CPU topology, workers are not pinned\n");
+        pool_config->placement = PLACEMENT_NONE;
+    }
+
+    /* Start the minimum number of workers */
+    for (unsigned int i = 0; i < pool_config->min_threads; i++)
+    {
+        if (sched_spawn_thread(scheduler, pool_config->body, pool_config->arg, NULL) == ERROR)
+        {
+            return ERROR;
+        }
+    }
+
+    return !ERROR;  /* Return success */
+}
+
+/**
+ * @brief Runs a body on a worker of a scheduler, spawning a new worker if none is idle.
+ * @param scheduler The scheduler.
+ * @param body The function to run.
+ * @param arg The argument passed to `body`, or `NULL` to pass the index of the worker.
+ * @param thread Receives the thread ID of the worker. May be `NULL`.
+ * @return Returns `!ERROR` on success, `ERROR` if the pool is full, the scheduler is quiesced or being destroyed,
+ *         or the thread cannot be created.
+ * @details An idle worker is taken over with a CAS IDLE -> RESUMING and woken on its work word. Otherwise a new thread
+ *          is created with the control signal blocked; it unblocks it once its control block is registered.
+ */
+int sched_spawn_thread(scheduler_t *scheduler, thread_body_t body, void *arg, pthread_t *thread)
+{
+    unsigned int count = atomic_load_explicit(&scheduler->slot_count, memory_order_acquire);
+    sigset_t control_signals, old_mask;
+    worker_slot_t *slot;
+    pthread_attr_t attr;
+    pthread_t thread_id;
+    int status;
+
+    if (scheduler->slot_chunks == NULL || body == NULL || atomic_load(&scheduler->destroying))
+    {
+        return ERROR;
+    }
+    if (atomic_load(&scheduler->quiescing))
+    {
+        LOG_WARN("Pool is quiesced\n");
+        return ERROR;
+    }
+
+    /* Hand the work to an idle worker */
+    for (unsigned int i = 0; i < count; i++)
+    {
+        slot = get_slot(scheduler, i);
+        if (tcb_get_state(&slot->tcb) == THREAD_STATE_IDLE &&
+            tcb_try_transition(&slot->tcb, THREAD_STATE_IDLE, THREAD_STATE_RESUMING, NULL))
+        {
+            if (quiesce_gated(&slot->tcb))
+            {
+                tcb_set_state(&slot->tcb, THREAD_STATE_IDLE);
+                LOG_WARN("Pool is quiesced\n");
+                return ERROR;
+            }
+            slot->body = body;
+            slot->arg = arg;
+            atomic_store(&slot->tcb.cooperative, 0);
+            publish_state(&slot->tcb, THREAD_STATE_RUNNING);
+            atomic_fetch_add_explicit(&slot->work, 1, memory_order_release);
+            futex_wake(&slot->work, 1);
+            if (thread != NULL)
+            {
+                *thread = slot->tcb.thread_id;
+            }
+            return !ERROR;
+        }
+    }
+
+    /* Otherwise grow the pool */
+    STATS_LOCK(&scheduler->pool_mutex, current_tcb);
+    if (atomic_load(&scheduler->destroying))
+    {
+        pthread_mutex_unlock(&scheduler->pool_mutex);
+        return ERROR;
+    }
+    if (atomic_load(&scheduler->quiescing))
+    {
+        pthread_mutex_unlock(&scheduler->pool_mutex);
+        LOG_WARN("Pool is quiesced\n");
+        return ERROR;
+    }
+    slot = claim_slot(scheduler);
+    if (slot == NULL)
+    {
+        pthread_mutex_unlock(&scheduler->pool_mutex);
+        LOG_WARN("Pool is full\n");
+        return ERROR;
+    }
+    slot->body = body;
+    slot->arg = arg;
 
-/**
- * @brief List of threads that are currently running.
- * @details This list stores the thread IDs of threads that are actively executing.
- */
-static LinkedList running_threads;
+    /* Created threads inherit this mask */
+    sigemptyset(&control_signals);
+    sigaddset(&control_signals, CONTROL_SIGNAL);
+    pthread_sigmask(SIG_BLOCK, &control_signals, &old_mask);
 
-/**
- * @brief Mutex to ensure that the kernel code won't be interrupted by a thread.
- * @details This mutex is used to protect critical sections of the kernel code.
- */
-static pthread_mutex_t kernel_mutex = PTHREAD_MUTEX_INITIALIZER;
+    init_worker_attr(&attr, slot);
+    status = pthread_create(&thread_id, &attr, thread_entry, slot);
+    pthread_attr_destroy(&attr);
+    if (status != 0)
+    {
+        LOG_ERROR("Error in creating thread[%u]\n", slot->tcb.index);
+        if (slot->stack != NULL)
+        {
+            stack_pool_put(&scheduler->worker_stacks, slot->stack);
+            slot->stack = NULL;
+        }
+        atomic_store(&slot->reusable, 1);
+        pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+        pthread_mutex_unlock(&scheduler->pool_mutex);
+        return ERROR;
+    }
+
+    /* Bind the control block and index it; the stop signal is blocked, so no lookup waits on a stopped writer */
+    thread_index_remove(&scheduler->thread_index, slot->tcb.thread_id, slot->tcb.index);
+    thread_index_insert(&scheduler->thread_index, thread_id, slot->tcb.index);
+    if (index_worker(&slot->tcb, slot->tcb.thread_id, thread_id) == ERROR)
+    {
+        LOG_WARN("Cannot index thread[%u], it is reachable through its scheduler only\n", slot->tcb.index);
+    }
+    slot->tcb.thread_id = thread_id;
+    slot->joinable = 1;
+    atomic_fetch_add(&scheduler->live_workers, 1);
+    publish_state(&slot->tcb, THREAD_STATE_RUNNING);
+
+    /* Restore the signal mask of the calling thread */
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    pthread_mutex_unlock(&scheduler->pool_mutex);
+
+    if (thread != NULL)
+    {
+        *thread = thread_id;
+    }
+
+    return !ERROR;  /* Return success */
+}
 
 /**
- * @brief Mutex for synchronizing the main thread.
- * @details This mutex is used to control access to the main thread's critical sections.
+ * @brief Runs a body on a pooled worker, spawning a new worker if none is idle.
+ * @param body The function to run.
+ * @param arg The argument passed to `body`, or `NULL` to pass the index of the worker.
+ * @param thread Receives the thread ID of the worker. May be `NULL`.
+ * @return Returns `!ERROR` on success, `ERROR` if the pool is full or quiesced, or the thread cannot be created.
+ * @details `sched_spawn_thread` on the default scheduler.
  */
-static pthread_mutex_t main_mutex = PTHREAD_MUTEX_INITIALIZER;
+int spawn_thread(thread_body_t body, void *arg, pthread_t *thread)
+{
+    return sched_spawn_thread(&default_scheduler, body, arg, thread);
+}
 
 /**
- * @brief Condition variable for synchronizing the main thread.
- * @details This condition variable is used to signal the main thread when it needs to resume.
+ * @brief Returns the number of live workers of a scheduler.
+ * @param scheduler The scheduler.
+ * @return Returns the number of workers, running, stopped or idle.
  */
-static pthread_cond_t main_cond = PTHREAD_COND_INITIALIZER;
+unsigned int sched_get_pool_size(scheduler_t *scheduler)
+{
+    return atomic_load(&scheduler->live_workers);
+}
 
 /**
- * @brief Flag to indicate if a signal has been handled.
- * @details This flag is used to synchronize signal handling between threads.
+ * @brief Returns the number of live workers of the default scheduler.
+ * @return Returns the number of workers, running, stopped or idle.
+ * @details `sched_get_pool_size` on the default scheduler.
  */
-static __uint8_t signal_is_handled = SIGNAL_UNHANDLED;
-/*******************************************************************
- * Global Variables
- *******************************************************************/
+unsigned int get_pool_size()
+{
+    return sched_get_pool_size(&default_scheduler);
+}
 
 /**
- * @brief Array to store the created threads initially.
- * @details This array holds the thread IDs of all threads created by the system.
+ * @brief Creates a scheduler and starts its minimum number of workers.
+ * @param config The configuration of its pool.
+ * @return Returns the scheduler, or `NULL` if the configuration is invalid or resources are short.
+ * @details The scheduler is aligned to a cache line, so its hot counters share no line with another scheduler.
  */
-pthread_t threads[NUMBER_OF_THREADS];
+scheduler_t *sched_create(const thread_pool_config_t *config)
+{
+    scheduler_t *scheduler = (scheduler_t *)aligned_alloc(_Alignof(scheduler_t), sizeof(scheduler_t));
+
+    if (scheduler == NULL)
+    {
+        return NULL;
+    }
+    memset(scheduler, 0, sizeof(*scheduler));
+    pthread_mutex_init(&scheduler->pool_mutex, NULL);
+    pthread_mutex_init(&scheduler->quiesce_mutex, NULL);
+    pthread_mutex_init(&scheduler->periodic.mutex, NULL);
+
+    if (sched_init(scheduler, config) == ERROR)
+    {
+        sched_destroy(scheduler);
+        return NULL;
+    }
+
+    return scheduler;
+}
 
 /**
- * @brief Stores the thread ID of the main thread.
- * @details This variable is used to identify the main thread for special handling.
+ * @brief Retires the workers of a scheduler and releases it.
+ * @param scheduler The scheduler; `NULL` and the default scheduler are ignored.
+ * @details New spawns are refused once `destroying` is set; taking `pool_mutex` waits for a spawn that is growing
+ *          the pool, after which `slot_count` is final. Its periodic threads are detached first, with their timers
+ *          disarmed, so a job parked in `wait_next_period` returns and a held one is resumed. Stopped workers are
+ *          resumed and every work word is bumped, so idle workers retire at once and busy ones when their body
+ *          returns. Every worker is joined before the slots and the stacks are freed, so none is still running on them.
  */
-pthread_t main_thread;
+void sched_destroy(scheduler_t *scheduler)
+{
+    sigset_t control_signals, old_mask;
+    owner_table_t *table;
+    unsigned int count;
+    worker_slot_t *slot;
+
+    if (scheduler == NULL || scheduler == &default_scheduler)
+    {
+        return;
+    }
+
+    atomic_store(&scheduler->destroying, 1);
+    pthread_mutex_lock(&scheduler->pool_mutex);
+    count = atomic_load(&scheduler->slot_count);
+    pthread_mutex_unlock(&scheduler->pool_mutex);
+
+    /* Detach the periodic threads; `destroying` keeps them from joining again */
+    periodic_lock(scheduler, &old_mask);
+    while (scheduler->periodic.head != NULL)
+    {
+        periodic_leave(scheduler, scheduler->periodic.head);
+    }
+    timer_disarm(&scheduler->periodic.budget_timer);
+    periodic_unlock(scheduler, &old_mask);
+
+    /* Wake every worker, then join each of them */
+    if (scheduler->quiesced != NULL)
+    {
+        sched_unquiesce(scheduler);
+    }
+    if (scheduler->stopped_threads.cells != NULL)
+    {
+        sched_resume_all(scheduler);
+    }
+    for (unsigned int i = 0; i < count; i++)
+    {
+        slot = get_slot(scheduler, i);
+        atomic_fetch_add_explicit(&slot->work, 1, memory_order_release);
+        futex_wake(&slot->work, 1);
+    }
+    for (unsigned int i = 0; i < count; i++)
+    {
+        slot = get_slot(scheduler, i);
+        if (slot->joinable)
+        {
+            pthread_join(slot->tcb.thread_id, NULL);
+            slot->joinable = 0;
+        }
+        if (slot->stack != NULL)
+        {
+            stack_pool_put(&scheduler->worker_stacks, slot->stack);
+        }
+    }
+
+    /* Drop the workers from the process-wide index before their blocks are freed, with the stop signal blocked */
+    sigemptyset(&control_signals);
+    sigaddset(&control_signals, CONTROL_SIGNAL);
+    pthread_sigmask(SIG_BLOCK, &control_signals, &old_mask);
+    pthread_mutex_lock(&owner_mutex);
+    table = atomic_load_explicit(&owner_table, memory_order_relaxed);
+    for (unsigned int i = 0; table != NULL && i < count; i++)
+    {
+        slot = get_slot(scheduler, i);
+        thread_index_remove(&table->index, slot->tcb.thread_id, (uintptr_t)&slot->tcb);
+    }
+    pthread_mutex_unlock(&owner_mutex);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+
+    /* Release the resources of the pool */
+    if (scheduler->worker_stacks.mapping_size != 0)
+    {
+        stack_pool_destroy(&scheduler->worker_stacks);
+    }
+    if (scheduler->slot_chunks != NULL)
+    {
+        for (unsigned int i = 0; i < count; i += POOL_CHUNK_SIZE)
+        {
+            free(scheduler->slot_chunks[i / POOL_CHUNK_SIZE]);
+        }
+        free(scheduler->slot_chunks);
+    }
+    thread_index_destroy(&scheduler->thread_index);
+    lockfree_queue_destroy(&scheduler->running_threads);
+    lockfree_queue_destroy(&scheduler->stopped_threads);
+    free((void *)scheduler->pool_config.cpus);
+    free(scheduler->quiesced);
+    pthread_mutex_destroy(&scheduler->pool_mutex);
+    pthread_mutex_destroy(&scheduler->quiesce_mutex);
+    pthread_mutex_destroy(&scheduler->periodic.mutex);
+    free(scheduler);
+}
 
-/*******************************************************************
- * Static Functions
- *******************************************************************/
 /**
- * @brief Increment the system tick (unused in this implementation).
- * @param sig The signal number (unused).
+ * @brief Returns the default scheduler.
  */
-static void increment_tick(int sig);
+scheduler_t *sched_default()
+{
+    return &default_scheduler;
+}
 
 /**
- * @brief Signal handler for SIGUSR1, which stops the thread execution.
- * @param sig The signal number (unused).
+ * @brief Returns the compact handle of a managed worker.
+ * @param thread The thread ID of the worker.
+ * @param handle Receives the handle, the index of the worker in the pool of its scheduler.
+ * @return Returns `!ERROR` on success, `ERROR` if the thread is not a managed worker.
+ * @details A handle stays valid while the worker lives; afterwards it may name the next worker of the same slot.
+ *          It is resolved by `sched_get_thread_by_handle` on the scheduler of the worker.
  */
-static void stop_thread_handler(int sig);
+int get_thread_handle(pthread_t thread, unsigned int *handle)
+{
+    thread_control_block_t *tcb = find_tcb(thread);
+
+    if (tcb == NULL || tcb == &main_tcb)
+    {
+        return ERROR;
+    }
+
+    *handle = tcb->index;
+
+    return !ERROR;
+}
 
 /**
- * @brief Signal handler for SIGUSR2, which resumes the thread execution.
- * @param sig The signal number (unused).
+ * @brief Returns the thread ID of the worker of a scheduler behind a handle.
+ * @param scheduler The scheduler of the worker.
+ * @param handle The handle returned by `get_thread_handle`.
+ * @param thread Receives the thread ID.
+ * @return Returns `!ERROR` on success, `ERROR` if no live worker of the scheduler has the handle.
  */
-static void resume_thread_handler(int sig);
+int sched_get_thread_by_handle(scheduler_t *scheduler, unsigned int handle, pthread_t *thread)
+{
+    thread_control_block_t *tcb;
+    thread_state_t state;
+
+    if (handle >= atomic_load_explicit(&scheduler->slot_count, memory_order_acquire))
+    {
+        return ERROR;
+    }
+
+    tcb = &get_slot(scheduler, handle)->tcb;
+    state = tcb_get_state(tcb);
+    if (state == THREAD_STATE_UNUSED || state == THREAD_STATE_EXITED)
+    {
+        return ERROR;
+    }
+    *thread = tcb->thread_id;
+
+    return !ERROR;
+}
 
 /**
- * @brief Entry point for created threads.
- * @param arg The argument passed to the thread (unused).
+ * @brief Returns the thread ID of the worker of the default scheduler behind a handle.
+ * @param handle The handle returned by `get_thread_handle`.
+ * @param thread Receives the thread ID.
+ * @return Returns `!ERROR` on success, `ERROR` if no live worker has the handle.
+ * @details `sched_get_thread_by_handle` on the default scheduler.
  */
-static void pthread_body(void *arg);
+int get_thread_by_handle(unsigned int handle, pthread_t *thread)
+{
+    return sched_get_thread_by_handle(&default_scheduler, handle, thread);
+}
+
 /**
- * @brief Signal handler for SIGUSR1, which stops the thread execution.
- * @param sig The signal number (unused).
- * @details This handler blocks all signals except SIGUSR2 and SIGALRM, then suspends the thread until a resume signal is received.
+ * @brief Copies the counters of the worker stacks of the default scheduler.
+ * @param stats Receives the counters.
+ * @return Returns `!ERROR` on success, `ERROR` if the workers run on the stacks of the C library.
  */
+int get_stack_pool_stats(stack_pool_stats_t *stats)
+{
+    scheduler_t *scheduler = &default_scheduler;
+    if (scheduler->slot_chunks == NULL || scheduler->pool_config.stack_size == 0)
+    {
+        return ERROR;
+    }
 
-/*******************************************************************
- * Signal Handlers
- *******************************************************************/
+    stack_pool_get_stats(&scheduler->worker_stacks, stats);
+
+    return !ERROR;
+}
 
 /**
- * @brief Signal handler for SIGUSR1, which stops the thread execution.
- * @param sig The signal number (unused).
- * @details This handler blocks all signals except SIGUSR2 and SIGALRM, then suspends the thread until a resume signal is received.
+ * @brief Copies the scheduling statistics of a managed thread.
+ * @param thread The thread ID, or the main thread.
+ * @param snapshot Receives the statistics.
+ * @return Returns `!ERROR` on success, `ERROR` if the thread is not managed or statistics are compiled out.
+ * @details Lock-free; the thread keeps running while its counters are read.
  */
-void stop_thread_handler(int sig)
+int get_thread_stats(pthread_t thread, thread_stats_snapshot_t *snapshot)
 {
-    (void) sig; /* To remove warning */
-    sigset_t signal_mask;
-    sigfillset(&signal_mask);  /* Block all signals */
-    sigdelset(&signal_mask, SIGUSR2);  /* Unblock SIGUSR2 */
-    sigdelset(&signal_mask, SIGALRM);  /* Unblock SIGALRM */
-    signal_is_handled = SIGNAL_HANDLED;  /* Mark the signal as handled */
-    sigsuspend(&signal_mask);  /* Suspend the thread until a resume signal is received */
-    return;
+    thread_control_block_t *tcb = find_tcb(thread);
+
+    if (!THREAD_STATS || tcb == NULL)
+    {
+        return ERROR;
+    }
+
+    snapshot_tcb(tcb, snapshot);
+    return !ERROR;
 }
 
 /**
- * @brief Signal handler for SIGUSR2, which resumes the thread execution.
- * @param sig The signal number (unused).
- * @details This handler is called when SIGUSR2 is received. It does nothing but must be defined to handle the signal.
+ * @brief Copies the scheduling statistics of every worker of the default scheduler.
+ * @param snapshots Receives the statistics in slot order.
+ * @param capacity The number of entries of `snapshots`.
+ * @return Returns the number of entries filled, 0 if statistics are compiled out.
+ * @details Slots that never held a thread are skipped; slots of exited workers keep the totals of their last thread
+ *          until the slot is reused.
  */
-void resume_thread_handler(int sig)
+unsigned int get_all_thread_stats(thread_stats_snapshot_t *snapshots, unsigned int capacity)
 {
+    scheduler_t *scheduler = &default_scheduler;
+    unsigned int count = scheduler->slot_chunks != NULL ?
+                         atomic_load_explicit(&scheduler->slot_count, memory_order_acquire) : 0;
+    unsigned int filled = 0;
 
-    (void) sig; /* To remove warning */
-    return;
-}
+    for (unsigned int i = 0; THREAD_STATS && i < count && filled < capacity; i++)
+    {
+        thread_control_block_t *tcb = &get_slot(scheduler, i)->tcb;
+        if (tcb_get_state(tcb) != THREAD_STATE_UNUSED)
+        {
+            snapshot_tcb(tcb, &snapshots[filled++]);
+        }
+    }
 
-/*******************************************************************
- * Functions
- *******************************************************************/
+    return filled;
+}
 
 /**
- * @brief Sends a SIGUSR1 signal to stop the execution of a thread.
- * @param thread_to_stop The thread ID of the thread to be stopped.
- * @return Returns `!ERROR` on success, `ERROR` on failure.
- * @details This function sends a SIGUSR1 signal to the specified thread, which triggers the `stop_thread_handler` to pause the thread.
- *          The thread is then moved from the `running_threads` list to the `stopped_threads` list.
+ * @brief Starts a thread that prints the statistics of every worker to stdout periodically.
+ * @param interval_ms The interval between two dumps in milliseconds.
+ * @return Returns `!ERROR` on success, `ERROR` if a dump is already running, the interval is 0 or statistics are
+ *         compiled out.
  */
-int stop_thread(pthread_t thread_to_stop)
+int start_stats_dump(unsigned int interval_ms)
 {
-    /* Variable to store the status of each syscall or library call */
-    int status;
+    uint32_t idle = 0;
 
-    /* Try to lock the kernel mutex */
-    if (pthread_mutex_lock(&kernel_mutex) != 0)
+    if (!THREAD_STATS || interval_ms == 0 || !atomic_compare_exchange_strong(&dump_running, &idle, 1))
     {
-        printf("Cannot lock the kernel mutex to stop thread\n");
         return ERROR;
     }
 
-    /* Search for the thread in the stopped_threads list */
-    if (search_node(&stopped_threads, thread_to_stop) != NULL)
+    if (pthread_create(&dump_thread, NULL, stats_dump_body, (void *)(uintptr_t)interval_ms) != 0)
     {
-        printf("Thread is already stopped\n");
-        pthread_mutex_unlock(&kernel_mutex);
+        LOG_ERROR("Error in creating the statistics thread\n");
+        atomic_store(&dump_running, 0);
         return ERROR;
     }
 
-    /* Try to send the stop signal (SIGUSR1) to the thread */
-    if (pthread_kill(thread_to_stop, SIGUSR1) != 0)
+    return !ERROR;
+}
+
+/**
+ * @brief Stops the thread started by `start_stats_dump` and waits for it to exit.
+ */
+void stop_stats_dump()
+{
+    uint32_t running = 1;
+
+    if (atomic_compare_exchange_strong(&dump_running, &running, 0))
     {
-        printf("Cannot send stop signal\n");
-        pthread_mutex_unlock(&kernel_mutex);
-        return ERROR;
+        futex_wake(&dump_running, 1);
+        pthread_join(dump_thread, NULL);
     }
+}
+
+/**
+ * @brief Initializes the threads and their associated data structures.
+ * @details This function runs the default `pthread_body` in every worker thread.
+ */
+void init_threads()
+{
+    init_threads_with_body(pthread_body, NULL);
+}
 
-    /* Wait until the signal is handled */
-    while (signal_is_handled == SIGNAL_UNHANDLED);
-    signal_is_handled = SIGNAL_UNHANDLED;
+/**
+ * @brief Initializes the worker threads to run a given body.
+ * @param body The function run by every worker thread.
+ * @param arg The argument passed to `body`, or `NULL` to pass the index of the thread in `threads`.
+ * @details This function starts a fixed pool of `NUMBER_OF_THREADS` workers that never retire, and records their
+ *          thread IDs in `threads`. With a `THREAD_STACK_SIZE` they run on pooled stacks with a one page guard.
+ */
+void init_threads_with_body(thread_body_t body, void *arg)
+{
+    thread_pool_config_t config = {
+        .min_threads = NUMBER_OF_THREADS,
+        .max_threads = NUMBER_OF_THREADS,
+        .idle_timeout_ms = 0,
+        .body = body,
+        .arg = arg,
+        .stack_size = THREAD_STACK_SIZE,
+        .guard_size = (size_t)sysconf(_SC_PAGESIZE),
+    };
 
-    /* If the thread is not the main thread, update the lists */
-    if (thread_to_stop != main_thread)
+    if (init_thread_pool(&config) == ERROR)
     {
-        /* Add the stopped thread to the stopped_threads list */
-        add_node_end(&stopped_threads, thread_to_stop);
-
-        /* Remove the thread from the running_threads list */
-        delete_node(&running_threads, thread_to_stop);
+        LOG_ERROR("Error in initializing the thread pool\n");
     }
 
-    /* Try to unlock the kernel mutex */
-    if (pthread_mutex_unlock(&kernel_mutex) != 0)
+    for (unsigned int i = 0; i < atomic_load(&default_scheduler.slot_count) && i < NUMBER_OF_THREADS; i++)
     {
-        printf("Cannot unlock the kernel mutex after stopping thread\n");
-        return ERROR;
+        threads[i] = get_slot(&default_scheduler, i)->tcb.thread_id;
     }
+}
 
-    return !ERROR;  /* Return success */
+#ifdef POSIX_TIMER
+/**
+ * @brief Appends a thread to the ready queue of its priority.
+ * @param tcb The control block of the thread.
+ */
+void ready_push(thread_control_block_t *tcb)
+{
+    tcb->ready_next = NULL;
+    if (ready_tail[tcb->priority] != NULL)
+    {
+        ready_tail[tcb->priority]->ready_next = tcb;
+    }
+    else
+    {
+        ready_head[tcb->priority] = tcb;
+    }
+    ready_tail[tcb->priority] = tcb;
+    ready_bitmap |= 1u << tcb->priority;
 }
 
 /**
- * @brief Sends a SIGUSR2 signal to resume the execution of a thread.
- * @param thread_to_resume The thread ID of the thread to be resumed.
- * @return Returns `!ERROR` on success, `ERROR` on failure.
- * @details This function sends a SIGUSR2 signal to the specified thread, which triggers the `resume_thread_handler` to resume the thread.
- *          The thread is then moved from the `stopped_threads` list to the `running_threads` list.
+ * @brief Removes a thread from the ready queue of its priority.
+ * @param tcb The control block of the thread.
  */
-int resume_thread(pthread_t thread_to_resume)
+void ready_remove(thread_control_block_t *tcb)
 {
-    /* Variable to store the status of each syscall or library call */
-    int status;
+    thread_control_block_t **link = &ready_head[tcb->priority];
+    thread_control_block_t *previous = NULL;
 
-    /* Try to lock the kernel mutex */
-    if (pthread_mutex_lock(&kernel_mutex) != 0)
+    while (*link != NULL && *link != tcb)
     {
-        printf("Cannot lock the kernel mutex to resume thread\n");
-        return ERROR;
+        previous = *link;
+        link = &previous->ready_next;
     }
-
-    /* Search for the thread in the running_threads list */
-    if (search_node(&running_threads, thread_to_resume) != NULL)
+    if (*link == NULL)
     {
-        printf("Thread is already running\n");
-        pthread_mutex_unlock(&kernel_mutex);
-        return ERROR;
+        return;
     }
 
-    /* Try to send the resume signal (SIGUSR2) to the thread */
-    if (pthread_kill(thread_to_resume, SIGUSR2) != 0)
+    *link = tcb->ready_next;
+    if (ready_tail[tcb->priority] == tcb)
     {
-        printf("Cannot send resume signal\n");
-        pthread_mutex_unlock(&kernel_mutex);
-        return ERROR;
+        ready_tail[tcb->priority] = previous;
     }
-
-    /* If the thread is not the main thread, update the lists */
-    if (thread_to_resume != main_thread)
+    if (ready_head[tcb->priority] == NULL)
     {
-        /* Add the resumed thread to the running_threads list */
-        add_node_end(&running_threads, thread_to_resume);
-
-        /* Remove the thread from the stopped_threads list */
-        delete_node(&stopped_threads, thread_to_resume);
+        ready_bitmap &= ~(1u << tcb->priority);
     }
+}
 
-    /* Try to unlock the kernel mutex */
-    if (pthread_mutex_unlock(&kernel_mutex) != 0)
+/**
+ * @brief Removes the oldest ready thread of the highest priority that can still be resumed.
+ * @return Returns its control block, or `NULL` if no thread is ready.
+ * @details Threads that exited, or were resumed by someone else, are dropped from the scheduler on the way.
+ */
+thread_control_block_t *ready_pop(void)
+{
+    while (ready_bitmap != 0)
     {
-        printf("Cannot unlock the kernel mutex after resuming thread\n");
-        return ERROR;
+        unsigned int priority = 31 - (unsigned int)__builtin_clz(ready_bitmap);
+        thread_control_block_t *tcb = ready_head[priority];
+
+        ready_remove(tcb);
+        if (tcb_get_state(tcb) == THREAD_STATE_STOPPED)
+        {
+            return tcb;
+        }
+        tcb->scheduled = 0;
     }
 
-    return !ERROR;  /* Return success */
+    return NULL;
 }
+
 /**
- * @brief Entry point function for worker threads.
- * @param arg The argument passed to the thread (unused).
- * @details This function simulates a task by incrementing a dummy variable and then resumes the main thread before exiting.
+ * @brief Adds a latency to a pair of total and maximum.
+ * @param total The total.
+ * @param max The maximum.
+ * @param expiry_ns The time the tick expired.
  */
-void pthread_body(void *arg)
+void record_tick_latency(uint64_t *total, uint64_t *max, uint64_t expiry_ns)
 {
-    sleep(1);  /* Simulate some initial delay */
-    volatile int dummy = 0;  /* Dummy variable to simulate work */
+    uint64_t now = stats_now_ns();
+    uint64_t latency = now > expiry_ns ? now - expiry_ns : 0;
 
-    /* Simulate work by incrementing the dummy variable */
-    for (int i = 1; i < 100; i++)
+    *total += latency;
+    if (latency > *max)
     {
-        dummy++;
+        *max = latency;
     }
-
-    printf("Thread finished\n");  /* Indicate that the thread has completed its work */
-    resume_main();  /* Resume the main thread */
-    printf("Main resumed and task exits\n");  /* Indicate that the main thread has been resumed */
-
-    pthread_exit((void *)10);  /* Exit the thread with a return value */
 }
 
 /**
- * @brief Initializes signal handlers for SIGUSR1 and SIGUSR2.
- * @details This function sets up the signal handlers for stopping and resuming threads using SIGUSR1 and SIGUSR2, respectively.
+ * @brief Hands a managed thread to the tick scheduler, or changes its priority.
+ * @param thread The thread ID of a worker.
+ * @param priority The priority, below `SCHED_PRIORITIES`; higher runs first.
+ * @return Returns `!ERROR` on success, `ERROR` if the thread is not a managed worker or the priority is invalid.
+ * @details A running thread is stopped and queued as ready; the next tick dispatches the highest priority.
+ *          A new priority of the running thread takes effect at the next tick.
  */
-void init_signals()
+int set_thread_priority(pthread_t thread, unsigned int priority)
 {
-    struct sigaction sigusr1, sigusr2;
+    thread_control_block_t *tcb = find_tcb(thread);
+    int result = !ERROR;
 
-    /* Configure SIGUSR1 handler to stop threads */
-    sigusr1.sa_flags = 0;
-    sigusr1.sa_handler = stop_thread_handler;
-    sigemptyset(&sigusr1.sa_mask);
-
-    /* Configure SIGUSR2 handler to resume threads */
-    sigusr2.sa_flags = 0;
-    sigusr2.sa_handler = resume_thread_handler;
-    sigusr2.sa_mask = sigusr1.sa_mask;
+    if (tcb == NULL || tcb == &main_tcb || priority >= SCHED_PRIORITIES)
+    {
+        LOG_WARN("Thread cannot be scheduled\n");
+        return ERROR;
+    }
 
-    /* Register SIGUSR1 handler */
-    if (sigaction(SIGUSR1, &sigusr1, NULL) == -1)
+    pthread_mutex_lock(&tick_mutex);
+    if (tcb == dispatched_tcb)
     {
-        printf("Error in initializing the stop handler\n");
+        tcb->priority = priority;
+    }
+    else
+    {
+        if (tcb->scheduled)
+        {
+            ready_remove(tcb);
+            tcb->scheduled = 0;
+        }
+        if (tcb_get_state(tcb) == THREAD_STATE_RUNNING)
+        {
+            stop_tcb(tcb);
+        }
+        if (tcb_get_state(tcb) == THREAD_STATE_STOPPED)
+        {
+            tcb->priority = priority;
+            tcb->scheduled = 1;
+            ready_push(tcb);
+        }
+        else
+        {
+            LOG_WARN("Thread cannot be scheduled\n");
+            result = ERROR;
+        }
     }
+    pthread_mutex_unlock(&tick_mutex);
+
+    return result;
+}
+
+/**
+ * @brief Takes a thread back from the tick scheduler, leaving it stopped or running as it is.
+ * @param thread The thread ID.
+ * @return Returns `!ERROR` on success, `ERROR` if the scheduler does not own the thread.
+ */
+int unschedule_thread(pthread_t thread)
+{
+    thread_control_block_t *tcb = find_tcb(thread);
+    int result = ERROR;
 
-    /* Register SIGUSR2 handler */
-    if (sigaction(SIGUSR2, &sigusr2, NULL) == -1)
+    pthread_mutex_lock(&tick_mutex);
+    if (tcb != NULL && tcb->scheduled)
     {
-        printf("Error in initializing the resume handler\n");
+        if (tcb == dispatched_tcb)
+        {
+            dispatched_tcb = NULL;
+        }
+        else
+        {
+            ready_remove(tcb);
+        }
+        tcb->scheduled = 0;
+        result = !ERROR;
     }
+    pthread_mutex_unlock(&tick_mutex);
+
+    return result;
 }
 
 /**
- * @brief Initializes the threads and their associated data structures.
- * @details This function initializes the `running_threads` and `stopped_threads` lists, sets thread attributes, and creates worker threads.
+ * @brief Copies the counters of the tick scheduler.
+ * @param stats Receives the counters.
  */
-void init_threads()
+void get_tick_scheduler_stats(tick_scheduler_stats_t *stats)
 {
-    /* Initialize the lists for running and stopped threads */
-    init_list(&running_threads);
-    init_list(&stopped_threads);
+    pthread_mutex_lock(&tick_mutex);
+    *stats = tick_stats;
+    stats->tick_latency_mean_ns = tick_stats.ticks != 0 ? tick_latency_total_ns / tick_stats.ticks : 0;
+    stats->dispatch_latency_mean_ns = tick_stats.dispatches != 0 ? dispatch_latency_total_ns / tick_stats.dispatches : 0;
+    pthread_mutex_unlock(&tick_mutex);
+}
 
-    /* Initialize thread attributes */
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+/**
+ * @brief Tick callback of the scheduler: preempts the running thread when a thread of higher priority is ready.
+ * @param ticks The number of ticks elapsed since the previous call.
+ * @details The running thread keeps the CPU while no ready thread has a higher priority, or until its time slice
+ *          ends when one of the same priority is ready. A preempted thread is stopped with the usual stop protocol
+ *          and queued behind the threads of its priority, then the chosen thread is resumed.
+ */
+void increment_tick(int ticks)
+{
+    uint64_t expiry_ns = osEE_linux_system_timer_expiry_ns();
+    thread_control_block_t *next;
+    int highest;
+
+    pthread_mutex_lock(&tick_mutex);
+    tick_stats.ticks++;
+    tick_stats.missed_ticks += (uint64_t)(ticks - 1);
+    record_tick_latency(&tick_latency_total_ns, &tick_stats.tick_latency_max_ns, expiry_ns);
+
+    /* A thread whose body returned, or that someone else stopped, gives up the CPU */
+    if (dispatched_tcb != NULL && tcb_get_state(dispatched_tcb) != THREAD_STATE_RUNNING)
+    {
+        dispatched_tcb->scheduled = 0;
+        dispatched_tcb = NULL;
+    }
 
-    /* Set thread scheduling parameters */
-    struct sched_param param;
-    param.sched_priority = 0;  /* Set thread priority */
-    int policy = SCHED_FIFO;   /* Set scheduling policy to FIFO */
-    pthread_attr_setschedparam(&attr, &param);
-    pthread_attr_setschedpolicy(&attr, &policy);
+    slice_left = slice_left > (unsigned int)ticks ? slice_left - (unsigned int)ticks : 0;
+    highest = ready_bitmap != 0 ? 31 - __builtin_clz(ready_bitmap) : -1;
+    if (highest < 0 || (dispatched_tcb != NULL && (highest < (int)dispatched_tcb->priority ||
+                                                   (highest == (int)dispatched_tcb->priority && slice_left > 0))))
+    {
+        pthread_mutex_unlock(&tick_mutex);
+        return;
+    }
 
-    /* Create worker threads */
-    for (int i = 0; i < NUMBER_OF_THREADS; i++)
+    /* Preempt the running thread */
+    if (dispatched_tcb != NULL)
     {
-        if (pthread_create(&threads[i], &attr, pthread_body, (void *)i) != 0)
+        if (stop_tcb(dispatched_tcb) != ERROR)
         {
-            printf("Error in creating thread[%d]\n", i);
+            ready_push(dispatched_tcb);
+            tick_stats.preemptions++;
         }
         else
         {
-            /* Add the newly created thread to the running_threads list */
-            add_node_end(&running_threads, threads[i]);
+            dispatched_tcb->scheduled = 0;
         }
+        dispatched_tcb = NULL;
     }
-}
 
-#ifdef POSIX_TIMER
-void increment_tick(int sig)
-{
-    // tick++;
-    return;
+    /* Dispatch the highest ready thread */
+    while ((next = ready_pop()) != NULL)
+    {
+        if (do_resume(next) != ERROR)
+        {
+            record_tick_latency(&dispatch_latency_total_ns, &tick_stats.dispatch_latency_max_ns, expiry_ns);
+            tick_stats.dispatches++;
+            dispatched_tcb = next;
+            slice_left = SCHED_TIME_SLICE;
+            break;
+        }
+        next->scheduled = 0;
+    }
+    pthread_mutex_unlock(&tick_mutex);
 }
 #endif
 /**
- * @brief Stops the main thread by waiting on a condition variable.
- * @details This function locks the `main_mutex` and waits on the `main_cond` condition variable, effectively pausing the main thread.
- *          The main thread will remain blocked until `resume_main` is called.
+ * @brief Stops the main thread until a worker calls `resume_main`.
+ * @details The main thread parks on the handoff word of its control block. A `resume_main` issued before the main
+ *          thread parks is counted and consumed here, so the wakeup is never lost.
  */
 void stop_main()
 {
-    pthread_mutex_lock(&main_mutex);  /* Lock the main mutex */
-    pthread_cond_wait(&main_cond, &main_mutex);  /* Wait for the condition variable */
-    pthread_mutex_unlock(&main_mutex);  /* Unlock the main mutex */
+    handoff_park(&main_tcb);
 }
 
 /**
- * @brief Resumes the main thread by signaling the condition variable.
- * @details This function signals the `main_cond` condition variable, which wakes up the main thread if it is waiting in `stop_main`.
+ * @brief Resumes the main thread parked in `stop_main`.
+ * @details Wakes the main thread with one system call if it sleeps, none if it has not parked yet.
  */
 void resume_main()
 {
-    pthread_cond_signal(&main_cond);  /* Signal the condition variable to resume the main thread */
-}
\ No newline at end of file
+    handoff_unpark(&main_tcb);
+}
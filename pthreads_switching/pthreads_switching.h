@@ -8,6 +8,9 @@
  #ifndef __PTHREAD_SWITCHING__
  #define __PTHREAD_SWITCHING__
  
+ #ifndef _GNU_SOURCE
+ #define _GNU_SOURCE  /**< For `pthread_attr_setaffinity_np` and the CPU set macros. */
+ #endif
  #include <pthread.h>
  #include <signal.h>
  #include <unistd.h>
@@ -16,56 +19,680 @@
  #include <stdlib.h>
  #include <stdio.h>
  #include <string.h>
+ #include <stdint.h>
+ #include <stdatomic.h>
  #include "../threads_linked_list/threads_linked_list.h"
+ #include "../thread_control_block/thread_control_block.h"
+ #include "../lockfree_queue/lockfree_queue.h"
+ #include "../futex/futex.h"
+ #include "../cpu_topology/cpu_topology.h"
+ #include "../trace/trace.h"
+ #include "../async_log/async_log.h"
+ #include "../stack_pool/stack_pool.h"
+ #include "../thread_index/thread_index.h"
  
  #ifdef POSIX_TIMER
  #include "../posix_timer/ee_linux_system_timer.h"
  #endif
  
- #define NUMBER_OF_THREADS 20  /**< Maximum number of threads supported by the system. */
+ #ifndef NUMBER_OF_THREADS
+ #define NUMBER_OF_THREADS 20  /**< Number of threads started by `init_threads`, and the default pool maximum. */
+ #endif
+ #ifndef CONTROL_SIGNAL_OFFSET
+ #define CONTROL_SIGNAL_OFFSET 0  /**< The control signal is `SIGRTMIN + CONTROL_SIGNAL_OFFSET`. */
+ #endif
+ #ifndef THREAD_STACK_SIZE
+ #define THREAD_STACK_SIZE 0   /**< Pooled stack of the threads started by `init_threads`; 0 keeps the C library's. */
+ #endif
  #define ERROR 0               /**< Error return value. */
  
+ /**
+  * @brief Number of control blocks allocated together when the pool grows.
+  */
+ #define POOL_CHUNK_SIZE 64
+ 
+ /**
+  * @brief Number of stops a batch tracks on the stack before it allocates its pending list.
+  */
+ #define STOP_BATCH 64
+ 
+ /**
+  * @brief Function run by a worker thread.
+  * @param arg The argument given to `init_threads_with_body`.
+  */
+ typedef void (*thread_body_t)(void *arg);
+ 
+ /**
+  * @brief Runtime configuration of the worker pool.
+  * @details Workers are spawned on demand up to `max_threads`. A worker whose body returns waits for new work;
+  *          once it has waited `idle_timeout_ms` and more than `min_threads` workers are alive, it retires.
+  *          Worker `i` is pinned according to `placement`, so a stopped worker resumes on the CPU whose caches it left.
+  *          With a `stack_size`, workers run on stacks of a pool: the stack of a retired worker is recycled by the next
+  *          worker spawned into its slot instead of being unmapped and mapped again.
+  */
+ typedef struct {
+     unsigned int min_threads;       /**< Workers started by `init_thread_pool` and never retired. */
+     unsigned int max_threads;       /**< Upper bound on the number of workers; 0 selects `NUMBER_OF_THREADS`. */
+     unsigned int idle_timeout_ms;   /**< Idle time before a worker above the minimum retires; 0 keeps idle workers. */
+     thread_body_t body;             /**< Body of the workers started by `init_thread_pool`. */
+     void *arg;                      /**< Argument passed to `body`, or `NULL` to pass the index of the worker. */
+     placement_policy_t placement;   /**< How workers are pinned to CPUs; `PLACEMENT_NONE` leaves them unpinned. */
+     const int *cpus;                /**< CPU list of `PLACEMENT_CPU_LIST`; copied by `init_thread_pool`. */
+     unsigned int cpu_count;         /**< Length of `cpus`. */
+     size_t stack_size;              /**< Stack of each worker from the stack pool; 0 keeps the stacks of the C library. */
+     size_t guard_size;              /**< Inaccessible guard below each pooled stack. */
+     unsigned int stack_flags;       /**< `STACK_POOL_HUGEPAGES` and `STACK_POOL_PREFAULT` for the pooled stacks. */
+ } thread_pool_config_t;
+ 
+ /**
+  * @brief A scheduler: a worker pool with its own slots, thread index, state queues and stack pool.
+  * @details Schedulers share no lock and no cache line, so subsystems given schedulers of their own, e.g. one per
+  *          core or per NUMA node, never contend with each other. Functions that take no scheduler act on the
+  *          default scheduler, which `init_thread_pool` initializes.
+  */
+ typedef struct scheduler scheduler_t;
+ 
  /**
   * @brief Flag to indicate that a signal is unhandled.
+  * @details Value of a per-thread stop acknowledgement word while a stop request is in flight.
   */
  #define SIGNAL_UNHANDLED 0
  
  /**
   * @brief Flag to indicate that a signal is handled.
+  * @details Value stored by the stop handler once the target thread is about to suspend.
   */
  #define SIGNAL_HANDLED 1
  
  /**
-  * @brief Sends a SIGUSR1 signal to stop the execution of a thread.
+  * @brief Flag to indicate that the thread exited instead of handling a signal.
+  * @details Value stored in the stop acknowledgement word by a thread that exits, so no controller waits for it forever.
+  */
+ #define SIGNAL_THREAD_EXITED 2
+ 
+ /**
+  * @brief Realtime signal carrying the stop and resume commands.
+  * @details Realtime signals are queued, not coalesced, and delivered in the order they were sent, so each command
+  *          reaches the thread with its own payload.
+  */
+ #define CONTROL_SIGNAL (SIGRTMIN + CONTROL_SIGNAL_OFFSET)
+ 
+ /**
+  * @brief Command carried by the control signal.
+  */
+ typedef enum {
+     THREAD_COMMAND_STOP = 0,        /**< Suspend the thread in the control handler. */
+     THREAD_COMMAND_RESUME           /**< Release the thread from the control handler. */
+ } thread_command_t;
+ 
+ /**
+  * @brief Sends a control signal to stop the execution of a thread.
   * @param thread_to_stop The thread ID of the thread to be stopped.
   * @return Returns `!ERROR` on success, `ERROR` on failure.
   */
  int stop_thread(pthread_t thread_to_stop);
  
  /**
-  * @brief Sends a SIGUSR2 signal to resume the execution of a thread.
+  * @brief Sends a control signal to resume the execution of a thread.
   * @param thread_to_resume The thread ID of the thread to be resumed.
   * @return Returns `!ERROR` on success, `ERROR` on failure.
   */
  int resume_thread(pthread_t thread_to_resume);
  
  /**
-  * @brief Initializes signal handlers for SIGUSR1 and SIGUSR2.
+  * @brief Stops several threads with a single round-trip.
+  * @param threads_to_stop The thread IDs of the threads to be stopped.
+  * @param count The number of thread IDs.
+  * @return Returns the number of threads that were stopped.
+  */
+ int stop_threads(const pthread_t *threads_to_stop, size_t count);
+ 
+ /**
+  * @brief Resumes several threads.
+  * @param threads_to_resume The thread IDs of the threads to be resumed.
+  * @param count The number of thread IDs.
+  * @return Returns the number of threads that were resumed.
+  */
+ int resume_threads(const pthread_t *threads_to_resume, size_t count);
+ 
+ /**
+  * @brief Sends a sequence of stop and resume commands to a thread and waits only for the last acknowledgement.
+  * @param thread The thread ID of a worker that takes stop signals.
+  * @param commands The commands, applied in order; a command that would not change the state is dropped.
+  * @param count The number of commands.
+  * @return Returns `!ERROR` once the thread acknowledged every command, `ERROR` if the thread is not managed, is busy,
+  *         polls safepoints, exited, or a command could not be sent.
+  */
+ int send_thread_commands(pthread_t thread, const thread_command_t *commands, size_t count);
+ 
+ /**
+  * @brief Status of an asynchronous transition.
+  */
+ typedef enum {
+     TRANSITION_PENDING = 0,         /**< The thread has not acknowledged the transition yet. */
+     TRANSITION_DONE,                /**< The transition completed. */
+     TRANSITION_FAILED               /**< The transition could not start, or the thread exited before acknowledging. */
+ } transition_status_t;
+ 
+ /**
+  * @brief Handle of an asynchronous transition; it must stay valid while the transition is pending.
+  */
+ typedef struct {
+     countdown_latch_t latch;        /**< Counted down by the acknowledgement of the thread. */
+     thread_control_block_t *tcb;    /**< Control block of the thread. */
+     transition_status_t status;     /**< Status returned by the last `transition_poll`. */
+ } transition_t;
+ 
+ /**
+  * @brief Starts stopping a thread without waiting for its acknowledgement.
+  * @param thread The thread ID of the thread to stop.
+  * @param op The handle of the transition.
+  * @param event_fd Eventfd written once the thread acknowledges, or -1.
+  * @return Returns `!ERROR` if the stop is pending, `ERROR` if it could not start; `op` is then `TRANSITION_FAILED`.
+  */
+ int stop_thread_async(pthread_t thread, transition_t *op, int event_fd);
+ 
+ /**
+  * @brief Resumes a thread through a transition handle.
+  * @param thread The thread ID of the thread to resume.
+  * @param op The handle of the transition.
+  * @return Returns `!ERROR` on success, `ERROR` on failure; `op` is complete either way.
+  */
+ int resume_thread_async(pthread_t thread, transition_t *op);
+ 
+ /**
+  * @brief Checks whether an asynchronous transition has completed, without blocking.
+  * @param op The handle of the transition.
+  * @return Returns the status of the transition.
+  */
+ transition_status_t transition_poll(transition_t *op);
+ 
+ /**
+  * @brief Waits until an asynchronous transition has completed.
+  * @param op The handle of the transition.
+  * @return Returns `TRANSITION_DONE` or `TRANSITION_FAILED`.
+  */
+ transition_status_t transition_wait(transition_t *op);
+ 
+ /**
+  * @brief Stops every running worker of the default scheduler with a single round-trip.
+  * @return Returns the number of threads that were stopped.
+  */
+ int stop_all();
+ 
+ /**
+  * @brief Resumes every stopped worker of the default scheduler.
+  * @return Returns the number of threads that were resumed.
+  */
+ int resume_all();
+ 
+ /**
+  * @brief Time a worker took to reach its safepoint during `quiesce`.
+  */
+ typedef struct {
+     pthread_t thread;               /**< Thread ID of the worker. */
+     unsigned int index;             /**< Index of the worker in the pool. */
+     uint64_t time_to_safepoint_ns;  /**< Time from the start of `quiesce` until the worker acknowledged its stop. */
+ } quiesce_sample_t;
+ 
+ /**
+  * @brief Outcome of `quiesce`.
+  */
+ typedef struct {
+     size_t stopped;                 /**< Number of workers stopped. */
+     uint64_t quiesce_ns;            /**< Time until the last worker reached its safepoint. */
+     quiesce_sample_t *samples;      /**< Receives the slowest workers first; may be `NULL`. */
+     size_t capacity;                /**< Length of `samples`. */
+     size_t count;                   /**< Number of samples written. */
+ } quiesce_report_t;
+ 
+ /**
+  * @brief Stops every running worker but the caller, for a consistent snapshot of the state they share.
+  * @param report Receives the outcome and the time-to-safepoint of the slowest workers, or `NULL`.
+  * @return Returns `!ERROR` once every stopped worker has reached its safepoint, `ERROR` if the pool is already
+  *         quiesced or memory is short.
+  */
+ int quiesce(quiesce_report_t *report);
+ 
+ /**
+  * @brief Resumes the workers stopped by `quiesce`.
+  * @return Returns the number of workers resumed.
+  */
+ int unquiesce();
+ 
+ /**
+  * @brief Stops a thread once a delay has elapsed.
+  * @param thread The thread ID of the thread to stop.
+  * @param delay_ns The delay in nanoseconds.
+  * @return Returns `!ERROR` if the stop is scheduled, `ERROR` if the thread is not managed or no timer is available.
+  */
+ int stop_after(pthread_t thread, uint64_t delay_ns);
+ 
+ /**
+  * @brief Resumes a thread once a delay has elapsed.
+  * @param thread The thread ID of the thread to resume.
+  * @param delay_ns The delay in nanoseconds.
+  * @return Returns `!ERROR` if the resume is scheduled, `ERROR` if the thread is not managed or no timer is available.
+  */
+ int resume_after(pthread_t thread, uint64_t delay_ns);
+ 
+ /**
+  * @brief Stops a thread now and resumes it after a duration.
+  * @param thread The thread ID of the thread to put to sleep.
+  * @param duration_ns The duration in nanoseconds.
+  * @return Returns `!ERROR` on success, `ERROR` if the thread could not be stopped or the resume not scheduled.
+  */
+ int sleep_thread(pthread_t thread, uint64_t duration_ns);
+ 
+ /**
+  * @brief Cancels the pending `stop_after`, `resume_after` and `sleep_thread` timers of a thread.
+  * @param thread The thread ID.
+  * @return Returns the number of timers cancelled.
+  */
+ int cancel_thread_timers(pthread_t thread);
+ 
+ /**
+  * @brief Scheduling policy of the periodic threads.
+  * @details Under `SCHED_POLICY_RATE_MONOTONIC` and `SCHED_POLICY_EDF` one periodic job runs at a time: the scheduler
+  *          resumes the most urgent released job and stops the others with the stop protocol. Under
+  *          `SCHED_POLICY_DEADLINE` each periodic thread gets a Linux `SCHED_DEADLINE` reservation and the kernel
+  *          schedules and throttles it.
+  */
+ typedef enum {
+     SCHED_POLICY_FIFO = 0,          /**< No periodic threads; workers run under the policy they were created with. */
+     SCHED_POLICY_RATE_MONOTONIC,    /**< The job with the shortest period runs first. */
+     SCHED_POLICY_EDF,               /**< The job with the earliest absolute deadline runs first. */
+     SCHED_POLICY_DEADLINE           /**< Reservations of the kernel's `SCHED_DEADLINE`; needs `CAP_SYS_NICE`. */
+ } sched_policy_t;
+ 
+ /**
+  * @brief Timing of a periodic thread.
+  */
+ typedef struct {
+     uint64_t period_ns;             /**< Time between two releases. */
+     uint64_t budget_ns;             /**< CPU time a job may use; a job that uses it up is stopped until its next release. */
+     uint64_t deadline_ns;           /**< Time from a release by which the job must be complete; 0 selects the period. */
+ } periodic_params_t;
+ 
+ /**
+  * @brief Counters of a periodic thread.
+  */
+ typedef struct {
+     uint64_t jobs;                  /**< Jobs completed. */
+     uint64_t overruns;              /**< Jobs that exhausted their budget. */
+     uint64_t deadline_misses;       /**< Jobs not complete by their deadline. */
+     uint64_t preemptions;           /**< Times a job was stopped for a more urgent one. */
+     uint64_t max_response_ns;       /**< Longest time from a release to the completion of its job. */
+ } periodic_stats_t;
+ 
+ /**
+  * @brief Selects the policy of the periodic threads of the default scheduler.
+  * @param policy The policy.
+  * @return Returns `!ERROR` on success, `ERROR` while periodic threads exist.
+  */
+ int set_sched_policy(sched_policy_t policy);
+ 
+ /**
+  * @brief Selects the policy of the periodic threads of a scheduler; each scheduler runs its own periodic set.
+  * @param scheduler The scheduler.
+  * @param policy The policy.
+  * @return Returns `!ERROR` on success, `ERROR` while periodic threads of the scheduler exist.
+  */
+ int sched_set_sched_policy(scheduler_t *scheduler, sched_policy_t policy);
+ 
+ /**
+  * @brief Returns the policy of the periodic threads of the default scheduler.
+  */
+ sched_policy_t get_sched_policy();
+ 
+ /**
+  * @brief Returns the policy of the periodic threads of a scheduler.
+  * @param scheduler The scheduler.
+  */
+ sched_policy_t sched_get_sched_policy(scheduler_t *scheduler);
+ 
+ /**
+  * @brief Hands a worker to the periodic scheduler of its pool, or changes its timing; its first job is released at
+  *        once.
+  * @param thread The thread ID of a worker.
+  * @param params The timing; `budget_ns <= deadline_ns <= period_ns` is required.
+  * @return Returns `!ERROR` on success, `ERROR` if no periodic policy is selected, the thread is not a worker that
+  *         takes stop signals, or the timing is invalid.
+  */
+ int set_thread_period(pthread_t thread, const periodic_params_t *params);
+ 
+ /**
+  * @brief Takes a thread back from the periodic scheduler and lets it run.
+  * @param thread The thread ID.
+  * @return Returns `!ERROR` on success, `ERROR` if the thread is not periodic.
+  */
+ int clear_thread_period(pthread_t thread);
+ 
+ /**
+  * @brief Completes the current job of the calling periodic thread and waits until its next job is dispatched.
+  * @details Returns at once when the calling thread is not periodic.
+  */
+ void wait_next_period();
+ 
+ /**
+  * @brief Copies the counters of a periodic thread.
+  * @param thread The thread ID.
+  * @param stats Receives the counters.
+  * @return Returns `!ERROR` on success, `ERROR` if the thread is not managed.
+  */
+ int get_periodic_stats(pthread_t thread, periodic_stats_t *stats);
+ 
+ /**
+  * @brief Copies the IDs of the threads in a given state into a linked list.
+  * @param state The state to collect (`THREAD_STATE_RUNNING` or `THREAD_STATE_STOPPED`).
+  * @param list An initialized linked list that receives the thread IDs in creation order.
+  * @return Returns `!ERROR` on success, `ERROR` if the state is invalid or a list node cannot be allocated.
+  */
+ int get_threads_in_state(thread_state_t state, LinkedList *list);
+ 
+ /**
+  * @brief Removes the oldest thread from the queue of a given state.
+  * @param state The state to pick from (`THREAD_STATE_RUNNING` or `THREAD_STATE_STOPPED`).
+  * @param thread Receives the thread ID.
+  * @return Returns `!ERROR` on success, `ERROR` if no thread is queued for the state.
+  */
+ int next_thread_in_state(thread_state_t state, pthread_t *thread);
+ 
+ /**
+  * @brief Switches the calling worker thread to cooperative suspension.
+  * @details Once enabled, the thread is stopped at its next `safepoint` call instead of by the control signal.
+  */
+ void enable_safepoints();
+ 
+ /**
+  * @brief Suspends the calling thread here if a stop has been requested.
+  * @details Must be called regularly by threads that called `enable_safepoints`; it is a no-op for the others.
+  */
+ void safepoint();
+ 
+ /**
+  * @brief Initializes the handler of the control signal.
   */
  void init_signals();
  
+ /**
+  * @brief Initializes the default scheduler and starts its minimum number of workers.
+  * @param config The configuration of the pool.
+  * @return Returns `!ERROR` on success, `ERROR` on failure.
+  */
+ int init_thread_pool(const thread_pool_config_t *config);
+ 
+ /**
+  * @brief Runs a body on a pooled worker, spawning a new worker if none is idle.
+  * @param body The function to run.
+  * @param arg The argument passed to `body`, or `NULL` to pass the index of the worker.
+  * @param thread Receives the thread ID of the worker. May be `NULL`.
+  * @return Returns `!ERROR` on success, `ERROR` if the pool is full or quiesced, or the thread cannot be created.
+  */
+ int spawn_thread(thread_body_t body, void *arg, pthread_t *thread);
+ 
+ /**
+  * @brief Returns the number of live workers of the default scheduler.
+  * @return Returns the number of workers, running, stopped or idle.
+  */
+ unsigned int get_pool_size();
+ 
+ /**
+  * @brief Creates a scheduler and starts its minimum number of workers.
+  * @param config The configuration of its pool.
+  * @return Returns the scheduler, or `NULL` if the configuration is invalid or resources are short.
+  * @note The signals must be initialized with `init_signals`.
+  */
+ scheduler_t *sched_create(const thread_pool_config_t *config);
+ 
+ /**
+  * @brief Retires the workers of a scheduler and releases it.
+  * @param scheduler The scheduler; `NULL` and the default scheduler are ignored.
+  * @details Periodic workers are detached and stopped workers resumed, then it waits until every worker has returned
+  *          from its body, so no body may block forever. Workers must be taken back from the tick scheduler first.
+  */
+ void sched_destroy(scheduler_t *scheduler);
+ 
+ /**
+  * @brief Returns the default scheduler.
+  */
+ scheduler_t *sched_default();
+ 
+ /**
+  * @brief Runs a body on a worker of a scheduler, spawning a new worker if none is idle.
+  * @param scheduler The scheduler.
+  * @param body The function to run.
+  * @param arg The argument passed to `body`, or `NULL` to pass the index of the worker.
+  * @param thread Receives the thread ID of the worker. May be `NULL`.
+  * @return Returns `!ERROR` on success, `ERROR` if the pool is full, the scheduler is quiesced or being destroyed,
+  *         or the thread cannot be created.
+  */
+ int sched_spawn_thread(scheduler_t *scheduler, thread_body_t body, void *arg, pthread_t *thread);
+ 
+ /**
+  * @brief Stops a worker of a scheduler.
+  * @param scheduler The scheduler.
+  * @param thread The thread ID of the worker.
+  * @return Returns `!ERROR` on success, `ERROR` if the thread is not a worker of the scheduler or cannot be stopped.
+  */
+ int sched_stop_thread(scheduler_t *scheduler, pthread_t thread);
+ 
+ /**
+  * @brief Resumes a worker of a scheduler.
+  * @param scheduler The scheduler.
+  * @param thread The thread ID of the worker.
+  * @return Returns `!ERROR` on success, `ERROR` if the thread is not a worker of the scheduler or is not stopped.
+  */
+ int sched_resume_thread(scheduler_t *scheduler, pthread_t thread);
+ 
+ /**
+  * @brief Stops every running worker of a scheduler with a single round-trip.
+  * @param scheduler The scheduler.
+  * @return Returns the number of threads that were stopped.
+  */
+ int sched_stop_all(scheduler_t *scheduler);
+ 
+ /**
+  * @brief Resumes every stopped worker of a scheduler.
+  * @param scheduler The scheduler.
+  * @return Returns the number of threads that were resumed.
+  */
+ int sched_resume_all(scheduler_t *scheduler);
+ 
+ /**
+  * @brief Stops every running worker of a scheduler but the caller.
+  * @param scheduler The scheduler.
+  * @param report Receives the outcome and the time-to-safepoint of the slowest workers, or `NULL`.
+  * @return Returns `!ERROR` once every stopped worker has reached its safepoint, `ERROR` if the scheduler is already
+  *         quiesced or memory is short.
+  */
+ int sched_quiesce(scheduler_t *scheduler, quiesce_report_t *report);
+ 
+ /**
+  * @brief Resumes the workers of a scheduler stopped by `sched_quiesce`.
+  * @param scheduler The scheduler.
+  * @return Returns the number of workers resumed.
+  */
+ int sched_unquiesce(scheduler_t *scheduler);
+ 
+ /**
+  * @brief Copies the IDs of the threads of a scheduler in a given state into a linked list.
+  * @param scheduler The scheduler.
+  * @param state The state to collect (`THREAD_STATE_RUNNING` or `THREAD_STATE_STOPPED`).
+  * @param list An initialized linked list that receives the thread IDs in creation order.
+  * @return Returns `!ERROR` on success, `ERROR` if the state is invalid or a list node cannot be allocated.
+  */
+ int sched_get_threads_in_state(scheduler_t *scheduler, thread_state_t state, LinkedList *list);
+ 
+ /**
+  * @brief Removes the oldest thread from the queue of a given state of a scheduler.
+  * @param scheduler The scheduler.
+  * @param state The state to pick from (`THREAD_STATE_RUNNING` or `THREAD_STATE_STOPPED`).
+  * @param thread Receives the thread ID.
+  * @return Returns `!ERROR` on success, `ERROR` if no thread is queued for the state.
+  */
+ int sched_next_thread_in_state(scheduler_t *scheduler, thread_state_t state, pthread_t *thread);
+ 
+ /**
+  * @brief Returns the number of live workers of a scheduler.
+  * @param scheduler The scheduler.
+  * @return Returns the number of workers, running, stopped or idle.
+  */
+ unsigned int sched_get_pool_size(scheduler_t *scheduler);
+ 
+ /**
+  * @brief Copies the counters of the worker stacks of the default scheduler.
+  * @param stats Receives the counters.
+  * @return Returns `!ERROR` on success, `ERROR` if the workers run on the stacks of the C library.
+  */
+ int get_stack_pool_stats(stack_pool_stats_t *stats);
+ 
+ /**
+  * @brief Returns the compact handle of a managed worker.
+  * @param thread The thread ID of the worker.
+  * @param handle Receives the handle, the index of the worker in the pool of its scheduler.
+  * @return Returns `!ERROR` on success, `ERROR` if the thread is not a managed worker.
+  */
+ int get_thread_handle(pthread_t thread, unsigned int *handle);
+ 
+ /**
+  * @brief Returns the thread ID of the worker of the default scheduler behind a handle.
+  * @param handle The handle returned by `get_thread_handle`.
+  * @param thread Receives the thread ID.
+  * @return Returns `!ERROR` on success, `ERROR` if no live worker has the handle.
+  */
+ int get_thread_by_handle(unsigned int handle, pthread_t *thread);
+ 
+ /**
+  * @brief Returns the thread ID of the worker of a scheduler behind a handle.
+  * @param scheduler The scheduler of the worker.
+  * @param handle The handle returned by `get_thread_handle`.
+  * @param thread Receives the thread ID.
+  * @return Returns `!ERROR` on success, `ERROR` if no live worker of the scheduler has the handle.
+  */
+ int sched_get_thread_by_handle(scheduler_t *scheduler, unsigned int handle, pthread_t *thread);
+ 
+ /**
+  * @brief Copies the scheduling statistics of a managed thread.
+  * @param thread The thread ID, or the main thread.
+  * @param snapshot Receives the statistics.
+  * @return Returns `!ERROR` on success, `ERROR` if the thread is not managed or statistics are compiled out.
+  */
+ int get_thread_stats(pthread_t thread, thread_stats_snapshot_t *snapshot);
+ 
+ /**
+  * @brief Copies the scheduling statistics of every worker of the default scheduler.
+  * @param snapshots Receives the statistics in slot order.
+  * @param capacity The number of entries of `snapshots`.
+  * @return Returns the number of entries filled, 0 if statistics are compiled out.
+  */
+ unsigned int get_all_thread_stats(thread_stats_snapshot_t *snapshots, unsigned int capacity);
+ 
+ /**
+  * @brief Starts a thread that prints the statistics of every worker to stdout periodically.
+  * @param interval_ms The interval between two dumps in milliseconds.
+  * @return Returns `!ERROR` on success, `ERROR` on failure.
+  */
+ int start_stats_dump(unsigned int interval_ms);
+ 
+ /**
+  * @brief Stops the thread started by `start_stats_dump` and waits for it to exit.
+  */
+ void stop_stats_dump();
+ 
  /**
   * @brief Initializes the worker threads and their associated data structures.
   */
  void init_threads();
  
  /**
-  * @brief Stops the main thread by waiting on a condition variable.
+  * @brief Initializes the worker threads to run a given body.
+  * @param body The function run by every worker thread.
+  * @param arg The argument passed to `body`, or `NULL` to pass the index of the thread in `threads`.
+  */
+ void init_threads_with_body(thread_body_t body, void *arg);
+ 
+ #ifdef POSIX_TIMER
+ /**
+  * @brief Number of priorities of the tick scheduler; one bit each in its ready bitmap.
+  */
+ #define SCHED_PRIORITIES 32
+ 
+ #ifndef SCHED_TIME_SLICE
+ #define SCHED_TIME_SLICE 1  /**< Ticks a thread runs before a ready thread of the same priority takes over. */
+ #endif
+ 
+ /**
+  * @brief Counters of the tick scheduler.
+  * @details Latencies are measured from the expiry of the tick: `tick_latency` until the scheduler runs,
+  *          `dispatch_latency` until the chosen thread has been resumed.
+  */
+ typedef struct {
+     uint64_t ticks;                         /**< Ticks handled. */
+     uint64_t missed_ticks;                  /**< Ticks that expired while the previous one was being handled. */
+     uint64_t dispatches;                    /**< Threads resumed by the scheduler. */
+     uint64_t preemptions;                   /**< Running threads stopped in favour of another. */
+     uint64_t tick_latency_mean_ns;          /**< Mean time from expiry to the scheduler. */
+     uint64_t tick_latency_max_ns;           /**< Longest time from expiry to the scheduler. */
+     uint64_t dispatch_latency_mean_ns;      /**< Mean time from expiry to the end of a dispatch. */
+     uint64_t dispatch_latency_max_ns;       /**< Longest time from expiry to the end of a dispatch. */
+ } tick_scheduler_stats_t;
+ 
+ /**
+  * @brief Hands a managed thread to the tick scheduler, or changes its priority.
+  * @param thread The thread ID of a worker.
+  * @param priority The priority, below `SCHED_PRIORITIES`; higher runs first.
+  * @return Returns `!ERROR` on success, `ERROR` if the thread is not a managed worker or the priority is invalid.
+  */
+ int set_thread_priority(pthread_t thread, unsigned int priority);
+ 
+ /**
+  * @brief Takes a thread back from the tick scheduler, leaving it stopped or running as it is.
+  * @param thread The thread ID.
+  * @return Returns `!ERROR` on success, `ERROR` if the scheduler does not own the thread.
+  */
+ int unschedule_thread(pthread_t thread);
+ 
+ /**
+  * @brief Copies the counters of the tick scheduler.
+  * @param stats Receives the counters.
+  */
+ void get_tick_scheduler_stats(tick_scheduler_stats_t *stats);
+ 
+ /**
+  * @brief Tick callback of the scheduler: preempts the running thread when a thread of higher priority is ready.
+  * @param ticks The number of ticks elapsed since the previous call.
+  */
+ void increment_tick(int ticks);
+ #endif
+ 
+ /**
+  * @brief Wakes a thread parked in `handoff_wait` or `handoff_to`, and parks the caller until a handoff wakes it.
+  * @param thread The thread ID of the thread to hand off to.
+  * @return Returns `!ERROR` once the caller has been handed control back, `ERROR` if either thread is not managed.
+  */
+ int handoff_to(pthread_t thread);
+ 
+ /**
+  * @brief Wakes a thread parked in `handoff_wait` or `handoff_to` without parking the caller.
+  * @param thread The thread ID of the thread to wake.
+  * @return Returns `!ERROR` on success, `ERROR` if the thread is not managed.
+  */
+ int handoff_wake(pthread_t thread);
+ 
+ /**
+  * @brief Parks the calling thread until a handoff wakes it.
+  * @return Returns `!ERROR` once woken, `ERROR` if the caller is not managed.
+  */
+ int handoff_wait();
+ 
+ /**
+  * @brief Stops the main thread until a worker calls `resume_main`.
   */
  void stop_main();
  
  /**
-  * @brief Resumes the main thread by signaling the condition variable.
+  * @brief Resumes the main thread parked in `stop_main`.
   */
  void resume_main();
  
@@ -0,0 +1,157 @@
+/**
+ * @file ring_registry.c
+ * @brief Implementation of registries of per-thread single-producer rings.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#include <sched.h>
+#include <sys/mman.h>
+#include "ring_registry.h"
+
+/**
+ * @brief Marks the ring of an exiting thread, so the drain thread unmaps it once drained.
+ * @param ring The ring.
+ */
+static void retire_ring(void *ring)
+{
+    atomic_store_explicit(&((ring_header_t *)ring)->retired, 1, memory_order_release);
+}
+
+/**
+ * @brief Creates the key of a registry on first use.
+ * @param registry The registry.
+ * @details The first caller creates the key; the others wait the few instructions it takes.
+ */
+static void create_key(ring_registry_t *registry)
+{
+    uint32_t state = 0;
+
+    if (atomic_load_explicit(&registry->key_state, memory_order_acquire) == 2)
+    {
+        return;
+    }
+    if (atomic_compare_exchange_strong(&registry->key_state, &state, 1))
+    {
+        pthread_key_create(&registry->key, retire_ring);
+        atomic_store_explicit(&registry->key_state, 2, memory_order_release);
+        return;
+    }
+    while (atomic_load_explicit(&registry->key_state, memory_order_acquire) != 2)
+    {
+        sched_yield();
+    }
+}
+
+/**
+ * @brief Removes a drained ring of an exited thread from a registry and unmaps it.
+ * @param registry The registry.
+ * @param ring The ring.
+ * @details Only the drain thread unlinks, and other threads only ever replace the first ring, so a ring that is
+ *          not first can be unlinked with a plain store.
+ */
+static void free_ring(ring_registry_t *registry, ring_header_t *ring)
+{
+    ring_header_t *expected = ring;
+
+    if (!atomic_compare_exchange_strong(&registry->rings, &expected, ring->next))
+    {
+        for (ring_header_t *previous = expected; previous != NULL; previous = previous->next)
+        {
+            if (previous->next == ring)
+            {
+                previous->next = ring->next;
+                break;
+            }
+        }
+    }
+    munmap(ring, registry->ring_bytes);
+}
+
+/**
+ * @brief Maps a ring for the calling thread and adds it to a registry.
+ * @param registry The registry.
+ * @return Returns the ring, zeroed but for its link, or `NULL` if it cannot be mapped.
+ * @details The key's destructor retires the ring when the thread exits.
+ */
+ring_header_t *ring_registry_attach(ring_registry_t *registry)
+{
+    ring_header_t *ring = (ring_header_t *)mmap(NULL, registry->ring_bytes, PROT_READ | PROT_WRITE,
+                                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ring_header_t *first;
+
+    if (ring == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    create_key(registry);
+    pthread_setspecific(registry->key, ring);
+
+    first = atomic_load(&registry->rings);
+    do
+    {
+        ring->next = first;
+    } while (!atomic_compare_exchange_weak(&registry->rings, &first, ring));
+
+    return ring;
+}
+
+/**
+ * @brief Reserves the next position of a ring.
+ * @param ring The ring of the calling thread.
+ * @param capacity The number of entries of the ring.
+ * @param position Receives the position; entry `position & (capacity - 1)` is published with sequence `position + 1`.
+ * @param fill Receives the number of entries queued before it. May be `NULL`.
+ * @return Returns 1 on success, 0 if the ring is full; the entry is then counted as dropped.
+ */
+int ring_registry_reserve(ring_header_t *ring, uint64_t capacity, uint64_t *position, uint64_t *fill)
+{
+    uint64_t reserved = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail;
+
+    do
+    {
+        tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (reserved - tail >= capacity)
+        {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return 0;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&ring->head, &reserved, reserved + 1, memory_order_relaxed,
+                                                    memory_order_relaxed));
+
+    *position = reserved;
+    if (fill != NULL)
+    {
+        *fill = reserved - tail;
+    }
+    return 1;
+}
+
+/**
+ * @brief Drains every ring of a registry and unmaps the empty rings of exited threads.
+ * @param registry The registry.
+ * @param drain Copies the published entries of one ring and advances its `tail`.
+ * @param context The argument passed to `drain`.
+ * @details `retired` is read before the ring is drained, so an entry published just before the owner exited is
+ *          never lost with its ring.
+ */
+void ring_registry_drain(ring_registry_t *registry, void (*drain)(ring_header_t *ring, void *context), void *context)
+{
+    ring_header_t *ring = atomic_load_explicit(&registry->rings, memory_order_acquire);
+
+    while (ring != NULL)
+    {
+        ring_header_t *next = ring->next;
+        int retired = atomic_load_explicit(&ring->retired, memory_order_acquire);
+
+        drain(ring, context);
+        if (retired && atomic_load_explicit(&ring->tail, memory_order_relaxed) ==
+                       atomic_load_explicit(&ring->head, memory_order_acquire))
+        {
+            free_ring(registry, ring);
+        }
+        ring = next;
+    }
+}
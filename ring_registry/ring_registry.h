@@ -0,0 +1,76 @@
+/**
+ * @file ring_registry.h
+ * @brief Header file for registries of per-thread single-producer rings, shared by the trace and the logger.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details Every thread owns one ring of a registry. The owner reserves a position with a CAS on `head`, so a signal
+ *          handler interrupting it simply takes the next position, fills the entry and publishes it through a
+ *          sequence number of its own. A single drain thread copies entries up to the first unpublished one and then
+ *          advances `tail`. Rings are mapped rather than taken from `malloc`, and the ring of an exited thread is
+ *          unmapped by the drain thread once it is empty.
+ */
+
+#ifndef RING_REGISTRY_H
+#define RING_REGISTRY_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/**
+ * @brief Bookkeeping of a ring; the first member of every ring type, followed by the entries.
+ */
+typedef struct ring_header {
+    struct ring_header *next;                   /**< Next ring of the registry. */
+    _Atomic uint32_t retired;                   /**< Set when the owner has exited. */
+    _Atomic uint64_t dropped;                   /**< Entries lost because the ring was full. */
+    _Alignas(64) _Atomic uint64_t head;         /**< Next position to reserve; written by the owner. */
+    _Alignas(64) _Atomic uint64_t tail;         /**< Next position to drain; written by the drain thread. */
+} ring_header_t;
+
+/**
+ * @brief Rings of every thread that registered, newest first.
+ * @details Pushed by any thread and unlinked by the drain thread only. Initialize with `RING_REGISTRY_INITIALIZER`.
+ */
+typedef struct {
+    _Atomic(ring_header_t *) rings;             /**< Newest ring. */
+    size_t ring_bytes;                          /**< Size of one ring, header included. */
+    _Atomic uint32_t key_state;                 /**< 0 before `key` is created, 1 while it is, 2 once it exists. */
+    pthread_key_t key;                          /**< Key whose destructor retires the ring of an exiting thread. */
+} ring_registry_t;
+
+/**
+ * @brief Initializer of a registry of rings of a given type.
+ */
+#define RING_REGISTRY_INITIALIZER(ring_type) { .rings = NULL, .ring_bytes = sizeof(ring_type), .key_state = 0 }
+
+/**
+ * @brief Maps a ring for the calling thread and adds it to a registry.
+ * @param registry The registry.
+ * @return Returns the ring, zeroed but for its link, or `NULL` if it cannot be mapped.
+ * @note Not async-signal-safe; threads that use their ring from signal handlers register before.
+ */
+ring_header_t *ring_registry_attach(ring_registry_t *registry);
+
+/**
+ * @brief Reserves the next position of a ring.
+ * @param ring The ring of the calling thread.
+ * @param capacity The number of entries of the ring.
+ * @param position Receives the position; entry `position & (capacity - 1)` is published with sequence `position + 1`.
+ * @param fill Receives the number of entries queued before it. May be `NULL`.
+ * @return Returns 1 on success, 0 if the ring is full; the entry is then counted as dropped.
+ * @note This function is async-signal-safe.
+ */
+int ring_registry_reserve(ring_header_t *ring, uint64_t capacity, uint64_t *position, uint64_t *fill);
+
+/**
+ * @brief Drains every ring of a registry and unmaps the empty rings of exited threads.
+ * @param registry The registry.
+ * @param drain Copies the published entries of one ring and advances its `tail`.
+ * @param context The argument passed to `drain`.
+ * @details Must only be called by one thread at a time.
+ */
+void ring_registry_drain(ring_registry_t *registry, void (*drain)(ring_header_t *ring, void *context), void *context);
+
+#endif /* RING_REGISTRY_H */
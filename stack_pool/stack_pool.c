@@ -0,0 +1,221 @@
+/**
+ * @file stack_pool.c
+ * @brief Implementation of pools of thread stacks.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details A stack is one anonymous mapping whose lowest `guard_size` bytes are `PROT_NONE`, so an overflow faults
+ *          instead of running into the neighbouring mapping. Huge pages are transparent ones requested with
+ *          `MADV_HUGEPAGE` on a stack aligned to `STACK_POOL_HUGEPAGE_SIZE`; unlike `MAP_HUGETLB` they need no
+ *          reserved huge pages, and the kernel falls back to small pages when none is available.
+ */
+
+#define _GNU_SOURCE
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "stack_pool.h"
+
+/**
+ * @brief Rounds a size up to a multiple of a power of two.
+ * @param size The size.
+ * @param granule The power of two.
+ */
+static size_t round_up(size_t size, size_t granule)
+{
+    return (size + granule - 1) & ~(granule - 1);
+}
+
+/**
+ * @brief Maps a new stack.
+ * @param pool The pool.
+ * @return Returns the stack, or `NULL` if it cannot be mapped.
+ * @details With huge pages the mapping is made one huge page larger than needed and trimmed, so the stack itself
+ *          starts on a huge page boundary. Pre-faulting writes one byte per page, top down like a growing stack.
+ */
+static pooled_stack_t *map_stack(stack_pool_t *pool)
+{
+    size_t stack_size = pool->config.stack_size;
+    size_t guard_size = pool->config.guard_size;
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    pooled_stack_t *stack = (pooled_stack_t *)malloc(sizeof(pooled_stack_t));
+    char *mapping, *base;
+
+    if (stack == NULL)
+    {
+        return NULL;
+    }
+
+    if (pool->config.flags & STACK_POOL_HUGEPAGES)
+    {
+        size_t slack = STACK_POOL_HUGEPAGE_SIZE;
+        char *start = (char *)mmap(NULL, pool->mapping_size + slack, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (start == MAP_FAILED)
+        {
+            free(stack);
+            return NULL;
+        }
+        base = (char *)round_up((uintptr_t)start + guard_size, STACK_POOL_HUGEPAGE_SIZE);
+        mapping = base - guard_size;
+        if (mapping > start)
+        {
+            munmap(start, (size_t)(mapping - start));
+        }
+        if (start + pool->mapping_size + slack > mapping + pool->mapping_size)
+        {
+            munmap(mapping + pool->mapping_size, (size_t)(start + pool->mapping_size + slack - (mapping + pool->mapping_size)));
+        }
+        madvise(base, stack_size, MADV_HUGEPAGE);
+        page_size = STACK_POOL_HUGEPAGE_SIZE;
+    }
+    else
+    {
+        mapping = (char *)mmap(NULL, pool->mapping_size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        if (mapping == MAP_FAILED)
+        {
+            free(stack);
+            return NULL;
+        }
+        base = mapping + guard_size;
+    }
+
+    if (guard_size != 0)
+    {
+        mprotect(mapping, guard_size, PROT_NONE);
+    }
+    if (pool->config.flags & STACK_POOL_PREFAULT)
+    {
+        for (size_t offset = stack_size; offset >= page_size; offset -= page_size)
+        {
+            ((volatile char *)base)[offset - 1] = 0;
+        }
+    }
+
+    stack->mapping = mapping;
+    stack->base = base;
+    stack->next = NULL;
+
+    return stack;
+}
+
+/**
+ * @brief Initializes a pool.
+ * @param pool The pool.
+ * @param config The geometry of its stacks.
+ * @return Returns 1 on success, 0 if the stack size is below `PTHREAD_STACK_MIN`.
+ */
+int stack_pool_init(stack_pool_t *pool, const stack_pool_config_t *config)
+{
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (config->stack_size < (size_t)PTHREAD_STACK_MIN)
+    {
+        return 0;
+    }
+
+    pool->config = *config;
+    pool->config.stack_size = round_up(config->stack_size, (config->flags & STACK_POOL_HUGEPAGES) ?
+                                                           STACK_POOL_HUGEPAGE_SIZE : page_size);
+    pool->config.guard_size = round_up(config->guard_size, page_size);
+    pool->mapping_size = pool->config.guard_size + pool->config.stack_size;
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->free = NULL;
+    memset(&pool->stats, 0, sizeof(pool->stats));
+
+    return 1;
+}
+
+/**
+ * @brief Takes a stack from a pool, mapping a new one if the free list is empty.
+ * @param pool The pool.
+ * @return Returns the stack, or `NULL` if it cannot be mapped.
+ * @details The free list is LIFO, so the stack handed out is the one whose pages were touched last.
+ */
+pooled_stack_t *stack_pool_get(stack_pool_t *pool)
+{
+    pooled_stack_t *stack;
+
+    pthread_mutex_lock(&pool->lock);
+    stack = pool->free;
+    if (stack != NULL)
+    {
+        pool->free = stack->next;
+        pool->stats.free--;
+        pool->stats.reused++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    if (stack != NULL)
+    {
+        return stack;
+    }
+
+    /* Map outside the lock */
+    stack = map_stack(pool);
+    if (stack != NULL)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->stats.mapped++;
+        pool->stats.mapped_bytes += pool->mapping_size;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return stack;
+}
+
+/**
+ * @brief Gives a stack back to its pool.
+ * @param pool The pool.
+ * @param stack The stack; no thread may run on it any more.
+ */
+void stack_pool_put(stack_pool_t *pool, pooled_stack_t *stack)
+{
+    pthread_mutex_lock(&pool->lock);
+    stack->next = pool->free;
+    pool->free = stack;
+    pool->stats.free++;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief Returns the usable size of the stacks of a pool.
+ * @param pool The pool.
+ */
+size_t stack_pool_stack_size(const stack_pool_t *pool)
+{
+    return pool->config.stack_size;
+}
+
+/**
+ * @brief Copies the counters of a pool.
+ * @param pool The pool.
+ * @param stats Receives the counters.
+ */
+void stack_pool_get_stats(stack_pool_t *pool, stack_pool_stats_t *stats)
+{
+    pthread_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief Unmaps the free stacks of a pool and releases it.
+ * @param pool The pool; every stack it handed out must have been given back.
+ */
+void stack_pool_destroy(stack_pool_t *pool)
+{
+    pooled_stack_t *stack = pool->free;
+
+    while (stack != NULL)
+    {
+        pooled_stack_t *next = stack->next;
+        munmap(stack->mapping, pool->mapping_size);
+        free(stack);
+        stack = next;
+    }
+    pool->free = NULL;
+    pool->stats.free = 0;
+    pthread_mutex_destroy(&pool->lock);
+}
@@ -0,0 +1,112 @@
+/**
+ * @file stack_pool.h
+ * @brief Header file for pools of thread stacks with guard pages, optional huge pages and pre-faulting.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details A stack is mapped once and given back to its pool when its thread is done with it, so a thread created
+ *          on a recycled stack pays neither `mmap`/`munmap` nor the page faults of a fresh stack.
+ */
+
+#ifndef STACK_POOL_H
+#define STACK_POOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Back the stacks with transparent huge pages.
+ */
+#define STACK_POOL_HUGEPAGES 0x1
+
+/**
+ * @brief Touch every page of a stack when it is mapped.
+ */
+#define STACK_POOL_PREFAULT 0x2
+
+/**
+ * @brief Alignment and granularity of a stack backed by huge pages.
+ */
+#define STACK_POOL_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * @brief Geometry of the stacks of a pool.
+ */
+typedef struct {
+    size_t stack_size;              /**< Usable size; rounded up to pages, or to huge pages with `STACK_POOL_HUGEPAGES`. */
+    size_t guard_size;              /**< Inaccessible region below each stack; rounded up to pages, 0 for none. */
+    unsigned int flags;             /**< `STACK_POOL_HUGEPAGES` and `STACK_POOL_PREFAULT`. */
+} stack_pool_config_t;
+
+/**
+ * @brief A stack of a pool.
+ */
+typedef struct pooled_stack {
+    void *mapping;                  /**< Start of the mapping, guard included. */
+    void *base;                     /**< Lowest usable address of the stack. */
+    struct pooled_stack *next;      /**< Next free stack of the pool. */
+} pooled_stack_t;
+
+/**
+ * @brief Counters of a pool.
+ */
+typedef struct {
+    uint64_t mapped;                /**< Stacks mapped. */
+    uint64_t reused;                /**< Stacks handed out again from the free list. */
+    uint64_t free;                  /**< Stacks in the free list. */
+    uint64_t mapped_bytes;          /**< Bytes mapped, guards included. */
+} stack_pool_stats_t;
+
+/**
+ * @brief A pool of stacks of one geometry.
+ */
+typedef struct {
+    stack_pool_config_t config;     /**< Geometry, with the sizes rounded. */
+    size_t mapping_size;            /**< Size of the mapping of one stack. */
+    pthread_mutex_t lock;           /**< Protects the free list and the counters. */
+    pooled_stack_t *free;           /**< Stacks given back, most recently used first. */
+    stack_pool_stats_t stats;       /**< Counters. */
+} stack_pool_t;
+
+/**
+ * @brief Initializes a pool.
+ * @param pool The pool.
+ * @param config The geometry of its stacks.
+ * @return Returns 1 on success, 0 if the stack size is below `PTHREAD_STACK_MIN`.
+ */
+int stack_pool_init(stack_pool_t *pool, const stack_pool_config_t *config);
+
+/**
+ * @brief Takes a stack from a pool, mapping a new one if the free list is empty.
+ * @param pool The pool.
+ * @return Returns the stack, or `NULL` if it cannot be mapped.
+ */
+pooled_stack_t *stack_pool_get(stack_pool_t *pool);
+
+/**
+ * @brief Gives a stack back to its pool.
+ * @param pool The pool.
+ * @param stack The stack; no thread may run on it any more.
+ */
+void stack_pool_put(stack_pool_t *pool, pooled_stack_t *stack);
+
+/**
+ * @brief Returns the usable size of the stacks of a pool.
+ * @param pool The pool.
+ */
+size_t stack_pool_stack_size(const stack_pool_t *pool);
+
+/**
+ * @brief Copies the counters of a pool.
+ * @param pool The pool.
+ * @param stats Receives the counters.
+ */
+void stack_pool_get_stats(stack_pool_t *pool, stack_pool_stats_t *stats);
+
+/**
+ * @brief Unmaps the free stacks of a pool and releases it.
+ * @param pool The pool; every stack it handed out must have been given back.
+ */
+void stack_pool_destroy(stack_pool_t *pool);
+
+#endif /* STACK_POOL_H */
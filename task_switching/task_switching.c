@@ -0,0 +1,621 @@
+/**
+ * @file task_switching.c
+ * @brief Implementation of the task API, backed by kernel threads or by user-space contexts.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details In the user-context backend every task is a user-space context with its own stack. A few carrier pthreads,
+ *          pinned to their own CPUs, switch into ready tasks; a task runs until it calls `task_yield` or returns, which switches back to its
+ *          carrier. Stopping a task only raises its stop request: the carrier parks the task instead of re-queuing it,
+ *          so a stop/resume pair costs two context switches and no signal.
+ *
+ *          Every carrier owns a work-stealing deque of the tasks that yielded on it and an inbox for the tasks resumed
+ *          by other threads. A resumed task goes to the inbox of the carrier it last ran on, so it finds its cache
+ *          warm; a carrier that runs out of work steals from the others before it parks.
+ */
+
+/*******************************************************************
+ * Includes
+ *******************************************************************/
+#define _GNU_SOURCE
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <string.h>
+#include "task_switching.h"
+
+/*******************************************************************
+ * Types
+ *******************************************************************/
+/**
+ * @brief Task of the user-context backend.
+ */
+typedef struct {
+    thread_control_block_t tcb;     /**< State machine shared with the kernel-thread backend. */
+    user_context_t context;         /**< Saved context of the task. */
+    user_context_t *carrier;        /**< Context of the carrier the task last ran on. */
+    unsigned int home;              /**< Index of the carrier the task last ran on. */
+    void *stack;                    /**< Stack mapping, including the guard page. */
+    _Atomic uint32_t finished;      /**< Set once the body has returned. */
+} task_t;
+
+/**
+ * @brief Carrier pthread of the user-context backend and its run queues.
+ * @details The counters are written by the carrier only and read by `get_carrier_stats`.
+ */
+typedef struct {
+    ws_deque_t deque;                       /**< Tasks that yielded on this carrier; stealable. */
+    lockfree_queue_t inbox;                 /**< Tasks resumed or created for this carrier by other threads. */
+    pthread_t thread;                       /**< The carrier pthread. */
+    unsigned int index;                     /**< Index of the carrier. */
+    int node;                               /**< NUMA node the carrier allocates from, or -1 if it is not pinned. */
+    unsigned int next_victim;               /**< Carrier to steal from next. */
+    _Atomic uint64_t tasks_run;             /**< Number of times a task was switched in. */
+    _Atomic uint64_t steals;                /**< Number of tasks taken from other carriers. */
+    _Atomic uint64_t idle_ns;               /**< Time spent parked without work. */
+} carrier_t;
+
+/*******************************************************************
+ * Static Global Variables
+ *******************************************************************/
+/**
+ * @brief Backend selected by `init_tasks`.
+ */
+static task_backend_t task_backend;
+
+/**
+ * @brief Tasks of the user-context backend.
+ */
+static task_t tasks[NUMBER_OF_THREADS];
+
+/**
+ * @brief Futex word bumped whenever a task is queued; idle carriers park on it.
+ */
+static _Atomic uint32_t ready_sequence = 0;
+
+/**
+ * @brief Number of carriers parked on `ready_sequence`, so queuing only pays for a wake when one is idle.
+ */
+static _Atomic uint32_t sleeping_carriers = 0;
+
+/**
+ * @brief Number of tasks whose body has not returned yet; the carriers exit when it drops to zero.
+ */
+static _Atomic uint32_t live_tasks = 0;
+
+/**
+ * @brief Carriers of the user-context backend.
+ */
+static carrier_t *carriers = NULL;
+
+/**
+ * @brief Number of carriers.
+ */
+static unsigned int carrier_count = 0;
+
+/**
+ * @brief Time the carriers were started, in nanoseconds.
+ */
+static uint64_t carriers_start_ns;
+
+/**
+ * @brief Body run by every task and its argument.
+ */
+static thread_body_t task_body;
+static void *task_arg;
+
+/**
+ * @brief Task running on the calling carrier, or `NULL`.
+ */
+static __thread task_t *current_task = NULL;
+
+/* Threads created by the kernel-thread backend */
+extern pthread_t threads[NUMBER_OF_THREADS];
+
+/* Thread ID of the main thread */
+extern pthread_t main_thread;
+
+/*******************************************************************
+ * Static Functions
+ *******************************************************************/
+
+/**
+ * @brief Makes a task ready on the carrier it last ran on and wakes an idle carrier if there is one.
+ * @param task The task to queue.
+ * @details Any carrier may take the task from the inbox if its home carrier is busy.
+ */
+static void make_ready(task_t *task)
+{
+    lockfree_queue_enqueue(&carriers[task->home].inbox, task);
+    atomic_fetch_add(&ready_sequence, 1);
+    if (atomic_load(&sleeping_carriers) != 0)
+    {
+        futex_wake(&ready_sequence, 1);
+    }
+}
+
+/**
+ * @brief Parks a task instead of running it if a stop has been requested.
+ * @param task The task, which is not queued and not running.
+ * @return Returns 1 if the task was parked, otherwise 0.
+ * @details Only the carrier that holds the task touches `stops_served`, and the queue hand-off orders it between carriers.
+ */
+static int park_if_requested(task_t *task)
+{
+    if (atomic_load_explicit(&task->tcb.stop_requests, memory_order_acquire) == task->tcb.stops_served)
+    {
+        return 0;
+    }
+
+    task->tcb.stops_served++;
+    atomic_store_explicit(&task->tcb.stop_ack, SIGNAL_HANDLED, memory_order_release);
+    futex_wake(&task->tcb.stop_ack, 1);
+
+    return 1;
+}
+
+/**
+ * @brief Releases a task whose body has returned.
+ * @param task The task.
+ * @details Like a kernel thread that exits, the task moves to EXITED and releases a controller waiting to stop it.
+ */
+static void finish_task(task_t *task)
+{
+    atomic_exchange(&task->tcb.state, THREAD_STATE_EXITED);
+    atomic_store(&task->tcb.stop_ack, SIGNAL_THREAD_EXITED);
+    futex_wake(&task->tcb.stop_ack, 1);
+
+    munmap(task->stack, TASK_STACK_SIZE + (size_t)sysconf(_SC_PAGESIZE));
+    task->stack = NULL;
+
+    /* The last task releases every carrier */
+    if (atomic_fetch_sub(&live_tasks, 1) == 1)
+    {
+        atomic_fetch_add(&ready_sequence, 1);
+        futex_wake(&ready_sequence, INT32_MAX);
+    }
+}
+
+/**
+ * @brief First function run on the stack of a task.
+ * @param arg The task.
+ */
+static void task_entry(void *arg)
+{
+    task_t *task = (task_t *)arg;
+
+    task_body(task_arg != NULL ? task_arg : (void *)(intptr_t)task->tcb.index);
+
+    /* Hand the task back to its carrier for the last time */
+    atomic_store(&task->finished, 1);
+    user_context_switch(&task->context, task->carrier);
+}
+
+/**
+ * @brief Finds the next task for a carrier.
+ * @param carrier The carrier.
+ * @return Returns a task, or `NULL` if no carrier has work.
+ * @details Looks at the carrier's own inbox, then its deque, then steals from the other carriers in turn.
+ */
+static task_t *find_task(carrier_t *carrier)
+{
+    void *entry;
+    int status;
+
+    /* Resumed tasks first: yielding tasks keep the deque full, so the inbox would otherwise starve */
+    if (lockfree_queue_dequeue(&carrier->inbox, &entry))
+    {
+        return (task_t *)entry;
+    }
+    do
+    {
+        status = ws_deque_steal(&carrier->deque, &entry);
+    } while (status == WS_DEQUE_LOST);
+    if (status == WS_DEQUE_TAKEN)
+    {
+        return (task_t *)entry;
+    }
+
+    /* Then steal, starting with the last victim since it had spare work */
+    for (unsigned int i = 0; i < carrier_count; i++)
+    {
+        carrier_t *victim = &carriers[(carrier->next_victim + i) % carrier_count];
+        if (victim == carrier)
+        {
+            continue;
+        }
+        if (ws_deque_steal(&victim->deque, &entry) == WS_DEQUE_TAKEN ||
+            lockfree_queue_dequeue(&victim->inbox, &entry))
+        {
+            carrier->next_victim = victim->index;
+            atomic_fetch_add_explicit(&carrier->steals, 1, memory_order_relaxed);
+            return (task_t *)entry;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Main loop of a carrier pthread.
+ * @param arg The carrier.
+ * @return Returns `NULL` once every task has finished.
+ */
+static void *carrier_main(void *arg)
+{
+    carrier_t *carrier = (carrier_t *)arg;
+    user_context_t self;
+    task_t *task;
+    uint32_t sequence;
+
+    /* Keep the memory of a pinned carrier on its node */
+    if (carrier->node >= 0)
+    {
+        topology_prefer_node(carrier->node);
+    }
+
+    while (atomic_load(&live_tasks) != 0)
+    {
+        sequence = atomic_load(&ready_sequence);
+        task = find_task(carrier);
+        if (task == NULL)
+        {
+            /* Announce the sleep, then look again so a task queued meanwhile is not missed */
+            atomic_fetch_add(&sleeping_carriers, 1);
+            task = find_task(carrier);
+            if (task == NULL)
+            {
+                uint64_t idle_start = timer_now_ns();
+                if (atomic_load(&live_tasks) != 0)
+                {
+                    futex_wait(&ready_sequence, sequence, NULL);
+                }
+                atomic_fetch_add_explicit(&carrier->idle_ns, timer_now_ns() - idle_start, memory_order_relaxed);
+                atomic_fetch_sub(&sleeping_carriers, 1);
+                continue;
+            }
+            atomic_fetch_sub(&sleeping_carriers, 1);
+        }
+
+        if (park_if_requested(task))
+        {
+            continue;
+        }
+
+        /* Run the task until it yields or finishes */
+        task->carrier = &self;
+        task->home = carrier->index;
+        current_task = task;
+        atomic_fetch_add_explicit(&carrier->tasks_run, 1, memory_order_relaxed);
+        user_context_switch(&self, &task->context);
+        current_task = NULL;
+
+        if (atomic_load(&task->finished))
+        {
+            finish_task(task);
+        }
+        else if (!park_if_requested(task))
+        {
+            ws_deque_push(&carrier->deque, task);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the user-context backend.
+ * @param count Number of carrier pthreads.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ * @details Carrier `i` is pinned according to `CARRIER_PLACEMENT`, so its deque stays with the caches of one CPU
+ *          and a task resumed on its home carrier finds them warm.
+ */
+static int init_user_context_tasks(unsigned int count)
+{
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    cpu_topology_t *topology;
+    pthread_attr_t attr;
+    cpu_set_t cpus;
+
+    if (count == 0)
+    {
+        return ERROR;
+    }
+
+    /* Tasks log through the drain thread rather than stdio, which a carrier may hold when it is stopped */
+    async_log_start(STDOUT_FILENO);
+
+    /* Every queue can hold every task, so queuing never fails */
+    carriers = (carrier_t *)aligned_alloc(_Alignof(carrier_t), count * sizeof(carrier_t));
+    if (carriers == NULL)
+    {
+        return ERROR;
+    }
+    memset(carriers, 0, count * sizeof(carrier_t));
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!ws_deque_init(&carriers[i].deque, NUMBER_OF_THREADS) ||
+            !lockfree_queue_init(&carriers[i].inbox, NUMBER_OF_THREADS))
+        {
+            return ERROR;
+        }
+        carriers[i].index = i;
+        carriers[i].next_victim = i;
+    }
+
+    for (unsigned int i = 0; i < NUMBER_OF_THREADS; i++)
+    {
+        task_t *task = &tasks[i];
+
+        /* Stack with an inaccessible guard page below it */
+        task->stack = mmap(NULL, TASK_STACK_SIZE + page_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        if (task->stack == MAP_FAILED)
+        {
+            LOG_ERROR("Error in allocating the stack of task[%u]\n", i);
+            return ERROR;
+        }
+        mprotect(task->stack, page_size, PROT_NONE);
+
+        tcb_init(&task->tcb, i);
+        STATS_ENTER(&task->tcb, 0);
+        atomic_init(&task->finished, 0);
+        user_context_init(&task->context, (char *)task->stack + page_size, TASK_STACK_SIZE, task_entry, task);
+        tcb_set_state(&task->tcb, THREAD_STATE_RUNNING);
+
+        /* Spread the tasks over the carriers */
+        task->home = i % count;
+        lockfree_queue_enqueue(&carriers[task->home].inbox, task);
+    }
+    atomic_store(&live_tasks, NUMBER_OF_THREADS);
+
+    /* The topology is large, so it is read on the heap; carriers run unpinned if it cannot be read */
+    topology = (cpu_topology_t *)malloc(sizeof(cpu_topology_t));
+    if (topology != NULL && !topology_detect(topology))
+    {
+        LOG_WARN("Cannot read the CPU topology, carriers are not pinned\n");
+        free(topology);
+        topology = NULL;
+    }
+
+    /* Carriers that fail to start leave their queues to be stolen from */
+    carrier_count = count;
+    carriers_start_ns = timer_now_ns();
+    unsigned int started = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        int status;
+
+        /* Pin the carrier before it runs, so its stack is first touched on its own node */
+        pthread_attr_init(&attr);
+        carriers[i].node = -1;
+        if (topology != NULL &&
+            topology_place(topology, CARRIER_PLACEMENT, NULL, 0, i, &cpus, &carriers[i].node))
+        {
+            pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+        }
+        status = pthread_create(&carriers[i].thread, &attr, carrier_main, &carriers[i]);
+        pthread_attr_destroy(&attr);
+        if (status != 0)
+        {
+            LOG_ERROR("Error in creating carrier[%u]\n", i);
+            carriers[i].thread = 0;
+            continue;
+        }
+        started++;
+    }
+    free(topology);
+
+    return started != 0 ? !ERROR : ERROR;
+}
+
+/*******************************************************************
+ * Functions
+ *******************************************************************/
+
+/**
+ * @brief Starts the tasks.
+ * @param backend The backend to run the tasks on.
+ * @param count Number of carrier pthreads of the user-context backend; ignored by the kernel-thread backend.
+ * @param body The function run by every task. It receives `arg`, or the task ID if `arg` is `NULL`.
+ * @param arg The argument passed to `body`.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ */
+int init_tasks(task_backend_t backend, unsigned int count, thread_body_t body, void *arg)
+{
+    task_backend = backend;
+    task_body = body;
+    task_arg = arg;
+
+    if (backend == TASK_BACKEND_USER_CONTEXT)
+    {
+        return init_user_context_tasks(count);
+    }
+
+    /* Kernel-thread mode: the existing pthread switching core */
+    main_thread = pthread_self();
+    init_signals();
+    init_threads_with_body(body, arg);
+
+    return !ERROR;
+}
+
+/**
+ * @brief Stops a task and waits until it is suspended.
+ * @param task_id The ID of the task, between 0 and `NUMBER_OF_THREADS - 1`.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ * @details Follows the same RUNNING -> STOPPING -> STOPPED protocol as `stop_thread`, with the carrier acknowledging
+ *          on the task's behalf.
+ */
+int stop_task(unsigned int task_id)
+{
+    thread_state_t state;
+    task_t *task;
+
+    if (task_id >= NUMBER_OF_THREADS)
+    {
+        LOG_WARN("Task is not managed\n");
+        return ERROR;
+    }
+
+    if (task_backend == TASK_BACKEND_KERNEL_THREADS)
+    {
+        return stop_thread(threads[task_id]);
+    }
+
+    task = &tasks[task_id];
+
+    /* Take ownership of the transition */
+    if (!tcb_try_transition(&task->tcb, THREAD_STATE_RUNNING, THREAD_STATE_STOPPING, &state))
+    {
+        LOG_WARN(state == THREAD_STATE_STOPPED ? "Task is already stopped\n" : "Task is busy\n");
+        return ERROR;
+    }
+
+    /* Clear the acknowledgement, then make sure the task did not finish in the meantime */
+    atomic_store(&task->tcb.stop_ack, SIGNAL_UNHANDLED);
+    if (tcb_get_state(&task->tcb) == THREAD_STATE_EXITED)
+    {
+        LOG_WARN("Task has exited\n");
+        return ERROR;
+    }
+
+    /* Raise the request and wait for the carrier to park the task */
+    atomic_fetch_add_explicit(&task->tcb.stop_requests, 1, memory_order_release);
+    if (futex_await_change(&task->tcb.stop_ack, SIGNAL_UNHANDLED) == SIGNAL_THREAD_EXITED)
+    {
+        LOG_WARN("Task has exited\n");
+        return ERROR;
+    }
+
+    STATS_COUNT(&task->tcb, stops);
+    STATS_ENTER(&task->tcb, 1);
+    tcb_set_state(&task->tcb, THREAD_STATE_STOPPED);
+
+    return !ERROR;  /* Return success */
+}
+
+/**
+ * @brief Resumes a stopped task.
+ * @param task_id The ID of the task.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ */
+int resume_task(unsigned int task_id)
+{
+    thread_state_t state;
+    task_t *task;
+
+    if (task_id >= NUMBER_OF_THREADS)
+    {
+        LOG_WARN("Task is not managed\n");
+        return ERROR;
+    }
+
+    if (task_backend == TASK_BACKEND_KERNEL_THREADS)
+    {
+        return resume_thread(threads[task_id]);
+    }
+
+    task = &tasks[task_id];
+
+    /* Take ownership of the transition */
+    if (!tcb_try_transition(&task->tcb, THREAD_STATE_STOPPED, THREAD_STATE_RESUMING, &state))
+    {
+        LOG_WARN(state == THREAD_STATE_RUNNING ? "Task is already running\n" : "Task is busy\n");
+        return ERROR;
+    }
+
+    STATS_COUNT(&task->tcb, resumes);
+    STATS_ENTER(&task->tcb, 0);
+    tcb_set_state(&task->tcb, THREAD_STATE_RUNNING);
+    make_ready(task);
+
+    return !ERROR;  /* Return success */
+}
+
+/**
+ * @brief Gives up the processor from inside a task.
+ */
+void task_yield()
+{
+    task_t *task = current_task;
+
+    if (task == NULL)
+    {
+        /* Kernel thread, or a thread that is not a task */
+        safepoint();
+        sched_yield();
+        return;
+    }
+
+    /* The task may continue on another carrier, so nothing thread-local is used after the switch */
+    user_context_switch(&task->context, task->carrier);
+}
+
+/**
+ * @brief Waits until every task has returned from its body, then releases the backend.
+ */
+void wait_tasks()
+{
+    if (task_backend != TASK_BACKEND_USER_CONTEXT)
+    {
+        return;
+    }
+
+    for (unsigned int i = 0; i < carrier_count; i++)
+    {
+        if (carriers[i].thread != 0)
+        {
+            pthread_join(carriers[i].thread, NULL);
+        }
+    }
+
+    /* Only once every carrier is gone, since a carrier may still look into another's queues */
+    for (unsigned int i = 0; i < carrier_count; i++)
+    {
+        ws_deque_destroy(&carriers[i].deque);
+        lockfree_queue_destroy(&carriers[i].inbox);
+    }
+
+    free(carriers);
+    carriers = NULL;
+    carrier_count = 0;
+}
+
+/**
+ * @brief Returns the number of carriers of the user-context backend.
+ * @return Returns the number of carriers, or 0 for the kernel-thread backend.
+ */
+unsigned int get_carrier_count()
+{
+    return carrier_count;
+}
+
+/**
+ * @brief Reads the scheduling counters of a carrier.
+ * @param carrier The index of the carrier.
+ * @param stats Receives the counters.
+ * @return Returns `!ERROR` on success, `ERROR` if there is no such carrier.
+ * @details The utilization is the share of the carrier's lifetime it did not spend parked without work.
+ */
+int get_carrier_stats(unsigned int carrier, carrier_stats_t *stats)
+{
+    uint64_t uptime;
+
+    if (carrier >= carrier_count)
+    {
+        return ERROR;
+    }
+
+    uptime = timer_now_ns() - carriers_start_ns;
+    stats->tasks_run = atomic_load_explicit(&carriers[carrier].tasks_run, memory_order_relaxed);
+    stats->steals = atomic_load_explicit(&carriers[carrier].steals, memory_order_relaxed);
+    stats->idle_ns = atomic_load_explicit(&carriers[carrier].idle_ns, memory_order_relaxed);
+    stats->queued = ws_deque_size(&carriers[carrier].deque);
+    stats->utilization = uptime > 0 ? 1.0 - (double)stats->idle_ns / (double)uptime : 0.0;
+    if (stats->utilization < 0.0)
+    {
+        stats->utilization = 0.0;
+    }
+
+    return !ERROR;
+}
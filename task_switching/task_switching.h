@@ -0,0 +1,95 @@
+/**
+ * @file task_switching.h
+ * @brief Header file for the task API, backed by kernel threads or by user-space contexts.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#ifndef __TASK_SWITCHING__
+#define __TASK_SWITCHING__
+
+#include "../pthreads_switching/pthreads_switching.h"
+#include "../user_context/user_context.h"
+#include "../work_stealing_deque/work_stealing_deque.h"
+
+#define TASK_STACK_SIZE (64 * 1024)  /**< Stack size of a task in the user-context backend. */
+
+#ifndef CARRIER_PLACEMENT
+#define CARRIER_PLACEMENT PLACEMENT_SCATTER  /**< How carriers are pinned to CPUs; carrier `i` takes placement `i`. */
+#endif
+
+/**
+ * @brief Backend that runs the tasks.
+ */
+typedef enum {
+    TASK_BACKEND_KERNEL_THREADS = 0,    /**< One pthread per task, suspended with `stop_thread`/`resume_thread`. */
+    TASK_BACKEND_USER_CONTEXT           /**< M:N: tasks are user-space contexts multiplexed on a few carrier pthreads. */
+} task_backend_t;
+
+/**
+ * @brief Scheduling counters of one carrier of the user-context backend.
+ */
+typedef struct {
+    uint64_t tasks_run;         /**< Number of times a task was switched in. */
+    uint64_t steals;            /**< Number of tasks taken from other carriers' queues. */
+    uint64_t idle_ns;           /**< Time spent parked without work. */
+    size_t queued;              /**< Tasks currently in the carrier's deque. */
+    double utilization;         /**< Share of the carrier's lifetime spent with work, between 0 and 1. */
+} carrier_stats_t;
+
+/**
+ * @brief Starts the tasks.
+ * @param backend The backend to run the tasks on.
+ * @param count Number of carrier pthreads of the user-context backend; ignored by the kernel-thread backend.
+ * @param body The function run by every task. It receives `arg`, or the task ID if `arg` is `NULL`.
+ * @param arg The argument passed to `body`.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ * @details `NUMBER_OF_THREADS` tasks are started. The kernel-thread backend is `init_signals` followed by
+ *          `init_threads_with_body` and must be called from the main thread.
+ */
+int init_tasks(task_backend_t backend, unsigned int count, thread_body_t body, void *arg);
+
+/**
+ * @brief Stops a task and waits until it is suspended.
+ * @param task_id The ID of the task, between 0 and `NUMBER_OF_THREADS - 1`.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ * @details User-context tasks are suspended at their next `task_yield`, or before they are switched in again.
+ *          Must not be called from a task of the user-context backend.
+ */
+int stop_task(unsigned int task_id);
+
+/**
+ * @brief Resumes a stopped task.
+ * @param task_id The ID of the task.
+ * @return Returns `!ERROR` on success, `ERROR` on failure.
+ */
+int resume_task(unsigned int task_id);
+
+/**
+ * @brief Gives up the processor from inside a task.
+ * @details A user-context task switches back to its carrier, which queues it behind the carrier's other ready tasks,
+ *          or parks it if a stop is pending. For kernel threads this is a `safepoint` followed by `sched_yield`.
+ */
+void task_yield();
+
+/**
+ * @brief Waits until every task has returned from its body, then releases the backend.
+ * @details Only supported by the user-context backend; kernel threads are joined by the caller.
+ */
+void wait_tasks();
+
+/**
+ * @brief Returns the number of carriers of the user-context backend.
+ * @return Returns the number of carriers, or 0 for the kernel-thread backend.
+ */
+unsigned int get_carrier_count();
+
+/**
+ * @brief Reads the scheduling counters of a carrier.
+ * @param carrier The index of the carrier.
+ * @param stats Receives the counters.
+ * @return Returns `!ERROR` on success, `ERROR` if there is no such carrier.
+ */
+int get_carrier_stats(unsigned int carrier, carrier_stats_t *stats);
+
+#endif /* __TASK_SWITCHING__ */
@@ -0,0 +1,98 @@
+/**
+ * @file thread_control_block.c
+ * @brief Implementation of thread control blocks and their atomic state machine.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "thread_control_block.h"
+
+/**
+ * @brief Initializes a control block.
+ * @param tcb The control block to initialize.
+ * @param index The index of the block in its table.
+ * @details The block starts unused and outside every queue, with its stop acknowledgement and statistics cleared.
+ */
+void tcb_init(thread_control_block_t *tcb, unsigned int index)
+{
+    tcb->index = index;
+    atomic_init(&tcb->state, THREAD_STATE_UNUSED);
+    atomic_init(&tcb->stop_ack, 0);
+    atomic_init(&tcb->stop_latch, NULL);
+    atomic_init(&tcb->stop_detached, 0);
+    tcb->stop_ack_ns = 0;
+    atomic_init(&tcb->queued, 0);
+    atomic_init(&tcb->cooperative, 0);
+    atomic_init(&tcb->stop_requests, 0);
+    atomic_init(&tcb->resumes, 0);
+    tcb->stops_served = 0;
+    atomic_init(&tcb->handoffs, 0);
+    atomic_init(&tcb->handoff_parked, 0);
+    tcb->handoffs_taken = 0;
+    atomic_init(&tcb->commands_sent, 0);
+    atomic_init(&tcb->commands_acked, 0);
+    atomic_init(&tcb->commands_waiting, 0);
+    tcb->command_stopped = 0;
+    timer_entry_init(&tcb->stop_timer);
+    timer_entry_init(&tcb->resume_timer);
+    atomic_init(&tcb->kernel_tid, 0);
+    memset(&tcb->periodic, 0, sizeof(tcb->periodic));
+    timer_entry_init(&tcb->periodic.release_timer);
+#ifdef POSIX_TIMER
+    tcb->priority = 0;
+    tcb->scheduled = 0;
+    tcb->ready_next = NULL;
+#endif
+#if THREAD_STATS
+    stats_reset(&tcb->stats);
+#endif
+}
+
+/**
+ * @brief Reads the state of a control block.
+ * @param tcb The control block.
+ * @return Returns the current state.
+ */
+thread_state_t tcb_get_state(thread_control_block_t *tcb)
+{
+    return atomic_load_explicit(&tcb->state, memory_order_acquire);
+}
+
+/**
+ * @brief Atomically moves a control block from one state to another.
+ * @param tcb The control block.
+ * @param from The state the block must be in.
+ * @param to The new state.
+ * @param observed Receives the state found in the block when the transition fails. May be `NULL`.
+ * @return Returns 1 if the transition happened, otherwise 0.
+ * @details Only one of several racing controllers can win the CAS, which gives it ownership of the transition.
+ */
+int tcb_try_transition(thread_control_block_t *tcb, thread_state_t from, thread_state_t to, thread_state_t *observed)
+{
+    thread_state_t expected = from;
+
+    if (atomic_compare_exchange_strong_explicit(&tcb->state, &expected, to,
+                                                memory_order_acq_rel, memory_order_acquire))
+    {
+        return 1;
+    }
+
+    if (observed != NULL)
+    {
+        *observed = expected;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Publishes a new state of a control block owned by the caller.
+ * @param tcb The control block.
+ * @param state The new state.
+ */
+void tcb_set_state(thread_control_block_t *tcb, thread_state_t state)
+{
+    atomic_store_explicit(&tcb->state, state, memory_order_release);
+}
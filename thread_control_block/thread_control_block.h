@@ -0,0 +1,142 @@
+/**
+ * @file thread_control_block.h
+ * @brief Header file for thread control blocks and their atomic state machine.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#ifndef THREAD_CONTROL_BLOCK_H
+#define THREAD_CONTROL_BLOCK_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <sys/types.h>
+#include "../futex/futex.h"
+#include "../thread_stats/thread_stats.h"
+#include "../timer_wheel/timer_wheel.h"
+
+/**
+ * @brief Scheduling state of a managed thread.
+ * @details A stop moves a thread RUNNING -> STOPPING -> STOPPED and a resume STOPPED -> RESUMING -> RUNNING.
+ *          The transitional states are owned by the controller that won the CAS into them. An exiting thread
+ *          moves itself to EXITED from any state. A pooled thread whose body has returned waits in IDLE for new work.
+ */
+typedef enum {
+    THREAD_STATE_UNUSED = 0,    /**< The control block is not bound to a thread. */
+    THREAD_STATE_RUNNING,       /**< The thread is running. */
+    THREAD_STATE_STOPPING,      /**< A stop request is in flight. */
+    THREAD_STATE_STOPPED,       /**< The thread is suspended in the stop handler. */
+    THREAD_STATE_RESUMING,      /**< A resume request is in flight. */
+    THREAD_STATE_EXITED,        /**< The thread has exited. */
+    THREAD_STATE_IDLE           /**< The thread finished its body and waits for new work. */
+} thread_state_t;
+
+/**
+ * @brief State of the current job of a periodic thread.
+ */
+typedef enum {
+    PERIODIC_NONE = 0,          /**< The thread is not periodic. */
+    PERIODIC_WAITING,           /**< The job is complete; the thread waits in `wait_next_period` for its next release. */
+    PERIODIC_READY,             /**< The job is released and waits for the CPU. */
+    PERIODIC_RUNNING,           /**< The job runs. */
+    PERIODIC_THROTTLED          /**< The job exhausted its budget; the thread is stopped until its next release. */
+} periodic_state_t;
+
+/**
+ * @brief Timing of a periodic thread and the state of its current job.
+ * @details Owned by the periodic scheduler, which serializes every field except the counters; those are atomic so
+ *          they can be read at any time, and bumped from the SIGXCPU handler under `SCHED_DEADLINE`.
+ */
+typedef struct {
+    uint64_t period_ns;                     /**< Time between two releases. */
+    uint64_t budget_ns;                     /**< CPU time a job may use. */
+    uint64_t deadline_ns;                   /**< Time from a release by which the job must be complete. */
+    uint64_t release_ns;                    /**< Release time of the current job. */
+    uint64_t deadline_at_ns;                /**< Absolute deadline of the current job. */
+    uint64_t budget_used_ns;                /**< CPU time used by the current job before its latest dispatch. */
+    uint64_t dispatched_ns;                 /**< Time of the latest dispatch. */
+    periodic_state_t state;                 /**< State of the current job. */
+    uint32_t held;                          /**< Non-zero while the scheduler keeps the thread stopped. */
+    _Atomic uint32_t dispatches;            /**< Futex word the thread waits on between jobs; bumped by each dispatch. */
+    _Atomic uint64_t jobs;                  /**< Jobs completed. */
+    _Atomic uint64_t overruns;              /**< Jobs that exhausted their budget. */
+    _Atomic uint64_t deadline_misses;       /**< Jobs not complete by their deadline. */
+    _Atomic uint64_t preemptions;           /**< Times a job was stopped for a more urgent one. */
+    _Atomic uint64_t max_response_ns;       /**< Longest time from a release to the completion of its job. */
+    timer_entry_t release_timer;            /**< Timer of the next release. */
+    struct thread_control_block *next;      /**< Next thread of the periodic set. */
+} periodic_task_t;
+
+/**
+ * @brief Thread control block.
+ * @details One block exists per managed thread. Every field that controllers race on is atomic, so
+ *          independent threads can be stopped and resumed in parallel without a global lock.
+ */
+typedef struct thread_control_block {
+    pthread_t thread_id;                    /**< ID of the thread bound to this block. */
+    _Atomic uint32_t kernel_tid;            /**< Futex word: kernel ID of the thread, for the system calls that take one; 0 until it starts. */
+    unsigned int index;                     /**< Index of the block in its table. */
+    _Atomic thread_state_t state;           /**< Current scheduling state. */
+    _Atomic uint32_t stop_ack;              /**< Outcome of the last stop request, set by the stop handler. */
+    _Atomic(countdown_latch_t *) stop_latch;    /**< Latch to count down once the stop is acknowledged, or `NULL`. */
+    _Atomic uint32_t stop_detached;         /**< 1 while a stop no controller waits for is in flight, 2 once a resume waits for it. */
+    uint64_t stop_ack_ns;                   /**< Monotonic time of the last acknowledgement, published by the latch. */
+    _Atomic uint32_t queued;                /**< Bit `1 << state` is set while the block sits in that state's queue. */
+    _Atomic uint32_t cooperative;           /**< Non-zero once the thread polls safepoints instead of taking stop signals. */
+    _Atomic uint32_t stop_requests;         /**< Number of cooperative stop requests issued to the thread. */
+    _Atomic uint32_t resumes;               /**< Futex word the thread parks on at a safepoint; bumped by every cooperative resume. */
+    uint32_t stops_served;                  /**< Number of stop requests the thread has served; owned by the thread. */
+    _Atomic uint32_t handoffs;              /**< Futex word of directed handoffs; bumped by every handoff to the thread. */
+    _Atomic uint32_t handoff_parked;        /**< Non-zero while the thread sleeps on `handoffs`. */
+    uint32_t handoffs_taken;                /**< Number of handoffs the thread has consumed; owned by the thread. */
+    _Atomic uint32_t commands_sent;         /**< Sequence number of the last control command sent to the thread. */
+    _Atomic uint32_t commands_acked;        /**< Futex word: sequence number of the last command the thread handled. */
+    _Atomic uint32_t commands_waiting;      /**< Non-zero while a controller sleeps on `commands_acked`. */
+    volatile sig_atomic_t command_stopped;  /**< Non-zero while the control handler holds the thread stopped; owned by the thread. */
+    timer_entry_t stop_timer;               /**< Timer of a pending `stop_after`. */
+    timer_entry_t resume_timer;             /**< Timer of a pending `resume_after` or `sleep_thread`. */
+    periodic_task_t periodic;               /**< Timing of the thread under a periodic policy. */
+#ifdef POSIX_TIMER
+    unsigned int priority;                  /**< Fixed priority under the tick scheduler; higher runs first. */
+    uint32_t scheduled;                     /**< Non-zero while the tick scheduler owns the thread. */
+    struct thread_control_block *ready_next;    /**< Next block of the same priority in the ready queue. */
+#endif
+#if THREAD_STATS
+    thread_stats_t stats;                   /**< Scheduling statistics, on their own cache lines. */
+#endif
+} thread_control_block_t;
+
+/**
+ * @brief Initializes a control block.
+ * @param tcb The control block to initialize.
+ * @param index The index of the block in its table.
+ */
+void tcb_init(thread_control_block_t *tcb, unsigned int index);
+
+/**
+ * @brief Reads the state of a control block.
+ * @param tcb The control block.
+ * @return Returns the current state.
+ */
+thread_state_t tcb_get_state(thread_control_block_t *tcb);
+
+/**
+ * @brief Atomically moves a control block from one state to another.
+ * @param tcb The control block.
+ * @param from The state the block must be in.
+ * @param to The new state.
+ * @param observed Receives the state found in the block when the transition fails. May be `NULL`.
+ * @return Returns 1 if the transition happened, otherwise 0.
+ */
+int tcb_try_transition(thread_control_block_t *tcb, thread_state_t from, thread_state_t to, thread_state_t *observed);
+
+/**
+ * @brief Publishes a new state of a control block owned by the caller.
+ * @param tcb The control block.
+ * @param state The new state.
+ */
+void tcb_set_state(thread_control_block_t *tcb, thread_state_t state);
+
+#endif /* THREAD_CONTROL_BLOCK_H */
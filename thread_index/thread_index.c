@@ -0,0 +1,315 @@
+/**
+ * @file thread_index.c
+ * @brief Implementation of the hash index from thread IDs to slots of the pool.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details Linear probing over entries of 16 bytes, four to a cache line, so a lookup usually reads one line.
+ *          A writer makes the sequence counter odd, changes the table with relaxed atomic stores and makes the
+ *          counter even again with a release store; a reader that saw the counter change retries, so it never acts
+ *          on a half-updated probe chain.
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+#include "thread_index.h"
+
+/**
+ * @brief Returns the first entry a key probes.
+ * @param index The index.
+ * @param key The key.
+ * @details Fibonacci hashing: thread IDs are aligned addresses, so the low bits alone would cluster.
+ */
+static uint32_t hash_key(const thread_index_t *index, uint64_t key)
+{
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> index->shift);
+}
+
+/**
+ * @brief Starts a change of the table.
+ * @param index The index.
+ */
+static void begin_write(thread_index_t *index)
+{
+    atomic_store_explicit(&index->sequence, atomic_load_explicit(&index->sequence, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * @brief Publishes a change of the table.
+ * @param index The index.
+ */
+static void end_write(thread_index_t *index)
+{
+    atomic_store_explicit(&index->sequence, atomic_load_explicit(&index->sequence, memory_order_relaxed) + 1,
+                          memory_order_release);
+}
+
+/**
+ * @brief Rebuilds the table without its deleted entries.
+ * @param index The index.
+ * @details If the live entries cannot be copied aside, the deleted ones stay; lookups remain correct.
+ */
+static void rebuild(thread_index_t *index)
+{
+    thread_index_entry_t *live = (thread_index_entry_t *)malloc(index->live * sizeof(thread_index_entry_t));
+    uint32_t count = 0;
+
+    if (live == NULL)
+    {
+        return;
+    }
+
+    begin_write(index);
+    for (uint32_t i = 0; i <= index->mask; i++)
+    {
+        uint64_t key = atomic_load_explicit(&index->entries[i].key, memory_order_relaxed);
+        if (key != THREAD_INDEX_EMPTY && key != THREAD_INDEX_DELETED)
+        {
+            atomic_init(&live[count].key, key);
+            atomic_init(&live[count].value, atomic_load_explicit(&index->entries[i].value, memory_order_relaxed));
+            count++;
+        }
+        atomic_store_explicit(&index->entries[i].key, THREAD_INDEX_EMPTY, memory_order_relaxed);
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t key = atomic_load_explicit(&live[i].key, memory_order_relaxed);
+        uint32_t position = hash_key(index, key);
+        while (atomic_load_explicit(&index->entries[position].key, memory_order_relaxed) != THREAD_INDEX_EMPTY)
+        {
+            position = (position + 1) & index->mask;
+        }
+        atomic_store_explicit(&index->entries[position].value, atomic_load_explicit(&live[i].value, memory_order_relaxed),
+                              memory_order_relaxed);
+        atomic_store_explicit(&index->entries[position].key, key, memory_order_relaxed);
+    }
+    index->deleted = 0;
+    end_write(index);
+
+    free(live);
+}
+
+/**
+ * @brief Initializes an index.
+ * @param index The index to initialize.
+ * @param capacity The maximum number of keys.
+ * @return Returns 1 on success, 0 if memory is short.
+ */
+int thread_index_init(thread_index_t *index, uint32_t capacity)
+{
+    uint32_t size = 2, bits = 1;
+
+    while (size < 2 * capacity)
+    {
+        size <<= 1;
+        bits++;
+    }
+
+    index->entries = (thread_index_entry_t *)aligned_alloc(64, size * sizeof(thread_index_entry_t) < 64 ?
+                                                           64 : size * sizeof(thread_index_entry_t));
+    if (index->entries == NULL)
+    {
+        return 0;
+    }
+    for (uint32_t i = 0; i < size; i++)
+    {
+        atomic_init(&index->entries[i].key, THREAD_INDEX_EMPTY);
+        atomic_init(&index->entries[i].value, 0);
+    }
+    index->mask = size - 1;
+    index->shift = 64 - bits;
+    index->live = 0;
+    index->deleted = 0;
+    atomic_init(&index->sequence, 0);
+
+    return 1;
+}
+
+/**
+ * @brief Releases the table of an index.
+ * @param index The index; no lookup may be running.
+ */
+void thread_index_destroy(thread_index_t *index)
+{
+    free(index->entries);
+    index->entries = NULL;
+}
+
+/**
+ * @brief Maps a thread ID to a slot, replacing any slot it was mapped to.
+ * @param index The index.
+ * @param thread The thread ID.
+ * @param value The slot.
+ * @return Returns 1 on success, 0 if the index already holds `capacity` keys.
+ * @details The new key takes the first deleted entry of its probe chain, so churn does not lengthen the chains.
+ */
+int thread_index_insert(thread_index_t *index, pthread_t thread, uint64_t value)
+{
+    uint64_t key = (uint64_t)thread;
+    uint32_t position = hash_key(index, key), free_position = index->mask + 1;
+
+    if (key == THREAD_INDEX_EMPTY || key == THREAD_INDEX_DELETED)
+    {
+        return 0;
+    }
+
+    for (uint32_t probes = 0; probes <= index->mask; probes++, position = (position + 1) & index->mask)
+    {
+        uint64_t current = atomic_load_explicit(&index->entries[position].key, memory_order_relaxed);
+        if (current == key)
+        {
+            begin_write(index);
+            atomic_store_explicit(&index->entries[position].value, value, memory_order_relaxed);
+            end_write(index);
+            return 1;
+        }
+        if (current == THREAD_INDEX_DELETED && free_position > index->mask)
+        {
+            free_position = position;
+        }
+        if (current == THREAD_INDEX_EMPTY)
+        {
+            free_position = free_position > index->mask ? position : free_position;
+            break;
+        }
+    }
+
+    if (free_position > index->mask || 2 * (index->live + 1) > index->mask + 1)
+    {
+        return 0;
+    }
+    if (atomic_load_explicit(&index->entries[free_position].key, memory_order_relaxed) == THREAD_INDEX_DELETED)
+    {
+        index->deleted--;
+    }
+    begin_write(index);
+    atomic_store_explicit(&index->entries[free_position].value, value, memory_order_relaxed);
+    atomic_store_explicit(&index->entries[free_position].key, key, memory_order_relaxed);
+    index->live++;
+    end_write(index);
+
+    return 1;
+}
+
+/**
+ * @brief Removes a thread ID if it is still mapped to a slot.
+ * @param index The index.
+ * @param thread The thread ID.
+ * @param value The slot the thread ID must be mapped to; a thread ID reused by a newer thread stays.
+ */
+void thread_index_remove(thread_index_t *index, pthread_t thread, uint64_t value)
+{
+    uint64_t key = (uint64_t)thread;
+    uint32_t position = hash_key(index, key);
+
+    if (key == THREAD_INDEX_EMPTY || key == THREAD_INDEX_DELETED)
+    {
+        return;
+    }
+
+    for (uint32_t probes = 0; probes <= index->mask; probes++, position = (position + 1) & index->mask)
+    {
+        uint64_t current = atomic_load_explicit(&index->entries[position].key, memory_order_relaxed);
+        if (current == THREAD_INDEX_EMPTY)
+        {
+            return;
+        }
+        if (current == key)
+        {
+            if (atomic_load_explicit(&index->entries[position].value, memory_order_relaxed) != value)
+            {
+                return;
+            }
+            begin_write(index);
+            atomic_store_explicit(&index->entries[position].key, THREAD_INDEX_DELETED, memory_order_relaxed);
+            index->live--;
+            index->deleted++;
+            end_write(index);
+            break;
+        }
+    }
+
+    /* Purge the deleted entries once they fill a quarter of the table */
+    if (4 * index->deleted > index->mask + 1)
+    {
+        rebuild(index);
+    }
+}
+
+/**
+ * @brief Looks up the slot of a thread ID.
+ * @param index The index.
+ * @param thread The thread ID.
+ * @param value Receives the slot.
+ * @return Returns 1 if the thread ID is mapped, otherwise 0.
+ * @details The probe is bounded by the size of the table, so even a read torn by a writer terminates; the sequence
+ *          counter then makes the reader retry.
+ */
+int thread_index_lookup(thread_index_t *index, pthread_t thread, uint64_t *value)
+{
+    uint64_t key = (uint64_t)thread, result = 0;
+    uint32_t sequence;
+    int found;
+
+    if (key == THREAD_INDEX_EMPTY || key == THREAD_INDEX_DELETED)
+    {
+        return 0;
+    }
+
+    do
+    {
+        /* Wait out a writer; it may have been preempted on this CPU */
+        while ((sequence = atomic_load_explicit(&index->sequence, memory_order_acquire)) & 1)
+        {
+            sched_yield();
+        }
+
+        found = 0;
+        for (uint32_t probes = 0, position = hash_key(index, key); probes <= index->mask;
+             probes++, position = (position + 1) & index->mask)
+        {
+            uint64_t current = atomic_load_explicit(&index->entries[position].key, memory_order_relaxed);
+            if (current == key)
+            {
+                result = atomic_load_explicit(&index->entries[position].value, memory_order_relaxed);
+                found = 1;
+                break;
+            }
+            if (current == THREAD_INDEX_EMPTY)
+            {
+                break;
+            }
+        }
+        atomic_thread_fence(memory_order_acquire);
+    } while (atomic_load_explicit(&index->sequence, memory_order_relaxed) != sequence);
+
+    if (found)
+    {
+        *value = result;
+    }
+
+    return found;
+}
+
+/**
+ * @brief Copies every thread ID of an index into another.
+ * @param to The index to fill.
+ * @param from The index to copy; its writers are serialized with those of `to`.
+ * @return Returns 1 on success, 0 if `to` cannot hold the keys of both.
+ * @details Used to move the keys to a larger table; lookups of `to` may run meanwhile.
+ */
+int thread_index_copy(thread_index_t *to, const thread_index_t *from)
+{
+    for (uint32_t i = 0; i <= from->mask; i++)
+    {
+        uint64_t key = atomic_load_explicit(&from->entries[i].key, memory_order_relaxed);
+        if (key != THREAD_INDEX_EMPTY && key != THREAD_INDEX_DELETED &&
+            !thread_index_insert(to, (pthread_t)key, atomic_load_explicit(&from->entries[i].value, memory_order_relaxed)))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file thread_index.h
+ * @brief Header file for an open-addressing hash index from thread IDs to slots of the pool.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details Lookups take no lock: they read the table under a sequence counter and retry if a writer changed it in
+ *          the meantime. Writers are serialized by the caller and must not be interrupted by a thread that looks
+ *          up the index, or the lookup spins until the writer resumes.
+ */
+
+#ifndef THREAD_INDEX_H
+#define THREAD_INDEX_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/**
+ * @brief One entry of the table.
+ */
+typedef struct {
+    _Atomic uint64_t key;           /**< Thread ID, `THREAD_INDEX_EMPTY` or `THREAD_INDEX_DELETED`. */
+    _Atomic uint64_t value;         /**< Slot of the thread. */
+} thread_index_entry_t;
+
+/**
+ * @brief Key of an entry that was never used; a lookup stops there.
+ */
+#define THREAD_INDEX_EMPTY 0
+
+/**
+ * @brief Key of an entry whose thread was removed; a lookup probes past it.
+ */
+#define THREAD_INDEX_DELETED 1
+
+/**
+ * @brief Hash index from thread IDs to slots.
+ * @details The table holds at least twice as many entries as keys, and is rebuilt in place once deleted entries
+ *          fill a quarter of it, so a probe stays short whatever the size of the pool.
+ */
+typedef struct {
+    thread_index_entry_t *entries;  /**< Table of `mask + 1` entries. */
+    uint32_t mask;                  /**< Size of the table minus one; the size is a power of two. */
+    uint32_t shift;                 /**< 64 minus the number of bits of the size, for Fibonacci hashing. */
+    uint32_t live;                  /**< Entries holding a key; owned by the writer. */
+    uint32_t deleted;               /**< Entries marked deleted; owned by the writer. */
+    _Alignas(64) _Atomic uint32_t sequence; /**< Odd while a writer changes the table. */
+} thread_index_t;
+
+/**
+ * @brief Initializes an index.
+ * @param index The index to initialize.
+ * @param capacity The maximum number of keys.
+ * @return Returns 1 on success, 0 if memory is short.
+ */
+int thread_index_init(thread_index_t *index, uint32_t capacity);
+
+/**
+ * @brief Releases the table of an index.
+ * @param index The index; no lookup may be running.
+ */
+void thread_index_destroy(thread_index_t *index);
+
+/**
+ * @brief Maps a thread ID to a slot, replacing any slot it was mapped to.
+ * @param index The index.
+ * @param thread The thread ID.
+ * @param value The slot.
+ * @return Returns 1 on success, 0 if the index already holds `capacity` keys.
+ */
+int thread_index_insert(thread_index_t *index, pthread_t thread, uint64_t value);
+
+/**
+ * @brief Removes a thread ID if it is still mapped to a slot.
+ * @param index The index.
+ * @param thread The thread ID.
+ * @param value The slot the thread ID must be mapped to; a thread ID reused by a newer thread stays.
+ */
+void thread_index_remove(thread_index_t *index, pthread_t thread, uint64_t value);
+
+/**
+ * @brief Looks up the slot of a thread ID.
+ * @param index The index.
+ * @param thread The thread ID.
+ * @param value Receives the slot.
+ * @return Returns 1 if the thread ID is mapped, otherwise 0.
+ */
+int thread_index_lookup(thread_index_t *index, pthread_t thread, uint64_t *value);
+
+/**
+ * @brief Copies every thread ID of an index into another.
+ * @param to The index to fill.
+ * @param from The index to copy; its writers are serialized with those of `to`.
+ * @return Returns 1 on success, 0 if `to` cannot hold the keys of both.
+ */
+int thread_index_copy(thread_index_t *to, const thread_index_t *from);
+
+#endif /* THREAD_INDEX_H */
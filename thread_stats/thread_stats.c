@@ -0,0 +1,165 @@
+/**
+ * @file thread_stats.c
+ * @brief Implementation of the per-thread scheduling statistics.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#include <string.h>
+#include <time.h>
+#include "thread_stats.h"
+#include "../timer_wheel/timer_wheel.h"
+
+/**
+ * @brief Reads the monotonic clock.
+ * @return Returns the time in nanoseconds.
+ * @note This function is async-signal-safe.
+ */
+uint64_t stats_now_ns(void)
+{
+    return timer_now_ns();
+}
+
+/**
+ * @brief Clears the statistics of a thread.
+ * @param stats The statistics.
+ * @details Called before the thread runs, while no other thread updates the counters.
+ */
+void stats_reset(thread_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+/**
+ * @brief Closes the current interval of a thread and starts a running or stopped one.
+ * @param stats The statistics of the thread.
+ * @param is_stopped Non-zero if the new interval is a stopped one.
+ * @details Called by the controller that owns the thread's transition, so intervals never overlap.
+ */
+void stats_enter(thread_stats_t *stats, int is_stopped)
+{
+    uint64_t now = stats_now_ns();
+    uint64_t since = atomic_exchange_explicit(&stats->since_ns, now, memory_order_relaxed);
+    uint32_t was_stopped = atomic_exchange_explicit(&stats->stopped, is_stopped != 0, memory_order_relaxed);
+
+    if (since != 0)
+    {
+        atomic_fetch_add_explicit(was_stopped ? &stats->stopped_ns : &stats->run_ns, now - since, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Records the delivery of the pending request of one kind.
+ * @param latency The latency counters of the kind.
+ * @note This function is async-signal-safe.
+ */
+void stats_delivered(stats_latency_t *latency)
+{
+    uint64_t sent = atomic_load_explicit(&latency->sent_ns, memory_order_relaxed);
+    uint64_t elapsed, max;
+
+    if (sent == 0)
+    {
+        return;
+    }
+
+    elapsed = stats_now_ns() - sent;
+    atomic_fetch_add_explicit(&latency->total_ns, elapsed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&latency->count, 1, memory_order_relaxed);
+    max = atomic_load_explicit(&latency->max_ns, memory_order_relaxed);
+    while (elapsed > max &&
+           !atomic_compare_exchange_weak_explicit(&latency->max_ns, &max, elapsed, memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+/**
+ * @brief Locks a mutex and records the time spent waiting if it was contended.
+ * @param mutex The mutex.
+ * @param stats The statistics of the calling thread, or `NULL`.
+ * @return Returns the result of `pthread_mutex_lock`.
+ * @details An uncontended lock costs one `pthread_mutex_trylock` and reads no clock.
+ */
+int stats_lock(pthread_mutex_t *mutex, thread_stats_t *stats)
+{
+    uint64_t start;
+    int status;
+
+    if (pthread_mutex_trylock(mutex) == 0)
+    {
+        return 0;
+    }
+
+    start = stats_now_ns();
+    status = pthread_mutex_lock(mutex);
+    if (stats != NULL)
+    {
+        atomic_fetch_add_explicit(&stats->mutex_waits, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stats->mutex_wait_ns, stats_now_ns() - start, memory_order_relaxed);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Copies the mean and maximum of one kind of delivery latency.
+ */
+static void snapshot_latency(stats_latency_t *latency, uint64_t *count, uint64_t *mean_ns, uint64_t *max_ns)
+{
+    *count = atomic_load_explicit(&latency->count, memory_order_relaxed);
+    *mean_ns = *count != 0 ? atomic_load_explicit(&latency->total_ns, memory_order_relaxed) / *count : 0;
+    *max_ns = atomic_load_explicit(&latency->max_ns, memory_order_relaxed);
+}
+
+/**
+ * @brief Copies the statistics of a thread.
+ * @param stats The statistics.
+ * @param snapshot Receives the counters; the identity fields are left to the caller.
+ * @details The counters are read one by one without stopping the thread, so they may be off by the events that
+ *          happen during the copy. The current interval is added to the run or stopped time.
+ */
+void stats_snapshot(thread_stats_t *stats, thread_stats_snapshot_t *snapshot)
+{
+    uint64_t since = atomic_load_explicit(&stats->since_ns, memory_order_relaxed);
+    uint64_t now = stats_now_ns();
+
+    snapshot->stops = atomic_load_explicit(&stats->stops, memory_order_relaxed);
+    snapshot->resumes = atomic_load_explicit(&stats->resumes, memory_order_relaxed);
+    snapshot->run_ns = atomic_load_explicit(&stats->run_ns, memory_order_relaxed);
+    snapshot->stopped_ns = atomic_load_explicit(&stats->stopped_ns, memory_order_relaxed);
+    if (since != 0 && now > since)
+    {
+        *(atomic_load_explicit(&stats->stopped, memory_order_relaxed) ? &snapshot->stopped_ns : &snapshot->run_ns) +=
+            now - since;
+    }
+    snapshot_latency(&stats->stop_delivery, &snapshot->stop_signals, &snapshot->stop_latency_mean_ns,
+                     &snapshot->stop_latency_max_ns);
+    snapshot_latency(&stats->resume_delivery, &snapshot->resume_signals, &snapshot->resume_latency_mean_ns,
+                     &snapshot->resume_latency_max_ns);
+    snapshot->mutex_waits = atomic_load_explicit(&stats->mutex_waits, memory_order_relaxed);
+    snapshot->mutex_wait_ns = atomic_load_explicit(&stats->mutex_wait_ns, memory_order_relaxed);
+}
+
+/**
+ * @brief Prints a table of snapshots.
+ * @param out The stream to print to.
+ * @param snapshots The snapshots.
+ * @param count The number of snapshots.
+ * @details Run, stopped and wait times are printed in microseconds, delivery latencies in nanoseconds.
+ */
+void stats_print(FILE *out, const thread_stats_snapshot_t *snapshots, unsigned int count)
+{
+    fprintf(out, "%6s %5s %8s %8s %12s %12s %10s %10s %10s %10s %8s %10s\n", "thread", "state", "stops", "resumes",
+            "run_us", "stopped_us", "stop_ns", "stop_max", "resume_ns", "resume_max", "waits", "wait_us");
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const thread_stats_snapshot_t *s = &snapshots[i];
+        fprintf(out, "%6u %5d %8llu %8llu %12llu %12llu %10llu %10llu %10llu %10llu %8llu %10llu\n", s->index, s->state,
+                (unsigned long long)s->stops, (unsigned long long)s->resumes,
+                (unsigned long long)(s->run_ns / 1000), (unsigned long long)(s->stopped_ns / 1000),
+                (unsigned long long)s->stop_latency_mean_ns, (unsigned long long)s->stop_latency_max_ns,
+                (unsigned long long)s->resume_latency_mean_ns, (unsigned long long)s->resume_latency_max_ns,
+                (unsigned long long)s->mutex_waits, (unsigned long long)(s->mutex_wait_ns / 1000));
+    }
+    fflush(out);
+}
@@ -0,0 +1,145 @@
+/**
+ * @file thread_stats.h
+ * @brief Header file for the per-thread scheduling statistics kept in every thread control block.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details Every counter is updated with relaxed atomics by whichever thread observes the event, so instrumentation
+ *          never orders or serializes the hot path. Build with `-DTHREAD_STATS=0` to compile every update out and drop
+ *          the counters from the control blocks.
+ */
+
+#ifndef THREAD_STATS_H
+#define THREAD_STATS_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+#ifndef THREAD_STATS
+#define THREAD_STATS 1  /**< Non-zero to keep per-thread statistics. */
+#endif
+
+/**
+ * @brief Size of a cache line; the counters of a thread start on their own line.
+ */
+#define STATS_CACHE_LINE 64
+
+/**
+ * @brief Delivery latency of one kind of request: from the controller sending it until the thread acts on it.
+ */
+typedef struct {
+    _Atomic uint64_t sent_ns;       /**< Time the pending request was sent. */
+    _Atomic uint64_t total_ns;      /**< Sum of all delivery latencies. */
+    _Atomic uint64_t max_ns;        /**< Largest delivery latency. */
+    _Atomic uint64_t count;         /**< Number of requests delivered. */
+} stats_latency_t;
+
+/**
+ * @brief Scheduling statistics of one thread.
+ * @details Run time covers every interval outside STOPPED, idle waits included.
+ */
+typedef struct {
+    _Alignas(STATS_CACHE_LINE) _Atomic uint64_t stops;  /**< Number of completed stops. */
+    _Atomic uint64_t resumes;       /**< Number of completed resumes. */
+    _Atomic uint64_t run_ns;        /**< Time spent outside STOPPED, up to `since_ns`. */
+    _Atomic uint64_t stopped_ns;    /**< Time spent STOPPED, up to `since_ns`. */
+    _Atomic uint64_t since_ns;      /**< Start of the current interval, or 0 before the thread first runs. */
+    _Atomic uint32_t stopped;       /**< Non-zero while the current interval is a stopped one. */
+    stats_latency_t stop_delivery;  /**< From the stop request until the thread acknowledges it. */
+    stats_latency_t resume_delivery;    /**< From the resume request until the thread runs again. */
+    _Atomic uint64_t mutex_waits;   /**< Number of contended lock acquisitions. */
+    _Atomic uint64_t mutex_wait_ns; /**< Time spent blocked on contended locks. */
+} thread_stats_t;
+
+/**
+ * @brief Plain copy of the statistics of one thread.
+ */
+typedef struct {
+    pthread_t thread_id;            /**< ID of the thread. */
+    unsigned int index;             /**< Index of the thread's control block. */
+    int state;                      /**< `thread_state_t` of the thread when the snapshot was taken. */
+    uint64_t stops;                 /**< Number of completed stops. */
+    uint64_t resumes;               /**< Number of completed resumes. */
+    uint64_t run_ns;                /**< Time spent outside STOPPED, including the current interval. */
+    uint64_t stopped_ns;            /**< Time spent STOPPED, including the current interval. */
+    uint64_t stop_signals;          /**< Number of stop requests delivered. */
+    uint64_t stop_latency_mean_ns;  /**< Mean delivery latency of the stop requests. */
+    uint64_t stop_latency_max_ns;   /**< Largest delivery latency of the stop requests. */
+    uint64_t resume_signals;        /**< Number of resume requests delivered. */
+    uint64_t resume_latency_mean_ns;    /**< Mean delivery latency of the resume requests. */
+    uint64_t resume_latency_max_ns; /**< Largest delivery latency of the resume requests. */
+    uint64_t mutex_waits;           /**< Number of contended lock acquisitions. */
+    uint64_t mutex_wait_ns;         /**< Time spent blocked on contended locks. */
+} thread_stats_snapshot_t;
+
+#if THREAD_STATS
+/** @brief Counts an event of a control block. */
+#define STATS_COUNT(tcb, field) atomic_fetch_add_explicit(&(tcb)->stats.field, 1, memory_order_relaxed)
+/** @brief Records that a request of kind `stop_delivery` or `resume_delivery` is being sent to a control block. */
+#define STATS_SENT(tcb, kind) atomic_store_explicit(&(tcb)->stats.kind.sent_ns, stats_now_ns(), memory_order_relaxed)
+/** @brief Records that the thread of a control block acted on its pending request of kind `kind`. */
+#define STATS_DELIVERED(tcb, kind) stats_delivered(&(tcb)->stats.kind)
+/** @brief Starts a new running or stopped interval of a control block. */
+#define STATS_ENTER(tcb, is_stopped) stats_enter(&(tcb)->stats, (is_stopped))
+/** @brief Locks a mutex, charging any wait to a control block, which may be `NULL`. */
+#define STATS_LOCK(mutex, tcb) stats_lock((mutex), (tcb) != NULL ? &(tcb)->stats : NULL)
+#else
+#define STATS_COUNT(tcb, field) ((void)0)
+#define STATS_SENT(tcb, kind) ((void)0)
+#define STATS_DELIVERED(tcb, kind) ((void)0)
+#define STATS_ENTER(tcb, is_stopped) ((void)0)
+#define STATS_LOCK(mutex, tcb) pthread_mutex_lock(mutex)
+#endif
+
+/**
+ * @brief Reads the monotonic clock.
+ * @return Returns the time in nanoseconds.
+ * @note This function is async-signal-safe.
+ */
+uint64_t stats_now_ns(void);
+
+/**
+ * @brief Clears the statistics of a thread.
+ * @param stats The statistics.
+ */
+void stats_reset(thread_stats_t *stats);
+
+/**
+ * @brief Closes the current interval of a thread and starts a running or stopped one.
+ * @param stats The statistics of the thread.
+ * @param is_stopped Non-zero if the new interval is a stopped one.
+ */
+void stats_enter(thread_stats_t *stats, int is_stopped);
+
+/**
+ * @brief Records the delivery of the pending request of one kind.
+ * @param latency The latency counters of the kind.
+ * @note This function is async-signal-safe.
+ */
+void stats_delivered(stats_latency_t *latency);
+
+/**
+ * @brief Locks a mutex and records the time spent waiting if it was contended.
+ * @param mutex The mutex.
+ * @param stats The statistics of the calling thread, or `NULL`.
+ * @return Returns the result of `pthread_mutex_lock`.
+ */
+int stats_lock(pthread_mutex_t *mutex, thread_stats_t *stats);
+
+/**
+ * @brief Copies the statistics of a thread.
+ * @param stats The statistics.
+ * @param snapshot Receives the counters; the identity fields are left to the caller.
+ */
+void stats_snapshot(thread_stats_t *stats, thread_stats_snapshot_t *snapshot);
+
+/**
+ * @brief Prints a table of snapshots.
+ * @param out The stream to print to.
+ * @param snapshots The snapshots.
+ * @param count The number of snapshots.
+ */
+void stats_print(FILE *out, const thread_stats_snapshot_t *snapshots, unsigned int count);
+
+#endif /* THREAD_STATS_H */
@@ -7,22 +7,115 @@
 
  #include <stdio.h>
  #include <stdlib.h>
+ #include <stdint.h>
+ #include <stdatomic.h>
  #include <pthread.h>
  #include "threads_linked_list.h"
+ #include "../index_free_list/index_free_list.h"
+ 
+ /**
+  * @brief Contiguous storage of the node pool, or `NULL` if the pool is not in use.
+  */
+ static Node* pool_nodes = NULL;
+ 
+ /**
+  * @brief Number of nodes in the pool.
+  */
+ static size_t pool_capacity = 0;
+ 
+ /**
+  * @brief Lock-free free list of the indices of `pool_nodes`; empty while the pool is not in use.
+  */
+ static index_free_list_t pool_free;
+ 
+ /**
+  * @brief Pops a node from the pool's free list.
+  * @return Returns a free node, or `NULL` if the pool is empty or not in use.
+  */
+ static Node* pool_pop(void)
+ {
+     uint32_t index = index_free_list_pop(&pool_free);
+ 
+     return index != INDEX_FREE_LIST_EMPTY ? &pool_nodes[index] : NULL;
+ }
+ 
+ /**
+  * @brief Pushes a node back onto the pool's free list.
+  * @param node A node that belongs to the pool.
+  */
+ static void pool_push(Node* node)
+ {
+     index_free_list_push(&pool_free, (uint32_t)(node - pool_nodes));
+ }
+ 
+ /**
+  * @brief Checks whether a node was allocated from the pool.
+  * @param node The node to check.
+  * @return Returns 1 if the node belongs to the pool, otherwise 0.
+  */
+ static int pool_owns(Node* node)
+ {
+     return pool_nodes != NULL && node >= pool_nodes && node < pool_nodes + pool_capacity;
+ }
+ 
+ /**
+  * @brief Creates the fixed-capacity node pool used by `create_node` and `delete_node`.
+  * @param capacity The number of nodes in the pool.
+  * @return Returns 1 on success, 0 on failure or if the pool already exists.
+  * @details The nodes are allocated as one contiguous block and chained into a lock-free free list,
+  *          so list operations make no heap calls while the pool has free nodes.
+  */
+ int init_node_pool(size_t capacity)
+ {
+     if (pool_nodes != NULL || capacity == 0 || capacity >= UINT32_MAX)
+     {
+         return 0;
+     }
+ 
+     /* Every node starts in the free list, lowest address first */
+     pool_nodes = (Node*)calloc(capacity, sizeof(Node));
+     if (pool_nodes == NULL || !index_free_list_init(&pool_free, capacity))
+     {
+         printf("Node pool allocation failed!\n");
+         free(pool_nodes);
+         pool_nodes = NULL;
+         return 0;
+     }
+     pool_capacity = capacity;
+ 
+     return 1;
+ }
+ 
+ /**
+  * @brief Releases the node pool. Nodes are allocated from the heap again afterwards.
+  * @details Must only be called once no list holds nodes from the pool.
+  */
+ void destroy_node_pool(void)
+ {
+     index_free_list_destroy(&pool_free);
+     free(pool_nodes);
+     pool_nodes = NULL;
+     pool_capacity = 0;
+ }
  
  /**
   * @brief Creates a new node with the given thread ID.
   * @param data The thread ID to store in the node.
-  * @return Returns a pointer to the newly created node.
-  * @details This function allocates memory for a new node and initializes it with the given thread ID.
+  * @return Returns a pointer to the newly created node, or `NULL` if no memory is available.
+  * @details This function takes a node from the node pool if one was created and still has free nodes,
+  *          otherwise it allocates memory for a new node, and initializes it with the given thread ID.
   */
  Node* create_node(pthread_t data)
  {
-     Node* new_node = (Node*)malloc(sizeof(Node));
+     Node* new_node = pool_pop();
+     if (new_node == NULL)
+     {
+         new_node = (Node*)malloc(sizeof(Node));
+     }
      if (new_node == NULL)
      {
          printf("Memory allocation failed!\n");
-         exit(1);
+         return NULL;
      }
      new_node->data = data;
      new_node->next = NULL;
@@ -43,34 +136,28 @@
   * @brief Adds a node at the end of the linked list.
   * @param list The linked list to which the node will be added.
   * @param data The thread ID to add to the list.
+  * @return Returns 1 if the thread ID is in the list, 0 if no node can be created for it.
   * @details This function adds a new node with the given thread ID to the end of the list.
   *          If a node with the same thread ID already exists, the function does nothing.
   */
- void add_node_end(LinkedList* list, pthread_t data)
+ int add_node_end(LinkedList* list, pthread_t data)
  {
-     Node* new_node = create_node(data);
+     Node** link = &list->head;
  
-     if (list->head == NULL)
+     /* Traverse to the end of the list */
+     while (*link != NULL)
      {
-         /* If the list is empty, make the new node the head */
-         list->head = new_node;
-     }
-     else
-     {
-         /* Traverse to the end of the list */
-         Node* temp = list->head;
-         while (temp->next != NULL)
+         /* If the node exists, return and don't add it */
+         if (pthread_equal((*link)->data, data))
          {
-             /* If the node exists, return and don't add it */
-             if (pthread_equal(temp->data, data))
-             {
-                 return;
-             }
-             temp = temp->next;
+             return 1;
          }
-         /* Add the new node at the end if the node doesn't exist */
-         temp->next = new_node;
+         link = &(*link)->next;
      }
+ 
+     /* Add the new node at the end if the node doesn't exist */
+     *link = create_node(data);
+     return *link != NULL;
  }
  
  /**
@@ -100,7 +187,15 @@
                  /* If the node to delete is in the middle or end */
                  prev->next = temp->next;
              }
-             free(temp); /* Free the memory of the deleted node */
+             /* Return the node to the pool or free its memory */
+             if (pool_owns(temp))
+             {
+                 pool_push(temp);
+             }
+             else
+             {
+                 free(temp);
+             }
              return;
          }
          prev = temp;
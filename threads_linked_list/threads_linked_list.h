@@ -9,6 +9,7 @@
  #define THREADS_LINKED_LIST_H
  
  #include <pthread.h>
+ #include <stddef.h>
  
  #define EMPTY_PTHREAD 0  /**< Represents an empty pthread_t value. */
  
@@ -29,6 +30,18 @@
      Node* head;             /**< Head pointer for the linked list. */
  } LinkedList;
  
+ /**
+  * @brief Creates the fixed-capacity node pool used by `create_node` and `delete_node`.
+  * @param capacity The number of nodes in the pool.
+  * @return Returns 1 on success, 0 on failure or if the pool already exists.
+  */
+ int init_node_pool(size_t capacity);
+ 
+ /**
+  * @brief Releases the node pool. Nodes are allocated from the heap again afterwards.
+  */
+ void destroy_node_pool(void);
+ 
  /**
   * @brief Initializes a linked list.
   * @param list The linked list to initialize.
@@ -38,7 +51,7 @@
  /**
   * @brief Creates a new node with the given thread ID.
   * @param data The thread ID to store in the node.
-  * @return Returns a pointer to the newly created node.
+  * @return Returns a pointer to the newly created node, or `NULL` if no memory is available.
   */
  Node* create_node(pthread_t data);
  
@@ -46,8 +59,9 @@
   * @brief Adds a node at the end of the linked list.
   * @param list The linked list to which the node will be added.
   * @param data The thread ID to add to the list.
+  * @return Returns 1 if the thread ID is in the list, 0 if no node can be created for it.
   */
- void add_node_end(LinkedList* list, pthread_t data);
+ int add_node_end(LinkedList* list, pthread_t data);
  
  /**
   * @brief Deletes a node with the given thread ID from the linked list.
@@ -0,0 +1,467 @@
+/**
+ * @file timer_wheel.c
+ * @brief Implementation of the hierarchical timer wheel and of the tickless timer service.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/timerfd.h>
+#include "timer_wheel.h"
+
+/**
+ * @brief Bits of a tick that select the slot of a level.
+ */
+#define SLOT_BITS 6
+
+/**
+ * @brief Span of the wheel: timers further away are parked in the last slot of the top level.
+ */
+#define WHEEL_SPAN (1ULL << (SLOT_BITS * TIMER_WHEEL_LEVELS))
+
+/**
+ * @brief Tick of the programmed timer when it is disarmed.
+ */
+#define NOT_PROGRAMMED UINT64_MAX
+
+/**
+ * @brief State of the timer service: its wheel, the one-shot timer, the thread sleeping on it and the tick the
+ *        timer is programmed to. Everything but the counter of wake-ups is guarded by `service_mutex`.
+ */
+static pthread_mutex_t service_mutex = PTHREAD_MUTEX_INITIALIZER;
+static timer_wheel_t service_wheel;
+static int service_started = 0;
+static int service_running = 0;
+static int timer_fd = -1;
+static pthread_t timer_thread;
+static uint64_t programmed = NOT_PROGRAMMED;
+static _Atomic uint64_t wakeups = 0;
+
+/**
+ * @brief Links a timer at the head of a list.
+ */
+static void link_entry(timer_entry_t **head, timer_entry_t *entry, int16_t slot)
+{
+    entry->next = *head;
+    if (entry->next != NULL)
+    {
+        entry->next->pprev = &entry->next;
+    }
+    *head = entry;
+    entry->pprev = head;
+    entry->slot = slot;
+}
+
+/**
+ * @brief Places a timer on the level its distance selects, or on the expired list if it is due.
+ * @details A timer `d` ticks away goes on the first level `k` with `d < 64^(k+1)`, in slot `(expires >> 6k) & 63`.
+ *          That slot is reached, and the timer cascades, no later than the timer expires.
+ */
+static void place_entry(timer_wheel_t *wheel, timer_entry_t *entry)
+{
+    uint64_t expires = entry->expires;
+    uint64_t delta;
+    int level, slot;
+
+    if (expires <= wheel->current)
+    {
+        link_entry(&wheel->expired, entry, -1);
+        return;
+    }
+
+    delta = expires - wheel->current;
+    if (delta >= WHEEL_SPAN)
+    {
+        expires = wheel->current + WHEEL_SPAN - 1;
+        delta = WHEEL_SPAN - 1;
+    }
+    for (level = 0; level < TIMER_WHEEL_LEVELS - 1; level++)
+    {
+        if ((delta >> (SLOT_BITS * (level + 1))) == 0)
+        {
+            break;
+        }
+    }
+
+    slot = (int)((expires >> (SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+    link_entry(&wheel->slots[level][slot], entry, (int16_t)(level * TIMER_WHEEL_SLOTS + slot));
+    wheel->occupied[level] |= 1ULL << slot;
+}
+
+/**
+ * @brief Initializes a timer entry.
+ * @param entry The entry.
+ */
+void timer_entry_init(timer_entry_t *entry)
+{
+    entry->next = NULL;
+    entry->pprev = NULL;
+    entry->expires = 0;
+    entry->slot = -1;
+    entry->callback = NULL;
+    entry->arg = NULL;
+}
+
+/**
+ * @brief Initializes a wheel.
+ * @param wheel The wheel.
+ * @param now The current tick.
+ */
+void timer_wheel_init(timer_wheel_t *wheel, uint64_t now)
+{
+    wheel->current = now;
+    wheel->expired = NULL;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        wheel->occupied[level] = 0;
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+        {
+            wheel->slots[level][slot] = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Removes a pending timer from a wheel.
+ * @param wheel The wheel.
+ * @param entry The timer.
+ * @return Returns 1 if the timer was pending, 0 if it had expired or was never added.
+ */
+int timer_wheel_cancel(timer_wheel_t *wheel, timer_entry_t *entry)
+{
+    if (entry->pprev == NULL)
+    {
+        return 0;
+    }
+
+    *entry->pprev = entry->next;
+    if (entry->next != NULL)
+    {
+        entry->next->pprev = entry->pprev;
+    }
+    if (entry->slot >= 0)
+    {
+        int level = entry->slot / TIMER_WHEEL_SLOTS, slot = entry->slot % TIMER_WHEEL_SLOTS;
+        if (wheel->slots[level][slot] == NULL)
+        {
+            wheel->occupied[level] &= ~(1ULL << slot);
+        }
+    }
+    entry->next = NULL;
+    entry->pprev = NULL;
+
+    return 1;
+}
+
+/**
+ * @brief Adds a timer to a wheel, moving it if it is already pending.
+ * @param wheel The wheel.
+ * @param entry The timer, with `callback` and `arg` set.
+ * @param expires The tick at which it expires; a tick already processed makes it due at once.
+ */
+void timer_wheel_add(timer_wheel_t *wheel, timer_entry_t *entry, uint64_t expires)
+{
+    timer_wheel_cancel(wheel, entry);
+    entry->expires = expires;
+    place_entry(wheel, entry);
+}
+
+/**
+ * @brief Finds the first tick after the current one at which a slot of the wheel is reached.
+ * @return Returns the tick, or `UINT64_MAX` if no slot holds a timer.
+ * @details On each level the first occupied slot after the current one is found by rotating the bitmap so that
+ *          the next slot comes first and counting its trailing zeros.
+ */
+static uint64_t next_slot_tick(const timer_wheel_t *wheel)
+{
+    uint64_t best = UINT64_MAX;
+
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        uint64_t block, rotated, candidate;
+        unsigned int shift;
+
+        if (wheel->occupied[level] == 0)
+        {
+            continue;
+        }
+        block = wheel->current >> (SLOT_BITS * level);
+        shift = (unsigned int)((block + 1) & (TIMER_WHEEL_SLOTS - 1));
+        rotated = shift == 0 ? wheel->occupied[level] :
+                  (wheel->occupied[level] >> shift) | (wheel->occupied[level] << (TIMER_WHEEL_SLOTS - shift));
+        candidate = (block + 1 + (uint64_t)__builtin_ctzll(rotated)) << (SLOT_BITS * level);
+        if (candidate < best)
+        {
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief Finds the next tick at which the wheel has work: an expiry or a cascade.
+ * @param wheel The wheel.
+ * @param tick Receives the tick; the current tick while expired timers wait to be popped.
+ * @return Returns 1 if a timer is pending, 0 if the wheel is empty.
+ */
+int timer_wheel_next(const timer_wheel_t *wheel, uint64_t *tick)
+{
+    *tick = wheel->expired != NULL ? wheel->current : next_slot_tick(wheel);
+    return *tick != UINT64_MAX;
+}
+
+/**
+ * @brief Processes the wheel up to a tick, moving the timers due by then to the expired list.
+ * @param wheel The wheel.
+ * @param now The current tick.
+ * @details Only ticks with work are visited, so a long idle period costs nothing. At a tick that starts a slot of
+ *          a coarse level, the timers of that slot are placed again, from the top level down, before the timers of
+ *          the tick's level 0 slot expire.
+ */
+void timer_wheel_advance(timer_wheel_t *wheel, uint64_t now)
+{
+    uint64_t tick;
+
+    while (wheel->current < now)
+    {
+        tick = next_slot_tick(wheel);
+        if (tick > now)
+        {
+            wheel->current = now;
+            return;
+        }
+        wheel->current = tick;
+
+        for (int level = TIMER_WHEEL_LEVELS - 1; level >= 0; level--)
+        {
+            int slot = (int)((tick >> (SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+            timer_entry_t *entry;
+
+            if ((tick & ((1ULL << (SLOT_BITS * level)) - 1)) != 0 || (wheel->occupied[level] & (1ULL << slot)) == 0)
+            {
+                continue;
+            }
+            entry = wheel->slots[level][slot];
+            wheel->slots[level][slot] = NULL;
+            wheel->occupied[level] &= ~(1ULL << slot);
+            while (entry != NULL)
+            {
+                timer_entry_t *next = entry->next;
+                place_entry(wheel, entry);
+                entry = next;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Takes one timer off the expired list.
+ * @param wheel The wheel.
+ * @return Returns the timer, no longer pending, or `NULL` if no timer is due.
+ */
+timer_entry_t *timer_wheel_pop_expired(timer_wheel_t *wheel)
+{
+    timer_entry_t *entry = wheel->expired;
+
+    if (entry != NULL)
+    {
+        timer_wheel_cancel(wheel, entry);
+    }
+    return entry;
+}
+
+/**
+ * @brief Reads the monotonic clock in nanoseconds, the time base of `timer_arm` and the clock of every module.
+ * @note This function is async-signal-safe.
+ */
+uint64_t timer_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Programs the one-shot timer to the next event of the wheel, or disarms it.
+ * @details Must be called with `service_mutex` held. The timer is only touched when the next event changed.
+ */
+static void reprogram_timer(void)
+{
+    struct itimerspec value = { .it_interval = { 0, 0 }, .it_value = { 0, 0 } };
+    uint64_t tick;
+
+    if (!timer_wheel_next(&service_wheel, &tick))
+    {
+        tick = NOT_PROGRAMMED;
+    }
+    if (tick == programmed)
+    {
+        return;
+    }
+
+    programmed = tick;
+    if (tick != NOT_PROGRAMMED)
+    {
+        uint64_t expiry_ns = tick * TIMER_WHEEL_RESOLUTION_NS;
+        value.it_value.tv_sec = (time_t)(expiry_ns / 1000000000ULL);
+        value.it_value.tv_nsec = (long)(expiry_ns % 1000000000ULL);
+        if (value.it_value.tv_sec == 0 && value.it_value.tv_nsec == 0)
+        {
+            value.it_value.tv_nsec = 1;  /* Zero would disarm the timer */
+        }
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &value, NULL);
+}
+
+/**
+ * @brief Body of the timer thread: sleeps until the programmed event, then fires the timers due.
+ * @details Callbacks run without the lock held, so they may arm and disarm timers themselves.
+ */
+static void *timer_body(void *arg)
+{
+    (void) arg;
+
+    pthread_mutex_lock(&service_mutex);
+    while (service_running)
+    {
+        uint64_t expirations;
+        timer_entry_t *entry;
+
+        pthread_mutex_unlock(&service_mutex);
+        if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        {
+            pthread_mutex_lock(&service_mutex);
+            continue;
+        }
+        atomic_fetch_add_explicit(&wakeups, 1, memory_order_relaxed);
+
+        pthread_mutex_lock(&service_mutex);
+        programmed = NOT_PROGRAMMED;  /* The one-shot timer has fired */
+        timer_wheel_advance(&service_wheel, timer_now_ns() / TIMER_WHEEL_RESOLUTION_NS);
+        while (service_running && (entry = timer_wheel_pop_expired(&service_wheel)) != NULL)
+        {
+            pthread_mutex_unlock(&service_mutex);
+            entry->callback(entry->arg);
+            pthread_mutex_lock(&service_mutex);
+        }
+        reprogram_timer();
+    }
+    pthread_mutex_unlock(&service_mutex);
+
+    return NULL;
+}
+
+/**
+ * @brief Creates the one-shot timer and the timer thread.
+ * @return Returns 1 on success, otherwise 0.
+ * @details Must be called with `service_mutex` held.
+ */
+static int start_service(void)
+{
+    if (!service_started)
+    {
+        timer_wheel_init(&service_wheel, timer_now_ns() / TIMER_WHEEL_RESOLUTION_NS);
+        service_started = 1;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd < 0)
+    {
+        perror("timerfd_create");
+        return 0;
+    }
+
+    service_running = 1;
+    programmed = NOT_PROGRAMMED;
+    if (pthread_create(&timer_thread, NULL, timer_body, NULL) != 0)
+    {
+        service_running = 0;
+        close(timer_fd);
+        timer_fd = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Arms a timer of the timer service, starting the service with the first timer.
+ * @param entry The timer, initialized with `timer_entry_init`.
+ * @param expiry_ns Monotonic time at which it expires; re-arming a pending timer moves it.
+ * @param callback The function called on the timer thread on expiry.
+ * @param arg The argument of `callback`.
+ * @return Returns 1 on success, 0 if the timer service cannot be started.
+ * @details The expiry is rounded up to the next tick of the wheel, so a timer never fires early.
+ */
+int timer_arm(timer_entry_t *entry, uint64_t expiry_ns, timer_callback_t callback, void *arg)
+{
+    pthread_mutex_lock(&service_mutex);
+    if (!service_running && !start_service())
+    {
+        pthread_mutex_unlock(&service_mutex);
+        return 0;
+    }
+
+    entry->callback = callback;
+    entry->arg = arg;
+    timer_wheel_add(&service_wheel, entry, (expiry_ns + TIMER_WHEEL_RESOLUTION_NS - 1) / TIMER_WHEEL_RESOLUTION_NS);
+    reprogram_timer();
+    pthread_mutex_unlock(&service_mutex);
+
+    return 1;
+}
+
+/**
+ * @brief Disarms a timer of the timer service.
+ * @param entry The timer.
+ * @return Returns 1 if the timer was pending, 0 if it already fired or is firing.
+ */
+int timer_disarm(timer_entry_t *entry)
+{
+    int pending;
+
+    pthread_mutex_lock(&service_mutex);
+    pending = timer_wheel_cancel(&service_wheel, entry);
+    if (pending && service_running)
+    {
+        reprogram_timer();
+    }
+    pthread_mutex_unlock(&service_mutex);
+
+    return pending;
+}
+
+/**
+ * @brief Stops the timer service; pending timers stay armed and fire once it is started again.
+ */
+void timer_service_stop(void)
+{
+    struct itimerspec now = { .it_interval = { 0, 0 }, .it_value = { 0, 1 } };
+
+    pthread_mutex_lock(&service_mutex);
+    if (!service_running)
+    {
+        pthread_mutex_unlock(&service_mutex);
+        return;
+    }
+    service_running = 0;
+    timerfd_settime(timer_fd, 0, &now, NULL);
+    pthread_mutex_unlock(&service_mutex);
+
+    pthread_join(timer_thread, NULL);
+    close(timer_fd);
+    timer_fd = -1;
+}
+
+/**
+ * @brief Returns the number of times the timer thread has woken up.
+ */
+uint64_t timer_service_wakeups(void)
+{
+    return atomic_load_explicit(&wakeups, memory_order_relaxed);
+}
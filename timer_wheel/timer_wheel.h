@@ -0,0 +1,146 @@
+/**
+ * @file timer_wheel.h
+ * @brief Header file for the hierarchical timer wheel and the tickless timer service built on it.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details The wheel has `TIMER_WHEEL_LEVELS` levels of 64 slots; a slot of level `k` spans `64^k` ticks of
+ *          `TIMER_WHEEL_RESOLUTION_NS`. Adding and cancelling a timer is O(1) whatever the number of pending timers,
+ *          and a bitmap per level finds the next event in O(levels). Timers of a coarse level cascade to finer
+ *          levels as their time approaches.
+ *          The timer service runs the wheel on one thread that sleeps on a one-shot `timerfd` programmed to the
+ *          next event only, so the process is not woken while no timer is due.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+#ifndef TIMER_WHEEL_RESOLUTION_NS
+#define TIMER_WHEEL_RESOLUTION_NS 10000  /**< Length of a tick of the wheel; timers never fire early. */
+#endif
+
+/**
+ * @brief Number of levels of the wheel; timers beyond `64^TIMER_WHEEL_LEVELS` ticks are re-cascaded from the top.
+ */
+#define TIMER_WHEEL_LEVELS 4
+
+/**
+ * @brief Number of slots of a level.
+ */
+#define TIMER_WHEEL_SLOTS 64
+
+/**
+ * @brief Function called when a timer expires.
+ * @param arg The argument given when the timer was armed.
+ */
+typedef void (*timer_callback_t)(void *arg);
+
+/**
+ * @brief A timer; embedded in the structure it acts on, so arming it allocates nothing.
+ */
+typedef struct timer_entry {
+    struct timer_entry *next;       /**< Next timer of the same slot. */
+    struct timer_entry **pprev;     /**< Link that points to this timer, or `NULL` while it is not pending. */
+    uint64_t expires;               /**< Tick at which the timer expires. */
+    int16_t slot;                   /**< `level * TIMER_WHEEL_SLOTS + slot`, or -1 on the expired list. */
+    timer_callback_t callback;      /**< Function called on expiry. */
+    void *arg;                      /**< Argument of `callback`. */
+} timer_entry_t;
+
+/**
+ * @brief A hierarchical timer wheel. Not thread-safe; the timer service serializes it.
+ */
+typedef struct {
+    uint64_t current;                                               /**< Last tick processed. */
+    uint64_t occupied[TIMER_WHEEL_LEVELS];                          /**< Bit `s` is set while slot `s` holds a timer. */
+    timer_entry_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];    /**< Pending timers. */
+    timer_entry_t *expired;                                         /**< Timers due but not handed out yet. */
+} timer_wheel_t;
+
+/**
+ * @brief Initializes a timer entry.
+ * @param entry The entry.
+ */
+void timer_entry_init(timer_entry_t *entry);
+
+/**
+ * @brief Initializes a wheel.
+ * @param wheel The wheel.
+ * @param now The current tick.
+ */
+void timer_wheel_init(timer_wheel_t *wheel, uint64_t now);
+
+/**
+ * @brief Adds a timer to a wheel, moving it if it is already pending.
+ * @param wheel The wheel.
+ * @param entry The timer, with `callback` and `arg` set.
+ * @param expires The tick at which it expires; a tick already processed makes it due at once.
+ */
+void timer_wheel_add(timer_wheel_t *wheel, timer_entry_t *entry, uint64_t expires);
+
+/**
+ * @brief Removes a pending timer from a wheel.
+ * @param wheel The wheel.
+ * @param entry The timer.
+ * @return Returns 1 if the timer was pending, 0 if it had expired or was never added.
+ */
+int timer_wheel_cancel(timer_wheel_t *wheel, timer_entry_t *entry);
+
+/**
+ * @brief Finds the next tick at which the wheel has work: an expiry or a cascade.
+ * @param wheel The wheel.
+ * @param tick Receives the tick.
+ * @return Returns 1 if a timer is pending, 0 if the wheel is empty.
+ */
+int timer_wheel_next(const timer_wheel_t *wheel, uint64_t *tick);
+
+/**
+ * @brief Processes the wheel up to a tick, moving the timers due by then to the expired list.
+ * @param wheel The wheel.
+ * @param now The current tick.
+ * @details Only ticks with work are visited, so a long idle period costs nothing.
+ */
+void timer_wheel_advance(timer_wheel_t *wheel, uint64_t now);
+
+/**
+ * @brief Takes one timer off the expired list.
+ * @param wheel The wheel.
+ * @return Returns the timer, no longer pending, or `NULL` if no timer is due.
+ */
+timer_entry_t *timer_wheel_pop_expired(timer_wheel_t *wheel);
+
+/**
+ * @brief Arms a timer of the timer service, starting the service with the first timer.
+ * @param entry The timer, initialized with `timer_entry_init`.
+ * @param expiry_ns Monotonic time at which it expires; re-arming a pending timer moves it.
+ * @param callback The function called on the timer thread on expiry.
+ * @param arg The argument of `callback`.
+ * @return Returns 1 on success, 0 if the timer service cannot be started.
+ */
+int timer_arm(timer_entry_t *entry, uint64_t expiry_ns, timer_callback_t callback, void *arg);
+
+/**
+ * @brief Disarms a timer of the timer service.
+ * @param entry The timer.
+ * @return Returns 1 if the timer was pending, 0 if it already fired or is firing.
+ */
+int timer_disarm(timer_entry_t *entry);
+
+/**
+ * @brief Stops the timer service; pending timers stay armed and fire once it is started again.
+ */
+void timer_service_stop(void);
+
+/**
+ * @brief Returns the number of times the timer thread has woken up.
+ */
+uint64_t timer_service_wakeups(void);
+
+/**
+ * @brief Reads the monotonic clock in nanoseconds, the time base of `timer_arm` and the clock of every module.
+ * @note This function is async-signal-safe.
+ */
+uint64_t timer_now_ns(void);
+
+#endif /* TIMER_WHEEL_H */
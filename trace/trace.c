@@ -0,0 +1,313 @@
+/**
+ * @file trace.c
+ * @brief Implementation of the per-thread ring buffers of scheduling events and of their flush thread.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "trace.h"
+#include "../futex/futex.h"
+#include "../ring_registry/ring_registry.h"
+#include "../timer_wheel/timer_wheel.h"
+
+/**
+ * @brief Number of events written to the file with one `write`.
+ */
+#define TRACE_BATCH 256
+
+/**
+ * @brief Ring of one thread, drained by the flush thread; see `ring_registry.h` for the protocol.
+ */
+typedef struct {
+    ring_header_t header;                       /**< Positions, link and drop counter. */
+    uint32_t tid;                               /**< Kernel thread ID of the owner. */
+    _Alignas(64) trace_event_t events[TRACE_RING_SIZE];    /**< The events. */
+} trace_ring_t;
+
+/**
+ * @brief Non-zero while a trace is running; the fast path of `trace_record` reads nothing else.
+ */
+static _Atomic uint32_t trace_enabled = 0;
+
+/**
+ * @brief Rings of every thread that recorded.
+ */
+static ring_registry_t rings = RING_REGISTRY_INITIALIZER(trace_ring_t);
+
+/**
+ * @brief Ring of the calling thread.
+ */
+static __thread trace_ring_t *own_ring = NULL;
+
+/**
+ * @brief Number of signal handlers the calling thread is running; no ring is allocated while it is non-zero.
+ */
+static __thread uint32_t handler_depth = 0;
+
+/**
+ * @brief State of the running trace: the file, the flush thread, its interval and the header being built.
+ */
+static int trace_fd = -1;
+static pthread_t flush_thread;
+static _Atomic uint32_t flush_running = 0;
+static unsigned int flush_interval;
+static trace_file_header_t header;
+
+/**
+ * @brief Reads the time stamp counter, or the monotonic clock where there is none.
+ */
+static uint64_t trace_clock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return timer_now_ns();
+#endif
+}
+
+/**
+ * @brief Allocates the ring of the calling thread and adds it to the registry.
+ * @return Returns the ring, or `NULL` if it cannot be allocated.
+ */
+static trace_ring_t *create_ring(void)
+{
+    trace_ring_t *ring = (trace_ring_t *)ring_registry_attach(&rings);
+
+    if (ring != NULL)
+    {
+        ring->tid = (uint32_t)syscall(SYS_gettid);
+        own_ring = ring;
+    }
+    return ring;
+}
+
+/**
+ * @brief Copies the published events of a ring to the file.
+ * @param base The ring.
+ * @param context Unused.
+ */
+static void drain_ring(ring_header_t *base, void *context)
+{
+    trace_ring_t *ring = (trace_ring_t *)base;
+    trace_event_t batch[TRACE_BATCH];
+    uint64_t tail = atomic_load_explicit(&ring->header.tail, memory_order_relaxed);
+    size_t count;
+
+    (void) context;
+    do
+    {
+        count = 0;
+        while (count < TRACE_BATCH)
+        {
+            trace_event_t *event = &ring->events[(tail + count) & (TRACE_RING_SIZE - 1)];
+            if (__atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE) != tail + count + 1)
+            {
+                break;
+            }
+            batch[count++] = *event;
+        }
+        if (count != 0)
+        {
+            tail += count;
+            atomic_store_explicit(&ring->header.tail, tail, memory_order_release);
+            if (write(trace_fd, batch, count * sizeof(trace_event_t)) < 0)
+            {
+                perror("trace");
+            }
+        }
+    } while (count == TRACE_BATCH);
+
+    header.dropped += atomic_exchange_explicit(&ring->header.dropped, 0, memory_order_relaxed);
+}
+
+/**
+ * @brief Copies the published events of every ring to the file.
+ * @details Rings of exited threads are freed once they hold no event.
+ */
+static void drain_rings(void)
+{
+    ring_registry_drain(&rings, drain_ring, NULL);
+}
+
+/**
+ * @brief Body of the flush thread: drains the rings every interval until the trace stops.
+ */
+static void *flush_body(void *arg)
+{
+    struct timespec interval;
+
+    (void) arg;
+    interval.tv_sec = flush_interval / 1000;
+    interval.tv_nsec = (long)(flush_interval % 1000) * 1000000L;
+
+    while (atomic_load(&flush_running))
+    {
+        futex_wait(&flush_running, 1, &interval);
+        drain_rings();
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts tracing into a file.
+ * @param path The file to create.
+ * @param flush_interval_ms Interval between two drains of the rings; 0 selects `TRACE_DEFAULT_FLUSH_MS`.
+ * @return Returns 1 on success, 0 if a trace is already running or the file cannot be created.
+ * @details The header is written with the start clocks now and completed by `trace_stop`.
+ */
+int trace_start(const char *path, unsigned int flush_interval_ms)
+{
+    uint32_t idle = 0;
+
+    if (!atomic_compare_exchange_strong(&flush_running, &idle, 1))
+    {
+        return 0;
+    }
+
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd < 0)
+    {
+        perror("trace");
+        atomic_store(&flush_running, 0);
+        return 0;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.event_size = sizeof(trace_event_t);
+    header.start_ns = timer_now_ns();
+    header.start_tsc = trace_clock();
+    if (write(trace_fd, &header, sizeof(header)) != sizeof(header))
+    {
+        perror("trace");
+    }
+
+    flush_interval = flush_interval_ms != 0 ? flush_interval_ms : TRACE_DEFAULT_FLUSH_MS;
+    if (pthread_create(&flush_thread, NULL, flush_body, NULL) != 0)
+    {
+        close(trace_fd);
+        trace_fd = -1;
+        atomic_store(&flush_running, 0);
+        return 0;
+    }
+
+    atomic_store_explicit(&trace_enabled, 1, memory_order_release);
+    return 1;
+}
+
+/**
+ * @brief Stops tracing, drains the rings and completes the file.
+ * @details Events still being recorded by other threads at this point may be missing from the file.
+ */
+void trace_stop(void)
+{
+    uint32_t running = 1;
+
+    if (!atomic_compare_exchange_strong(&flush_running, &running, 0))
+    {
+        return;
+    }
+
+    atomic_store_explicit(&trace_enabled, 0, memory_order_release);
+    header.end_tsc = trace_clock();
+    header.end_ns = timer_now_ns();
+    futex_wake(&flush_running, 1);
+    pthread_join(flush_thread, NULL);
+    drain_rings();
+
+    if (pwrite(trace_fd, &header, sizeof(header), 0) != sizeof(header))
+    {
+        perror("trace");
+    }
+    close(trace_fd);
+    trace_fd = -1;
+}
+
+/**
+ * @brief Records an event of the calling thread.
+ * @param type The `trace_event_type_t` of the event.
+ * @param target The index of the control block the event is about.
+ * @param arg Event-specific argument.
+ * @details Costs one relaxed load when no trace is running. The event is dropped, and counted, if the ring is full.
+ *          A thread without a ring allocates it on its first event outside a signal handler; inside one the event is
+ *          dropped, so a handler interrupting the allocation never attaches a second ring.
+ * @note This function is async-signal-safe between `trace_handler_enter` and `trace_handler_leave`.
+ */
+void trace_record(uint16_t type, uint32_t target, uint32_t arg)
+{
+    trace_ring_t *ring = own_ring;
+    trace_event_t *event;
+    uint64_t position;
+
+    if (!atomic_load_explicit(&trace_enabled, memory_order_relaxed))
+    {
+        return;
+    }
+    if (ring == NULL && (handler_depth != 0 || (ring = create_ring()) == NULL))
+    {
+        return;
+    }
+
+    /* Reserve a position; a handler interrupting this thread reserves the next one */
+    if (!ring_registry_reserve(&ring->header, TRACE_RING_SIZE, &position, NULL))
+    {
+        return;
+    }
+
+    event = &ring->events[position & (TRACE_RING_SIZE - 1)];
+    event->tsc = trace_clock();
+    event->type = type;
+    event->reserved = 0;
+    event->tid = ring->tid;
+    event->target = target;
+    event->arg = arg;
+    __atomic_store_n(&event->sequence, position + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Gives the calling thread its ring ahead of its first event.
+ * @details Threads that record from signal handlers call this first, so their handler events are not dropped.
+ *          Does nothing when no trace is running; such a thread gets its ring on its first event outside a handler.
+ */
+void trace_register_thread(void)
+{
+    if (own_ring == NULL && atomic_load_explicit(&trace_enabled, memory_order_relaxed))
+    {
+        create_ring();
+    }
+}
+
+/**
+ * @brief Marks the calling thread as running a signal handler; until the matching `trace_handler_leave`, its events
+ *        are dropped instead of allocating a ring if it has none.
+ * @note This function is async-signal-safe.
+ */
+void trace_handler_enter(void)
+{
+    handler_depth++;
+    atomic_signal_fence(memory_order_seq_cst);
+}
+
+/**
+ * @brief Ends the handler started by the matching `trace_handler_enter`.
+ * @note This function is async-signal-safe.
+ */
+void trace_handler_leave(void)
+{
+    atomic_signal_fence(memory_order_seq_cst);
+    handler_depth--;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file trace.h
+ * @brief Header file for the binary trace of scheduling events and its file format.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details Every thread records into its own single-producer ring buffer with no lock and no system call, so tracing
+ *          does not reorder the events it observes. A background thread drains the rings into a file; the
+ *          `trace_convert` tool turns the file into Chrome trace JSON for `chrome://tracing` or Perfetto.
+ *          Build with `-DSCHED_TRACE=0` to compile every trace point out.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#ifndef SCHED_TRACE
+#define SCHED_TRACE 1  /**< Non-zero to compile the trace points in. */
+#endif
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 1024  /**< Events buffered per thread; a power of two. */
+#endif
+
+/**
+ * @brief Interval between two drains of the rings when `trace_start` is given 0.
+ */
+#define TRACE_DEFAULT_FLUSH_MS 100
+
+/**
+ * @brief Magic bytes at the start of a trace file.
+ */
+#define TRACE_MAGIC "SCHTRACE"
+
+/**
+ * @brief Version of the trace file format.
+ */
+#define TRACE_VERSION 1
+
+/**
+ * @brief Kind of a trace event.
+ * @details `target` is the index of the control block the event is about. Events that end in `_ACK` or `RESUMED`
+ *          are recorded by the target itself, the others by the thread that acted on it.
+ */
+typedef enum {
+    TRACE_THREAD_START = 1,     /**< The recording thread registered as `target`; `arg` is 1 for the main thread. */
+    TRACE_THREAD_EXIT,          /**< The recording thread, `target`, exits. */
+    TRACE_BODY_BEGIN,           /**< `target` starts a body. */
+    TRACE_BODY_END,             /**< `target` returned from its body. */
+    TRACE_STOP_REQUEST,         /**< A stop of `target` was sent; `arg` is 1 for a cooperative one. */
+    TRACE_STOP_ACK,             /**< `target` acknowledged a stop and suspends. */
+    TRACE_STOPPED,              /**< The stop of `target` completed; `arg` is 0 if the thread exited instead. */
+    TRACE_RESUME_REQUEST,       /**< A resume of `target` was sent. */
+    TRACE_RESUMED,              /**< `target` runs again. */
+    TRACE_TRANSITION_FAILED     /**< A stop (`arg` 1) or resume (`arg` 0) of `target` was refused. */
+} trace_event_type_t;
+
+/**
+ * @brief One event, as buffered in a ring and stored in a trace file.
+ */
+typedef struct {
+    uint64_t sequence;          /**< Position of the event in its ring plus one, once the event is complete. */
+    uint64_t tsc;               /**< Time stamp counter when the event was recorded. */
+    uint16_t type;              /**< `trace_event_type_t`. */
+    uint16_t reserved;          /**< Zero. */
+    uint32_t tid;               /**< Kernel thread ID of the recording thread. */
+    uint32_t target;            /**< Index of the control block the event is about. */
+    uint32_t arg;               /**< Event-specific argument. */
+} trace_event_t;
+
+/**
+ * @brief Header of a trace file, followed by the events of all threads in drain order.
+ * @details The two clock pairs let a reader convert time stamp counter values to nanoseconds.
+ */
+typedef struct {
+    char magic[8];              /**< `TRACE_MAGIC`. */
+    uint32_t version;           /**< `TRACE_VERSION`. */
+    uint32_t event_size;        /**< `sizeof(trace_event_t)`. */
+    uint64_t start_tsc;         /**< Time stamp counter when the trace started. */
+    uint64_t start_ns;          /**< Monotonic clock when the trace started. */
+    uint64_t end_tsc;           /**< Time stamp counter when the trace stopped. */
+    uint64_t end_ns;            /**< Monotonic clock when the trace stopped. */
+    uint64_t dropped;           /**< Events lost because a ring was full. */
+} trace_file_header_t;
+
+#if SCHED_TRACE
+/** @brief Records an event about a control block index if a trace is running. */
+#define TRACE_EVENT(type, target, arg) trace_record((type), (target), (arg))
+/** @brief Brackets a signal handler, whose events are dropped while the calling thread has no ring. */
+#define TRACE_HANDLER_ENTER() trace_handler_enter()
+#define TRACE_HANDLER_LEAVE() trace_handler_leave()
+#else
+#define TRACE_EVENT(type, target, arg) ((void)0)
+#define TRACE_HANDLER_ENTER() ((void)0)
+#define TRACE_HANDLER_LEAVE() ((void)0)
+#endif
+
+/**
+ * @brief Starts tracing into a file.
+ * @param path The file to create.
+ * @param flush_interval_ms Interval between two drains of the rings; 0 selects `TRACE_DEFAULT_FLUSH_MS`.
+ * @return Returns 1 on success, 0 if a trace is already running or the file cannot be created.
+ */
+int trace_start(const char *path, unsigned int flush_interval_ms);
+
+/**
+ * @brief Stops tracing, drains the rings and completes the file.
+ */
+void trace_stop(void);
+
+/**
+ * @brief Records an event of the calling thread.
+ * @param type The `trace_event_type_t` of the event.
+ * @param target The index of the control block the event is about.
+ * @param arg Event-specific argument.
+ * @note This function is async-signal-safe between `trace_handler_enter` and `trace_handler_leave`.
+ */
+void trace_record(uint16_t type, uint32_t target, uint32_t arg);
+
+/**
+ * @brief Gives the calling thread its ring ahead of its first event.
+ * @details Threads that record from signal handlers call this first, so their handler events are not dropped.
+ */
+void trace_register_thread(void);
+
+/**
+ * @brief Marks the calling thread as running a signal handler; until the matching `trace_handler_leave`, its events
+ *        are dropped instead of allocating a ring if it has none.
+ * @note This function is async-signal-safe.
+ */
+void trace_handler_enter(void);
+
+/**
+ * @brief Ends the handler started by the matching `trace_handler_enter`.
+ * @note This function is async-signal-safe.
+ */
+void trace_handler_leave(void);
+
+#endif /* TRACE_H */
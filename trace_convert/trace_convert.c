@@ -0,0 +1,326 @@
+/**
+ * @file trace_convert.c
+ * @brief Converts a binary scheduling trace to Chrome trace JSON.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details Usage: `trace_convert.out <trace file> [json file]`; the JSON goes to stdout without a second argument.
+ *          Open the result in `chrome://tracing` or https://ui.perfetto.dev. Every thread gets a track named after
+ *          its control block; a stopped thread shows a `stopped` slice from its acknowledgement until it runs again,
+ *          and an arrow leads from the controller's request to the slice, so it shows who stopped whom and when.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../trace/trace.h"
+
+/**
+ * @brief A trace loaded in memory.
+ */
+typedef struct {
+    trace_file_header_t header;     /**< Header of the file. */
+    trace_event_t *events;          /**< Events sorted by time stamp. */
+    size_t count;                   /**< Number of events. */
+    uint32_t max_target;            /**< Largest control block index seen. */
+    double ns_per_tick;             /**< Conversion from time stamp counter ticks to nanoseconds. */
+} trace_t;
+
+/**
+ * @brief Orders events by time stamp, then by thread and position in the thread's ring.
+ */
+static int compare_events(const void *a, const void *b)
+{
+    const trace_event_t *x = (const trace_event_t *)a;
+    const trace_event_t *y = (const trace_event_t *)b;
+
+    if (x->tsc != y->tsc)
+    {
+        return x->tsc < y->tsc ? -1 : 1;
+    }
+    if (x->tid != y->tid)
+    {
+        return x->tid < y->tid ? -1 : 1;
+    }
+    return (x->sequence > y->sequence) - (x->sequence < y->sequence);
+}
+
+/**
+ * @brief Reads a trace file.
+ * @param path The file.
+ * @param trace Receives the trace.
+ * @return Returns 1 on success, otherwise 0.
+ */
+static int load_trace(const char *path, trace_t *trace)
+{
+    FILE *file = fopen(path, "rb");
+    size_t capacity = 4096;
+
+    if (file == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+    if (fread(&trace->header, sizeof(trace->header), 1, file) != 1 ||
+        memcmp(trace->header.magic, TRACE_MAGIC, sizeof(trace->header.magic)) != 0 ||
+        trace->header.version != TRACE_VERSION || trace->header.event_size != sizeof(trace_event_t))
+    {
+        fprintf(stderr, "%s is not a trace of this version\n", path);
+        fclose(file);
+        return 0;
+    }
+
+    trace->count = 0;
+    trace->max_target = 0;
+    trace->events = (trace_event_t *)malloc(capacity * sizeof(trace_event_t));
+    while (trace->events != NULL && fread(&trace->events[trace->count], sizeof(trace_event_t), 1, file) == 1)
+    {
+        if (trace->events[trace->count].target > trace->max_target)
+        {
+            trace->max_target = trace->events[trace->count].target;
+        }
+        if (++trace->count == capacity)
+        {
+            trace_event_t *grown = (trace_event_t *)realloc(trace->events, 2 * capacity * sizeof(trace_event_t));
+            if (grown == NULL)
+            {
+                free(trace->events);
+            }
+            trace->events = grown;
+            capacity *= 2;
+        }
+    }
+    fclose(file);
+    if (trace->events == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 0;
+    }
+
+    /* A trace that was not stopped has no end clocks: assume the counter ticks in nanoseconds */
+    trace->ns_per_tick = 1.0;
+    if (trace->header.end_tsc > trace->header.start_tsc && trace->header.end_ns > trace->header.start_ns)
+    {
+        trace->ns_per_tick = (double)(trace->header.end_ns - trace->header.start_ns) /
+                             (double)(trace->header.end_tsc - trace->header.start_tsc);
+    }
+
+    qsort(trace->events, trace->count, sizeof(trace_event_t), compare_events);
+    return 1;
+}
+
+/**
+ * @brief Converts a time stamp counter value to microseconds since the start of the trace.
+ */
+static double timestamp_us(const trace_t *trace, uint64_t tsc)
+{
+    return (double)(int64_t)(tsc - trace->header.start_tsc) * trace->ns_per_tick / 1000.0;
+}
+
+/**
+ * @brief Starts a JSON event with the fields every event has.
+ */
+static void begin_event(FILE *out, int *first, const char *phase, const char *name, uint32_t tid, double ts)
+{
+    fprintf(out, "%s\n{\"ph\": \"%s\", \"name\": \"%s\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f", *first ? "" : ",",
+            phase, name, tid, ts);
+    *first = 0;
+}
+
+/**
+ * @brief Tells whether an event is recorded by the thread it is about.
+ */
+static int is_own_event(uint16_t type)
+{
+    return type == TRACE_THREAD_START || type == TRACE_THREAD_EXIT || type == TRACE_BODY_BEGIN ||
+           type == TRACE_BODY_END || type == TRACE_STOP_ACK || type == TRACE_RESUMED;
+}
+
+/* Events indexed by the entries `compare_by_thread` sorts */
+static const trace_event_t *sorted_events;
+
+/**
+ * @brief Orders event indices by the thread that recorded them, then by time.
+ */
+static int compare_by_thread(const void *a, const void *b)
+{
+    size_t x = *(const size_t *)a;
+    size_t y = *(const size_t *)b;
+
+    if (sorted_events[x].tid != sorted_events[y].tid)
+    {
+        return sorted_events[x].tid < sorted_events[y].tid ? -1 : 1;
+    }
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Names the track of every thread after its control block.
+ * @return Returns 1 on success, 0 if out of memory.
+ * @details Threads that started before the trace have no start event, so the first event a thread recorded about
+ *          itself identifies it. Threads that never did, such as controllers, keep the default name of their thread ID.
+ */
+static int write_thread_names(const trace_t *trace, FILE *out, int *first)
+{
+    size_t *own = (size_t *)malloc((trace->count + 1) * sizeof(size_t));
+    size_t own_count = 0;
+
+    if (own == NULL)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < trace->count; i++)
+    {
+        if (is_own_event(trace->events[i].type))
+        {
+            own[own_count++] = i;
+        }
+    }
+    sorted_events = trace->events;
+    qsort(own, own_count, sizeof(size_t), compare_by_thread);
+
+    for (size_t i = 0; i < own_count; i++)
+    {
+        const trace_event_t *event = &trace->events[own[i]];
+        char name[32];
+
+        if (i > 0 && trace->events[own[i - 1]].tid == event->tid)
+        {
+            continue;
+        }
+        snprintf(name, sizeof(name), event->type == TRACE_THREAD_START && event->arg ? "main" : "thread[%u]",
+                 event->target);
+        begin_event(out, first, "M", "thread_name", event->tid, 0.0);
+        fprintf(out, ", \"args\": {\"name\": \"%s\"}}", name);
+    }
+
+    free(own);
+    return 1;
+}
+
+/**
+ * @brief Writes a trace as Chrome trace JSON.
+ * @param trace The trace.
+ * @param out The stream to write to.
+ * @return Returns 1 on success, otherwise 0.
+ * @details Requests and completions are instant events on the controller's track, acknowledgements and resumes
+ *          open and close slices on the target's track, and flow events connect each request to its target.
+ */
+static int write_json(const trace_t *trace, FILE *out)
+{
+    uint64_t *pending_flow = (uint64_t *)calloc((size_t)trace->max_target + 1, sizeof(uint64_t));
+    uint64_t next_flow = 1;
+    int first = 1;
+
+    if (pending_flow == NULL)
+    {
+        return 0;
+    }
+
+    fprintf(out, "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped\": %llu}, \"traceEvents\": [",
+            (unsigned long long)trace->header.dropped);
+    if (!write_thread_names(trace, out, &first))
+    {
+        free(pending_flow);
+        return 0;
+    }
+
+    for (size_t i = 0; i < trace->count; i++)
+    {
+        const trace_event_t *event = &trace->events[i];
+        double ts = timestamp_us(trace, event->tsc);
+        char name[32];
+
+        switch (event->type)
+        {
+        case TRACE_THREAD_EXIT:
+            begin_event(out, &first, "i", "exit", event->tid, ts);
+            fprintf(out, ", \"s\": \"t\"}");
+            break;
+
+        case TRACE_BODY_BEGIN:
+        case TRACE_BODY_END:
+            begin_event(out, &first, event->type == TRACE_BODY_BEGIN ? "B" : "E", "body", event->tid, ts);
+            fprintf(out, "}");
+            break;
+
+        case TRACE_STOP_REQUEST:
+        case TRACE_RESUME_REQUEST:
+            snprintf(name, sizeof(name), "%s thread[%u]", event->type == TRACE_STOP_REQUEST ? "stop" : "resume",
+                     event->target);
+            begin_event(out, &first, "i", name, event->tid, ts);
+            fprintf(out, ", \"s\": \"t\", \"args\": {\"cooperative\": %u}}", event->arg);
+            pending_flow[event->target] = next_flow;
+            begin_event(out, &first, "s", event->type == TRACE_STOP_REQUEST ? "stop" : "resume", event->tid, ts);
+            fprintf(out, ", \"cat\": \"request\", \"id\": %llu}", (unsigned long long)next_flow++);
+            break;
+
+        case TRACE_STOP_ACK:
+        case TRACE_RESUMED:
+            if (pending_flow[event->target] != 0)
+            {
+                begin_event(out, &first, "f", event->type == TRACE_STOP_ACK ? "stop" : "resume", event->tid, ts);
+                fprintf(out, ", \"cat\": \"request\", \"bp\": \"e\", \"id\": %llu}",
+                        (unsigned long long)pending_flow[event->target]);
+                pending_flow[event->target] = 0;
+            }
+            begin_event(out, &first, event->type == TRACE_STOP_ACK ? "B" : "E", "stopped", event->tid, ts);
+            fprintf(out, "}");
+            break;
+
+        case TRACE_STOPPED:
+            snprintf(name, sizeof(name), event->arg ? "stopped thread[%u]" : "thread[%u] exited", event->target);
+            begin_event(out, &first, "i", name, event->tid, ts);
+            fprintf(out, ", \"s\": \"t\"}");
+            break;
+
+        case TRACE_TRANSITION_FAILED:
+            snprintf(name, sizeof(name), "%s thread[%u] refused", event->arg ? "stop" : "resume", event->target);
+            begin_event(out, &first, "i", name, event->tid, ts);
+            fprintf(out, ", \"s\": \"t\"}");
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+    free(pending_flow);
+    return ferror(out) == 0;
+}
+
+/**
+ * @brief Entry point of the converter.
+ * @return Returns 0 on success.
+ */
+int main(int argc, char *argv[])
+{
+    trace_t trace;
+    FILE *out = stdout;
+    int status;
+
+    if (argc < 2)
+    {
+        printf("Usage: %s <trace file> [json file]\n", argv[0]);
+        return 1;
+    }
+    if (!load_trace(argv[1], &trace))
+    {
+        return 1;
+    }
+    if (argc > 2 && (out = fopen(argv[2], "w")) == NULL)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    status = write_json(&trace, out);
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    free(trace.events);
+    fprintf(stderr, "%zu events, %llu dropped\n", trace.count, (unsigned long long)trace.header.dropped);
+
+    return status ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file user_context.c
+ * @brief Implementation of user-space execution contexts and the switch between them.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+/*******************************************************************
+ * Includes
+ *******************************************************************/
+#include <stdint.h>
+#include <stdlib.h>
+#include "user_context.h"
+
+#ifndef USE_UCONTEXT
+
+/*******************************************************************
+ * x86-64 Context Switch
+ *******************************************************************/
+
+/**
+ * @brief Saves the callee-saved state on the current stack, stores the stack pointer in `*save` and
+ *        continues from the stack pointer `load`. Implemented in assembly below.
+ */
+void user_context_swap(void **save, void *load);
+
+/**
+ * @brief First code run by a new context: calls `entry(arg)` with `entry` in r13 and `arg` in r12.
+ */
+void user_context_trampoline(void);
+
+__asm__(
+    ".text\n"
+    ".globl user_context_swap\n"
+    ".type user_context_swap, @function\n"
+    "user_context_swap:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size user_context_swap, .-user_context_swap\n"
+    ".globl user_context_trampoline\n"
+    ".type user_context_trampoline, @function\n"
+    "user_context_trampoline:\n"
+    "    movq %r12, %rdi\n"
+    "    callq *%r13\n"
+    "    ud2\n"
+    ".size user_context_trampoline, .-user_context_trampoline\n"
+);
+
+/**
+ * @brief Prepares a context that starts running `entry(arg)` on the given stack when switched to.
+ * @param context The context to prepare.
+ * @param stack Lowest address of the stack.
+ * @param stack_size Size of the stack in bytes.
+ * @param entry Function run by the context. It must never return.
+ * @param arg Argument of `entry`.
+ * @details Builds the frame `user_context_swap` pops: control words, r15..r12, rbx, rbp and the return address,
+ *          which points at the trampoline. The trampoline starts with a 16-byte aligned stack, as the ABI requires
+ *          before a call.
+ */
+void user_context_init(user_context_t *context, void *stack, size_t stack_size, user_context_entry_t entry, void *arg)
+{
+    uintptr_t top = ((uintptr_t)stack + stack_size) & ~(uintptr_t)15;
+    uint64_t *frame = (uint64_t *)(top - 64);
+
+    frame[0] = 0x1F80 | ((uint64_t)0x037F << 32);  /* Default MXCSR and x87 control word */
+    frame[1] = 0;                                   /* r15 */
+    frame[2] = 0;                                   /* r14 */
+    frame[3] = (uint64_t)(uintptr_t)entry;          /* r13 */
+    frame[4] = (uint64_t)(uintptr_t)arg;            /* r12 */
+    frame[5] = 0;                                   /* rbx */
+    frame[6] = 0;                                   /* rbp */
+    frame[7] = (uint64_t)(uintptr_t)user_context_trampoline;
+
+    context->stack_pointer = frame;
+}
+
+/**
+ * @brief Saves the running context into `from` and continues `to`.
+ * @param from Receives the current context.
+ * @param to The context to continue.
+ */
+void user_context_switch(user_context_t *from, user_context_t *to)
+{
+    user_context_swap(&from->stack_pointer, to->stack_pointer);
+}
+
+#else
+
+/*******************************************************************
+ * Portable Context Switch
+ *******************************************************************/
+
+/**
+ * @brief First function run by a new context; makecontext only passes int arguments, so the pointer is split.
+ */
+static void user_context_start(unsigned int high, unsigned int low)
+{
+    user_context_t *context = (user_context_t *)(((uintptr_t)high << 32) | (uintptr_t)low);
+    context->entry(context->arg);
+    abort();  /* Entries must never return */
+}
+
+/**
+ * @brief Prepares a context that starts running `entry(arg)` on the given stack when switched to.
+ * @param context The context to prepare.
+ * @param stack Lowest address of the stack.
+ * @param stack_size Size of the stack in bytes.
+ * @param entry Function run by the context. It must never return.
+ * @param arg Argument of `entry`.
+ */
+void user_context_init(user_context_t *context, void *stack, size_t stack_size, user_context_entry_t entry, void *arg)
+{
+    uintptr_t address = (uintptr_t)context;
+
+    getcontext(&context->context);
+    context->context.uc_stack.ss_sp = stack;
+    context->context.uc_stack.ss_size = stack_size;
+    context->context.uc_link = NULL;
+    context->entry = entry;
+    context->arg = arg;
+    makecontext(&context->context, (void (*)(void))user_context_start, 2,
+                (unsigned int)((uint64_t)address >> 32), (unsigned int)address);
+}
+
+/**
+ * @brief Saves the running context into `from` and continues `to`.
+ * @param from Receives the current context.
+ * @param to The context to continue.
+ */
+void user_context_switch(user_context_t *from, user_context_t *to)
+{
+    swapcontext(&from->context, &to->context);
+}
+
+#endif /* USE_UCONTEXT */
@@ -0,0 +1,62 @@
+/**
+ * @file user_context.h
+ * @brief Header file for user-space execution contexts and the switch between them.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#ifndef USER_CONTEXT_H
+#define USER_CONTEXT_H
+
+#include <stddef.h>
+
+#if !defined(__x86_64__) && !defined(USE_UCONTEXT)
+#define USE_UCONTEXT  /**< Only x86-64 has a hand-written switch; other targets use swapcontext. */
+#endif
+
+#ifdef USE_UCONTEXT
+#include <ucontext.h>
+#endif
+
+/**
+ * @brief Function run by a new context.
+ * @param arg The argument given to `user_context_init`.
+ */
+typedef void (*user_context_entry_t)(void *arg);
+
+/**
+ * @brief Saved execution context.
+ * @details On x86-64 only the stack pointer is stored: the callee-saved registers, MXCSR and the x87 control word
+ *          are pushed on the context's own stack by `user_context_switch`, which keeps a switch to a few dozen
+ *          instructions and out of the kernel. With `USE_UCONTEXT` the context is a `ucontext_t`, whose switch
+ *          also saves the signal mask with a syscall.
+ */
+typedef struct {
+#ifdef USE_UCONTEXT
+    ucontext_t context;             /**< Context saved by swapcontext. */
+    user_context_entry_t entry;     /**< Function run by the context. */
+    void *arg;                      /**< Argument of `entry`. */
+#else
+    void *stack_pointer;            /**< Stack pointer saved by the switch. */
+#endif
+} user_context_t;
+
+/**
+ * @brief Prepares a context that starts running `entry(arg)` on the given stack when switched to.
+ * @param context The context to prepare.
+ * @param stack Lowest address of the stack.
+ * @param stack_size Size of the stack in bytes.
+ * @param entry Function run by the context. It must never return; switch away for the last time instead.
+ * @param arg Argument of `entry`.
+ */
+void user_context_init(user_context_t *context, void *stack, size_t stack_size, user_context_entry_t entry, void *arg);
+
+/**
+ * @brief Saves the running context into `from` and continues `to`.
+ * @param from Receives the current context.
+ * @param to The context to continue.
+ * @details Returns when another switch continues `from`.
+ */
+void user_context_switch(user_context_t *from, user_context_t *to);
+
+#endif /* USER_CONTEXT_H */
@@ -0,0 +1,114 @@
+/**
+ * @file work_stealing_deque.c
+ * @brief Implementation of a bounded Chase-Lev work-stealing deque.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ * @details Follows the C11 formulation of Le, Pop, Cohen and Zappa Nardelli, "Correct and Efficient Work-Stealing
+ *          for Weak Memory Models" (PPoPP 2013), restricted to a fixed-size buffer.
+ */
+
+#include <stdlib.h>
+#include "work_stealing_deque.h"
+
+/**
+ * @brief Initializes a deque.
+ * @param deque The deque to initialize.
+ * @param capacity Minimum number of elements; rounded up to a power of two.
+ * @return Returns 1 on success, 0 on failure.
+ */
+int ws_deque_init(ws_deque_t *deque, size_t capacity)
+{
+    size_t size = 2;
+
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    deque->buffer = (_Atomic(void *) *)calloc(size, sizeof(*deque->buffer));
+    if (deque->buffer == NULL)
+    {
+        return 0;
+    }
+    deque->mask = (int64_t)size - 1;
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+
+    return 1;
+}
+
+/**
+ * @brief Releases the storage of a deque.
+ * @param deque The deque to destroy.
+ */
+void ws_deque_destroy(ws_deque_t *deque)
+{
+    free((void *)deque->buffer);
+    deque->buffer = NULL;
+}
+
+/**
+ * @brief Pushes an element at the bottom. Owner only.
+ * @param deque The deque.
+ * @param data The element.
+ * @return Returns 1 on success, 0 if the deque is full.
+ * @details The release fence publishes the slot before the new bottom becomes visible to consumers.
+ */
+int ws_deque_push(ws_deque_t *deque, void *data)
+{
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+    if (bottom - top > deque->mask)
+    {
+        return 0;
+    }
+
+    atomic_store_explicit(&deque->buffer[bottom & deque->mask], data, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+
+    return 1;
+}
+
+/**
+ * @brief Takes the oldest element from the top. Any thread.
+ * @param deque The deque.
+ * @param data Receives the element.
+ * @return Returns `WS_DEQUE_TAKEN`, `WS_DEQUE_EMPTY` or `WS_DEQUE_LOST`.
+ * @details The element is read before the CAS on `top`; if the CAS fails the value is discarded, so a slot
+ *          reused by the owner in the meantime is never returned.
+ */
+int ws_deque_steal(ws_deque_t *deque, void **data)
+{
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return WS_DEQUE_EMPTY;
+    }
+
+    *data = atomic_load_explicit(&deque->buffer[top & deque->mask], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed))
+    {
+        return WS_DEQUE_LOST;
+    }
+
+    return WS_DEQUE_TAKEN;
+}
+
+/**
+ * @brief Returns an estimate of the number of elements.
+ * @param deque The deque.
+ * @return Returns the number of elements at the time of the call.
+ */
+size_t ws_deque_size(ws_deque_t *deque)
+{
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    return bottom > top ? (size_t)(bottom - top) : 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file work_stealing_deque.h
+ * @brief Header file for a bounded Chase-Lev work-stealing deque.
+ * @author Mohamed Ezzat
+ * @date 2026-10-16
+ */
+
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define WS_DEQUE_EMPTY 0    /**< The deque was empty. */
+#define WS_DEQUE_TAKEN 1    /**< An element was taken. */
+#define WS_DEQUE_LOST -1    /**< Another consumer took the element first; retry or move on. */
+
+/**
+ * @brief Bounded Chase-Lev deque of pointers.
+ * @details Only the owner pushes at the bottom. Consumers, thieves and the owner alike, take from the top, so the
+ *          owner sees its own elements in FIFO order (the "async" mode of a work-stealing pool) and a yielded task
+ *          does not starve the others. `top` and `bottom` live on separate cache lines.
+ */
+typedef struct {
+    _Atomic(void *) *buffer;                /**< Ring of `mask + 1` slots. */
+    int64_t mask;                           /**< Capacity minus one; capacity is a power of two. */
+    _Alignas(64) _Atomic int64_t top;       /**< Index of the oldest element; advanced by consumers with a CAS. */
+    _Alignas(64) _Atomic int64_t bottom;    /**< Index one past the newest element; written by the owner only. */
+} ws_deque_t;
+
+/**
+ * @brief Initializes a deque.
+ * @param deque The deque to initialize.
+ * @param capacity Minimum number of elements; rounded up to a power of two.
+ * @return Returns 1 on success, 0 on failure.
+ */
+int ws_deque_init(ws_deque_t *deque, size_t capacity);
+
+/**
+ * @brief Releases the storage of a deque.
+ * @param deque The deque to destroy.
+ */
+void ws_deque_destroy(ws_deque_t *deque);
+
+/**
+ * @brief Pushes an element at the bottom. Owner only.
+ * @param deque The deque.
+ * @param data The element.
+ * @return Returns 1 on success, 0 if the deque is full.
+ */
+int ws_deque_push(ws_deque_t *deque, void *data);
+
+/**
+ * @brief Takes the oldest element from the top. Any thread.
+ * @param deque The deque.
+ * @param data Receives the element.
+ * @return Returns `WS_DEQUE_TAKEN`, `WS_DEQUE_EMPTY` or `WS_DEQUE_LOST`.
+ */
+int ws_deque_steal(ws_deque_t *deque, void **data);
+
+/**
+ * @brief Returns an estimate of the number of elements.
+ * @param deque The deque.
+ * @return Returns the number of elements at the time of the call.
+ */
+size_t ws_deque_size(ws_deque_t *deque);
+
+#endif /* WORK_STEALING_DEQUE_H */